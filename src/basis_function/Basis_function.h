@@ -107,6 +107,13 @@ public:
   */
   virtual doublevar cutoff(int )=0;
 
+  /*!
+    \brief
+    Whether every function depends only on r, so that it can be
+    tabulated as a function of distance.
+  */
+  virtual int isRadial() { return 0; }
+
   /*!
     \brief
     Show some summary information for the output file.  Return
@@ -106,10 +106,21 @@ int Blochwave_function::read(
     }
     bn_total+=bmax[kn];
   }
+  phases.setup(g_vector);
   // cout << "reading done " << endl;
   return 0;  
 }
 
+void Blochwave_function::calcPhases(const Array1 <doublevar> & r,
+                                    Array1 <dcomplex> & eigr) { 
+  static QMC_THREAD_LOCAL Array1 <doublevar> t_re, t_im;
+  t_re.Resize(nmax);
+  t_im.Resize(nmax);
+  eigr.Resize(nmax);
+  phases.calc(r, t_re.v, t_im.v);
+  for(int i=0; i< nmax; i++) eigr(i)=dcomplex(t_re(i),t_im(i));
+}
+
 
 void Blochwave_function::getVarParms(Array1 <doublevar> & parms) {
   //cout << "getVarParms " << endl;
@@ -171,16 +182,21 @@ void Blochwave_function::calcVal(const Array1 <doublevar> & r,
   assert(symvals.GetDim(0) >= bn_total+startfill);
   int index=startfill;
   symvals=dcomplex(0.0,0.0);
-  for(int kn=0; kn< kmax; kn++)
+  //exp(i(G+k)r)=exp(ikr)exp(iGr), and exp(iGr) is the same for all k.
+  static QMC_THREAD_LOCAL Array1 <dcomplex> eigr;
+  calcPhases(r,eigr);
+  for(int kn=0; kn< kmax; kn++) {
+    doublevar kdotr=0.0;
+    for(int d=0; d< 3; d++) kdotr+=k_vector(kn,d)*r(d+2);
+    dcomplex eikr=exp(I*kdotr);
     for(int bn=0; bn< bmax[kn]; bn++) {
-      for(int i=0; i< nmax; i++) {
-        doublevar gdotr=0.0;
-        for(int d=0; d< 3; d++)
-          gdotr+=( g_vector(i,d)+k_vector(kn,d) )*r(d+2);
-        symvals(index)+=ckg(kn,bn,i)*exp(I*gdotr);
-      }
+      dcomplex sum=0.0;
+      for(int i=0; i< nmax; i++) 
+        sum+=ckg(kn,bn,i)*eigr(i);
+      symvals(index)+=eikr*sum;
       index++;
-   }
+    }
+  }
   //cout << "done" << endl;
 }
 
@@ -196,29 +212,41 @@ void Blochwave_function::calcLap(
   assert(symvals.GetDim(1) >= 5);
 
   int index=startfill;
-  dcomplex t_exp;
   symvals=dcomplex(0.,0.);  
-  for(int kn=0; kn< kmax; kn++)
+  //With S0=sum c exp(iGr), Sg=sum c G exp(iGr) and Sgg=sum c G^2 exp(iGr),
+  //the value is exp(ikr) S0, the gradient i exp(ikr) (Sg+k S0), and 
+  //the Laplacian -exp(ikr) (Sgg+2k.Sg+k^2 S0).
+  static QMC_THREAD_LOCAL Array1 <dcomplex> eigr;
+  calcPhases(r,eigr);
+  for(int kn=0; kn< kmax; kn++) {
+    doublevar kdotr=0.0, ksquared=0.0;
+    for(int d=0; d< 3; d++) {
+      kdotr+=k_vector(kn,d)*r(2+d);
+      ksquared+=k_vector(kn,d)*k_vector(kn,d);
+    }
+    dcomplex eikr=exp(I*kdotr);
     for(int bn=0; bn< bmax[kn]; bn++) {
+      dcomplex s0=0.0, sgg=0.0, sg[3]={0.0,0.0,0.0};
       for(int fn=0; fn< nmax; fn++) {
-        doublevar gdotr=0.0;
-        doublevar gsquared=0.0;
-        for(int d=0; d< 3; d++) {
-          gdotr+=( g_vector(fn,d)+k_vector(kn,d) )*r(2+d);
-          //Should probably store this one...
-          gsquared+=(g_vector(fn,d)+k_vector(kn,d))*(g_vector(fn,d)+k_vector(kn,d));
-        }
-        t_exp=exp(I*gdotr);
-	//t_exp=dcomplex(1.0,0.0);
-        symvals(index,0)+=ckg(kn,bn,fn)*t_exp;
-        for(int i=1; i< 4; i++) {
-          symvals(index,i)+=ckg(kn,bn,fn)*I*(g_vector(fn, i-1)+k_vector(kn, i-1))*t_exp;
-        }
-        symvals(index,4)+=-ckg(kn,bn,fn)*gsquared*t_exp;
+        dcomplex t=ckg(kn,bn,fn)*eigr(fn);
+        doublevar gx=g_vector(fn,0), gy=g_vector(fn,1), gz=g_vector(fn,2);
+        s0+=t;
+        sg[0]+=gx*t;
+        sg[1]+=gy*t;
+        sg[2]+=gz*t;
+        sgg+=(gx*gx+gy*gy+gz*gz)*t;
+      }
+      symvals(index,0)+=eikr*s0;
+      dcomplex kdotsg=0.0;
+      for(int i=1; i< 4; i++) {
+        symvals(index,i)+=I*eikr*(sg[i-1]+k_vector(kn,i-1)*s0);
+        kdotsg+=k_vector(kn,i-1)*sg[i-1];
       }
+      symvals(index,4)+=-eikr*(sgg+2.0*kdotsg+ksquared*s0);
       // cout << index << symvals(index,0) << " Ck(0) " << ckg(kn,bn,0) << endl;
       index++;
     }
+  }
   //cout << "done" << endl;
 }
 
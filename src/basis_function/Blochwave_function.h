@@ -22,6 +22,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define BLOCHWAVE_FUNCTION_H_INCLUDED
 
 #include "Basis_function.h"
+#include "Planewave_phases.h"
 
 /*!
 
@@ -98,6 +99,8 @@ private:
   int bn_total; // total number of Bloch waves
   vector <int>  bmax; // number of bands for all k points
   string centername;
+  Planewave_phases phases; // exp(iGr), shared by all k points and bands
+  void calcPhases(const Array1 <doublevar> & r, Array1 <dcomplex> & eigr);
 };
 
 #endif // BLOCHWAVE_FUNCTION_H_INCLUDED
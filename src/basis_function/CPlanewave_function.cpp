@@ -21,6 +21,9 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "CPlanewave_function.h"
 #include "qmc_io.h"
 
+QMC_THREAD_LOCAL Array1 <doublevar> CPlanewave_function::t_re;
+QMC_THREAD_LOCAL Array1 <doublevar> CPlanewave_function::t_im;
+
 /*!
    Note:  We may need to change this to read directly from a file, for memory
    constraints..
@@ -53,6 +56,7 @@ int CPlanewave_function::read(
       counter++;
     }
   }
+  phases.setup(g_vector);
   //cout << "done " << endl;
   return 0;
 }
@@ -98,15 +102,17 @@ void CPlanewave_function::calcVal(const Array1 <doublevar> & r,
                                  Array1 <dcomplex> & symvals,
                                  const int startfill)
 {
-  const dcomplex I(0.0,1.0);
   //cout << "calcVal " << endl;
   assert(r.GetDim(0) >= 5);
   assert(symvals.GetDim(0) >= nmax+startfill);
   int index=startfill;
-  doublevar gdotr;
+  Array1 <doublevar> & t_re(CPlanewave_function::t_re);
+  Array1 <doublevar> & t_im(CPlanewave_function::t_im);
+  t_re.Resize(nmax);
+  t_im.Resize(nmax);
+  phases.calc(r, t_re.v, t_im.v);
   for(int i=0; i< nmax; i++) {
-    gdotr=g_vector(i,0)*r(2)+g_vector(i,1)*r(3)+g_vector(i,2)*r(4);
-    symvals(index++)=exp(I*gdotr);
+    symvals(index++)=dcomplex(t_re(i),t_im(i));
   }
   //cout << "done" << endl;
 }
@@ -124,12 +130,15 @@ void CPlanewave_function::calcLap(
   assert(symvals.GetDim(1) >= 5);
 
   int index=startfill;
-  doublevar gdotr;
   doublevar gsquared;
   dcomplex t_exp;
+  Array1 <doublevar> & t_re(CPlanewave_function::t_re);
+  Array1 <doublevar> & t_im(CPlanewave_function::t_im);
+  t_re.Resize(nmax);
+  t_im.Resize(nmax);
+  phases.calc(r, t_re.v, t_im.v);
   for(int fn=0; fn< nmax; fn++) {
-    gdotr=g_vector(fn,0)*r(2)+g_vector(fn,1)*r(3)+g_vector(fn,2)*r(4);
-    t_exp=exp(I*gdotr);
+    t_exp=dcomplex(t_re(fn),t_im(fn));
 
     //Should probably store this one..
     gsquared=g_vector(fn,0)*g_vector(fn,0)
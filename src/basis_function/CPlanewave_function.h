@@ -22,6 +22,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define CPLANEWAVE_FUNCTION_H_INCLUDED
 
 #include "Basis_function.h"
+#include "Planewave_phases.h"
 
 /*!
 
@@ -93,6 +94,8 @@ private:
   Array2 <doublevar> g_vector;
   int nmax;
   string centername;
+  Planewave_phases phases;
+  static QMC_THREAD_LOCAL Array1 <doublevar> t_re, t_im; //!< per-thread scratch for exp(igr)
 };
 
 #endif // CPLANEWAVE_FUNCTION_H_INCLUDED
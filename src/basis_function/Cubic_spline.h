@@ -107,6 +107,33 @@ private:
 
   void findCutoffs();
 
+  //Evaluation tables.  The radial coefficients of all splines are
+  //stored interval-major, so that one interval lookup serves every
+  //spline and the inner loop runs over splines with unit stride.
+  //The angular part of each function is a homogeneous polynomial of
+  //degree l, stored as its nonzero terms in the Cartesian monomials of 
+  //that degree; the monomials and their derivatives are computed once 
+  //per evaluation and shared by all functions.
+  int soa_radial; //!< whether all splines share a grid, so soa_coeff is valid
+  doublevar soa_spacing, soa_invspacing;
+  Array3 <doublevar> soa_coeff; //!< (interval, power, spline)
+  int maxl; //!< highest angular momentum on this center
+  Array1 <int> monostart; //!< first monomial of degree l
+  Array1 <int> nmono; //!< number of monomials of degree l
+  Array2 <int> mono_pow; //!< (monomial, [a,b,c]) for x^a y^b z^c
+  Array1 <int> spline_l; //!< angular momentum of each spline
+  Array1 <int> spline_nterm; //!< angular terms per function of each spline
+  Array1 <int> term_start; //!< first angular term of each spline
+  Array1 <doublevar> term_coeff; //!< coefficient of each angular term
+  Array1 <int> term_mono; //!< monomial of each angular term
+
+  void buildEvaluationTables();
+  void angularPolynomial(indiv_symm_type s, string & poly);
+  void evalRadial(doublevar r, int derivatives, doublevar * val,
+                  doublevar * d1, doublevar * d2);
+  void evalMonomials(const Array1 <doublevar> & r, int derivatives, 
+                     Array2 <doublevar> & mono_val);
+
   /*!
     Read the spline fit points.  
   */
@@ -379,7 +379,195 @@ void Cubic_spline::findCutoffs()
   for(int i=0; i< nsplines; i++) { 
     splines(i).pad(threshold);
   }
+  buildEvaluationTables();
 }
+
+//-------------------------------------------------------
+
+/*!
+The angular part of each function as a sum of Cartesian monomials,
+written as coefficient:letters, so "3:xxy" is 3x^2y.
+*/
+void Cubic_spline::angularPolynomial(indiv_symm_type s, string & poly) {
+  switch(s) {
+  case isym_S: poly="1:"; break;
+  case isym_Px: poly="1:x"; break;
+  case isym_Py: poly="1:y"; break;
+  case isym_Pz: poly="1:z"; break;
+  case isym_Dxx: poly="1:xx"; break;
+  case isym_Dyy: poly="1:yy"; break;
+  case isym_Dzz: poly="1:zz"; break;
+  case isym_Dxy: poly="1:xy"; break;
+  case isym_Dxz: poly="1:xz"; break;
+  case isym_Dyz: poly="1:yz"; break;
+  case isym_Dz2r2: poly="2:zz -1:xx -1:yy"; break;
+  case isym_Dx2y2: poly="1:xx -1:yy"; break;
+  case isym_Fxxx: poly="1:xxx"; break;
+  case isym_Fyyy: poly="1:yyy"; break;
+  case isym_Fzzz: poly="1:zzz"; break;
+  case isym_Fxxy: poly="1:xxy"; break;
+  case isym_Fxxz: poly="1:xxz"; break;
+  case isym_Fyyx: poly="1:yyx"; break;
+  case isym_Fyyz: poly="1:yyz"; break;
+  case isym_Fzzx: poly="1:zzx"; break;
+  case isym_Fzzy: poly="1:zzy"; break;
+  case isym_Fxyz: poly="1:xyz"; break;
+  case isym_Fm3: poly="3:xxy -1:yyy"; break;
+  case isym_Fm1: poly="4:yzz -1:xxy -1:yyy"; break;
+  case isym_F0: poly="2:zzz -3:xxz -3:yyz"; break;
+  case isym_Fp1: poly="4:xzz -1:xxx -1:xyy"; break;
+  case isym_Fp2: poly="1:xxz -1:yyz"; break;
+  case isym_Fp3: poly="1:xxx 1:xyy"; break;
+  case isym_Fp3mod: poly="1:xxx -3:xyy"; break;
+  case isym_Gxxxx: poly="1:xxxx"; break;
+  case isym_Gyyyy: poly="1:yyyy"; break;
+  case isym_Gzzzz: poly="1:zzzz"; break;
+  case isym_Gxxxy: poly="1:xxxy"; break;
+  case isym_Gxxxz: poly="1:xxxz"; break;
+  case isym_Gyyyx: poly="1:yyyx"; break;
+  case isym_Gyyyz: poly="1:yyyz"; break;
+  case isym_Gzzzx: poly="1:zzzx"; break;
+  case isym_Gzzzy: poly="1:zzzy"; break;
+  case isym_Gxxyy: poly="1:xxyy"; break;
+  case isym_Gxxzz: poly="1:xxzz"; break;
+  case isym_Gyyzz: poly="1:yyzz"; break;
+  case isym_Gxxyz: poly="1:xxyz"; break;
+  case isym_Gyyxz: poly="1:yyxz"; break;
+  case isym_Gzzxy: poly="1:zzxy"; break;
+  //35z^4-30z^2r^2+3r^4
+  case isym_G0: poly="8:zzzz 3:xxxx 3:yyyy 6:xxyy -24:xxzz -24:yyzz"; break;
+  //xz(7z^2-3r^2)
+  case isym_G1: poly="4:xzzz -3:xxxz -3:xyyz"; break;
+  //yz(7z^2-3r^2)
+  case isym_G2: poly="4:yzzz -3:xxyz -3:yyyz"; break;
+  //(x^2-y^2)(7z^2-r^2)
+  case isym_G3: poly="6:xxzz -1:xxxx -6:yyzz 1:yyyy"; break;
+  //xy(7z^2-r^2)
+  case isym_G4: poly="6:xyzz -1:xxxy -1:xyyy"; break;
+  case isym_G5: poly="1:xxxz -3:xyyz"; break;
+  case isym_G6: poly="3:xxyz -1:yyyz"; break;
+  case isym_G7: poly="1:xxxx -6:xxyy 1:yyyy"; break;
+  case isym_G8: poly="1:xxxy -1:xyyy"; break;
+  default:
+    error("Bad symmetry in Cubic_spline::angularPolynomial ", s);
+  }
+}
+
+//-------------------------------------------------------
+
+void Cubic_spline::buildEvaluationTables() {
+  //Radial part.  Splines made from a basis all share a grid; 
+  //those read in as SPLINE sections may not, and are then 
+  //evaluated one at a time.
+  soa_radial=1;
+  soa_spacing=splines(0).getSpacing();
+  int nint=0;
+  for(int s=0; s< nsplines; s++) { 
+    if(splines(s).getSpacing()!=soa_spacing) soa_radial=0;
+    nint=max(nint,splines(s).nIntervals());
+  }
+  if(soa_radial) { 
+    soa_invspacing=1.0/soa_spacing;
+    soa_coeff.Resize(nint,4,nsplines);
+    soa_coeff=0.0;
+    for(int s=0; s< nsplines; s++) { 
+      for(int i=0; i< splines(s).nIntervals(); i++) { 
+        for(int j=0; j< 4; j++) soa_coeff(i,j,s)=splines(s).getCoeff(i,j);
+      }
+    }
+  }
+  else soa_coeff.clear();
+
+  //Angular part: all monomials x^a y^b z^c with a+b+c=l, for l up to maxl
+  spline_l.Resize(nsplines);
+  maxl=0;
+  for(int s=0; s< nsplines; s++) { 
+    spline_l(s)=symmetry_lvalue(symmetry(s));
+    maxl=max(maxl,spline_l(s));
+  }
+  monostart.Resize(maxl+1);
+  nmono.Resize(maxl+1);
+  int ntot=0;
+  for(int l=0; l<= maxl; l++) { 
+    monostart(l)=ntot;
+    nmono(l)=(l+1)*(l+2)/2;
+    ntot+=nmono(l);
+  }
+  mono_pow.Resize(ntot,3);
+  for(int l=0; l<= maxl; l++) { 
+    int m=monostart(l);
+    for(int a=l; a>=0; a--) { 
+      for(int b=l-a; b>=0; b--) { 
+        mono_pow(m,0)=a;
+        mono_pow(m,1)=b;
+        mono_pow(m,2)=l-a-b;
+        m++;
+      }
+    }
+  }
+
+  //The nonzero terms of each angular polynomial.  All the functions of 
+  //a spline get the same number of terms, padded with zeros, and that 
+  //number is rounded up to one of 1, 2, 3, or 6, so that the evaluation 
+  //has fixed loop lengths.
+  string space=" ";
+  vector <vector <doublevar> > coeffs(nfunctions);
+  vector <vector <int> > monos(nfunctions);
+  spline_nterm.Resize(nsplines);
+  term_start.Resize(nsplines);
+  int f=0, nterms=0;
+  for(int s=0; s< nsplines; s++) { 
+    int l=spline_l(s);
+    int maxterm=1;
+    for(int i=0; i< nfuncspline(s); i++, f++) { 
+      string poly;
+      angularPolynomial(indiv_symmetry(f),poly);
+      vector <string> terms;
+      split(poly,space,terms);
+      for(vector<string>::iterator t=terms.begin(); t!=terms.end(); t++) { 
+        size_t colon=t->find(':');
+        doublevar c=atof(t->substr(0,colon).c_str());
+        int pw[3]={0,0,0};
+        for(size_t k=colon+1; k< t->size(); k++) pw[(*t)[k]-'x']++;
+        if(pw[0]+pw[1]+pw[2]!=l) 
+          error("Cubic_spline: angular polynomial of the wrong degree for l=",l);
+        for(int m=monostart(l); m< monostart(l)+nmono(l); m++) { 
+          if(mono_pow(m,0)==pw[0] && mono_pow(m,1)==pw[1] 
+             && mono_pow(m,2)==pw[2]) { 
+            coeffs[f].push_back(c);
+            monos[f].push_back(m);
+          }
+        }
+      }
+      maxterm=max(maxterm,int(coeffs[f].size()));
+    }
+    if(maxterm > 6) 
+      error("Cubic_spline: too many terms in an angular polynomial");
+    if(maxterm > 3) maxterm=6;
+    spline_nterm(s)=maxterm;
+    term_start(s)=nterms;
+    nterms+=maxterm*nfuncspline(s);
+  }
+  term_coeff.Resize(nterms);
+  term_mono.Resize(nterms);
+  f=0;
+  for(int s=0; s< nsplines; s++) { 
+    int t=term_start(s);
+    for(int i=0; i< nfuncspline(s); i++, f++) { 
+      for(int k=0; k< spline_nterm(s); k++, t++) { 
+        if(k < int(coeffs[f].size())) { 
+          term_coeff(t)=coeffs[f][k];
+          term_mono(t)=monos[f][k];
+        }
+        else { 
+          term_coeff(t)=0.0;
+          term_mono(t)=monostart(spline_l(s));
+        }
+      }
+    }
+  }
+}
+
 //-------------------------------------------------------
 
 
@@ -22,334 +22,237 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "Cubic_spline.h"
 
 
-void Cubic_spline::calcVal(const Array1 <doublevar> & r,
-                           Array1 <doublevar> & symvals,
-                           const int startfill)
-{
-
-  if(r(0) >= threshold)
-  {
-    int end=startfill+nfunctions;
-    for(int i=startfill; i< end; i++)
-    {
-      symvals(i)=0;
+/*!
+Radial functions of all splines at r: values, and if derivatives is 
+set, \f$ \frac{1}{r}\frac{df}{dr} \f$ and \f$ \frac{d^2f}{dr^2} \f$.
+*/
+void Cubic_spline::evalRadial(doublevar r, int derivatives, doublevar * val,
+                              doublevar * d1, doublevar * d2) { 
+  if(soa_radial) { 
+    int interval=int(r*soa_invspacing);
+    doublevar height=r-interval*soa_spacing;
+    const doublevar * c0=soa_coeff.v+interval*soa_coeff.step1;
+    const doublevar * c1=c0+nsplines;
+    const doublevar * c2=c1+nsplines;
+    const doublevar * c3=c2+nsplines;
+    if(derivatives) { 
+      for(int s=0; s< nsplines; s++) { 
+        val[s]=c0[s]+height*(c1[s]+height*(c2[s]+height*c3[s]));
+        d1[s]=(c1[s]+height*(2*c2[s]+height*(3*c3[s])))/r;
+        d2[s]=2*c2[s]+6*height*c3[s];
+      }
+    }
+    else { 
+      for(int s=0; s< nsplines; s++) 
+        val[s]=c0[s]+height*(c1[s]+height*(c2[s]+height*c3[s]));
     }
   }
-  else {
-
-    doublevar v, v1, v2, v3, v4, v5;
-    doublevar temp;
-
-    int totf=startfill;
-    for(int i=0; i<nsplines; i++)  {
-
-      int interval=splines(i).getInterval(r(0));
-
-      //temp=coeff(i,interval,0)+height*(coeff(i,interval,1)
-      //                                 +height*(coeff(i,interval,2)
-      //                                          +height*coeff(i,interval,3)));
-      temp=splines(i).getVal(r(0), interval);
-      //cout << "phir " << temp << endl;
-      int end=totf+nfuncspline(i);
-      for(; totf <end; totf++) {
-        switch(indiv_symmetry(totf-startfill)) {
-        case isym_S: // s
-          symvals(totf)=temp;
-          break;
-
-        case isym_Px: //p
-          symvals(totf)=temp*r(2);
-          break;
-        case isym_Py:
-          symvals(totf)=temp*r(3);
-          break;
-        case isym_Pz:
-          symvals(totf)=temp*r(4);
-          break;
-
-        case isym_Dxx: //d
-          v=r(2)*r(2);  //xx
-          symvals(totf)=v*temp;
-          break;
-        case isym_Dyy:
-          v=r(3)*r(3); //yy
-          symvals(totf)=v*temp;
-          break;
-        case isym_Dzz:
-          v=r(4)*r(4); //zz
-          symvals(totf)=v*temp;
-          break;
-        case isym_Dxy:
-          v=r(2)*r(3); //xy
-          symvals(totf)=v*temp;
-          break;
-        case isym_Dxz:
-          v=r(2)*r(4);  //xz
-          symvals(totf)=v*temp;
-          break;
-        case isym_Dyz:
-          v=r(3)*r(4);  //yz
-          symvals(totf)=v*temp;
-          break;
-
-        case isym_Dx2y2:
-          v=r(2)*r(2)-r(3)*r(3);
-          symvals(totf)=v*temp;
-          break;
-
-        case isym_Dz2r2:
-          v=2.*r(4)*r(4)-r(2)*r(2)-r(3)*r(3);
-          symvals(totf)=v*temp;
-          break;
-
-
-        case isym_Fxxx: //f
-          //xxx
-          v2=r(2)*r(2);
-          v3=v2*r(2);
-          symvals(totf)=v3*temp;
-          break;
-
-        case isym_Fyyy: //yyy
-          v2=r(3)*r(3);
-          v3=v2*r(3);
-          symvals(totf)=v3*temp;
-          break;
-
-        case isym_Fzzz://zzz
-          v2=r(4)*r(4);
-          v3=v2*r(4);
-          symvals(totf)=v3*temp;
-          break;
-
-        case isym_Fxxy://xxy
-          v2=r(2)*r(2);
-          v3=v2*r(3);
-          symvals(totf)=v3*temp;
-          break;
-
-        case isym_Fxxz://xxz
-          v2=r(2)*r(2);
-          v3=v2*r(4);
-          symvals(totf)=v3*temp;
-          break;
-
-        case isym_Fyyx://yyx
-          v2=r(3)*r(3);
-          v3=v2*r(2);
-          symvals(totf)=v3*temp;
-          break;
-
-        case isym_Fyyz://yyz
-          v2=r(3)*r(3);
-          v3=v2*r(4);
-          symvals(totf)=v3*temp;
-          break;
-
-        case isym_Fzzx://zzx
-          v2=r(4)*r(4);
-          v3=r(2)*v2;
-          symvals(totf)=v3*temp;
-          break;
-
-        case isym_Fzzy://zzy
-          v2=r(4)*r(4);
-          v3=v2*r(3);
-          symvals(totf)=v3*temp;
-          break;
-
-        case isym_Fxyz://xyz     
-          v3=r(2)*r(3)*r(4);
-          symvals(totf)=v3*temp;
-          break;
-          
-        case isym_Fm3: //y(3*x*x-y*y)
-          v3=r(3)*(3.0*r(2)*r(2)-r(3)*r(3));
-          symvals(totf)=v3*temp;
-          break;
-          
-        case isym_Fm1://(4z2 - x2 - y2)*y
-          v3=r(3)*(4.0*r(4)*r(4)-r(2)*r(2)-r(3)*r(3));
-          symvals(totf)=v3*temp;
-          break;
-        
-        case isym_F0:
-          v3=r(4)*(2.0*r(4)*r(4)-3.0*(r(2)*r(2)+r(3)*r(3)));
-          symvals(totf)=v3*temp;
-          break;
-          
-        case isym_Fp1://(4z2 - x2 - y2)x
-          v3=r(2)*(4.0*r(4)*r(4)-r(2)*r(2)-r(3)*r(3));
-          symvals(totf)=v3*temp;
-          break;
-          
-        case isym_Fp2:
-          v3=r(4)*(r(2)*r(2)-r(3)*r(3));
-          symvals(totf)=v3*temp;
-          break;
-        
-        case isym_Fp3:
-          v3=r(2)*(r(2)*r(2)+r(3)*r(3));
-          symvals(totf)=v3*temp;
-          break;
-
-        case isym_Fp3mod:
-          v3=r(2)*(r(2)*r(2)-3.0*r(3)*r(3));
-          symvals(totf)=v3*temp;
-          break;  
-
-                  
-        case isym_Gxxxx: //g xxxx (15)
-          v4=r(2)*r(2)*r(2)*r(2);
-          symvals(totf)=v4*temp;
-          break;
-
-        case isym_Gyyyy: //yyyy
-          v4=r(3)*r(3)*r(3)*r(3);
-          symvals(totf)=v4*temp;
-          break;
-
-        case isym_Gzzzz://zzzz
-          v4=r(4)*r(4)*r(4)*r(4);
-          symvals(totf)=v4*temp;
-          break;
-
-        case isym_Gxxxy://xxxy
-          v4=r(2)*r(2)*r(2)*r(3);
-          symvals(totf)=v4*temp;
-          break;
+  else { 
+    for(int s=0; s< nsplines; s++) { 
+      int interval=splines(s).getInterval(r);
+      if(derivatives) splines(s).getDers(r,interval,val[s],d1[s],d2[s]);
+      else val[s]=splines(s).getVal(r,interval);
+    }
+  }
+}
 
-        case isym_Gxxxz://xxxz
-          v4=r(2)*r(2)*r(2)*r(4);
-          symvals(totf)=v4*temp;
-          break;
+//----------------------------------------------------------------------
 
-        case isym_Gyyyx: //g yyyx 
-          v4=r(3)*r(3)*r(3)*r(2);
-          symvals(totf)=v4*temp;
-          break;
+namespace { 
 
-        case isym_Gyyyz: //yyyz
-          v4=r(3)*r(3)*r(3)*r(4);
-          symvals(totf)=v4*temp;
-          break;
+/*!
+The monomial \f$ x^Ay^Bz^C \f$ from the powers pw of x, y, and z, and 
+with DERIV its gradient and Laplacian, at strides of ntot.  The entries
+that do not depend on the position fold to constants.
+*/
+template <int A, int B, int C, int DERIV> 
+inline void monomial(const doublevar pw[3][5], doublevar * m0, 
+                     const int ntot) { 
+  const doublevar px=pw[0][A], py=pw[1][B], pz=pw[2][C];
+  m0[0]=px*py*pz;
+  if(DERIV) { 
+    const doublevar dx=A > 0 ? A*pw[0][A > 0 ? A-1 : 0] : 0.0;
+    const doublevar dy=B > 0 ? B*pw[1][B > 0 ? B-1 : 0] : 0.0;
+    const doublevar dz=C > 0 ? C*pw[2][C > 0 ? C-1 : 0] : 0.0;
+    m0[ntot]=dx*py*pz;
+    m0[2*ntot]=px*dy*pz;
+    m0[3*ntot]=px*py*dz;
+    const doublevar d2x=A > 1 ? A*(A-1)*pw[0][A > 1 ? A-2 : 0] : 0.0;
+    const doublevar d2y=B > 1 ? B*(B-1)*pw[1][B > 1 ? B-2 : 0] : 0.0;
+    const doublevar d2z=C > 1 ? C*(C-1)*pw[2][C > 1 ? C-2 : 0] : 0.0;
+    m0[4*ntot]=d2x*py*pz+px*d2y*pz+px*py*d2z;
+  }
+}
 
-        case isym_Gzzzx://zzzx
-          v4=r(4)*r(4)*r(4)*r(2);
-          symvals(totf)=v4*temp;
-          break;
+/*!
+The monomials of degree L from \f$ x^Ay^B \f$ on, in the order of 
+Cubic_spline::mono_pow (A from L down to 0, then B from L-A down to 0).
+The recursion unrolls completely at compile time.
+*/
+template <int L, int A, int B, int DERIV> 
+struct Monomial_block { 
+  static inline void eval(const doublevar pw[3][5], doublevar * m0, 
+                          const int ntot) { 
+    monomial<A,B,L-A-B,DERIV>(pw,m0,ntot);
+    Monomial_block<L, (B > 0 ? A : A-1), (B > 0 ? B-1 : L-A+1), DERIV>
+      ::eval(pw,m0+1,ntot);
+  }
+};
 
-        case isym_Gzzzy://zzzy
-          v4=r(4)*r(4)*r(4)*r(3);
-          symvals(totf)=v4*temp;
-          break;
+template <int L, int B, int DERIV> 
+struct Monomial_block<L,-1,B,DERIV> { 
+  static inline void eval(const doublevar pw[3][5], doublevar * m0, 
+                          const int ntot) { }
+};
 
-        case isym_Gxxyy://xxyy
-          v4=r(2)*r(2)*r(3)*r(3);
-          symvals(totf)=v4*temp;
-          break;
+/*!
+All monomials up to degree MAXL.  Degree l starts at l(l+1)(l+2)/6.
+*/
+template <int MAXL, int DERIV> 
+inline void monomials(const Array1 <doublevar> & r, doublevar * m0, 
+                      const int ntot) { 
+  doublevar pw[3][5];
+  for(int d=0; d< 3; d++) { 
+    pw[d][0]=1.0;
+    for(int k=1; k<= MAXL; k++) pw[d][k]=pw[d][k-1]*r(d+2);
+  }
+  Monomial_block<0,0,0,DERIV>::eval(pw,m0,ntot);
+  if(MAXL >= 1) Monomial_block<1,1,0,DERIV>::eval(pw,m0+1,ntot);
+  if(MAXL >= 2) Monomial_block<2,2,0,DERIV>::eval(pw,m0+4,ntot);
+  if(MAXL >= 3) Monomial_block<3,3,0,DERIV>::eval(pw,m0+10,ntot);
+  if(MAXL >= 4) Monomial_block<4,4,0,DERIV>::eval(pw,m0+20,ntot);
+}
 
-        case isym_Gxxzz: //g xxzz 
-          v4=r(2)*r(2)*r(4)*r(4);
-          symvals(totf)=v4*temp;
-          break;
+template <int DERIV> 
+inline void monomials(const int maxl, const Array1 <doublevar> & r, 
+                      doublevar * m0, const int ntot) { 
+  switch(maxl) { 
+  case 0: monomials<0,DERIV>(r,m0,ntot); break;
+  case 1: monomials<1,DERIV>(r,m0,ntot); break;
+  case 2: monomials<2,DERIV>(r,m0,ntot); break;
+  case 3: monomials<3,DERIV>(r,m0,ntot); break;
+  default: monomials<4,DERIV>(r,m0,ntot);
+  }
+}
 
-        case isym_Gyyzz: //yyzz
-          v4=r(3)*r(3)*r(4)*r(4);
-          symvals(totf)=v4*temp;
-          break;
+/*!
+Values of the nf functions of one spline, each with NT angular terms.
+*/
+template <int NT> 
+inline void shellVal(const int nf, const doublevar * coeff, const int * mono,
+                     const doublevar * m0, const doublevar func, 
+                     doublevar * out) { 
+  for(int f=0; f< nf; f++) { 
+    doublevar ang=0;
+    for(int t=0; t< NT; t++) ang+=coeff[t]*m0[mono[t]];
+    out[f]=ang*func;
+    coeff+=NT;
+    mono+=NT;
+  }
+}
 
-        case isym_Gxxyz://xxyz
-          v4=r(2)*r(2)*r(3)*r(4);
-          symvals(totf)=v4*temp;
-          break;
+/*!
+Values, gradients, and Laplacians of the nf functions of one spline, 
+each with NT angular terms.  flap is \f$ f''+2(l+1)f'/r \f$.
+*/
+template <int NT> 
+inline void shellLap(const int nf, const doublevar * coeff, const int * mono,
+                     const doublevar * m0, const int ntot, 
+                     const doublevar func, const doublevar gx, 
+                     const doublevar gy, const doublevar gz, 
+                     const doublevar flap, doublevar * out, const int stride) { 
+  const doublevar * mx=m0+ntot;
+  const doublevar * my=mx+ntot;
+  const doublevar * mz=my+ntot;
+  const doublevar * ml=mz+ntot;
+  for(int f=0; f< nf; f++) { 
+    doublevar ang=0, angx=0, angy=0, angz=0, angl=0;
+    for(int t=0; t< NT; t++) { 
+      doublevar c=coeff[t];
+      int m=mono[t];
+      ang+=c*m0[m];
+      angx+=c*mx[m];
+      angy+=c*my[m];
+      angz+=c*mz[m];
+      angl+=c*ml[m];
+    }
+    out[0]=func*ang;
+    out[1]=gx*ang+func*angx;
+    out[2]=gy*ang+func*angy;
+    out[3]=gz*ang+func*angz;
+    out[4]=flap*ang+func*angl;
+    coeff+=NT;
+    mono+=NT;
+    out+=stride;
+  }
+}
 
-        case isym_Gyyxz://yyxz
-          v4=r(3)*r(3)*r(2)*r(4);
-          symvals(totf)=v4*temp;
-          break;
+}
 
-        case isym_Gzzxy://zzxy  end of g
-          v4=r(4)*r(4)*r(2)*r(3);
-          symvals(totf)=v4*temp;
-          break;
+//----------------------------------------------------------------------
 
+/*!
+All monomials \f$ x^ay^bz^c \f$ up to degree maxl at r (in the form r, 
+r^2, x, y, z), and if derivatives is set, their gradients and Laplacians,
+in the form ([M, dM/dx, dM/dy, dM/dz, lap M], monomial).
+*/
+void Cubic_spline::evalMonomials(const Array1 <doublevar> & r, 
+                                 int derivatives, Array2 <doublevar> & mono_val) { 
+  const int ntot=mono_pow.GetDim(0);
+  mono_val.Resize(5,ntot);
+  doublevar * m0=mono_val.v;
+  if(derivatives) monomials<1>(maxl,r,m0,ntot);
+  else monomials<0>(maxl,r,m0,ntot);
+}
 
-	case isym_G0: //g0
-	  v1=r(2)*r(2);
-	  v2=r(3)*r(3);
-	  v3=r(4)*r(4);
-	  v5=v1+v2+v3;
-          v4=35.*v3*v3-30.*v3*v5+3.*v5*v5;
-          symvals(totf)=v4*temp;
-          break;
-	case isym_G1: //g1
-	  v1=r(2)*r(2);
-	  v2=r(3)*r(3);
-	  v3=r(4)*r(4);
-	  v5=v1+v2+v3;
-          v4=r(2)*r(4)*(7.*v3-3.*v5);
-          symvals(totf)=v4*temp;
-          break;
-	case isym_G2: //g2
-	  v1=r(2)*r(2);
-	  v2=r(3)*r(3);
-	  v3=r(4)*r(4);
-	  v5=v1+v2+v3;
-          v4=r(3)*r(4)*(7.*v3-3.*v5);
-          symvals(totf)=v4*temp;
-          break;
-	case isym_G3: //g3
-	  v1=r(2)*r(2);
-	  v2=r(3)*r(3);
-	  v3=r(4)*r(4);
-	  v5=v1+v2+v3;
-          v4=(v1-v2)*(7.*v3-v5);
-          symvals(totf)=v4*temp;
-          break;
-        case isym_G4: //g4
-	  v1=r(2)*r(2);
-	  v2=r(3)*r(3);
-	  v3=r(4)*r(4);
-	  v5=v1+v2+v3;
-          v4=r(2)*r(3)*(7.*v3-v5);
-          symvals(totf)=v4*temp;
-          break;
-	case isym_G5: //g5
-	  v1=r(2)*r(2);
-	  v2=r(3)*r(3);
-          v4=(v1-3.*v2)*r(2)*r(4);
-          symvals(totf)=v4*temp;
-          break;  
-	case isym_G6: //g6
-	  v1=r(2)*r(2);
-	  v2=r(3)*r(3);
-          v4=(3.*v1-v2)*r(3)*r(4);
-          symvals(totf)=v4*temp;
-          break; 
-	case isym_G7: //g7
-	  v1=r(2)*r(2);
-	  v2=r(3)*r(3);
-          v4=(v1-3.*v2)*v1-(3.*v1-v2)*v2;
-          symvals(totf)=v4*temp;
-          break;
-	case isym_G8: //g8
-	  v1=r(2)*r(2);
-	  v2=r(3)*r(3);
-          v4=(v1-v2)*r(2)*r(3);
-          symvals(totf)=v4*temp;
-          break;
+//----------------------------------------------------------------------
 
-        default:
-          error("Bad symmetry in Cubic_spline::calcVal", indiv_symmetry(totf-startfill));
-        }
+void Cubic_spline::calcVal(const Array1 <doublevar> & r,
+                           Array1 <doublevar> & symvals,
+                           const int startfill)
+{
 
+  if(r(0) >= threshold)
+  {
+    int end=startfill+nfunctions;
+    for(int i=startfill; i< end; i++)
+    {
+      symvals(i)=0;
+    }
+  }
+  else {
+    static QMC_THREAD_LOCAL Array1 <doublevar> rad_val;
+    static QMC_THREAD_LOCAL Array2 <doublevar> mono_val;
+    Array1 <doublevar> & rv(rad_val);
+    Array2 <doublevar> & mv(mono_val);
+    rv.Resize(nsplines);
+    evalRadial(r(0),0,rv.v,NULL,NULL);
+    evalMonomials(r,0,mv);
+    const doublevar * m0=mv.v;
+    doublevar * out=symvals.v+startfill;
+    for(int s=0; s< nsplines; s++) { 
+      const int nf=nfuncspline(s);
+      const doublevar * coeff=term_coeff.v+term_start(s);
+      const int * mono=term_mono.v+term_start(s);
+      switch(spline_nterm(s)) { 
+      case 1: shellVal<1>(nf,coeff,mono,m0,rv(s),out); break;
+      case 2: shellVal<2>(nf,coeff,mono,m0,rv(s),out); break;
+      case 3: shellVal<3>(nf,coeff,mono,m0,rv(s),out); break;
+      default: shellVal<6>(nf,coeff,mono,m0,rv(s),out);
       }
+      out+=nf;
     }
   }
 
 }
 
+//----------------------------------------------------------------------
+
+/*!
+With the angular part Y a homogeneous polynomial of degree l, 
+\f$ \nabla^2 (fY) = (f''+2(l+1)f'/r) Y + f \nabla^2 Y \f$, since
+\f$ \vec{r}\cdot\nabla Y = lY \f$.
+*/
 void Cubic_spline::calcLap(
   const Array1 <doublevar> & r,
   //!< in form r, r^2, x, y, z
@@ -360,7 +263,6 @@ void Cubic_spline::calcLap(
 {
 
   assert(r.GetDim(0) >= 5);
-  //cout << "spline interval " << interval << "   r   " << r(0) << endl;
   if(r(0) >= threshold)
   {
     int end=startfill+nfunctions;
@@ -374,715 +276,46 @@ void Cubic_spline::calcLap(
   }
   else
   {
-    //cout << "calculating spline\n";
-
-    //int interval=splines(0).getInterval(r(0));
-
-    doublevar rdp, v, h, x, y, z, v1, v2, v3, v4, v5, u2, v2u2, dfdx, dfdy, dfdz;
-    doublevar func, fdir, f2dir;
-    //doublevar funct[3];
-    int totf=startfill;
-
-    assert(r(0) < threshold);
     assert(symvals.GetDim(0) >= nfunctions);
-
-
-    for(int i=0; i<nsplines; i++) {
-
-      int interval=splines(i).getInterval(r(0));
-      //cout << "interval " << interval << " r " << r(0) << endl;
-      //func=coeff(i,interval,0)+height*(coeff(i,interval,1)
-      //                                 +height*(coeff(i,interval,2)
-      //                                          +height*coeff(i,interval,3)));
-
-      //fdir=(coeff(i,interval,1)+height*(2*coeff(i,interval,2)
-      //                                  +height*(3*coeff(i,interval,3))))/r(0);
-
-      //f2dir=2*coeff(i,interval,2)+6*height*coeff(i,interval,3);
-      splines(i).getDers(r(0), interval,func, fdir, f2dir);
-      
-      //cout << "r(0) " << r(0) << " interval " << interval << " func " << func << endl;
-
-      //cout << "height " << height << endl;
-      //for(int j=0; j<4; j++) {
-      //  cout << "coeff " << j << "  " << coeff(i,interval,j) << endl;
-      //}
-      //cout << "rad fn " << func << "   " << fdir << "   "
-      //    << f2dir << endl;
-
-      int end=totf+nfuncspline(i);
-      for(; totf <end; totf++)
-      {
-        switch(indiv_symmetry(totf-startfill))
-        {
-        case isym_S: // s
-          symvals(totf,0)=func;
-          symvals(totf,1)=fdir*r(2);
-          symvals(totf,2)=fdir*r(3);
-          symvals(totf,3)=fdir*r(4);
-          symvals(totf,4)=f2dir+2.*fdir;
-          break;
-
-        case isym_Px: //p
-          symvals(totf,0)=func*r(2);
-          rdp=fdir*r(2);
-          symvals(totf,1)=rdp*r(2)+func;
-          symvals(totf ,2)=rdp*r(3);
-          symvals(totf ,3)=rdp*r(4);
-          symvals(totf ,4)=f2dir*r(2)+4.*rdp;
-          break;
-
-        case isym_Py:
-          symvals(totf ,0)=func*r(3);
-          rdp=fdir*r(3);
-          symvals(totf ,1)=rdp*r(2);
-          symvals(totf ,2)=rdp*r(3)+func;
-          symvals(totf ,3)=rdp*r(4);
-          symvals(totf ,4)=f2dir*r(3)+4.*rdp;
-          break;
-
-        case isym_Pz:
-          symvals(totf ,0)=func*r(4);
-          rdp=fdir*r(4);
-          symvals(totf ,1)=rdp*r(2);
-          symvals(totf ,2)=rdp*r(3);
-          symvals(totf ,3)=rdp*r(4)+func;
-          symvals(totf ,4)=f2dir*r(4)+4.*rdp;
-          break;
-
-        case isym_Dxx: //d
-          v=r(2)*r(2);  //xx
-          symvals(totf,0)=v*func;
-          h=v*fdir;
-          symvals(totf,1)=h*r(2)+func*2.*r(2);
-          symvals(totf,2)=h*r(3);
-          symvals(totf,3)=h*r(4);
-          symvals(totf,4)=v*f2dir+6.*h+2.*func;
-          break;
-
-        case isym_Dyy:
-          v=r(3)*r(3); //yy
-          symvals(totf,0)=v*func;
-          h=v*fdir;
-          symvals(totf,1)=h*r(2);
-          symvals(totf,2)=h*r(3)+func*2.*r(3);
-          symvals(totf,3)=h*r(4);
-          symvals(totf,4)=v*f2dir+6.*h+2.*func;
-          break;
-
-        case isym_Dzz:
-          v=r(4)*r(4); //zz
-          symvals(totf,0)=v*func;
-          h=v*fdir;
-          symvals(totf,1)=h*r(2);
-          symvals(totf,2)=h*r(3);
-          symvals(totf,3)=h*r(4)+func*2.*r(4);
-          symvals(totf,4)=v*f2dir+6.*h+2.*func;
-          break;
-
-        case isym_Dxy:
-          v=r(2)*r(3); //xy
-          symvals(totf,0)=v*func;
-          h=v*fdir;
-          symvals(totf,1)=h*r(2)+func*r(3);
-          symvals(totf,2)=h*r(3)+func*r(2);
-          symvals(totf,3)=h*r(4);
-          symvals(totf,4)=v*f2dir+6.*h;
-          break;
-
-        case isym_Dxz:
-          v=r(2)*r(4);  //xz
-          symvals(totf,0)=v*func;
-          h=v*fdir;
-          symvals(totf,1)=h*r(2)+func*r(4);
-          symvals(totf,2)=h*r(3);
-          symvals(totf,3)=h*r(4)+func*r(2);
-          symvals(totf,4)=v*f2dir+6.*h;
-          break;
-
-        case isym_Dyz:
-          v=r(3)*r(4);  //yz
-          symvals(totf,0)=v*func;
-          h=v*fdir;
-          symvals(totf,1)=h*r(2);
-          symvals(totf,2)=h*r(3)+func*r(4);
-          symvals(totf,3)=h*r(4)+func*r(3);
-          symvals(totf,4)=v*f2dir+6.*h;
-          break;
-
-        case isym_Dx2y2:
-          v=r(2)*r(2)-r(3)*r(3);
-          symvals(totf,0)=v*func;
-          h=v*fdir;
-          symvals(totf,1)=h*r(2)+2.*func*r(2);
-          symvals(totf,2)=h*r(3)-2.*func*r(3);
-          symvals(totf,3)=h*r(4);
-          symvals(totf,4)=v*f2dir+6.*h;
-          break;
-
-        case isym_Dz2r2:
-          v=2.*r(4)*r(4)-r(2)*r(2)-r(3)*r(3);
-          symvals(totf,0)=v*func;
-          h=v*fdir;
-          symvals(totf,1)=h*r(2)-2*func*r(2);
-          symvals(totf,2)=h*r(3)-2*func*r(3);
-          symvals(totf,3)=h*r(4)+4*func*r(4);
-          symvals(totf,4)=v*f2dir+6*h;
-          break;
-
-          //f
-        case isym_Fxxx: //xxx
-          v2=r(2)*r(2);
-          v3=v2*r(2);
-          symvals(totf,0)=v3*func;
-          h=v3*fdir;
-          symvals(totf, 1)=h*r(2)+func*3.*v2;
-          symvals(totf, 2)=h*r(3);
-          symvals(totf, 3)=h*r(4);
-          symvals(totf, 4)=v3*f2dir+8.*h+6.*func*r(2);
-          break;
-
-        case isym_Fyyy://yyy
-          v2=r(3)*r(3);
-          v3=v2*r(3);
-          symvals(totf,0)=v3*func;
-          h=v3*fdir;
-          symvals(totf, 1)=h*r(2);
-          symvals(totf, 2)=h*r(3)+3.*func*v2;
-          symvals(totf, 3)=h*r(4);
-          symvals(totf, 4)=v3*f2dir+8.*h+6.*func*r(3);
-          break;
-
-
-        case isym_Fzzz: //zzz
-          v2=r(4)*r(4);
-          v3=v2*r(4);
-          symvals(totf, 0)=v3*func;
-          h=v3*fdir;
-          symvals(totf, 1)=h*r(2);
-          symvals(totf, 2)=h*r(3);
-          symvals(totf, 3)=h*r(4)+3.*func*v2;
-          symvals(totf, 4)=v3*f2dir+8.*h+6.*func*r(4);
-          break;
-
-        case isym_Fxxy: //xxy
-          v2=r(2)*r(2);
-          v3=v2*r(3);
-          symvals(totf, 0)=v3*func;
-          h=v3*fdir;
-          symvals(totf, 1)=h*r(2)+2.*func*r(2)*r(3);
-          symvals(totf, 2)=h*r(3)+func*v2;
-          symvals(totf, 3)=h*r(4);
-          symvals(totf, 4)=v3*f2dir+8.*h+2.*func*r(3);
-          break;
-
-        case isym_Fxxz://xxz
-          v2=r(2)*r(2);
-          v3=v2*r(4);
-          symvals(totf, 0)=v3*func;
-          h=v3*fdir;
-          symvals(totf, 1)=h*r(2)+2.*func*r(2)*r(4);
-          symvals(totf, 2)=h*r(3);
-          symvals(totf, 3)=h*r(4)+func*v2;
-          symvals(totf, 4)=v3*f2dir+8.*h+2.*func*r(4);
-          break;
-
-        case isym_Fyyx://yyx
-          v2=r(3)*r(3);
-          v3=v2*r(2);
-          symvals(totf, 0)=v3*func;
-          h=v3*fdir;
-          symvals(totf, 1)=h*r(2)+v2*func;
-          symvals(totf, 2)=h*r(3)+2.*func*r(2)*r(3);
-          symvals(totf, 3)=h*r(4);
-          symvals(totf, 4)=v3*f2dir+8.*h+2.*func*r(2);
-          break;
-
-        case isym_Fyyz://yyz
-          v2=r(3)*r(3);
-          v3=v2*r(4);
-          symvals(totf, 0)=v3*func;
-          h=v3*fdir;
-          symvals(totf, 1)=h*r(2);
-          symvals(totf, 2)=h*r(3)+2.*func*r(3)*r(4);
-          symvals(totf, 3)=h*r(4)+func*v2;
-          symvals(totf, 4)=v3*f2dir+8.*h+2.*func*r(4);
-          break;
-
-        case isym_Fzzx://zzx
-          v2=r(4)*r(4);
-          v3=r(2)*v2;
-          symvals(totf, 0)=v3*func;
-          h=v3*fdir;
-          symvals(totf, 1)=h*r(2)+func*v2;
-          symvals(totf, 2)=h*r(3);
-          symvals(totf, 3)=h*r(4)+2.*func*r(2)*r(4);
-          symvals(totf, 4)=v3*f2dir+8.*h+2.*func*r(2);
-          break;
-
-        case isym_Fzzy://zzy
-          v2=r(4)*r(4);
-          v3=v2*r(3);
-          symvals(totf, 0)=v3*func;
-          h=v3*fdir;
-          symvals(totf, 1)=h*r(2);
-          symvals(totf, 2)=h*r(3)+func*v2;
-          symvals(totf, 3)=h*r(4)+2.*func*r(3)*r(4);
-          symvals(totf, 4)=v3*f2dir+8.*h+2.*func*r(3);
-          break;
-
-        case isym_Fxyz://xyz
-          v3=r(2)*r(3)*r(4);
-          symvals(totf, 0)=v3*func;
-          v2=func*r(4);
-          h=v3*fdir;
-          symvals(totf, 1)=h*r(2)+v2*r(3);
-          symvals(totf, 2)=h*r(3)+v2*r(2);
-          symvals(totf, 3)=h*r(4)+func*r(2)*r(3);
-          symvals(totf, 4)=v3*f2dir+8.*h;
-          break;
-          
-          
-        case isym_Fm3: 
-          v3=r(3)*(3.0*r(2)*r(2)-r(3)*r(3));
-          symvals(totf,0)=v3*func;
-          h=v3*fdir;
-          v2=6.0*r(2)*r(3);
-          v4=3.0*(r(2)*r(2)-r(3)*r(3));
-          symvals(totf,1)=h*r(2)+v2*func;
-          symvals(totf,2)=h*r(3)+v4*func;
-          symvals(totf,3)=h*r(4);
-          symvals(totf,4)=v3*f2dir+8.*h;
-          break;
-          
-        case isym_Fm1:
-          v3=r(3)*(4.0*r(4)*r(4)-r(2)*r(2)-r(3)*r(3));
-          symvals(totf,0)=v3*func;
-          h=v3*fdir;
-          symvals(totf,1)=h*r(2)-2.*r(2)*r(3)*func;
-          symvals(totf,2)=h*r(3)+(4.*r(4)*r(4)-r(2)*r(2)-3.*r(3)*r(3))*func;
-          symvals(totf,3)=h*r(4)+8.*r(3)*r(4)*func;
-          symvals(totf,4)=v3*f2dir+8.*h;
-          break;
-          
-        case isym_F0:
-          v3=r(4)*(2.0*r(4)*r(4)-3.0*(r(2)*r(2)+r(3)*r(3)));
-          symvals(totf,0)=v3*func;
-          h=v3*fdir;
-          symvals(totf,1)=h*r(2)-6.*r(2)*r(4)*func;
-          symvals(totf,2)=h*r(3)-6.*r(3)*r(4)*func;
-          symvals(totf,3)=h*r(4)+func*(6.*r(4)*r(4)-3.*(r(2)*r(2)+r(3)*r(3)));
-          symvals(totf,4)=v3*f2dir+8.*h;
-          break;
-          
-        case isym_Fp1:
-          v3=r(2)*(4.0*r(4)*r(4)-r(2)*r(2)-r(3)*r(3));
-          symvals(totf,0)=v3*func;
-          h=v3*fdir;
-          symvals(totf,1)=h*r(2)+func*(4.*r(4)*r(4)-3.*r(2)*r(2)-r(3)*r(3));
-          symvals(totf,2)=h*r(3)-2.*r(2)*r(3)*func;
-          symvals(totf,3)=h*r(4)+8*r(2)*r(4)*func;
-          symvals(totf,4)=v3*f2dir+8.*h;
-
-          break;
-          
-        case isym_Fp2:
-          v3=r(4)*(r(2)*r(2)-r(3)*r(3));
-          symvals(totf,0)=v3*func;
-          h=v3*fdir;
-          symvals(totf,1)=h*r(2)+2.*r(2)*r(4)*func;
-          symvals(totf,2)=h*r(3)-2.*r(4)*r(3)*func;
-          symvals(totf,3)=h*r(4)+func*(r(2)*r(2)-r(3)*r(3));
-          symvals(totf,4)=v3*f2dir+8.*h;
-          break;
-          
-        case isym_Fp3:
-          v3=r(2)*(r(2)*r(2)+r(3)*r(3));
-          symvals(totf,0)=v3*func;
-          h=v3*fdir;
-          symvals(totf,1)=h*r(2)+func*(3.*r(2)*r(2)+r(3)*r(3));
-          symvals(totf,2)=h*r(3)+2.*r(2)*r(3)*func;
-          symvals(totf,3)=h*r(4);
-          symvals(totf,4)=v3*f2dir+8.*h+func*8.*r(2);
-          break;
-       case isym_Fp3mod:
-          v3=r(2)*(r(2)*r(2)-3.*r(3)*r(3));
-          symvals(totf,0)=v3*func;
-          h=v3*fdir;
-          symvals(totf,1)=h*r(2)+func*(3.*r(2)*r(2)-3.0*r(3)*r(3));
-          symvals(totf,2)=h*r(3)-6.0*r(2)*r(3)*func;
-          symvals(totf,3)=h*r(4);
-          symvals(totf,4)=v3*f2dir+8.*h;
-          break;   
-          
-          
-          
-        case isym_Gxxxx: // g xxxx done by MB
-	  v2=r(2)*r(2);
-	  v3=v2*r(2);
-	  v4=v2*v2;
-	  h=v4*fdir;
-          symvals(totf,0)=v4*func;
-          symvals(totf,1)=4.*v3*func+h*r(2);
-          symvals(totf,2)=h*r(3);
-          symvals(totf,3)=h*r(4);
-          symvals(totf,4)=12.*v2*func+10.*h+v4*f2dir;
-          break;
-
-        case isym_Gyyyy: // g yyyy
-	  v2=r(3)*r(3);
-	  v3=v2*r(3);
-	  v4=v2*v2;
-	  h=v4*fdir;
-          symvals(totf,0)=v4*func;
-          symvals(totf,1)=h*r(2);
-          symvals(totf,2)=4.*v3*func+h*r(3);
-          symvals(totf,3)=h*r(4);
-          symvals(totf,4)=12.*v2*func+10.*h+v4*f2dir;
-	  break;
-
-        case isym_Gzzzz: // g zzzz
-	  v2=r(4)*r(4);
-	  v3=v2*r(4);
-	  v4=v2*v2;
-	  h=v4*fdir;
-          symvals(totf,0)=v4*func;
-          symvals(totf,1)=h*r(2);
-          symvals(totf,2)=h*r(3);
-          symvals(totf,3)=4.*v3*func+h*r(4);
-          symvals(totf,4)=12.*v2*func+10.*h+v4*f2dir;
-          break;
-
-        case isym_Gxxxy: // g xxxy
-	  v2=r(2)*r(2);
-	  v3=v2*r(2);
-	  v4=v2*v2;
-	  h=fdir*v3;	
-	  symvals(totf,0)=v3*r(3)*func;
-          symvals(totf,1)=r(3)*(3.*v2*func+v4*fdir);
-          symvals(totf,2)=v3*func+r(3)*r(3)*h;
-          symvals(totf,3)=h*r(3)*r(4);
-          symvals(totf,4)=r(2)*r(3)*(6.*func+v2*(10.*fdir+f2dir));
-	  break;
-
-        case isym_Gxxxz: // g xxxzarXiv:cond-mat/9503150v2
-	  v2=r(2)*r(2);
-	  v3=v2*r(2);
-	  v4=v2*v2;
-	  h=fdir*v3;
-	  symvals(totf,0)=v3*r(4)*func;
-          symvals(totf,1)=r(4)*(3.*v2*func+v4*fdir);
-          symvals(totf,2)=h*r(3)*r(4);
-          symvals(totf,3)=v3*func+r(4)*r(4)*h;
-          symvals(totf,4)=r(2)*r(4)*(6.*func+v2*(10.*fdir+f2dir));
-          break;
-
-        case isym_Gyyyx: // g yyyx
-	  v2=r(3)*r(3);
-	  v3=v2*r(3);
-	  v4=v2*v2;
-          h=fdir*v3;
-	  symvals(totf,0)=v3*r(2)*func;
-          symvals(totf,1)=v3*func+r(2)*r(2)*h;
-          symvals(totf,2)=r(2)*(3.*v2*func+v4*fdir);
-          symvals(totf,3)=h*r(2)*r(4);
-          symvals(totf,4)=r(2)*r(3)*(6.*func+v2*(10.*fdir+f2dir));
-          break;
-
-        case isym_Gyyyz: // g yyyz
-	  v2=r(3)*r(3);
-	  v3=v2*r(3);
-	  v4=v2*v2;
-          h=fdir*v3;
-	  symvals(totf,0)=v3*r(4)*func;
-          symvals(totf,1)=h*r(2)*r(4);
-          symvals(totf,2)=r(4)*(3.*v2*func+v4*fdir);
-          symvals(totf,3)=v3*func+r(4)*r(4)*h;
-          symvals(totf,4)=r(4)*r(3)*(6.*func+v2*(10.*fdir+f2dir));
-          break;
-
-        case isym_Gzzzx: // g zzzx
-	  v2=r(4)*r(4);
-	  v3=v2*r(4);
-	  v4=v2*v2;
-	  h=fdir*v3;
-	  symvals(totf,0)=v3*r(2)*func;
-          symvals(totf,1)=v3*func+r(2)*r(2)*h;
-          symvals(totf,2)=h*r(2)*r(3);
-          symvals(totf,3)=r(2)*(3.*v2*func+v4*fdir);
-          symvals(totf,4)=r(2)*r(4)*(6.*func+v2*(10.*fdir+f2dir));
-          break;
-
-        case isym_Gzzzy: // g zzzy
-	  v2=r(4)*r(4);
-	  v3=v2*r(4);
-	  v4=v2*v2;
-          h=fdir*v3;
-	  symvals(totf,0)=v3*r(3)*func;
-          symvals(totf,1)=h*r(3)*r(2);
-          symvals(totf,2)=v3*func+r(3)*r(3)*h;
-          symvals(totf,3)=r(3)*(3.*v2*func+v4*fdir);
-          symvals(totf,4)=r(3)*r(4)*(6.*func+v2*(10.*fdir+f2dir));
-          break;
-
-        case isym_Gxxyy: // g xxyy
-	  v2=r(2)*r(2);
-	  u2=r(3)*r(3);
-	  v2u2=v2*u2;
-	  symvals(totf,0)=v2u2*func;
-	  symvals(totf,1)=r(2)*u2*(2.*func+v2*fdir);
-          symvals(totf,2)=r(3)*v2*(2.*func+u2*fdir);
-          symvals(totf,3)=v2u2*r(4)*fdir;
-	  symvals(totf,4)=2.*(v2+u2)*func+v2u2*(10.*fdir+f2dir);
-	  break;
-
-        case isym_Gxxzz: // g xxzz
-	  v2=r(2)*r(2);
-	  u2=r(4)*r(4);
-	  v2u2=v2*u2;
-	  symvals(totf,0)=v2u2*func;
-	  symvals(totf,1)=r(2)*u2*(2.*func+v2*fdir);
-          symvals(totf,2)=v2u2*r(3)*fdir;
-          symvals(totf,3)=r(4)*v2*(2.*func+u2*fdir);
-	  symvals(totf,4)=2.*(v2+u2)*func+v2u2*(10.*fdir+f2dir);
-          break;
-
-        case isym_Gyyzz: // g yyzz
-	  v2=r(3)*r(3);
-	  u2=r(4)*r(4);
-	  v2u2=v2*u2;
-	  symvals(totf,0)=v2u2*func;
-	  symvals(totf,1)=v2u2*r(2)*fdir;
-          symvals(totf,2)=r(3)*u2*(2.*func+v2*fdir);
-          symvals(totf,3)=r(4)*v2*(2.*func+u2*fdir);
-	  symvals(totf,4)=2.*(v2+u2)*func+v2u2*(10.*fdir+f2dir);
-          break;
-
-        case isym_Gxxyz: // g xxyz
-	  v2=r(2)*r(2);
-	  u2=r(3)*r(4);
-	  symvals(totf,0)=v2*u2*func;
-	  symvals(totf,1)=r(2)*u2*(2.*func+v2*fdir);
-          symvals(totf,2)=v2*r(4)*(func+r(3)*r(3)*fdir);
-	  symvals(totf,3)=v2*r(3)*(func+r(4)*r(4)*fdir);
-	  symvals(totf,4)=u2*(2.*func+v2*(10.*fdir+f2dir));
-          break;
-
-        case isym_Gyyxz: // g yyxz
-	  v2=r(3)*r(3);
-	  u2=r(2)*r(4);
-	  symvals(totf,0)=v2*u2*func;
-	  symvals(totf,1)=v2*r(4)*(func+r(2)*r(2)*fdir);
-          symvals(totf,2)=r(3)*u2*(2.*func+v2*fdir);
-	  symvals(totf,3)=v2*r(2)*(func+r(4)*r(4)*fdir);
-	  symvals(totf,4)=u2*(2.*func+v2*(10.*fdir+f2dir));
-          break;
-
-        case isym_Gzzxy: // g zzxy
-	  v2=r(4)*r(4);
-	  u2=r(2)*r(3);
-	  symvals(totf,0)=v2*u2*func;
-	  symvals(totf,1)=v2*r(3)*(func+r(2)*r(2)*fdir);
-          symvals(totf,2)=v2*r(2)*(func+r(3)*r(3)*fdir);
-	  symvals(totf,3)=r(4)*u2*(2.*func+v2*fdir);
-	  symvals(totf,4)=u2*(2.*func+v2*(10.*fdir+f2dir));
-          break;
-
-	case isym_G0: //g0
-	  x=r(2);
-	  y=r(3);
-	  z=r(4);
-	  v1=x*x;
-	  v2=y*y;
-	  v3=z*z;
-	  v5=v1+v2+v3;
-          v4=35.*v3*v3-30.*v3*v5+3.*v5*v5;
-	  dfdx=  12.0*(v1 + v2 - 4*v3)*x;
-	  dfdy=  12.0 *(v1 + v2 - 4*v3)*y;
-	  dfdz= -48.0*(v1 + v2 + v3)*z + 80*v3*z;
-	  h=fdir*v4;
-          symvals(totf,0)=v4*func;
-	  symvals(totf,1)=func*dfdx+h*x;
-	  symvals(totf,2)=func*dfdy+h*y;
-	  symvals(totf,3)=func*dfdz+h*z;
-	  symvals(totf,4)=2*h+2*fdir*(dfdx*x+dfdy*y+dfdz*z)+v4*f2dir;
-          break;
-
-	case isym_G1: //g1
-	  x=r(2);
-	  y=r(3);
-	  z=r(4);
-	  v1=x*x;
-	  v2=y*y;
-	  v3=z*z;
-	  v5=v1+v2+v3;
-          v4=x*z*(7.*v3-3.*v5);
-	  dfdx= (-9.*v1 - 3.*v2 + 4.*v3)*z;
-	  dfdy= -6.*x*y*z;
-	  dfdz= (-3.*v1 - 3.*v2 + 12.*v3)*x;
-	  h=fdir*v4;
-          symvals(totf,0)=v4*func;
-	  symvals(totf,1)=func*dfdx+h*x;
-	  symvals(totf,2)=func*dfdy+h*y;
-	  symvals(totf,3)=func*dfdz+h*z;
-	  symvals(totf,4)=2*h+2*fdir*(dfdx*x+dfdy*y+dfdz*z)+v4*f2dir;
-	  break;
-
-	case isym_G2: //g2
-	  x=r(2);
-	  y=r(3);
-	  z=r(4);
-	  v1=x*x;
-	  v2=y*y;
-	  v3=z*z;
-	  v5=v1+v2+v3;
-          v4=y*z*(7.*v3-3.*v5);
-	  dfdx= -6.*x*y*z;
-	  dfdy= (-3.*v1 - 9.*v2 + 4.*v3)*z;
-	  dfdz= (-3.*v1 - 3.*v2 + 12.*v3)*y;
-	  h=fdir*v4;
-          symvals(totf,0)=v4*func;
-	  symvals(totf,1)=func*dfdx+h*x;
-	  symvals(totf,2)=func*dfdy+h*y;
-	  symvals(totf,3)=func*dfdz+h*z;
-	  symvals(totf,4)=2*h+2*fdir*(dfdx*x+dfdy*y+dfdz*z)+v4*f2dir;
-	  break;
-
-	case isym_G3: //g3
-	  x=r(2);
-	  y=r(3);
-	  z=r(4);
-	  v1=x*x;
-	  v2=y*y;
-	  v3=z*z;
-	  v5=v1+v2+v3;
-          v4=(v1 - v2)*(-v5 + 7. *v3);
-	  dfdx= -4.*v1*x + 12.*v3*x;
-	  dfdy= 4.*v2*y - 12.*v3*y;
-	  dfdz= 12.*(v1 - 1.*v2)*z;
-	  h=fdir*v4;
-          symvals(totf,0)=v4*func;
-	  symvals(totf,1)=func*dfdx+h*x;
-	  symvals(totf,2)=func*dfdy+h*y;
-	  symvals(totf,3)=func*dfdz+h*z;
-	  symvals(totf,4)=2*h+2*fdir*(dfdx*x+dfdy*y+dfdz*z)+v4*f2dir;
-	  break;
-	  
-	case isym_G4: //g4
-	  x=r(2);
-	  y=r(3);
-	  z=r(4);
-	  v1=x*x;
-	  v2=y*y;
-	  v3=z*z;
-	  v5=v1+v2+v3;
-          v4=x*y*(-v5 + 7. *v3);
-	  dfdx= (-3.*v1 - 1.*v2 + 6.*v3)*y;
-	  dfdy= (-1.*v1 - 3.*v2 + 6.*v3)*x;
-	  dfdz= 12.*x*y*z;
-	  h=fdir*v4;
-          symvals(totf,0)=v4*func;
-	  symvals(totf,1)=func*dfdx+h*x;
-	  symvals(totf,2)=func*dfdy+h*y;
-	  symvals(totf,3)=func*dfdz+h*z;
-	  symvals(totf,4)=2*h+2*fdir*(dfdx*x+dfdy*y+dfdz*z)+v4*f2dir;
-	  break;
-
-       case isym_G5: //g5
-	  x=r(2);
-	  y=r(3);
-	  z=r(4);
-	  v1=x*x;
-	  v2=y*y;
-	  v3=z*z;
-	  v5=v1+v2+v3;
-          v4=x*z*(v1-3.*v2);
-	  dfdx= 3*(v1 - v2)*z;
-	  dfdy= -6*x*y*z;
-	  dfdz= (v1 - 3*v2)*x;
-	  h=fdir*v4;
-          symvals(totf,0)=v4*func;
-	  symvals(totf,1)=func*dfdx+h*x;
-	  symvals(totf,2)=func*dfdy+h*y;
-	  symvals(totf,3)=func*dfdz+h*z;
-	  symvals(totf,4)=2*h+2*fdir*(dfdx*x+dfdy*y+dfdz*z)+v4*f2dir;
-	  break;
-
-	case isym_G6: //g6
-	  x=r(2);
-	  y=r(3);
-	  z=r(4);
-	  v1=x*x;
-	  v2=y*y;
-	  v3=z*z;
-	  v5=v1+v2+v3;
-          v4=y*z*(3*v1-v2);
-	  dfdx= 6*x*y*z;
-	  dfdy= 3*(v1 - v2)*z;
-	  dfdz= (3*v1 - v2)*y;
-	  h=fdir*v4;
-          symvals(totf,0)=v4*func;
-	  symvals(totf,1)=func*dfdx+h*x;
-	  symvals(totf,2)=func*dfdy+h*y;
-	  symvals(totf,3)=func*dfdz+h*z;
-	  symvals(totf,4)=2*h+2*fdir*(dfdx*x+dfdy*y+dfdz*z)+v4*f2dir;
-	  break;
-
-	case isym_G7: //g7
-	  x=r(2);
-	  y=r(3);
-	  z=r(4);
-	  v1=x*x;
-	  v2=y*y;
-	  v3=z*z;
-	  v5=v1+v2+v3;
-          v4=(v1-3.*v2)*v1-(3.*v1-v2)*v2;
-	  dfdx= 2*x*(2.*v1 - 6*v2);
-	  dfdy= 2*y*(-6*v1 + 2*v2);
-	  h=fdir*v4;
-          symvals(totf,0)=v4*func;
-	  symvals(totf,1)=func*dfdx+h*x;
-	  symvals(totf,2)=func*dfdy+h*y;
-	  symvals(totf,3)=h*z;
-	  symvals(totf,4)=2*h+2*fdir*(dfdx*x+dfdy*y)+v4*f2dir;
-	  break;
-
-	case isym_G8: //g8
-	  x=r(2);
-	  y=r(3);
-	  z=r(4);
-	  v1=x*x;
-	  v2=y*y;
-	  v3=z*z;
-	  v5=v1+v2+v3;
-	  v4=x*y*(v1-v2);
-	  dfdx= (3*v1 - v2)*y;
-	  dfdy= (v1 - 3*v2)*x;
-	  h=fdir*v4;
-	  symvals(totf,0)=v4*func;
-	  symvals(totf,1)=func*dfdx+h*x;
-	  symvals(totf,2)=func*dfdy+h*y;
-	  symvals(totf,3)=h*z;
-	  symvals(totf,4)=2*h+2*fdir*(dfdx*x+dfdy*y)+v4*f2dir;
-	  break;
-
-
-        default:
-          error("Bad symmetry in Cubic_spline::calcLap.\n");
-        }
-        //if(fabs(r(4)-3.39275) < 1e-3) { 
-        //  cout << "r " << r(0) << " " << r(1) << "  " 
-        //  << r(2) << "  " << r(3) << " " << r(4) << endl;
-        //  cout << "symmvals " ;
-        //  for(int i=0; i< 5; i++) cout << symvals(totf,i) << " ";
-        //  cout << endl;
-        //  cout << "interval " << interval << " func " << func << endl;
-        //}
+    assert(symvals.GetDim(1) >= 5);
+    static QMC_THREAD_LOCAL Array2 <doublevar> rad_val, mono_val;
+    Array2 <doublevar> & rv(rad_val);
+    Array2 <doublevar> & mv(mono_val);
+    rv.Resize(3,nsplines);
+    evalRadial(r(0),1,&rv(0,0),&rv(1,0),&rv(2,0));
+    evalMonomials(r,1,mv);
+    const int ntot=mv.GetDim(1);
+    const doublevar * m0=mv.v;
+    const int stride=symvals.GetDim(1);
+    doublevar * out=symvals.v+startfill*stride;
+    doublevar x=r(2), y=r(3), z=r(4);
+    for(int s=0; s< nsplines; s++) { 
+      const int nf=nfuncspline(s);
+      const doublevar * coeff=term_coeff.v+term_start(s);
+      const int * mono=term_mono.v+term_start(s);
+      doublevar func=rv(0,s), fdir=rv(1,s);
+      doublevar gx=fdir*x, gy=fdir*y, gz=fdir*z;
+      doublevar flap=rv(2,s)+2.*(spline_l(s)+1)*fdir;
+      switch(spline_nterm(s)) { 
+      case 1: 
+        shellLap<1>(nf,coeff,mono,m0,ntot,func,gx,gy,gz,flap,out,stride);
+        break;
+      case 2: 
+        shellLap<2>(nf,coeff,mono,m0,ntot,func,gx,gy,gz,flap,out,stride);
+        break;
+      case 3: 
+        shellLap<3>(nf,coeff,mono,m0,ntot,func,gx,gy,gz,flap,out,stride);
+        break;
+      default: 
+        shellLap<6>(nf,coeff,mono,m0,ntot,func,gx,gy,gz,flap,out,stride);
       }
+      out+=nf*stride;
     }
   }
+
 }
 
+
 //--------------------------------------------------------------------------
 void Cubic_spline::calcHessian(const Array1 <doublevar> & r,
 			       Array2 <doublevar> & symvals,
@@ -54,6 +54,8 @@ public:
     return rcut;
   }
 
+  int isRadial() { return 1; }
+
   int showinfo(string & indent, ostream & os);
   int writeinput(string &, ostream &);
 
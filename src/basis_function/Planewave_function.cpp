@@ -21,6 +21,9 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "Planewave_function.h"
 #include "qmc_io.h"
 
+QMC_THREAD_LOCAL Array1 <doublevar> Planewave_function::t_cos;
+QMC_THREAD_LOCAL Array1 <doublevar> Planewave_function::t_sin;
+
 /*!
    Note:  We may need to change this to read directly from a file, for memory
    constraints..
@@ -53,6 +56,7 @@ int Planewave_function::read(
       counter++;
     }
   }
+  phases.setup(g_vector);
   //cout << "done " << endl;
   return 0;
 }
@@ -104,17 +108,14 @@ void Planewave_function::calcVal(const Array1 <doublevar> & r,
   assert(r.GetDim(0) >= 5);
   assert(symvals.GetDim(0) >= nmax*2+startfill);
   int index=startfill;
-  doublevar gdotr, t_cos, t_sin;
+  Array1 <doublevar> & t_cos(Planewave_function::t_cos);
+  Array1 <doublevar> & t_sin(Planewave_function::t_sin);
+  t_cos.Resize(nmax);
+  t_sin.Resize(nmax);
+  phases.calc(r, t_cos.v, t_sin.v);
   for(int i=0; i< nmax; i++) {
-    gdotr=g_vector(i,0)*r(2)+g_vector(i,1)*r(3)+g_vector(i,2)*r(4);
-#ifdef __USE_GNU
-    sincos(gdotr, &t_sin, &t_cos);
-#else
-    t_cos=cos(gdotr);
-    t_sin=sin(gdotr);
-#endif
-    symvals(index++)=t_cos;
-    symvals(index++)=t_sin;
+    symvals(index++)=t_cos(i);
+    symvals(index++)=t_sin(i);
   }
   //cout << "done" << endl;
 }
@@ -131,35 +132,32 @@ void Planewave_function::calcLap(
   assert(symvals.GetDim(1) >= 5);
 
   int index=startfill;
-  doublevar gdotr, t_cos, t_sin;
   doublevar gsquared;
+  Array1 <doublevar> & t_cos(Planewave_function::t_cos);
+  Array1 <doublevar> & t_sin(Planewave_function::t_sin);
+  t_cos.Resize(nmax);
+  t_sin.Resize(nmax);
+  phases.calc(r, t_cos.v, t_sin.v);
   for(int fn=0; fn< nmax; fn++) {
-    gdotr=g_vector(fn,0)*r(2)+g_vector(fn,1)*r(3)+g_vector(fn,2)*r(4);
-
     //Should probably store this one..
     gsquared=g_vector(fn,0)*g_vector(fn,0)
              +g_vector(fn,1)*g_vector(fn,1)
              +g_vector(fn,2)*g_vector(fn,2);
-#ifdef __USE_GNU
-    sincos(gdotr, &t_sin, &t_cos);
-#else
-    t_cos=cos(gdotr);
-    t_sin=sin(gdotr);
-#endif
+    doublevar c=t_cos(fn), s=t_sin(fn);
     //cos function
-    symvals(index, 0)=t_cos;
+    symvals(index, 0)=c;
     for(int i=1; i< 4; i++) {
-      symvals(index, i)=-g_vector(fn, i-1)*t_sin;
+      symvals(index, i)=-g_vector(fn, i-1)*s;
     }
-    symvals(index, 4)=-gsquared*t_cos;
+    symvals(index, 4)=-gsquared*c;
     index++;
 
     //sin function
-    symvals(index, 0)=t_sin;
+    symvals(index, 0)=s;
     for(int i=1; i< 4; i++) {
-      symvals(index, i)=g_vector(fn,i-1)*t_cos;
+      symvals(index, i)=g_vector(fn,i-1)*c;
     }
-    symvals(index, 4)=-gsquared*t_sin;
+    symvals(index, 4)=-gsquared*s;
     index++;
   }
   //cout << "done" << endl;
@@ -179,48 +177,45 @@ void Planewave_function::calcHessian(
   assert(symvals.GetDim(1) >= 10);
 
   int index=startfill;
-  doublevar gdotr, t_cos, t_sin;
   doublevar gx, gy, gz;
   //  doublevar gsquared;
+  Array1 <doublevar> & t_cos(Planewave_function::t_cos);
+  Array1 <doublevar> & t_sin(Planewave_function::t_sin);
+  t_cos.Resize(nmax);
+  t_sin.Resize(nmax);
+  phases.calc(r, t_cos.v, t_sin.v);
   for(int fn=0; fn< nmax; fn++) {
     gx=g_vector(fn, 0);
     gy=g_vector(fn, 1);
     gz=g_vector(fn, 2);
-    gdotr=gx*r(2)+gy*r(3)+gz*r(4);
-
-#ifdef __USE_GNU
-    sincos(gdotr, &t_sin, &t_cos);
-#else
-    t_cos=cos(gdotr);
-    t_sin=sin(gdotr);
-#endif
+    doublevar c=t_cos(fn), s=t_sin(fn);
     
     //cos function
-    symvals(index, 0)=t_cos;
+    symvals(index, 0)=c;
     for(int i=1; i< 4; i++) {
-      symvals(index, i)=-g_vector(fn, i-1)*t_sin;
+      symvals(index, i)=-g_vector(fn, i-1)*s;
     }
 
-    symvals(index, 4)=-gx*gx*t_cos;
-    symvals(index, 5)=-gy*gy*t_cos;
-    symvals(index, 6)=-gz*gz*t_cos;
-    symvals(index, 7)=-gx*gy*t_cos;
-    symvals(index, 8)=-gx*gz*t_cos;
-    symvals(index, 9)=-gy*gz*t_cos;
+    symvals(index, 4)=-gx*gx*c;
+    symvals(index, 5)=-gy*gy*c;
+    symvals(index, 6)=-gz*gz*c;
+    symvals(index, 7)=-gx*gy*c;
+    symvals(index, 8)=-gx*gz*c;
+    symvals(index, 9)=-gy*gz*c;
     
     index++;
 
     //sin function
-    symvals(index, 0)=t_sin;
+    symvals(index, 0)=s;
     for(int i=1; i< 4; i++) {
-      symvals(index, i)=g_vector(fn,i-1)*t_cos;
+      symvals(index, i)=g_vector(fn,i-1)*c;
     }
-    symvals(index, 4)=-gx*gx*t_sin;
-    symvals(index, 5)=-gy*gy*t_sin;
-    symvals(index, 6)=-gz*gz*t_sin;
-    symvals(index, 7)=-gx*gy*t_sin;
-    symvals(index, 8)=-gx*gz*t_sin;
-    symvals(index, 9)=-gy*gz*t_sin;
+    symvals(index, 4)=-gx*gx*s;
+    symvals(index, 5)=-gy*gy*s;
+    symvals(index, 6)=-gz*gz*s;
+    symvals(index, 7)=-gx*gy*s;
+    symvals(index, 8)=-gx*gz*s;
+    symvals(index, 9)=-gy*gz*s;
     
     index++;
   }
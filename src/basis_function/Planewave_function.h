@@ -22,6 +22,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define PLANEWAVE_FUNCTION_H_INCLUDED
 
 #include "Basis_function.h"
+#include "Planewave_phases.h"
 
 /*!
 
@@ -93,6 +94,8 @@ private:
   Array2 <doublevar> g_vector;
   int nmax;
   string centername;
+  Planewave_phases phases;
+  static QMC_THREAD_LOCAL Array1 <doublevar> t_cos, t_sin; //!< per-thread scratch for cos(gr) and sin(gr)
 };
 
 #endif // PLANEWAVE_FUNCTION_H_INCLUDED
@@ -0,0 +1,169 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "Planewave_phases.h"
+#include <algorithm>
+
+//----------------------------------------------------------------------
+
+static void cross3(const doublevar * a, const doublevar * b, doublevar * c) {
+  c[0]=a[1]*b[2]-a[2]*b[1];
+  c[1]=a[2]*b[0]-a[0]*b[2];
+  c[2]=a[0]*b[1]-a[1]*b[0];
+}
+
+/*!
+  The lattice vectors are the shortest g, the shortest g not parallel
+  to it, and the shortest g out of their plane.  This finds the
+  primitive reciprocal vectors for the usual spheres of g-vectors; if
+  it picks a sublattice some g's have fractional coordinates and we
+  fall back to the direct evaluation.
+ */
+int Planewave_phases::setup(Array2 <doublevar> & g_vector) {
+  ng=g_vector.GetDim(0);
+  g.Resize(ng,3);
+  for(int i=0; i< ng; i++)
+    for(int d=0; d< 3; d++) g(i,d)=g_vector(i,d);
+  recursive=0;
+
+  vector < pair <doublevar, int> > bylength;
+  for(int i=0; i< ng; i++) {
+    doublevar len=sqrt(g(i,0)*g(i,0)+g(i,1)*g(i,1)+g(i,2)*g(i,2));
+    if(len > 1e-10) bylength.push_back(make_pair(len,i));
+  }
+  sort(bylength.begin(), bylength.end());
+
+  int nfound=0;
+  const doublevar tol=1e-6;
+  for(unsigned int j=0; j< bylength.size() && nfound < 3; j++) {
+    int i=bylength[j].second;
+    doublevar len=bylength[j].first;
+    doublevar cand[3]={g(i,0),g(i,1),g(i,2)};
+    int independent=0;
+    if(nfound==0) independent=1;
+    else if(nfound==1) {
+      doublevar cross[3];
+      cross3(b[0],cand,cross);
+      doublevar clen=sqrt(cross[0]*cross[0]+cross[1]*cross[1]+cross[2]*cross[2]);
+      independent=clen > tol*len*bylength[0].first;
+    }
+    else {
+      doublevar cross[3];
+      cross3(b[0],b[1],cross);
+      doublevar vol=fabs(cross[0]*cand[0]+cross[1]*cand[1]+cross[2]*cand[2]);
+      doublevar clen=sqrt(cross[0]*cross[0]+cross[1]*cross[1]+cross[2]*cross[2]);
+      independent=vol > tol*len*clen;
+    }
+    if(independent) {
+      for(int d=0; d< 3; d++) b[nfound][d]=cand[d];
+      nfound++;
+    }
+  }
+  if(nfound < 3) return 0;
+
+  //Coordinates of g in the b basis: n=g.inv, with inv the inverse of
+  //the matrix whose rows are the b's.
+  doublevar inv[3][3];
+  doublevar det=b[0][0]*(b[1][1]*b[2][2]-b[1][2]*b[2][1])
+               -b[0][1]*(b[1][0]*b[2][2]-b[1][2]*b[2][0])
+               +b[0][2]*(b[1][0]*b[2][1]-b[1][1]*b[2][0]);
+  for(int i=0; i< 3; i++) {
+    for(int j=0; j< 3; j++) {
+      int i1=(j+1)%3, i2=(j+2)%3, j1=(i+1)%3, j2=(i+2)%3;
+      inv[i][j]=(b[i1][j1]*b[i2][j2]-b[i1][j2]*b[i2][j1])/det;
+    }
+  }
+
+  int nhigh[3];
+  for(int d=0; d< 3; d++) {
+    gint[d].Resize(ng);
+    nlow[d]=nhigh[d]=0;
+  }
+  for(int i=0; i< ng; i++) {
+    for(int d=0; d< 3; d++) {
+      doublevar x=g(i,0)*inv[0][d]+g(i,1)*inv[1][d]+g(i,2)*inv[2][d];
+      int n=int(floor(x+0.5));
+      if(fabs(x-n) > tol*max(1.0,fabs(x))) return 0;
+      gint[d](i)=n;
+      nlow[d]=min(nlow[d],n);
+      nhigh[d]=max(nhigh[d],n);
+    }
+  }
+  for(int d=0; d< 3; d++) {
+    for(int i=0; i< ng; i++) gint[d](i)-=nlow[d];
+    npow[d]=nhigh[d]-nlow[d]+1;
+  }
+  recursive=1;
+  return 1;
+}
+
+//----------------------------------------------------------------------
+
+void Planewave_phases::calc(const Array1 <doublevar> & r, doublevar * re,
+                            doublevar * im) {
+  assert(r.GetDim(0) >= 5);
+  if(!recursive) {
+    for(int i=0; i< ng; i++) {
+      doublevar gdotr=g(i,0)*r(2)+g(i,1)*r(3)+g(i,2)*r(4);
+#ifdef __USE_GNU
+      sincos(gdotr, im+i, re+i);
+#else
+      re[i]=cos(gdotr);
+      im[i]=sin(gdotr);
+#endif
+    }
+    return;
+  }
+
+  //exp(i n b_d.r) at n-nlow[d]
+  static QMC_THREAD_LOCAL Array1 <doublevar> powre[3], powim[3];
+  for(int d=0; d< 3; d++) {
+    doublevar bdotr=b[d][0]*r(2)+b[d][1]*r(3)+b[d][2]*r(4);
+    doublevar c=cos(bdotr), s=sin(bdotr);
+    int zero=-nlow[d], n=npow[d];
+    powre[d].Resize(n);
+    powim[d].Resize(n);
+    doublevar * pr=powre[d].v, * pi=powim[d].v;
+    pr[zero]=1.0; pi[zero]=0.0;
+    for(int k=zero+1; k< n; k++) {
+      pr[k]=pr[k-1]*c-pi[k-1]*s;
+      pi[k]=pr[k-1]*s+pi[k-1]*c;
+    }
+    for(int k=zero-1; k >= 0; k--) {
+      pr[k]=pr[k+1]*c+pi[k+1]*s;
+      pi[k]=pi[k+1]*c-pr[k+1]*s;
+    }
+  }
+
+  const int * i0=gint[0].v, * i1=gint[1].v, * i2=gint[2].v;
+  const doublevar * r0=powre[0].v, * m0=powim[0].v;
+  const doublevar * r1=powre[1].v, * m1=powim[1].v;
+  const doublevar * r2=powre[2].v, * m2=powim[2].v;
+  for(int i=0; i< ng; i++) {
+    doublevar ar=r0[i0[i]], ai=m0[i0[i]];
+    doublevar br=r1[i1[i]], bi=m1[i1[i]];
+    doublevar cr=r2[i2[i]], ci=m2[i2[i]];
+    doublevar abr=ar*br-ai*bi, abi=ar*bi+ai*br;
+    re[i]=abr*cr-abi*ci;
+    im[i]=abr*ci+abi*cr;
+  }
+}
+
+//----------------------------------------------------------------------
@@ -0,0 +1,63 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef PLANEWAVE_PHASES_H_INCLUDED
+#define PLANEWAVE_PHASES_H_INCLUDED
+
+#include "Qmc_std.h"
+
+/*!
+\brief
+Computes exp(i g.r) for a fixed list of g-vectors.
+
+When every g is an integer combination n0 b0 + n1 b1 + n2 b2 of three
+vectors taken from the list, the phase is the product
+exp(i b0.r)^n0 exp(i b1.r)^n1 exp(i b2.r)^n2.  The powers are built by
+repeated multiplication, so an evaluation costs three complex
+exponentials and two complex multiplications per g, instead of a sine
+and cosine per g.  If no such lattice is found (for example, a g list
+that is not on a lattice), every phase is computed directly.
+*/
+class Planewave_phases {
+public:
+  Planewave_phases() { ng=0; recursive=0; }
+
+  //! g_vector is (g, [x y z]); returns 1 if the phases can be built recursively
+  int setup(Array2 <doublevar> & g_vector);
+
+  /*!
+    re(i)+I*im(i)=exp(i g_i.r), with r in the basis function
+    layout (r(2), r(3), r(4) are x, y, z)
+   */
+  void calc(const Array1 <doublevar> & r, doublevar * re, doublevar * im);
+
+  int isRecursive() { return recursive; }
+
+private:
+  int ng;
+  int recursive;
+  Array2 <doublevar> g;
+  doublevar b[3][3];     //!< (lattice vector, [x y z])
+  Array1 <int> gint[3];  //!< index of each g into the power tables
+  int nlow[3];           //!< most negative power in each direction
+  int npow[3];           //!< number of powers in each direction
+};
+
+#endif //PLANEWAVE_PHASES_H_INCLUDED
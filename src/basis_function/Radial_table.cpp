@@ -0,0 +1,120 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "Radial_table.h"
+#include "Spline_fitter.h"
+
+//----------------------------------------------------------------------
+
+int Radial_table::build(Basis_function * bas, doublevar maxspacing,
+                        doublevar maxrange) {
+  npoints=0;
+  nf=0;
+  tabrange=0;
+  if(!bas->isRadial()) return 0;
+  assert(maxspacing > 0);
+
+  nf=bas->nfunc();
+  doublevar cut=0;
+  for(int f=0; f< nf; f++) cut=max(cut,bas->cutoff(f));
+  tabrange=min(cut,maxrange);
+  int nint=max(3,int(ceil(tabrange/maxspacing)));
+  npoints=nint+1;
+  spacing=tabrange/nint;
+  invspacing=1.0/spacing;
+
+  //The analytic forms are singular at zero and cut off exactly at
+  //their cutoff, so the end points are sampled just inside the range.
+  const doublevar eps=1e-8*spacing;
+  Array1 <doublevar> R(5);
+  Array2 <doublevar> lap(nf,5);
+  Array1 <doublevar> x(npoints);
+  Array2 <doublevar> y(nf,npoints);
+  Array1 <doublevar> yp0(nf), ypn(nf);
+  for(int i=0; i< npoints; i++) {
+    x(i)=i*spacing;
+    doublevar r=x(i);
+    if(i==0) r=eps;
+    if(i==npoints-1) r-=eps;
+    R(0)=r; R(1)=r*r; R(2)=r; R(3)=R(4)=0;
+    bas->calcLap(R,lap);
+    for(int f=0; f< nf; f++) {
+      y(f,i)=lap(f,0);
+      if(i==0) yp0(f)=lap(f,1);
+      if(i==npoints-1) ypn(f)=lap(f,1);
+    }
+  }
+
+  coeff.Resize(nf,npoints,4);
+  Spline_fitter spline;
+  Array1 <doublevar> yf(npoints);
+  for(int f=0; f< nf; f++) {
+    for(int i=0; i< npoints; i++) yf(i)=y(f,i);
+    spline.splinefit(x,yf,yp0(f),ypn(f));
+    for(int i=0; i< npoints; i++) {
+      for(int j=0; j< 4; j++) coeff(f,i,j)=spline.getCoeff(i,j);
+    }
+  }
+  return 1;
+}
+
+//----------------------------------------------------------------------
+
+void Radial_table::evaluate(int n, const doublevar * r,
+                            Array2 <doublevar> & val,
+                            Array2 <doublevar> & dfr,
+                            Array2 <doublevar> & lap) {
+  assert(val.GetDim(0) >= nf && val.GetDim(1) >= n);
+  assert(dfr.GetDim(0) >= nf && dfr.GetDim(1) >= n);
+  assert(lap.GetDim(0) >= nf && lap.GetDim(1) >= n);
+  //offset of each point's interval in coeff, and the position in it
+  static QMC_THREAD_LOCAL Array1 <int> interval;
+  static QMC_THREAD_LOCAL Array1 <doublevar> height, rinv;
+  interval.Resize(n);
+  height.Resize(n);
+  rinv.Resize(n);
+  int * iv=interval.v;
+  doublevar * h=height.v;
+  doublevar * ri=rinv.v;
+  for(int p=0; p< n; p++) {
+    assert(r[p] < tabrange);
+    int i=int(r[p]*invspacing);
+    iv[p]=4*i;
+    h[p]=r[p]-i*spacing;
+    ri[p]=1.0/r[p];
+  }
+
+  for(int f=0; f< nf; f++) {
+    const doublevar * c=coeff.v+f*coeff.step1;
+    doublevar * v=val.v+f*val.step1;
+    doublevar * d1=dfr.v+f*dfr.step1;
+    doublevar * d2=lap.v+f*lap.step1;
+    for(int p=0; p< n; p++) {
+      const doublevar * ci=c+iv[p];
+      doublevar hh=h[p];
+      doublevar fr=(ci[1]+hh*(2*ci[2]+hh*3*ci[3]))*ri[p];
+      v[p]=ci[0]+hh*(ci[1]+hh*(ci[2]+hh*ci[3]));
+      d1[p]=fr;
+      d2[p]=2*ci[2]+6*hh*ci[3]+2*fr;
+    }
+  }
+}
+
+//----------------------------------------------------------------------
@@ -0,0 +1,68 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef RADIAL_TABLE_H_INCLUDED
+#define RADIAL_TABLE_H_INCLUDED
+
+#include "Basis_function.h"
+
+/*!
+\brief
+Cubic spline tables of the functions of a radial basis object.
+
+Each function f(r) of the basis is fit by a clamped cubic spline on a
+uniform grid from zero to range(), using the values and the end-point
+derivatives of the analytic function.  The tables must be rebuilt
+whenever the parameters of the basis change.  Evaluation takes a whole
+list of distances at once, so that the inner loops run over points
+and vectorize.
+*/
+class Radial_table {
+public:
+  Radial_table() { npoints=0; nf=0; tabrange=0; }
+
+  /*!
+    Tabulate bas out to the smaller of its cutoff and maxrange, with
+    a grid spacing of at most spacing.  Returns 0 (and leaves the table
+    empty) if bas is not radial.
+  */
+  int build(Basis_function * bas, doublevar spacing, doublevar maxrange);
+
+  int isBuilt() { return npoints > 0; }
+  int nfunc() { return nf; }
+  //! Distances below this are in the table
+  doublevar range() { return tabrange; }
+
+  /*!
+    For n points at distances r[p] < range(), fill
+    val(f,p)=f(r), dfr(f,p)=f'(r)/r and lap(f,p)=f''(r)+2f'(r)/r
+    for each function f.
+  */
+  void evaluate(int n, const doublevar * r, Array2 <doublevar> & val,
+                Array2 <doublevar> & dfr, Array2 <doublevar> & lap);
+
+private:
+  int npoints; //!< number of grid points
+  int nf;
+  doublevar tabrange, spacing, invspacing;
+  Array3 <doublevar> coeff; //!< (function, interval, power)
+};
+
+#endif //RADIAL_TABLE_H_INCLUDED
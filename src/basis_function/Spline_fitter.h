@@ -102,6 +102,11 @@ class Spline_fitter {
   //if we already have support past thresh, does nothing.
   void pad(doublevar thresh);
 
+  doublevar getSpacing() { return spacing; }
+  int nIntervals() { return coeff.GetDim(0); }
+  //coefficient j of interval i, for building evaluation tables
+  doublevar getCoeff(int i, int j) { return coeff(i,j); }
+
  private:
     doublevar invspacing; //1/spacing, so we can do multiplications instead of divisions.
   doublevar spacing;
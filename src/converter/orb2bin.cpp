@@ -0,0 +1,132 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+//Convert a text .orb file into the binary format read by QWalk's
+//MO matrices.  The layout is documented in orbitals/Binary_orb.h.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <complex>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+void usage(const char * name) {
+  cout << "usage: " << name << " <input .orb> <output binary .orb>\n";
+  cout << "Converts a text orbital file into QWalk's binary orbital format.\n";
+  exit(1);
+}
+
+int main(int argc, char ** argv) {
+  if(argc < 3) usage(argv[0]);
+  ifstream is(argv[1]);
+  if(!is) {
+    cout << "Couldn't open " << argv[1] << endl;
+    exit(1);
+  }
+
+  //The entries are MO, function, center, label, counting from one in
+  //the text file and from zero in the binary one.
+  vector <int> entries;
+  int maxmo=0, maxcenter=0, maxbasis=0, maxlabel=0;
+  set < pair <int, int> > functions;
+  string dummy;
+  while(true) {
+    if(!(is >> dummy)) {
+      cout << "Unexpected end of file; did not find COEFFICIENTS" << endl;
+      exit(1);
+    }
+    if(dummy=="COEFFICIENTS") break;
+    int e[4];
+    e[0]=atoi(dummy.c_str());
+    is >> e[1] >> e[2] >> e[3];
+    if(!is || e[0] < 1 || e[1] < 1 || e[2] < 1 || e[3] < 1) {
+      cout << "Bad orbital entry near MO " << dummy << endl;
+      exit(1);
+    }
+    maxmo=max(maxmo,e[0]);
+    maxbasis=max(maxbasis,e[1]);
+    maxcenter=max(maxcenter,e[2]);
+    maxlabel=max(maxlabel,e[3]);
+    functions.insert(make_pair(e[2],e[1]));
+    for(int i=0; i< 4; i++) entries.push_back(e[i]-1);
+  }
+
+  //Complex coefficients are written as (re,im)
+  vector <double> coeff;
+  int iscomplex=-1;
+  for(int i=0; i< maxlabel; i++) {
+    if(!(is >> dummy)) {
+      cout << "Unexpected end of file when reading orbital coefficients" << endl;
+      exit(1);
+    }
+    int thiscomplex=(dummy[0]=='(');
+    if(iscomplex==-1) iscomplex=thiscomplex;
+    else if(iscomplex!=thiscomplex) {
+      cout << "Mixed real and complex coefficients" << endl;
+      exit(1);
+    }
+    istringstream tok(dummy);
+    if(iscomplex) {
+      complex <double> c;
+      tok >> c;
+      coeff.push_back(c.real());
+      coeff.push_back(c.imag());
+    }
+    else {
+      double c;
+      tok >> c;
+      coeff.push_back(c);
+    }
+    if(!tok) {
+      cout << "Couldn't read coefficient " << dummy << endl;
+      exit(1);
+    }
+  }
+  if(iscomplex==-1) iscomplex=0;
+
+  ofstream os(argv[2], ios::binary);
+  if(!os) {
+    cout << "Couldn't open " << argv[2] << " for writing" << endl;
+    exit(1);
+  }
+  const int version=1;
+  int header[8]={version, iscomplex, maxmo, maxcenter, maxbasis,
+                 int(functions.size()), int(entries.size()/4), maxlabel};
+  os.write("QWORBBIN",8);
+  os.write((const char *) header, sizeof(header));
+  if(entries.size())
+    os.write((const char *) &entries[0], entries.size()*sizeof(int));
+  if(coeff.size())
+    os.write((const char *) &coeff[0], coeff.size()*sizeof(double));
+  if(!os) {
+    cout << "Error writing " << argv[2] << endl;
+    exit(1);
+  }
+  cout << "Wrote " << maxmo << " orbitals, " << entries.size()/4
+       << " entries and " << maxlabel << (iscomplex ? " complex" : " real")
+       << " coefficients to " << argv[2] << endl;
+  return 0;
+}
@@ -0,0 +1,19 @@
+######################################################################
+# Compiler definitions for Linux systems with OpenMP threading
+#  (use NTHREADS in the VMC and DMC sections)
+
+
+CXX:=g++
+F77:=gfortran
+
+CXXFLAGS := -O3 -fopenmp \
+   -funroll-loops -ffast-math \
+  $(INCLUDEPATH) -fomit-frame-pointer
+
+
+DEBUG:= -Wall -DNO_RANGE_CHECKING -DNDEBUG    -DDEBUG_WRITE
+LDFLAGS:= -fopenmp
+
+######################################################################
+# This is the invokation to generate dependencies
+DEPENDMAKER:=g++ -MM  $(INCLUDEPATH)
@@ -28,6 +28,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "average.h"
 #include "Generate_sample.h"
 #include <algorithm>
+#include <map>
 #include <ctime>
 #include <cstdio>
 void Dmc_method::read(vector <string> words,
@@ -105,6 +106,12 @@ void Dmc_method::read(vector <string> words,
 
   if(!readvalue(words, pos=0, branch_start_cutoff, "BRANCH_START_CUTOFF")) 
     branch_start_cutoff=10;
+
+  if(haskeyword(words, pos=0, "DISTRIBUTED_BRANCH")) distributed_branch=1;
+  else distributed_branch=0;
+
+  if(haskeyword(words, pos=0, "ASYNC_BRANCH")) async_branch=1;
+  else async_branch=0;
   
   branch_stop_cutoff=branch_start_cutoff*1.5;
   
@@ -135,10 +142,19 @@ void Dmc_method::read(vector <string> words,
 
   low_io=0;
   if(haskeyword(words, pos=0,"LOW_IO")) low_io=1;
+
+  resident_walkers=0;
+  if(haskeyword(words, pos=0,"RESIDENT_WALKERS")) resident_walkers=1;
+  if(!readvalue(words, pos=0, resident_refresh, "RESIDENT_REFRESH"))
+    resident_refresh=20;
+  if(resident_refresh < 1)
+    error("RESIDENT_REFRESH must be greater than or equal to 1");
   
   allocate(dynamics_words, dyngen);
   dyngen->enforceNodes(1);
 
+  threads.read(words, options);
+
   //MB: forwark walking lengths 
   fw_length.Resize(0);
   fw_length=0;
@@ -208,6 +224,24 @@ int Dmc_method::allocateIntermediateVariables(System * sys,
     pts(i).age.Resize(nelectrons);
     pts(i).age=0;
   }
+
+  branch_source.Resize(nconfig);
+  for(int i=0; i < nconfig; i++) branch_source(i)=i;
+  walker_pending.Resize(nconfig);
+  walker_pending=0;
+  if(resident_walkers) { 
+    walker_sample.Resize(nconfig);
+    walker_wf.Resize(nconfig);
+    walker_stale.Resize(nconfig);
+    walker_sample=NULL;
+    walker_wf=NULL;
+    walker_stale=1;
+    for(int i=0; i < nconfig; i++) { 
+      wfdata->generateWavefunction(walker_wf(i));
+      sys->generateSample(walker_sample(i));
+      walker_sample(i)->attachObserver(walker_wf(i));
+    }
+  }
   
   average_var.Resize(avg_words.size());
   average_var=NULL;
@@ -232,6 +266,7 @@ int Dmc_method::showinfo(ostream & os)
   os << "###########################################################\n";
   os << "Diffusion Monte Carlo:\n";
   os << "Number of processors " <<           mpi_info.nprocs << endl;
+  threads.showinfo(os);
   os << "Blocks: " <<                        nblock    << endl;
   os << "Steps per block: " <<               nstep     << endl;
   os << "Timestep: " <<                      timestep  << endl;
@@ -239,6 +274,13 @@ int Dmc_method::showinfo(ostream & os)
     os << "T-moves turned on" << endl;
   if(tmoves_sizeconsistent)
     os << "Size-consistent T-moves turned on" << endl;
+  if(distributed_branch)
+    os << "Distributed branching" << endl;
+  if(async_branch)
+    os << "Walker migration overlapped with propagation" << endl;
+  if(resident_walkers)
+    os << "Wave functions resident per walker; full recompute every " 
+       << resident_refresh << " branching steps" << endl;
 
   string indent="  ";
 
@@ -328,10 +370,20 @@ void Dmc_method::runWithVariables(Properties_manager & prop,
                                   ostream & output)
 {
 
+  rng.newRun();
+  //The resident wave functions all belong to wfdata, so the threads
+  //have to be able to share it.
+  if(resident_walkers && threads.nthreads() > 1 && !wfdata->threadSafe())
+    error("RESIDENT_WALKERS can't be used with NTHREADS > 1 for this "
+          "wave function");
   allocateIntermediateVariables(sys, wfdata);
   if(!wfdata->supports(laplacian_update))
     error("DMC doesn't support all-electron moves..please"
           " change your wave function to use the new Jastrow");
+  threads.allocate(sys, wfdata, pseudo, sample, wf, dyngen, 
+                   average_var, avg_words);
+  for(int t=1; t < threads.nthreads(); t++) 
+    threads.sampler(t)->enforceNodes(1);
 
   cout.precision(15);
   output.precision(10);
@@ -366,6 +418,7 @@ void Dmc_method::runWithVariables(Properties_manager & prop,
     nhist=1;
   
   doublevar teff=timestep;
+  int nbranch_since_refresh=0;
   for(int block=0; block < nblock; block++) {
 
     int totkilled=0;  
@@ -374,96 +427,160 @@ void Dmc_method::runWithVariables(Properties_manager & prop,
     for(int step=0; step < nstep; ) {
       int npsteps=min(feedback_interval, nstep-step);
 
-      Dynamics_info dinfo;
       doublevar acsum=0;
       doublevar deltar2=0;
       Array1 <doublevar> epos(3);
       
       doublevar avg_acceptance=0;
       
-      for(int walker=0; walker < nconfig; walker++) {
-        pts(walker).config_pos.restorePos(sample);
-        wf->updateLap(wfdata, sample);
-	//------Do several steps without branching
-        for(int p=0; p < npsteps; p++) {
-          pseudo->randomize();
+      //Walkers that are still arriving from other nodes go last, so that 
+      //their transfer overlaps with the propagation of the others.
+      Array1 <int> walker_order(nconfig);
+      int norder=0;
+      for(int walker=0; walker < nconfig; walker++) 
+        if(!walker_pending(walker)) walker_order(norder++)=walker;
+      for(int walker=0; walker < nconfig; walker++) 
+        if(walker_pending(walker)) walker_order(norder++)=walker;
+
+      //MPI is only called from the master thread, so with several 
+      //threads all arrivals are completed before the walkers are moved.
+      Array2 <long int> seeds;
+      if(threads.nthreads() > 1) { 
+        finishWalkerTransfers();
+        threads.generateSeeds(seeds);
+      }
+      int nthreadpoints=0;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(threads.nthreads()) \
+    reduction(+:acsum,deltar2,avg_acceptance,nthreadpoints)
+#endif
+      {
+        if(threads.nthreads() > 1) threads.seedThread(seeds);
+        int thread=Walker_threads::thread();
+        System * sys=threads.system(thread);
+        Wavefunction_data * wfdata=threads.wfdata(thread);
+        Pseudopotential * pseudo=threads.pseudo(thread);
+        Dynamics_generator * dyngen=threads.sampler(thread);
+        Array1 <Average_generator *> & average_var=threads.average(thread);
+        Dynamics_info dinfo;
+        
+        //Each thread takes the next walker in walker_order as soon as 
+        //it finishes its current one.
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,1)
+#endif
+        for(int iw=0; iw < nconfig; iw++) {
+          int walker=walker_order(iw);
+          if(walker_pending(walker)) finishWalkerTransfers();
+          else if(threads.nthreads()==1) progressWalkerTransfers();
+          //In resident mode each walker keeps its own up-to-date wave function,
+          //so we only need to recompute it when it has been branched or received.
+          Sample_point * sample=threads.sample(thread);
+          Wavefunction * wf=threads.wf(thread);
+          if(resident_walkers) { 
+            sample=walker_sample(walker);
+            wf=walker_wf(walker);
+          }
+          if(!resident_walkers || walker_stale(walker)) { 
+            pts(walker).config_pos.restorePos(sample);
+            wf->updateLap(wfdata, sample);
+            if(resident_walkers) walker_stale(walker)=0;
+          }
+  	//------Do several steps without branching
+          for(int p=0; p < npsteps; p++) {
+            //With counter-based streams, the random numbers depend only on 
+            //the global walker slot and step, not on the thread.
+            int gwalker=mpi_info.node*nconfig+walker;
+            int gstep=block*nstep+step+p;
+            rng.setStream(gwalker, gstep, rng_quadrature);
+            pseudo->randomize();
           
-          for(int e=0; e< nelectrons; e++) {
-            int acc;
-            acc=dyngen->sample(e, sample, wf, wfdata, guidingwf,
-                               dinfo, timestep);
+            rng.setStream(gwalker, gstep, rng_move);
+            for(int e=0; e< nelectrons; e++) {
+              int acc;
+              acc=dyngen->sample(e, sample, wf, wfdata, guidingwf,
+                                 dinfo, timestep);
+            
+              if(dinfo.accepted) 
+                deltar2+=dinfo.diffusion_rate/(nconfig*nelectrons*npsteps);
+              if(dinfo.accepted) {               
+                pts(walker).age(e)=0;
+              }
+              else { 
+                pts(walker).age(e)++;
+              }
+              avg_acceptance+=dinfo.acceptance/(nconfig*nelectrons*npsteps);
             
-            if(dinfo.accepted) 
-              deltar2+=dinfo.diffusion_rate/(nconfig*nelectrons*npsteps);
-            if(dinfo.accepted) {               
-              pts(walker).age(e)=0;
+              if(acc>0) acsum++;
             }
-            else { 
-              pts(walker).age(e)++;
+            nthreadpoints++;
+            rng.setStream(gwalker, gstep, rng_measure);
+            Properties_point pt;
+            if(tmoves or tmoves_sizeconsistent) {  //------------------T-moves
+              doTmove(pt,pseudo,sys,wfdata,wf,sample,guidingwf);
+            } ///---------------------------------done with the T-moves
+            else {
+              mygather.gatherData(pt, pseudo, sys, wfdata, wf, 
+                                  sample, guidingwf);
             }
-            avg_acceptance+=dinfo.acceptance/(nconfig*nelectrons*npsteps);
-            
-            if(acc>0) acsum++;
-          }
-          totpoints++;
-          Properties_point pt;
-          if(tmoves or tmoves_sizeconsistent) {  //------------------T-moves
-            doTmove(pt,pseudo,sys,wfdata,wf,sample,guidingwf);
-          } ///---------------------------------done with the T-moves
-          else {
-            mygather.gatherData(pt, pseudo, sys, wfdata, wf, 
-                                sample, guidingwf);
-          }
-          Dmc_history new_hist;
-          new_hist.main_en=pts(walker).prop.energy(0);
-          pts(walker).past_energies.push_front(new_hist);
-          deque<Dmc_history> & past(pts(walker).past_energies);
-          if(past.size() > nhist) 
-            past.erase(past.begin()+nhist, past.end());
+            Dmc_history new_hist;
+            new_hist.main_en=pts(walker).prop.energy(0);
+            pts(walker).past_energies.push_front(new_hist);
+            deque<Dmc_history> & past(pts(walker).past_energies);
+            if(int(past.size()) > nhist) 
+              past.erase(past.begin()+nhist, past.end());
           
-          pts(walker).prop=pt;
-          if(!pure_dmc) { 
-            pts(walker).weight*=getWeight(pts(walker),teff,etrial);
-            //Introduce potentially a small bias to avoid instability.
-            if(pts(walker).weight>max_poss_weight) pts(walker).weight=max_poss_weight;
-          }
-          else
-            pts(walker).weight=getWeightPURE_DMC(pts(walker),teff,etrial);
+            pts(walker).prop=pt;
+            if(!pure_dmc) { 
+              pts(walker).weight*=getWeight(pts(walker),teff,etrial);
+              //Introduce potentially a small bias to avoid instability.
+              if(pts(walker).weight>max_poss_weight) pts(walker).weight=max_poss_weight;
+            }
+            else
+              pts(walker).weight=getWeightPURE_DMC(pts(walker),teff,etrial);
           
-          if(pts(walker).ignore_walker) {
-            pts(walker).ignore_walker=0;
-            pts(walker).weight=1;
-            pts(walker).prop.count=0;
-          }
-          pts(walker).prop.weight=pts(walker).weight;
-          //This is somewhat inaccurate..will need to change it later
-          //For the moment, the autocorrelation will be slightly
-          //underestimated
-          pts(walker).prop.parent=walker;
-          pts(walker).prop.nchildren=1;
-          pts(walker).prop.children(0)=walker;
-          pts(walker).prop.avgrets.Resize(1,average_var.GetDim(0));
-          for(int i=0; i< average_var.GetDim(0); i++) { 
-            average_var(i)->randomize(wfdata,wf,sys,sample);
-            average_var(i)->evaluate(wfdata, wf, sys, pseudo, sample, pts(walker).prop.avgrets(0,i));
-          }
-          prop.insertPoint(step+p, walker, pts(walker).prop);
-          for(int i=0; i< densplt.GetDim(0); i++)
-            densplt(i)->accumulate(sample,pts(walker).prop.weight(0));
-          for(int i=0; i< nldensplt.GetDim(0); i++)
-            nldensplt(i)->accumulate(sample,pts(walker).prop.weight(0),
-                                     wfdata,wf);
+            if(pts(walker).ignore_walker) {
+              pts(walker).ignore_walker=0;
+              pts(walker).weight=1;
+              pts(walker).prop.count=0;
+            }
+            pts(walker).prop.weight=pts(walker).weight;
+            //This is somewhat inaccurate..will need to change it later
+            //For the moment, the autocorrelation will be slightly
+            //underestimated
+            pts(walker).prop.parent=walker;
+            pts(walker).prop.nchildren=1;
+            pts(walker).prop.children(0)=walker;
+            pts(walker).prop.avgrets.Resize(1,average_var.GetDim(0));
+            for(int i=0; i< average_var.GetDim(0); i++) { 
+              average_var(i)->randomize(wfdata,wf,sys,sample);
+              average_var(i)->evaluate(wfdata, wf, sys, pseudo, sample, pts(walker).prop.avgrets(0,i));
+            }
+            prop.insertPoint(step+p, walker, pts(walker).prop);
+#ifdef _OPENMP
+#pragma omp critical(dmc_accumulate)
+#endif
+            {
+              for(int i=0; i< densplt.GetDim(0); i++)
+                densplt(i)->accumulate(sample,pts(walker).prop.weight(0));
+              for(int i=0; i< nldensplt.GetDim(0); i++)
+                nldensplt(i)->accumulate(sample,pts(walker).prop.weight(0),
+                                         wfdata,wf);
+            }
           
           
-          //MB: making the history of prop.avgrets for forward walking
-          if(max_fw_length){
-            forwardWalking(walker, step+p,prop_fw);
-          }//if FW
+            //MB: making the history of prop.avgrets for forward walking
+            if(max_fw_length){
+              forwardWalking(walker, step+p,prop_fw);
+            }//if FW
           
-        }
+          }
 
-        pts(walker).config_pos.savePos(sample);
+          pts(walker).config_pos.savePos(sample);
+        }
       }
+      totpoints+=nthreadpoints;
+      finishWalkerTransfers();
       //---Finished moving all walkers
 
       doublevar accept_ratio=acsum/(nconfig*nelectrons*npsteps);
@@ -474,10 +591,25 @@ void Dmc_method::runWithVariables(Properties_manager & prop,
       step+=npsteps;
 
       int nkilled;
-      if(!pure_dmc)
-        nkilled=calcBranch();
-      else
+      rng.setStream(mpi_info.node*nconfig, block*nstep+step, rng_branch);
+      if(pure_dmc)
         nkilled=0;
+      else if(distributed_branch)
+        nkilled=calcBranchDistributed();
+      else
+        nkilled=calcBranch();
+      if(!async_branch || step >= nstep) 
+        finishWalkerTransfers();
+
+      if(resident_walkers) { 
+        reassignResidentWalkers();
+        //Periodically recompute from scratch to control the drift
+        //from the accumulated updates.
+        if(++nbranch_since_refresh >= resident_refresh) { 
+          walker_stale=1;
+          nbranch_since_refresh=0;
+        }
+      }
       
       totkilled+=nkilled;
       totbranch+=nkilled;
@@ -542,6 +674,7 @@ void Dmc_method::runWithVariables(Properties_manager & prop,
       output << "maximum age " << maxage 
 	     << " average age " << avgage << endl;
       dyngen->showStats(output);
+      wfdata->showStats(output);
 
       prop.printBlockSummary(output);
 
@@ -551,6 +684,7 @@ void Dmc_method::runWithVariables(Properties_manager & prop,
 	     << " steps " << endl;
     }
     dyngen->resetStats();
+    wfdata->resetStats();
   }
   
   if(output) {
@@ -564,6 +698,7 @@ void Dmc_method::runWithVariables(Properties_manager & prop,
     }
 
   }
+  threads.clear();
   wfdata->clearObserver();
   deallocateIntermediateVariables();
 }
@@ -634,6 +769,7 @@ void Dmc_method::restorecheckpoint(string & filename, System * sys,
   }
   else { 
     Array1 <Config_save_point>  configs;
+    rng.setStream(mpi_info.node*nconfig, 0, rng_init);
     generate_sample(sample,wf,wfdata,guidingwf,nconfig,configs);
     pts.Resize(nconfig);
     for(int i=0; i< nconfig; i++) 
@@ -759,6 +895,7 @@ void Dmc_method::doTmove(Properties_point & pt,Pseudopotential * pseudo, System
   pt.nonlocal(0)-=(sum-1)/timestep;
   //subtract_out_enwt=-(sum-1)/timestep;
   assert(sum >= 0);
+  rng.setPurpose(rng_tmove);
   if(tmoves) { ///Non-size consistent
     doublevar rand=rng.ulec()*sum;
     sum=1; //reset to choose the move
@@ -996,6 +1133,7 @@ int Dmc_method::calcBranch() {
   //cout << mpi_info.node << ": send queue= " << send_queue.size() << endl;
   //now do branching for the walkers that we get to keep
   Array1 <Dmc_point> savepts=pts;
+  branch_source=-1;
   int curr=0; //what walker we're currently copying from
   int curr_copy=0; //what walker we're currently copying to
   while(curr_copy < min(nnwalkers,nconfig)) { 
@@ -1003,6 +1141,7 @@ int Dmc_method::calcBranch() {
       //cout << mpi_info.node << ": copying " << curr << " to " << curr_copy << " branch " << my_branch(curr) << endl;
       my_branch(curr)--;
       pts(curr_copy)=savepts(curr);
+      branch_source(curr_copy)=curr;
       //pts(curr_copy).weight=1;
       curr_copy++;
     }
@@ -1012,7 +1151,10 @@ int Dmc_method::calcBranch() {
   single_write(cout,"Finding out where to send: ",double(time_b-time_a)/CLOCKS_PER_SEC,"\n");
   
   time_a=clock(); 
-  //Finally, send or receive spillover walkers 
+  //Finally, send or receive spillover walkers.  All the walkers going 
+  //to one node are packed together and sent as one message.
+  map <int, Pack_buffer> sendbufs;
+  map <int, vector <int> > recvslots;
   if(nnwalkers > nconfig) { 
     vector<Queue_element>::iterator queue_pos=send_queue.begin();
     while(curr < nconfig) { 
@@ -1023,98 +1165,469 @@ int Dmc_method::calcBranch() {
         }
         //cout << mpi_info.node << ":curr " << curr << " my_branch " << my_branch(curr) << endl;
         //cout << mpi_info.node << ":sending " << queue_pos->from_node << " to " << queue_pos->to_node << endl;
-        savepts(curr).mpiSend(queue_pos->to_node);
+        savepts(curr).pack(sendbufs[queue_pos->to_node]);
         queue_pos++;
       }
       else curr++;
     }
-    
   }
   else { //if nnwalkers == nconfig, then this will just get skipped immediately
     vector <Queue_element>::iterator queue_pos=send_queue.begin();
     while(curr_copy < nconfig) { 
       while(queue_pos->to_node != mpi_info.node) queue_pos++;
       //cout << mpi_info.node <<":receiving from " << queue_pos->from_node << " to " << curr_copy << endl;
-      pts(curr_copy).mpiReceive(queue_pos->from_node);
+      recvslots[queue_pos->from_node].push_back(curr_copy);
       //pts(curr_copy).weight=1;
       curr_copy++;
       queue_pos++;
     }
   }
+  startWalkerTransfers(sendbufs, recvslots);
   time_b=clock();
   single_write(cout,"sending walkers:",double(time_b-time_a)/CLOCKS_PER_SEC,"\n");
   
   return killsize;
   //exit(0);
 }
+
+//----------------------------------------------------------------------
+
+/*!
+  Branching without gathering the population on one node.  The statistics 
+  are the same as calcBranch: every walker with weight above the split 
+  threshold is paired with one of the smallest walkers, and one of the two
+  is copied while the other is killed, so the total population is constant.
+
+  -The smallest walkers are found from a global histogram of log(weight), 
+  so only nbins integers are reduced.
+  -Splitters and kill candidates are numbered by prefix sums over the 
+  per-node counts, and the j'th splitter is paired with the j'th candidate.
+  Only the weights of the pairs that cross nodes are exchanged.
+  -Finally the walkers are laid out in node order by a prefix sum over the new
+  per-node populations, and each node keeps positions [node*nconfig,(node+1)*nconfig).
+  Walkers outside that range go to the nodes that own them, which are 
+  the neighbors unless the imbalance is larger than nconfig.
+ */
+int Dmc_method::calcBranchDistributed() { 
+  const doublevar split_threshold=1.8;
+  const int nbins=64;
+  const doublevar min_logweight=log(1e-4);
+  const doublevar max_logweight=log(split_threshold);
+  int node=mpi_info.node;
+  int nprocs=mpi_info.nprocs;
+
+  long int time_a=clock();
+  //----Local census: splitting walkers, and a histogram of the rest
+  Array1 <int> bin(nconfig);
+  Array1 <int> hist(nbins+1); //the last element counts the splitters
+  hist=0;
+  vector <weight_obj> splitters;
+  for(int walker=0; walker < nconfig; walker++) { 
+    weight_obj tmp;
+    tmp.w=pts(walker).weight;
+    tmp.i=walker;
+    if(tmp.w >= split_threshold) { 
+      bin(walker)=-1;
+      splitters.push_back(tmp);
+    }
+    else {
+      //clamp before converting to int; a killed or underflowed walker
+      //has weight 0 and log(0)=-inf
+      doublevar x=0;
+      if(tmp.w > 0)
+        x=(log(tmp.w)-min_logweight)/(max_logweight-min_logweight)*nbins;
+      bin(walker)=x > 0 ? int(min(x,doublevar(nbins-1))) : 0;
+      hist(bin(walker))++;
+    }
+  }
+  hist(nbins)=splitters.size();
+  //largest first
+  sort(splitters.begin(), splitters.end());
+  reverse(splitters.begin(), splitters.end());
+
+  Array1 <int> globhist(nbins+1);
+#ifdef USE_MPI
+  MPI_Allreduce(hist.v, globhist.v, nbins+1, MPI_INT, MPI_SUM, MPI_Comm_grp);
+#else
+  globhist=hist;
+#endif
+  int nsmall=0;
+  for(int b=0; b< nbins; b++) nsmall+=globhist(b);
+  int npairs=min(globhist(nbins), nsmall);
+
+  //The npairs smallest walkers are everything below cutbin plus 
+  //the smallest (npairs-nbelow) walkers in cutbin.
+  int cutbin=0, nbelow=0;
+  while(cutbin < nbins-1 && nbelow+globhist(cutbin) < npairs) { 
+    nbelow+=globhist(cutbin);
+    cutbin++;
+  }
+
+  //----Per-node counts of splitters, walkers below cutbin, and walkers in it
+  Array1 <int> mycount(3);
+  mycount(0)=splitters.size();
+  mycount(1)=0;
+  for(int b=0; b < cutbin; b++) mycount(1)+=hist(b);
+  mycount(2)=hist(cutbin);
+  Array1 <int> allcount(3*nprocs);
+#ifdef USE_MPI
+  MPI_Allgather(mycount.v, 3, MPI_INT, allcount.v, 3, MPI_INT, MPI_Comm_grp);
+#else
+  allcount=mycount;
+#endif
+
+  Array1 <int> nsplit(nprocs), split_start(nprocs);
+  Array1 <int> ncand(nprocs), cand_start(nprocs);
+  int splitsum=0, candsum=0, cutsum=0;
+  for(int n=0; n< nprocs; n++) { 
+    nsplit(n)=min(max(npairs-splitsum,0), allcount(3*n));
+    split_start(n)=splitsum;
+    splitsum+=nsplit(n);
+    int take_cut=min(max(npairs-nbelow-cutsum,0), allcount(3*n+2));
+    cutsum+=allcount(3*n+2);
+    ncand(n)=min(allcount(3*n+1)+take_cut, max(npairs-candsum,0));
+    cand_start(n)=candsum;
+    candsum+=ncand(n);
+  }
+  assert(splitsum==npairs);
+  assert(candsum==npairs);
+
+  //----Our kill candidates, smallest first
+  vector <weight_obj> cands, cutcands;
+  for(int walker=0; walker < nconfig; walker++) { 
+    weight_obj tmp;
+    tmp.w=pts(walker).weight;
+    tmp.i=walker;
+    if(bin(walker) >= 0 && bin(walker) < cutbin) cands.push_back(tmp);
+    else if(bin(walker)==cutbin) cutcands.push_back(tmp);
+  }
+  sort(cutcands.begin(), cutcands.end());
+  for(vector<weight_obj>::iterator i=cutcands.begin(); 
+      i!=cutcands.end() && int(cands.size()) < ncand(node); i++) 
+    cands.push_back(*i);
+  sort(cands.begin(), cands.end());
+  assert(int(cands.size())==ncand(node));
+  
+  //node that holds the given global splitter or candidate index
+  Array1 <int> cand_owner(npairs), split_owner(npairs);
+  for(int n=0; n< nprocs; n++) { 
+    for(int j=0; j< nsplit(n); j++) split_owner(split_start(n)+j)=n;
+    for(int j=0; j< ncand(n); j++) cand_owner(cand_start(n)+j)=n;
+  }
+
+  //----Pair up.  Splitters send their weights to the candidates' nodes,
+  //which decide which of the two survives and send back the result.
+  Array1 <int> my_branch(nconfig);
+  my_branch=1;
+  vector < vector <doublevar> > sendbuf(nprocs), recvbuf(nprocs);
+  for(int j=0; j< nsplit(node); j++) 
+    sendbuf[cand_owner(split_start(node)+j)].push_back(splitters[j].w);
+  for(int j=0; j < ncand(node); j++) 
+    recvbuf[split_owner(cand_start(node)+j)].push_back(0.0);
+  recvbuf[node]=sendbuf[node];
+#ifdef USE_MPI
+  vector <MPI_Request> requests;
+  for(int n=0; n< nprocs; n++) { 
+    if(n!=node && sendbuf[n].size() > 0) { 
+      requests.push_back(MPI_Request());
+      MPI_Isend(&(sendbuf[n][0]), sendbuf[n].size(), MPI_DOUBLE, n, 0, 
+                MPI_Comm_grp, &requests.back());
+    }
+  }
+  for(int n=0; n< nprocs; n++) { 
+    if(n!=node && recvbuf[n].size() > 0) { 
+      MPI_Status status;
+      MPI_Recv(&(recvbuf[n][0]), recvbuf[n].size(), MPI_DOUBLE, n, 0,
+               MPI_Comm_grp, &status);
+    }
+  }
+  if(requests.size() > 0) 
+    MPI_Waitall(requests.size(), &requests[0], MPI_STATUSES_IGNORE);
+#endif
+
+  //replies hold (splitter survives, new weight) for each pair
+  vector < vector <doublevar> > replybuf(nprocs), resultbuf(nprocs);
+  Array1 <int> nreceived(nprocs);
+  nreceived=0;
+  for(int j=0; j< ncand(node); j++) { 
+    int n=split_owner(cand_start(node)+j);
+    doublevar wbig=recvbuf[n][nreceived(n)++];
+    int smallest=cands[j].i;
+    doublevar wsmall=pts(smallest).weight;
+    doublevar weight1=wbig/(wbig+wsmall);
+    doublevar newweight=(wbig+wsmall)/2.0;
+    if(weight1+rng.ulec() >= 1.0) { 
+      my_branch(smallest)=0;
+      replybuf[n].push_back(1.0);
+    }
+    else { 
+      my_branch(smallest)=2;
+      pts(smallest).weight=newweight;
+      replybuf[n].push_back(0.0);
+    }
+    replybuf[n].push_back(newweight);
+  }
+  for(int j=0; j< nsplit(node); j++) 
+    resultbuf[cand_owner(split_start(node)+j)].push_back(0.0);
+  for(int n=0; n< nprocs; n++) resultbuf[n].resize(2*resultbuf[n].size());
+  resultbuf[node]=replybuf[node];
+#ifdef USE_MPI
+  requests.clear();
+  for(int n=0; n< nprocs; n++) { 
+    if(n!=node && replybuf[n].size() > 0) { 
+      requests.push_back(MPI_Request());
+      MPI_Isend(&(replybuf[n][0]), replybuf[n].size(), MPI_DOUBLE, n, 0, 
+                MPI_Comm_grp, &requests.back());
+    }
+  }
+  for(int n=0; n< nprocs; n++) { 
+    if(n!=node && resultbuf[n].size() > 0) { 
+      MPI_Status status;
+      MPI_Recv(&(resultbuf[n][0]), resultbuf[n].size(), MPI_DOUBLE, n, 0,
+               MPI_Comm_grp, &status);
+    }
+  }
+  if(requests.size() > 0) 
+    MPI_Waitall(requests.size(), &requests[0], MPI_STATUSES_IGNORE);
+#endif
+  nreceived=0;
+  for(int j=0; j< nsplit(node); j++) { 
+    int n=cand_owner(split_start(node)+j);
+    int w=splitters[j].i;
+    int survives=resultbuf[n][nreceived(n)++] > 0.5;
+    doublevar newweight=resultbuf[n][nreceived(n)++];
+    if(survives) { 
+      my_branch(w)=2;
+      pts(w).weight=newweight;
+    }
+    else my_branch(w)=0;
+  }
+  long int time_b=clock();
+  single_write(cout,"matching: ",double(time_b-time_a)/CLOCKS_PER_SEC,"\n");
+
+  //----Rebalance.  Lay out all walkers in node order and keep 
+  //the positions [node*nconfig, (node+1)*nconfig)
+  time_a=clock();
+  int nmine=0, killsize=0;
+  for(int i=0; i< nconfig; i++) { 
+    nmine+=my_branch(i);
+    if(my_branch(i)==0) killsize++;
+  }
+  Array1 <int> nwalkers(nprocs);
+#ifdef USE_MPI
+  MPI_Allgather(&nmine, 1, MPI_INT, nwalkers.v, 1, MPI_INT, MPI_Comm_grp);
+#else
+  nwalkers(0)=nmine;
+#endif
+  Array1 <int> offset(nprocs);
+  int totwalkers=0;
+  for(int n=0; n< nprocs; n++) { 
+    offset(n)=totwalkers;
+    totwalkers+=nwalkers(n);
+  }
+  assert(totwalkers==nprocs*nconfig);
+
+  int my_start=node*nconfig;
+  Array1 <Dmc_point> savepts=pts;
+  branch_source=-1;
+  map <int, Pack_buffer> sendbufs;
+  int p=offset(node);
+  for(int i=0; i< nconfig; i++) { 
+    for(int c=0; c < my_branch(i); c++) { 
+      int dest=p/nconfig;
+      if(dest==node) { 
+        pts(p-my_start)=savepts(i);
+        branch_source(p-my_start)=i;
+      }
+      else savepts(i).pack(sendbufs[dest]);
+      p++;
+    }
+  }
+  map <int, vector <int> > recvslots;
+  for(int n=0; n< nprocs; n++) { 
+    if(n==node) continue;
+    int start=max(offset(n), my_start);
+    int end=min(offset(n)+nwalkers(n), my_start+nconfig);
+    for(int q=start; q < end; q++) 
+      recvslots[n].push_back(q-my_start);
+  }
+  startWalkerTransfers(sendbufs, recvslots);
+  time_b=clock();
+  single_write(cout,"sending walkers:",double(time_b-time_a)/CLOCKS_PER_SEC,"\n");
+  return killsize;
+}
+//----------------------------------------------------------------------
+
+/*!
+  Post the sends of the packed walkers in sendbufs and note which slots 
+  are waiting for walkers from which nodes.  The walkers are in flight until 
+  finishWalkerTransfers(); with ASYNC_BRANCH this happens while the local 
+  walkers are being propagated.
+ */
+void Dmc_method::startWalkerTransfers(map <int, Pack_buffer> & sendbufs,
+                                      map <int, vector <int> > & recvslots) { 
+  assert(send_buffers.size()==0 && recv_nodes.size()==0);
+  //fill send_buffers completely before starting, since the buffers can't move
+  for(map<int,Pack_buffer>::iterator i=sendbufs.begin(); i!=sendbufs.end(); i++) 
+    send_buffers.push_back(i->second);
+  int b=0;
+  for(map<int,Pack_buffer>::iterator i=sendbufs.begin(); i!=sendbufs.end(); i++) 
+    send_buffers[b++].startSend(i->first);
+
+  for(map<int,vector<int> >::iterator i=recvslots.begin(); i!=recvslots.end(); i++) { 
+    recv_nodes.push_back(i->first);
+    recv_slots.push_back(i->second);
+    recv_done.push_back(0);
+    for(vector<int>::iterator s=i->second.begin(); s!=i->second.end(); s++) 
+      walker_pending(*s)=1;
+  }
+}
+
+//----------------------------------------------------------------------
+
+//! Unpack any walkers that have already arrived, without waiting
+void Dmc_method::progressWalkerTransfers() { 
+  Pack_buffer recvbuf;
+  for(unsigned int i=0; i< recv_nodes.size(); i++) { 
+    if(!recv_done[i] && recvbuf.messageWaiting(recv_nodes[i])) { 
+      recvbuf.mpiReceive(recv_nodes[i]);
+      for(vector<int>::iterator s=recv_slots[i].begin(); s!=recv_slots[i].end(); s++) { 
+        pts(*s).unpack(recvbuf);
+        walker_pending(*s)=0;
+      }
+      recv_done[i]=1;
+    }
+  }
+  for(vector<Pack_buffer>::iterator i=send_buffers.begin(); i!=send_buffers.end(); i++) 
+    i->testSend();
+}
+
+//----------------------------------------------------------------------
+
+//! Wait for all walkers in flight to arrive and all sends to finish
+void Dmc_method::finishWalkerTransfers() { 
+  Pack_buffer recvbuf;
+  for(unsigned int i=0; i< recv_nodes.size(); i++) { 
+    if(recv_done[i]) continue;
+    recvbuf.mpiReceive(recv_nodes[i]);
+    for(vector<int>::iterator s=recv_slots[i].begin(); s!=recv_slots[i].end(); s++) { 
+      pts(*s).unpack(recvbuf);
+      walker_pending(*s)=0;
+    }
+  }
+  for(vector<Pack_buffer>::iterator i=send_buffers.begin(); i!=send_buffers.end(); i++) 
+    i->waitSend();
+  send_buffers.clear();
+  recv_nodes.clear();
+  recv_slots.clear();
+  recv_done.clear();
+}
+
+//----------------------------------------------------------------------
+
+/*!
+  After calcBranch has shuffled pts, hand the resident wave functions 
+  over to the slots that now hold their walkers.  The first copy of a walker
+  takes over its state by pointer; further copies and walkers received 
+  from other nodes take a state left over from a killed walker and are 
+  marked for a full recompute.
+ */
+void Dmc_method::reassignResidentWalkers() { 
+  Array1 <Sample_point *> old_sample=walker_sample;
+  Array1 <Wavefunction *> old_wf=walker_wf;
+  Array1 <int> old_stale=walker_stale;
+  Array1 <int> used(nconfig);
+  used=0;
+  walker_sample=NULL;
+  walker_wf=NULL;
+  for(int i=0; i< nconfig; i++) { 
+    int src=branch_source(i);
+    if(src >= 0 && !used(src)) { 
+      used(src)=1;
+      walker_sample(i)=old_sample(src);
+      walker_wf(i)=old_wf(src);
+      walker_stale(i)=old_stale(src);
+    }
+  }
+  int free=0;
+  for(int i=0; i< nconfig; i++) { 
+    if(walker_sample(i)==NULL) { 
+      while(used(free)) free++;
+      used(free)=1;
+      walker_sample(i)=old_sample(free);
+      walker_wf(i)=old_wf(free);
+      walker_stale(i)=1;
+    }
+  }
+}
 //----------------------------------------------------------------------
 
 //----------------------------------------------------------------------
 
 
 void Dmc_point::mpiSend(int node) { 
-#ifdef USE_MPI
-  prop.mpiSend(node);
-  config_pos.mpiSend(node);
+  Pack_buffer buf;
+  pack(buf);
+  buf.mpiSend(node);
+}
+
+//----------------------------------------------------------------------
+
+void Dmc_point::mpiReceive(int node) {
+  Pack_buffer buf;
+  buf.mpiReceive(node);
+  unpack(buf);
+}
+
+//----------------------------------------------------------------------
+
+void Dmc_point::pack(Pack_buffer & buf) { 
+  prop.pack(buf);
+  config_pos.pack(buf);
   int n=past_energies.size();
-  MPI_Send(&n,1, MPI_INT,node,0,MPI_Comm_grp);
+  buf.put(n);
   for(deque<Dmc_history>::iterator i=past_energies.begin();
       i!= past_energies.end(); i++) { 
-    i->mpiSend(node);
+    i->pack(buf);
   }
   
-  //MB: sending the past_properties for the forward walking
+  //MB: the past_properties for the forward walking
   int m=past_properties.size();
-  MPI_Send(&m,1, MPI_INT,node,0,MPI_Comm_grp);
+  buf.put(m);
   for(deque<Dmc_history_avgrets>::iterator i=past_properties.begin();
       i!= past_properties.end(); i++) { 
-    i->mpiSend(node);
+    i->pack(buf);
   }
 
-  MPI_Send(&weight,1,MPI_DOUBLE,node,0,MPI_Comm_grp);
-  MPI_Send(&ignore_walker,1, MPI_INT,node,0,MPI_Comm_grp);
-
-  int nelectrons=age.GetDim(0);
-  MPI_Send(&nelectrons,1, MPI_INT,node,0,MPI_Comm_grp);
-  MPI_Send(age.v,nelectrons, MPI_DOUBLE, node,0,MPI_Comm_grp);
-#endif
+  buf.put(weight);
+  buf.put(ignore_walker);
+  buf.put(age);
 }
 
 //----------------------------------------------------------------------
 
-void Dmc_point::mpiReceive(int node) {
-#ifdef USE_MPI
-  prop.mpiReceive(node);
-  config_pos.mpiReceive(node);
-  int n;
-  MPI_Status status;
-  MPI_Recv(&n,1,MPI_INT,node,0,MPI_Comm_grp, &status);
+void Dmc_point::unpack(Pack_buffer & buf) { 
+  prop.unpack(buf);
+  config_pos.unpack(buf);
+  int n=buf.getInt();
   Dmc_history tmp_hist;
   past_energies.clear();
   for(int i=0; i< n; i++) {
-    tmp_hist.mpiReceive(node);
+    tmp_hist.unpack(buf);
     past_energies.push_back(tmp_hist);
   }
 
-  //MB: receiving the past_properties for the forward walking
-  int m;
-  MPI_Recv(&m,1,MPI_INT,node,0,MPI_Comm_grp, &status);
+  int m=buf.getInt();
   Dmc_history_avgrets tmp_prop;
   past_properties.clear();
   for(int i=0; i< m; i++) {
-    tmp_prop.mpiReceive(node);
+    tmp_prop.unpack(buf);
     past_properties.push_back(tmp_prop);
   }
 
-
-  MPI_Recv(&weight,1,MPI_DOUBLE,node,0,MPI_Comm_grp, &status);
-  MPI_Recv(&ignore_walker,1,MPI_INT,node,0,MPI_Comm_grp, &status);
-      
-  int nelectrons;
-  MPI_Recv(&nelectrons,1,MPI_INT,node,0,MPI_Comm_grp,&status);
-  age.Resize(nelectrons);
-  MPI_Recv(age.v,nelectrons,MPI_DOUBLE, node,0,MPI_Comm_grp,&status);
-#endif
+  buf.get(weight);
+  buf.get(ignore_walker);
+  buf.get(age);
 }
 //----------------------------------------------------------------------
 
@@ -1203,6 +1716,22 @@ void Dmc_history_avgrets::mpiSend(int node) {
 #endif
 }
 
+void Dmc_history_avgrets::pack(Pack_buffer & buf) { 
+  buf.put(weight);
+  int n1=avgrets.GetDim(1);
+  buf.put(n1);
+  for(int j=0;j<n1;j++)
+    buf.put(avgrets(0,j).vals);
+}
+
+void Dmc_history_avgrets::unpack(Pack_buffer & buf) { 
+  buf.get(weight);
+  int n1=buf.getInt();
+  avgrets.Resize(1,n1);
+  for(int j=0;j<n1;j++)
+    buf.get(avgrets(0,j).vals);
+}
+
 void Dmc_history_avgrets::mpiReceive(int node) { 
 #ifdef USE_MPI
   MPI_Status status;
@@ -32,7 +32,9 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "System.h"
 #include "Split_sample.h"
 #include "Properties.h"
+#include "Walker_threads.h"
 #include <deque>
+#include <map>
 
 class Program_options;
 
@@ -40,6 +42,8 @@ struct Dmc_history {
   doublevar main_en;
   void mpiSend(int node);  
   void mpiReceive(int node);
+  void pack(Pack_buffer & buf) { buf.put(main_en); }
+  void unpack(Pack_buffer & buf) { buf.get(main_en); }
   void read(istream & is) { 
     string dummy;
     is >> dummy >> main_en;
@@ -55,6 +59,8 @@ struct Dmc_history_avgrets {
   doublevar weight;
   void mpiSend(int node);
   void mpiReceive(int node);
+  void pack(Pack_buffer & buf);
+  void unpack(Pack_buffer & buf);
   void read(istream & is);
   void write(ostream & os);
 };
@@ -73,8 +79,11 @@ struct Dmc_point {
     ignore_walker=0;
     sign=1;
   }
+  //! The walker is packed into one buffer, so it goes in one message
   void mpiSend(int node);
   void mpiReceive(int node);
+  void pack(Pack_buffer & buf);
+  void unpack(Pack_buffer & buf);
   void read(istream & is);
   void write(ostream & os);
   
@@ -143,6 +152,12 @@ public:
     sample=NULL;
     deallocate(wf);
     wf=NULL;
+    for(int i=0; i< walker_sample.GetDim(0); i++) { 
+      if(walker_sample(i)) delete walker_sample(i);
+      deallocate(walker_wf(i));
+    }
+    walker_sample.Resize(0);
+    walker_wf.Resize(0);
     for(int i=0; i< average_var.GetDim(0); i++) { 
       if(average_var(i)) delete average_var(i);
       average_var(i)=NULL;
@@ -163,6 +178,12 @@ public:
   doublevar getWeightPURE_DMC(Dmc_point & pt,
 			   doublevar teff, doublevar etr);
   int calcBranch();
+  int calcBranchDistributed();
+  void startWalkerTransfers(map <int, Pack_buffer> & sendbufs,
+                            map <int, vector <int> > & recvslots);
+  void progressWalkerTransfers();
+  void finishWalkerTransfers();
+  void reassignResidentWalkers();
   void find_cutoffs();
   void updateEtrial(doublevar feedback);
   
@@ -195,6 +216,10 @@ public:
   doublevar max_poss_weight;
   int max_fw_length; //!maximum length for forward walking time
   int pure_dmc; //turn on SHDMC mode (pure diffusion for the length of nhist)
+  int distributed_branch; //!< pair and rebalance walkers without gathering all weights on one node
+  int async_branch; //!< propagate local walkers while migrating walkers are in flight
+  int resident_walkers; //!< keep a Sample_point and Wavefunction alive for each walker
+  int resident_refresh; //!< recompute resident wave functions from scratch every this many branching steps
 
   //---Control variables and state
   int have_allocated_variables;
@@ -213,6 +238,20 @@ public:
 
   Array1 <Dmc_point> pts;
 
+  //Walker-resident state, indexed like pts.  walker_stale(i) is set 
+  //when walker_wf(i) no longer matches pts(i).config_pos.
+  Array1 <Sample_point *> walker_sample;
+  Array1 <Wavefunction *> walker_wf;
+  Array1 <int> walker_stale;
+  Array1 <int> branch_source; //!< local walker each slot was copied from in calcBranch(-1 if received)
+
+  //Walkers in flight after branching; see startWalkerTransfers()
+  vector <Pack_buffer> send_buffers;
+  vector <int> recv_nodes;
+  vector < vector <int> > recv_slots; //!< slots for the walkers from recv_nodes[i], in order
+  vector <int> recv_done;
+  Array1 <int> walker_pending; //!< slot is waiting for a walker from another node
+
   Array1 < Local_density_accumulator *> densplt;
   vector <vector <string> > dens_words;
   Array1 < Nonlocal_density_accumulator *> nldensplt;
@@ -220,6 +259,8 @@ public:
   Array1 < Average_generator * > average_var;
   vector <vector <string> > avg_words;
 
+  Walker_threads threads; //!< per-thread copies for the walker loop
+
 };
 
 
@@ -285,6 +285,13 @@ void Plot_method::run(Program_options & options, ostream & output) {
   
   int count=0;
   xyz=0;
+  Array2 <doublevar> linepos(D_array1(2),3);
+  Array2 <doublevar> linevals;
+  Array2 <dcomplex> clinevals;
+  if(!use_complex)
+    linevals.Resize(D_array1(2),orblist_pernode(0).GetSize());
+  else
+    clinevals.Resize(D_array1(2),orblist_pernode(0).GetSize());
   for(int xx=0;xx<D_array1(0);xx++){
     doublevar maxatborder=0;
     if(!periodic){
@@ -301,6 +308,7 @@ void Plot_method::run(Program_options & options, ostream & output) {
     for(int yy=0; yy<D_array1(1);yy++){
       if(!periodic)
         xyz(1)=minmax(2)+yy*resolution_array(1,1);  
+      //evaluate the whole line of z points at once
       for(int zz=0; zz<D_array1(2);zz++){
         if(periodic){
           for(int i=0;i<3;i++)
@@ -309,34 +317,37 @@ void Plot_method::run(Program_options & options, ostream & output) {
         }
         else
           xyz(2)=minmax(4)+zz*resolution_array(2,2);
-        mywalker->setElectronPos(electron,xyz); //move elec#1 to point specified by xyz
-        if(!use_complex)
-          mymomat->updateVal(mywalker,electron,0,mymovals); //recalculate MO value for elec#1
-        else
-          cmymomat->updateVal(mywalker,electron,0,cmymovals); //recalculate MO value for elec#1
+        for(int i=0;i<3;i++)
+          linepos(zz,i)=xyz(i);
+      }
+      if(!use_complex)
+        mymomat->updateValBatch(mywalker,electron,0,linepos,linevals); 
+      else
+        cmymomat->updateValBatch(mywalker,electron,0,linepos,clinevals);
+      for(int zz=0; zz<D_array1(2);zz++){
         density(count)=0;
         for(int i=0; i<orblist_pernode(0).GetSize(); i++) {
           if(!use_complex){
-            grid(0,i,count)=mymovals(i,0);
-            density(count)+=mymovals(i,0)*mymovals(i,0);
+            grid(0,i,count)=linevals(zz,i);
+            density(count)+=linevals(zz,i)*linevals(zz,i);
           }
           else{
-            grid(0,i,count)=cmymovals(i,0).real();
-            grid(1,i,count)=cmymovals(i,0).imag();
-            density(count)+=cmymovals(i,0).real()*cmymovals(i,0).real()+
-              cmymovals(i,0).imag()*cmymovals(i,0).imag();
+            grid(0,i,count)=clinevals(zz,i).real();
+            grid(1,i,count)=clinevals(zz,i).imag();
+            density(count)+=clinevals(zz,i).real()*clinevals(zz,i).real()+
+              clinevals(zz,i).imag()*clinevals(zz,i).imag();
           }
         }
         if(!periodic){
           if(zz==D_array1(2)-1 || yy==D_array1(1)-1 ||  xx==D_array1(1)-1){
             for(int i=0; i<orblist_pernode(0).GetSize(); i++) {
               if(!use_complex){
-                if(fabs(mymovals(i,0))>maxatborder )
-                  maxatborder=fabs(mymovals(i,0));
+                if(fabs(linevals(zz,i))>maxatborder )
+                  maxatborder=fabs(linevals(zz,i));
               }
               else{
-                if(cabs(cmymovals(i,0))>maxatborder )
-                  maxatborder=cabs(cmymovals(i,0));
+                if(cabs(clinevals(zz,i))>maxatborder )
+                  maxatborder=cabs(clinevals(zz,i));
               }
               
             }
@@ -34,25 +34,35 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 //######################################################################
 
-void Reptile::mpiSend(int node) { 
-  MPI_Send(direction,node);
+void Reptile::pack(Pack_buffer & buf) { 
+  buf.put(direction);
   int nrep=reptile.size();
-  MPI_Send(nrep,node);
+  buf.put(nrep);
   for(deque<Reptile_point>::iterator r=reptile.begin();
       r!=reptile.end(); r++) {
-    r->mpiSend(node);
+    r->pack(buf);
   }
 }
-void Reptile::mpiReceive(int node) { 
-  MPI_Recv(direction,node);
-  int nrep;
-  MPI_Recv(nrep,node);
+void Reptile::unpack(Pack_buffer & buf) { 
+  buf.get(direction);
+  int nrep=buf.getInt();
   reptile.resize(nrep);
   for(deque<Reptile_point>::iterator r=reptile.begin();
       r!=reptile.end(); r++) {
-    r->mpiReceive(node);
+    r->unpack(buf);
   }
 }
+//The whole reptile goes in one message
+void Reptile::mpiSend(int node) { 
+  Pack_buffer buf;
+  pack(buf);
+  buf.mpiSend(node);
+}
+void Reptile::mpiReceive(int node) { 
+  Pack_buffer buf;
+  buf.mpiReceive(node);
+  unpack(buf);
+}
 //----------------------------------------------------------------------
 void Reptile::read(istream & is) { 
   string dummy;
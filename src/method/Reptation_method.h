@@ -119,6 +119,28 @@ struct Reptile_point {
   }
   //--------------------------------------------------
 
+  void pack(Pack_buffer & buf) { 
+    prop.pack(buf);
+    buf.put(age);
+    buf.put(branching);
+    int nelectrons=electronpos.GetDim(0);
+    buf.put(nelectrons);
+    for(int e=0; e< nelectrons; e++) { 
+      buf.put(electronpos(e));
+    }
+  }
+  void unpack(Pack_buffer & buf) { 
+    prop.unpack(buf);
+    buf.get(age);
+    buf.get(branching);
+    int nelectrons=buf.getInt();
+    electronpos.Resize(nelectrons);
+    for(int e=0; e< nelectrons; e++) { 
+      buf.get(electronpos(e));
+    }
+  }
+  //--------------------------------------------------
+
   void mpiSend(int node) { 
     prop.mpiSend(node);
     MPI_Send(age,node);
@@ -148,6 +170,8 @@ class Reptile {
   public:
   void mpiSend(int node);
   void mpiReceive(int node);
+  void pack(Pack_buffer & buf);
+  void unpack(Pack_buffer & buf);
   void read(istream & is);
   void write(ostream & os);
   deque <Reptile_point> reptile; 
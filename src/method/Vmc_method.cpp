@@ -121,6 +121,8 @@ void Vmc_method::read(vector <string> words,
 
   low_io=0;
   if(haskeyword(words,pos=0,"LOW_IO")) low_io=1;
+
+  threads.read(words, options);
  
 }
 
@@ -214,6 +216,7 @@ int Vmc_method::showinfo(ostream & os)
     os << "Configurations per processor: " <<  nconfig   << endl;
     os << "Number of processors: "        <<  mpi_info.nprocs << endl;
     os << "Total configurations: " <<          nconfig*mpi_info.nprocs << endl;
+    threads.showinfo(os);
     os << "Blocks: " <<                        nblock    << endl;
     os << "Steps per block: " <<               nstep     << endl;
     os << "Number of decorrelation steps: " << ndecorr   << endl;
@@ -276,6 +279,7 @@ void Vmc_method::readcheck(string & filename) {
     config_pos.Resize(nconfig);
     for(int i=0; i< tmpconfig.GetDim(0); i++) { config_pos(i)=tmpconfig(i);} 
     for(int i=tmpconfig.GetDim(0); i< nconfig; i++) {
+      rng.setStream(mpi_info.node*nconfig+i, 0, rng_init);
       sample->randomGuess();
       config_pos(i).savePos(sample);
     }
@@ -347,8 +351,10 @@ void Vmc_method::runWithVariables(Properties_manager & prop,
 
   nelectrons=sys->nelectrons(0)+sys->nelectrons(1);
 
-  
+  rng.newRun();
   allocateIntermediateVariables(sys, wfdata);
+  threads.allocate(sys, wfdata, psp, sample, wf, sampler, 
+                   average_var, avg_words);
   readcheck(readconfig);
 
   cout.precision(10);
@@ -369,9 +375,35 @@ void Vmc_method::runWithVariables(Properties_manager & prop,
  
   for(int block=0; block< nblock; block++) {
     int nwf_guide=wf->nfunc();
-    Dynamics_info dinfo;
 
     doublevar acceptance=0;
+    doublevar block_diffusion=0;
+    doublevar block_lifetime=0;
+    Array2 <long int> seeds;
+    if(threads.nthreads() > 1) threads.generateSeeds(seeds);
+
+    //The walkers are independent, so each thread takes the next 
+    //unmoved walker as soon as it is done with its last one.
+#ifdef _OPENMP
+#pragma omp parallel num_threads(threads.nthreads()) \
+    reduction(+:acceptance,block_diffusion,block_lifetime) \
+    reduction(max:maxlife)
+#endif
+    {
+    if(threads.nthreads() > 1) threads.seedThread(seeds);
+    int thread=Walker_threads::thread();
+    System * sys=threads.system(thread);
+    Wavefunction_data * wfdata=threads.wfdata(thread);
+    Pseudopotential * psp=threads.pseudo(thread);
+    Sample_point * sample=threads.sample(thread);
+    Wavefunction * wf=threads.wf(thread);
+    Dynamics_generator * sampler=threads.sampler(thread);
+    Array1 <Average_generator *> & average_var=threads.average(thread);
+    Dynamics_info dinfo;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,1)
+#endif
     for(int walker=0; walker<nconfig; walker++) {  
       
       config_pos(walker).restorePos(sample);
@@ -387,6 +419,11 @@ void Vmc_method::runWithVariables(Properties_manager & prop,
       }
       
       for(int step=0; step< nstep; step++) {
+        //With counter-based streams, the random numbers depend only on 
+        //the global walker index and step, not on the thread or process.
+        int gwalker=mpi_info.node*nconfig+walker;
+        int gstep=block*nstep+step;
+        rng.setStream(gwalker, gstep, rng_quadrature);
         Array1 <doublevar> rotx(3), roty(3), rotz(3);
         generate_random_rotation(rotx, roty, rotz);
         psp->rotateQuadrature(rotx, roty, rotz);
@@ -395,6 +432,7 @@ void Vmc_method::runWithVariables(Properties_manager & prop,
         
         Array1 <doublevar> oldpos(3);
         Array1 <doublevar> newpos(3);
+        rng.setStream(gwalker, gstep, rng_move);
         for(int decorr=0; decorr< ndecorr; decorr++) {
 
             for(int e=0; e<nelectrons; e++) {
@@ -405,7 +443,7 @@ void Vmc_method::runWithVariables(Properties_manager & prop,
               sample->getElectronPos(e,newpos);
               
               for(int d=0; d< 3; d++) {
-                diffusion_rate(block)+=(newpos(d)-oldpos(d))                  
+                block_diffusion+=(newpos(d)-oldpos(d))                  
                   *(newpos(d)-oldpos(d));
               }
               if(print_wf_vals) { 
@@ -425,20 +463,25 @@ void Vmc_method::runWithVariables(Properties_manager & prop,
                 age(walker,e)++;
                 if(age(walker,e) > maxlife) maxlife=age(walker,e);
               }
-              avglifetime(block)+=age(walker, e);
+              block_lifetime+=age(walker, e);
            }  //electron
         }  //decorrelation
           
         
+        rng.setStream(gwalker, gstep, rng_measure);
         Properties_point pt;
         mygather.gatherData(pt, psp, sys, wfdata, wf, 
                             sample, guidewf);
         
-        for(int i=0; i< densplt.GetDim(0); i++)
-
-          densplt(i)->accumulate(sample,1.0);
-        for(int i=0; i< nldensplt.GetDim(0); i++)
-          nldensplt(i)->accumulate(sample,1.0,wfdata,wf);
+#ifdef _OPENMP
+#pragma omp critical(vmc_accumulate)
+#endif
+        {
+          for(int i=0; i< densplt.GetDim(0); i++)
+            densplt(i)->accumulate(sample,1.0);
+          for(int i=0; i< nldensplt.GetDim(0); i++)
+            nldensplt(i)->accumulate(sample,1.0,wfdata,wf);
+        }
         
         pt.avgrets.Resize(1,average_var.GetDim(0));
         for(int i=0; i< average_var.GetDim(0); i++) { 
@@ -456,7 +499,8 @@ void Vmc_method::runWithVariables(Properties_manager & prop,
           storecheck(config_trace,1);
         }
         if(dump_file!="") { 
-          if(mpi_info.nprocs !=1) error("Only one processor dump for now");
+          if(mpi_info.nprocs !=1 || threads.nthreads() !=1) 
+            error("Only one processor dump for now");
           ofstream dumpout(dump_file.c_str(),ios::app);
           dumpout << pt.energy(0) << " ";
           dumpout << pt.wf_val.sign(0) << " " << pt.wf_val.amp(0,0) << " ";
@@ -473,6 +517,9 @@ void Vmc_method::runWithVariables(Properties_manager & prop,
       config_pos(walker).savePos(sample);
       
     }   //walker
+    }   //parallel
+    diffusion_rate(block)+=block_diffusion;
+    avglifetime(block)+=block_lifetime;
 
     prop.endBlock();
     if(!low_io || block==nblock-1) { 
@@ -506,6 +553,8 @@ void Vmc_method::runWithVariables(Properties_manager & prop,
 
       sampler->showStats(output);
       sampler->resetStats();
+      wfdata->showStats(output);
+      wfdata->resetStats();
       prop.printBlockSummary(output);
       output << endl;
     }
@@ -529,6 +578,7 @@ void Vmc_method::runWithVariables(Properties_manager & prop,
     output << "VMC Done. \n";
   }
  
+  threads.clear();
   wfdata->clearObserver();
   deallocateIntermediateVariables();
 }
@@ -33,6 +33,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "Space_warper.h"
 class Program_options;
 #include "Properties.h"
+#include "Walker_threads.h"
 
 /*!
 \brief
@@ -141,6 +142,8 @@ private:
   Array1 < Average_generator * > average_var;
   vector <vector <string> > avg_words;
 
+  Walker_threads threads; //!< per-thread copies for the walker loop
+
 };
 
 #endif //VMC_METHOD_H_INCLUDED
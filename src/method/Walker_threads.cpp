@@ -0,0 +1,150 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "Walker_threads.h"
+#include "Program_options.h"
+#include "qmc_io.h"
+#include "ulec.h"
+
+//----------------------------------------------------------------------
+
+void Walker_threads::read(vector <string> & words,
+                          Program_options & options) {
+  unsigned int pos=0;
+  if(!readvalue(words, pos=0, nthread, "NTHREADS"))
+    nthread=1;
+  if(nthread < 1)
+    error("NTHREADS must be greater than or equal to 1");
+#ifndef _OPENMP
+  if(nthread > 1)
+    error("NTHREADS > 1 needs a build with OpenMP enabled");
+#endif
+  if(nthread==1) return;
+
+  if(options.twftext.size() < 1)
+    error("NTHREADS needs a TRIALFUNC section");
+  twftext=options.twftext[0];
+  if(!readsection(words, pos=0, dynamics_words, "DYNAMICS"))
+    dynamics_words.push_back("SPLIT");
+}
+
+//----------------------------------------------------------------------
+
+int Walker_threads::showinfo(ostream & os) {
+  if(nthread > 1)
+    os << "Threads per process: " << nthread << endl;
+  return 1;
+}
+
+//----------------------------------------------------------------------
+
+void Walker_threads::allocate(System * sys0, Wavefunction_data * wfdata0,
+                              Pseudopotential * psp0,
+                              Sample_point * sample0, Wavefunction * wf0,
+                              Dynamics_generator * sampler0,
+                              Array1 <Average_generator *> & avg0,
+                              vector <vector <string> > & avg_words) {
+  clear();
+  sys=sys0;
+  psp=psp0;
+  wfdata_.Resize(nthread);
+  sample_.Resize(nthread);
+  wf_.Resize(nthread);
+  sampler_.Resize(nthread);
+  avg.Resize(nthread);
+
+  wfdata_(0)=wfdata0;
+  sample_(0)=sample0;
+  wf_(0)=wf0;
+  sampler_(0)=sampler0;
+  avg(0)=avg0;
+  if(psp) psp->setThreads(nthread);
+
+  Array1 <doublevar> parms;
+  wfdata0->getVarParms(parms);
+  for(int t=1; t < nthread; t++) {
+    if(wfdata0->threadSafe()) wfdata_(t)=wfdata0;
+    else { 
+      wfdata_(t)=NULL;
+      ::allocate(twftext, sys, wfdata_(t));
+      if(wfdata_(t)->nparms()!=parms.GetDim(0))
+        error("Thread copy of the wave function has ", wfdata_(t)->nparms(),
+              " parameters, but the master has ", parms.GetDim(0));
+      wfdata_(t)->setVarParms(parms);
+    }
+    sampler_(t)=NULL;
+    ::allocate(dynamics_words, sampler_(t));
+
+    sample_(t)=NULL;
+    wf_(t)=NULL;
+    sys->generateSample(sample_(t));
+    wfdata_(t)->generateWavefunction(wf_(t));
+    sample_(t)->attachObserver(wf_(t));
+
+    avg(t).Resize(avg_words.size());
+    avg(t)=NULL;
+    for(int i=0; i < avg(t).GetDim(0); i++)
+      ::allocate(avg_words[i], sys, wfdata_(t), avg(t)(i));
+  }
+}
+
+//----------------------------------------------------------------------
+
+void Walker_threads::clear() {
+  for(int t=1; t < wfdata_.GetDim(0); t++) {
+    for(int i=0; i < avg(t).GetDim(0); i++)
+      if(avg(t)(i)) delete avg(t)(i);
+    if(wf_(t)) delete wf_(t);
+    if(sample_(t)) delete sample_(t);
+    if(sampler_(t)) delete sampler_(t);
+    if(wfdata_(t) && wfdata_(t)!=wfdata_(0)) {
+      wfdata_(t)->clearObserver();
+      delete wfdata_(t);
+    }
+  }
+  wfdata_.Resize(0);
+  sample_.Resize(0);
+  wf_.Resize(0);
+  sampler_.Resize(0);
+  avg.Resize(0);
+}
+
+//----------------------------------------------------------------------
+
+void Walker_threads::generateSeeds(Array2 <long int> & seeds) {
+  master_rng=rng;
+  if(rng.counterStreams()) return;
+  seeds.Resize(nthread, 2);
+  for(int t=0; t < nthread; t++) {
+    seeds(t,0)=long(rng.ulec()*1e9)+1;
+    seeds(t,1)=long(rng.ulec()*1e9)+1;
+  }
+}
+
+void Walker_threads::seedThread(Array2 <long int> & seeds) {
+  int t=thread();
+  if(t==0) return;
+  //Counter-based streams only depend on the key, so every thread 
+  //shares the master's.
+  if(master_rng.counterStreams()) rng=master_rng;
+  else rng.seed(seeds(t,0), seeds(t,1));
+}
+
+//----------------------------------------------------------------------
@@ -0,0 +1,115 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+
+#ifndef WALKER_THREADS_H_INCLUDED
+#define WALKER_THREADS_H_INCLUDED
+
+#include "Qmc_std.h"
+#include "System.h"
+#include "Wavefunction.h"
+#include "Wavefunction_data.h"
+#include "Sample_point.h"
+#include "Pseudopotential.h"
+#include "Split_sample.h"
+#include "Average_generator.h"
+#include "ulec.h"
+class Program_options;
+
+/*!
+\brief
+Private copies of the objects that a walker loop modifies, one set per
+shared-memory thread.
+
+The System, Pseudopotential, and Wavefunction_data are shared by all 
+the threads; their scratch space is thread-local.  Each thread gets its
+own Sample_point, Wavefunction, Dynamics_generator, and average 
+generators.  Thread 0 uses the objects that were passed in.  Wave 
+function types that keep state in their Wavefunction_data (see 
+Wavefunction_data::threadSafe()) are instead copied for each thread 
+from the input text, with the variational parameters of the master.
+The NTHREADS keyword sets the number of threads; it defaults to 1, in
+which case nothing is copied.
+*/
+class Walker_threads {
+public:
+  Walker_threads() {
+    nthread=1;
+    sys=NULL;
+    psp=NULL;
+  }
+  ~Walker_threads() {
+    clear();
+  }
+
+  void read(vector <string> & words, Program_options & options);
+  int showinfo(ostream & os);
+
+  int nthreads() { return nthread; }
+
+  /*!
+    Build the per-thread objects.  sample0, wf0, sampler0 and avg0 are
+    the ones the method already owns and become thread 0's.
+  */
+  void allocate(System * sys, Wavefunction_data * wfdata,
+                Pseudopotential * psp,
+                Sample_point * sample0, Wavefunction * wf0,
+                Dynamics_generator * sampler0,
+                Array1 <Average_generator *> & avg0,
+                vector <vector <string> > & avg_words);
+  void clear();
+
+  /*!
+    Seed the random number generators of threads 1..n-1 from the
+    master's stream, so that runs with a fixed seed are reproducible.
+    With counter-based streams the threads get a copy of the master 
+    generator instead.  seedThread() must be called from inside the 
+    parallel region.
+  */
+  void seedThread(Array2 <long int> & seeds);
+  void generateSeeds(Array2 <long int> & seeds);
+
+  System * system(int t) { return sys; }
+  Wavefunction_data * wfdata(int t) { return wfdata_(t); }
+  Pseudopotential * pseudo(int t) { return psp; }
+  Sample_point * sample(int t) { return sample_(t); }
+  Wavefunction * wf(int t) { return wf_(t); }
+  Dynamics_generator * sampler(int t) { return sampler_(t); }
+  Array1 <Average_generator *> & average(int t) { return avg(t); }
+
+  static int thread() { return thread_num(); }
+
+private:
+  int nthread;
+  vector <string> twftext;
+  vector <string> dynamics_words;
+  Random_generator master_rng;
+
+  System * sys;
+  Pseudopotential * psp;
+  Array1 <Wavefunction_data *> wfdata_;
+  Array1 <Sample_point *> sample_;
+  Array1 <Wavefunction *> wf_;
+  Array1 <Dynamics_generator *> sampler_;
+  Array1 <Array1 <Average_generator *> > avg;
+};
+
+#endif //WALKER_THREADS_H_INCLUDED
+//--------------------------------------------------------------------------
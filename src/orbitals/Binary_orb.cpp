@@ -0,0 +1,89 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "Binary_orb.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+
+//----------------------------------------------------------------------
+
+Binary_orbfile::Binary_orbfile() {
+  map=NULL;
+  mapsize=0;
+  header=entries=NULL;
+  coeff=NULL;
+}
+
+//----------------------------------------------------------------------
+
+int Binary_orbfile::isBinary(const string & filename) {
+  ifstream is(filename.c_str(), ios::binary);
+  char sig[8];
+  if(!is.read(sig,8)) return 0;
+  return strncmp(sig,binary_orb_signature,8)==0;
+}
+
+//----------------------------------------------------------------------
+
+void Binary_orbfile::open(const string & filename) {
+  close();
+  int fd=::open(filename.c_str(), O_RDONLY);
+  if(fd < 0) error("couldn't find orb file ", filename);
+  struct stat st;
+  if(fstat(fd,&st) < 0) error("couldn't stat ", filename);
+  mapsize=st.st_size;
+  if(mapsize < size_t(binary_orb_headersize))
+    error("Too short to be a binary orbital file: ", filename);
+  map=mmap(NULL, mapsize, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(map==MAP_FAILED) {
+    map=NULL;
+    error("couldn't map ", filename, " into memory");
+  }
+
+  const char * base=(const char *) map;
+  if(strncmp(base,binary_orb_signature,8)!=0)
+    error("Not a binary orbital file: ", filename);
+  header=(const int *)(base+8);
+  if(header[0]!=binary_orb_version)
+    error("Unknown binary orbital version ", header[0], " in ", filename,
+          "; it may have been written on a machine with a different byte order.");
+  entries=header+8;
+  size_t coeffstart=binary_orb_headersize+size_t(nentries())*4*sizeof(int);
+  coeff=(const double *)(base+coeffstart);
+  size_t need=coeffstart+size_t(ncoeff())*(isComplex() ? 2 : 1)*sizeof(double);
+  if(need > mapsize)
+    error("Binary orbital file is truncated: ", filename);
+}
+
+//----------------------------------------------------------------------
+
+void Binary_orbfile::close() {
+  if(map) munmap(map, mapsize);
+  map=NULL;
+  mapsize=0;
+  header=entries=NULL;
+  coeff=NULL;
+}
+
+//----------------------------------------------------------------------
@@ -0,0 +1,105 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef BINARY_ORB_H_INCLUDED
+#define BINARY_ORB_H_INCLUDED
+
+#include "Qmc_std.h"
+
+/*!
+\brief
+Read-only view of a binary orbital file, as written by orb2bin.
+
+The file holds the same information as a text .orb file, in the byte
+order of the machine that wrote it:
+
+  char[8]  "QWORBBIN"
+  int32    version (binary_orb_version)
+  int32    1 if the coefficients are complex, 0 if real
+  int32    nmo, the largest MO number
+  int32    ncenter, the largest center number
+  int32    maxbasis, the largest function number on a center
+  int32    totbasis, the number of distinct (center, function) pairs
+  int32    nentries
+  int32    ncoeff
+  int32    entries[nentries][4]: MO, function, center, coefficient label,
+           counting from zero
+  double   coeff[ncoeff] (real) or coeff[ncoeff][2] (complex)
+
+The file is mapped into memory, so nothing is parsed or copied until
+the entries are used.
+*/
+class Binary_orbfile {
+public:
+  Binary_orbfile();
+  ~Binary_orbfile() { close(); }
+
+  //! True if filename starts with the binary signature
+  static int isBinary(const string & filename);
+
+  void open(const string & filename);
+  void close();
+
+  int isComplex() { return header[1]; }
+  int nmo() { return header[2]; }
+  int ncenter() { return header[3]; }
+  int maxbasis() { return header[4]; }
+  int totbasis() { return header[5]; }
+  int nentries() { return header[6]; }
+  int ncoeff() { return header[7]; }
+
+  //! entry(i)[0..3] is MO, function, center, label of entry i
+  const int * entry(int i) { return entries+4*i; }
+  //! The coefficients; two doubles per label if isComplex()
+  const double * coefficients() { return coeff; }
+
+private:
+  void * map;
+  size_t mapsize;
+  const int * header;
+  const int * entries;
+  const double * coeff;
+};
+
+const char binary_orb_signature[9]="QWORBBIN";
+const int binary_orb_version=1;
+//! Size in bytes of the signature plus the header
+const int binary_orb_headersize=8+8*4;
+
+//----------------------------------------------------------------------
+
+inline void binary_orb_coeff(const double * c, int iscomplex, int i,
+                             doublevar & val) {
+  if(iscomplex) { 
+    if(fabs(c[2*i+1]) > 1e-10*max(1.0,fabs(c[2*i])))
+      error("The binary orbital file has complex coefficients, but the "
+            "orbitals are real");
+    val=c[2*i];
+  }
+  else val=c[i];
+}
+
+inline void binary_orb_coeff(const double * c, int iscomplex, int i,
+                             dcomplex & val) {
+  if(iscomplex) val=dcomplex(c[2*i],c[2*i+1]);
+  else val=c[i];
+}
+
+#endif //BINARY_ORB_H_INCLUDED
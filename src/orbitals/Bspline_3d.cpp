@@ -0,0 +1,76 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "Bspline_3d.h"
+
+//----------------------------------------------------------------------
+
+/*!
+  The cyclic system is written as a tridiagonal one plus a rank-one
+  correction (Sherman-Morrison).  The corners 1/6 are moved onto the
+  diagonal as -gamma and -1/(36 gamma), with gamma=-4/6.
+ */
+void Periodic_bspline_solver::setup(int n_) {
+  n=n_;
+  if(n < 3) error("Periodic B-spline needs at least 3 points");
+  const doublevar off=1.0/6.0, diag=4.0/6.0;
+  const doublevar gamma=-diag;
+  Array1 <doublevar> b(n,diag);
+  b(0)=diag-gamma;
+  b(n-1)=diag-off*off/gamma;
+  cprime.Resize(n);
+  denom.Resize(n);
+  denom(0)=b(0);
+  cprime(0)=off/denom(0);
+  for(int i=1; i< n; i++) {
+    denom(i)=b(i)-off*cprime(i-1);
+    cprime(i)=off/denom(i);
+  }
+  z.Resize(n);
+  z=0.0;
+  z(0)=gamma;
+  z(n-1)=off;
+  thomas(z);
+  zfact=1.0+z(0)+off*z(n-1)/gamma;
+  work.Resize(n);
+}
+
+//----------------------------------------------------------------------
+
+void Periodic_bspline_solver::thomas(Array1 <doublevar> & x) {
+  const doublevar off=1.0/6.0;
+  x(0)/=denom(0);
+  for(int i=1; i< n; i++)
+    x(i)=(x(i)-off*x(i-1))/denom(i);
+  for(int i=n-2; i >= 0; i--)
+    x(i)-=cprime(i)*x(i+1);
+}
+
+//----------------------------------------------------------------------
+
+void Periodic_bspline_solver::solve(doublevar * data, int stride) {
+  const doublevar off=1.0/6.0, gamma=-4.0/6.0;
+  for(int i=0; i< n; i++) work(i)=data[i*stride];
+  thomas(work);
+  doublevar fact=(work(0)+off*work(n-1)/gamma)/zfact;
+  for(int i=0; i< n; i++) data[i*stride]=work(i)-fact*z(i);
+}
+
+//----------------------------------------------------------------------
@@ -0,0 +1,288 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef BSPLINE_3D_H_INCLUDED
+#define BSPLINE_3D_H_INCLUDED
+
+#include "Qmc_std.h"
+#include "Shared_array.h"
+
+/*!
+  Solves for the coefficients of a periodic interpolating cubic B-spline
+  on n evenly spaced points, that is, the cyclic tridiagonal system
+  (c_{i-1}+4c_i+c_{i+1})/6 = d_i.  The factorization only depends on n,
+  so it is done once in setup().
+ */
+class Periodic_bspline_solver {
+public:
+  void setup(int n);
+  //! Replace data(0),data(stride),... with the spline coefficients.
+  void solve(doublevar * data, int stride);
+private:
+  int n;
+  Array1 <doublevar> cprime; //!< forward elimination of the Thomas algorithm
+  Array1 <doublevar> denom;
+  Array1 <doublevar> z; //!< solution for the Sherman-Morrison correction
+  doublevar zfact;
+  Array1 <doublevar> work;
+  void thomas(Array1 <doublevar> & x);
+};
+
+//----------------------------------------------------------------------
+
+//! The cubic B-spline weights, and their first and second derivatives, at t in [0,1)
+inline void bspline_weights(doublevar t, doublevar * a) {
+  doublevar t2=t*t, t3=t2*t;
+  const doublevar sixth=1.0/6.0;
+  a[0]=sixth*(1.0-3.0*t+3.0*t2-t3);
+  a[1]=sixth*(4.0-6.0*t2+3.0*t3);
+  a[2]=sixth*(1.0+3.0*t+3.0*t2-3.0*t3);
+  a[3]=sixth*t3;
+}
+
+inline void bspline_weights(doublevar t, doublevar * a, doublevar * da,
+                            doublevar * d2a) {
+  bspline_weights(t,a);
+  doublevar t2=t*t;
+  da[0]=-0.5*(1.0-2.0*t+t2);
+  da[1]=1.5*t2-2.0*t;
+  da[2]=0.5+t-1.5*t2;
+  da[3]=0.5*t2;
+  d2a[0]=1.0-t;
+  d2a[1]=3.0*t-2.0;
+  d2a[2]=1.0-3.0*t;
+  d2a[3]=t;
+}
+
+//----------------------------------------------------------------------
+
+const int bspline_block=8;
+
+/*!
+\brief
+A set of real periodic functions on the unit cube, each represented by
+a tricubic interpolating B-spline on the same grid.
+
+All functions are evaluated at once.  The coefficients are stored with
+the function index running fastest, so every one of the 64 grid points
+that contribute at a position is a contiguous stream.  For the 
+derivatives the functions are summed in blocks of bspline_block, with 
+the ten partial sums in local arrays so that the compiler can 
+vectorize the innermost loop.  S is the storage type of the coefficients (float
+or doublevar); the sums are always accumulated in doublevar.  Complex
+functions are handled by the caller as two real ones.
+*/
+template <class S> class Bspline_3d {
+public:
+  Bspline_3d() { ncomp=0; }
+
+  /*!
+    Allocate the coefficients for nfunc functions on an
+    npoints(0) x npoints(1) x npoints(2) grid.  With share=1 they are
+    kept once per node (see Shared_array).
+   */
+  void create(Array1 <int> & npoints, int nfunc, int share=0);
+
+  /*!
+    Interpolate function f through data(stride*((i*ny+j)*nz+k)), its
+    value at (i/nx, j/ny, k/nz).  Does nothing unless writer().
+   */
+  void set(int f, doublevar * data, int stride);
+
+  //! Whether this process computes the coefficients
+  int writer() { return coeff.writer(); }
+  //! Call on every process after the last set()
+  void sync() { coeff.sync(); }
+
+  int nfunc() { return ncomp; }
+
+  //! Values at (u0,u1,u2) in [0,1)^3, in form (function)
+  void val(doublevar u0, doublevar u1, doublevar u2, doublevar * vals);
+
+  /*!
+    Values, gradients and Hessians with respect to u.
+    grad is in form (d, function) and hess in form
+    ([xx xy xz yy yz zz], function).
+   */
+  void vgh(doublevar u0, doublevar u1, doublevar u2, doublevar * vals,
+           doublevar * grad, doublevar * hess);
+
+private:
+  int ncomp;
+  int n[3];
+  int stride0, stride1; //!< strides of the first two grid indices in coeff
+  Shared_array <S> coeff; //!< (i, j, k, function) on the grid padded by 3 in each direction
+  int nstride; //!< ncomp rounded up to a whole number of blocks
+
+  void locate(doublevar u0, doublevar u1, doublevar u2, int * i,
+              doublevar * t) {
+    doublevar u[3]={u0,u1,u2};
+    for(int d=0; d< 3; d++) {
+      doublevar x=u[d]*n[d];
+      i[d]=int(floor(x));
+      t[d]=x-i[d];
+      if(i[d] < 0) { i[d]=0; t[d]=0.0; }
+      if(i[d] >= n[d]) { i[d]=n[d]-1; t[d]=1.0; }
+    }
+  }
+};
+
+//----------------------------------------------------------------------
+
+template <class S> void Bspline_3d<S>::create(Array1 <int> & npoints, int nfunc,
+                                              int share) {
+  assert(npoints.GetDim(0)==3);
+  for(int d=0; d< 3; d++) {
+    n[d]=npoints(d);
+    if(n[d] < 3)
+      error("B-spline grids need at least 3 points in each direction");
+  }
+  ncomp=nfunc;
+  nstride=bspline_block*((ncomp+bspline_block-1)/bspline_block);
+  stride1=(n[2]+3)*nstride;
+  stride0=(n[1]+3)*stride1;
+  int ntot=(n[0]+3)*stride0;
+  coeff.Resize(ntot,share);
+  if(coeff.writer()) 
+    for(int p=0; p< ntot; p++) coeff(p)=S(0.0);
+}
+
+//----------------------------------------------------------------------
+
+template <class S> void Bspline_3d<S>::set(int f, doublevar * data, int stride) {
+  assert(f < ncomp);
+  if(!coeff.writer()) return;
+  int nx=n[0], ny=n[1], nz=n[2];
+  Array1 <doublevar> c(nx*ny*nz);
+  for(int p=0; p< nx*ny*nz; p++) c(p)=data[p*stride];
+
+  Periodic_bspline_solver solver;
+  solver.setup(nz);
+  for(int i=0; i< nx; i++)
+    for(int j=0; j< ny; j++) solver.solve(c.v+(i*ny+j)*nz,1);
+  solver.setup(ny);
+  for(int i=0; i< nx; i++)
+    for(int k=0; k< nz; k++) solver.solve(c.v+i*ny*nz+k,nz);
+  solver.setup(nx);
+  for(int j=0; j< ny; j++)
+    for(int k=0; k< nz; k++) solver.solve(c.v+j*nz+k,ny*nz);
+
+  //Padded grid point p holds coefficient (p-1) mod n, so that the four
+  //points around any position are contiguous.
+  for(int i=0; i< nx+3; i++) {
+    int ci=(i+nx-1)%nx;
+    for(int j=0; j< ny+3; j++) {
+      int cj=(j+ny-1)%ny;
+      for(int k=0; k< nz+3; k++) {
+        int ck=(k+nz-1)%nz;
+        coeff(i*stride0+j*stride1+k*nstride+f)=S(c((ci*ny+cj)*nz+ck));
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------
+
+template <class S> void Bspline_3d<S>::val(doublevar u0, doublevar u1,
+                                           doublevar u2, doublevar * vals) {
+  int i[3];
+  doublevar t[3];
+  locate(u0,u1,u2,i,t);
+  doublevar a[4],b[4],c[4];
+  bspline_weights(t[0],a);
+  bspline_weights(t[1],b);
+  bspline_weights(t[2],c);
+  const S * base=coeff.v+i[0]*stride0+i[1]*stride1+i[2]*nstride;
+  for(int m=0; m< ncomp; m++) vals[m]=0.0;
+  for(int ii=0; ii< 4; ii++) {
+    for(int jj=0; jj< 4; jj++) {
+      const doublevar w=a[ii]*b[jj];
+      const doublevar w0=w*c[0], w1=w*c[1], w2=w*c[2], w3=w*c[3];
+      const S * p0=base+ii*stride0+jj*stride1;
+      const S * p1=p0+nstride;
+      const S * p2=p1+nstride;
+      const S * p3=p2+nstride;
+      for(int m=0; m< ncomp; m++)
+        vals[m]+=w0*p0[m]+w1*p1[m]+w2*p2[m]+w3*p3[m];
+    }
+  }
+}
+
+//----------------------------------------------------------------------
+
+template <class S> void Bspline_3d<S>::vgh(doublevar u0, doublevar u1,
+    doublevar u2, doublevar * vals, doublevar * grad, doublevar * hess) {
+  int i[3];
+  doublevar t[3];
+  locate(u0,u1,u2,i,t);
+  doublevar a[4],da[4],d2a[4],b[4],db[4],d2b[4],c[4],dc[4],d2c[4];
+  bspline_weights(t[0],a,da,d2a);
+  bspline_weights(t[1],b,db,d2b);
+  bspline_weights(t[2],c,dc,d2c);
+  const doublevar n0=n[0], n1=n[1], n2=n[2];
+
+  const S * base=coeff.v+i[0]*stride0+i[1]*stride1+i[2]*nstride;
+  for(int m0=0; m0 < ncomp; m0+=bspline_block) {
+    //value, gradient, and [xx xy xz yy yz zz]
+    doublevar v[10][bspline_block];
+    for(int k=0; k< 10; k++)
+      for(int m=0; m< bspline_block; m++) v[k][m]=0.0;
+    for(int ii=0; ii< 4; ii++) {
+      for(int jj=0; jj< 4; jj++) {
+        const S * p0=base+ii*stride0+jj*stride1+m0;
+        const S * p1=p0+nstride;
+        const S * p2=p1+nstride;
+        const S * p3=p2+nstride;
+        const doublevar w=a[ii]*b[jj], wx=da[ii]*b[jj], wy=a[ii]*db[jj],
+              wxx=d2a[ii]*b[jj], wxy=da[ii]*db[jj], wyy=a[ii]*d2b[jj];
+        for(int m=0; m< bspline_block; m++) {
+          doublevar s0=c[0]*p0[m]+c[1]*p1[m]+c[2]*p2[m]+c[3]*p3[m];
+          doublevar s1=dc[0]*p0[m]+dc[1]*p1[m]+dc[2]*p2[m]+dc[3]*p3[m];
+          doublevar s2=d2c[0]*p0[m]+d2c[1]*p1[m]+d2c[2]*p2[m]+d2c[3]*p3[m];
+          v[0][m]+=w*s0;
+          v[1][m]+=wx*s0;
+          v[2][m]+=wy*s0;
+          v[3][m]+=w*s1;
+          v[4][m]+=wxx*s0;
+          v[5][m]+=wxy*s0;
+          v[6][m]+=wx*s1;
+          v[7][m]+=wyy*s0;
+          v[8][m]+=wy*s1;
+          v[9][m]+=w*s2;
+        }
+      }
+    }
+    //From derivatives in grid units to derivatives in u
+    const doublevar scale[10]={1.0, n0, n1, n2, n0*n0, n0*n1, n0*n2,
+                               n1*n1, n1*n2, n2*n2};
+    int mmax=min(bspline_block,ncomp-m0);
+    for(int m=0; m< mmax; m++) {
+      vals[m0+m]=v[0][m];
+      for(int d=0; d< 3; d++)
+        grad[d*ncomp+m0+m]=scale[d+1]*v[d+1][m];
+      for(int k=0; k< 6; k++)
+        hess[k*ncomp+m0+m]=scale[k+4]*v[k+4][m];
+    }
+  }
+}
+
+//----------------------------------------------------------------------
+
+#endif //BSPLINE_3D_H_INCLUDED
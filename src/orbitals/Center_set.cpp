@@ -23,6 +23,12 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "Basis_function.h"
 #include "CBasis_function.h"
 #include "Sample_point.h"
+#include <algorithm>
+
+QMC_THREAD_LOCAL Array2 <doublevar> Center_set::edist;
+QMC_THREAD_LOCAL int Center_set::edist_e=-1;
+QMC_THREAD_LOCAL Array1 <int> Center_set::nearlist;
+QMC_THREAD_LOCAL int Center_set::nnear=0;
 
 //----------------------------------------------------------------------
 
@@ -52,7 +58,6 @@ void Center_set::read(vector <string> & words, unsigned int pos,
 {
 
   usingsampcenters=usingatoms=0;
-  int nelectrons=sys->nelectrons(0)+sys->nelectrons(1);
   unsigned int startpos=pos;
 
   if(readvalue(words,pos, centerfile, "READ"))
@@ -89,6 +94,10 @@ void Center_set::read(vector <string> & words, unsigned int pos,
 
   if(usingsampcenters) {
     sys->getEquivalentCenters(equiv_centers, ncenters_atom, centers_displacement);
+    havepositions=sys->getCenterPos(position);
+    if(havepositions && position.GetDim(0)!=ncenters) 
+      error("Center_set: the system gave ", position.GetDim(0), 
+            " center positions for ", ncenters, " centers");
   }
   else {
     equiv_centers.Resize(ncenters,1);
@@ -102,7 +111,6 @@ void Center_set::read(vector <string> & words, unsigned int pos,
   }
 
 
-  edist.Resize(nelectrons,ncenters, 5);
   nbasis.Resize(ncenters);
   nbasis=0;
 }
@@ -170,28 +178,31 @@ void Center_set::assignBasis(Array1 <CBasis_function *> basisfunc)
 
 void Center_set::updateDistance(int e, Sample_point * sample)
 {
+  Array2 <doublevar> & edist(Center_set::edist);
+  edist.Resize(ncenters,5);
+  edist_e=e;
   if(usingatoms)
   {
-    Array1 <doublevar> R(5);
     sample->updateEIDist();
+    int stride;
+    const doublevar * row=sample->getEIRow(e,stride);
     for(int i=0; i< ncenters; i++ )
     {
-      sample->getEIDist(e, i, R);
       for(int d=0; d< 5; d++)
       {
-        edist(e,i,d)=R(d);
+        edist(i,d)=row[d*stride+i];
       }
     }
   }
   else if(usingsampcenters) {
-    Array1 <doublevar> R(5);
     sample->updateECDist();
+    int stride;
+    const doublevar * row=sample->getECRow(e,stride);
     for(int i=0; i< ncenters; i++ )
     {
-      sample->getECDist(e, i, R);
       for(int d=0; d< 5; d++)
       {
-        edist(e,i,d)=R(d);
+        edist(i,d)=row[d*stride+i];
       }
     }
   }
@@ -201,22 +212,134 @@ void Center_set::updateDistance(int e, Sample_point * sample)
     sample->getElectronPos(e, r);
     for(int i=0; i< ncenters; i++)
     {
-      edist(e,i,1)=0;
+      edist(i,1)=0;
       for(int d=0; d< 3; d++)
       {
-        edist(e,i,d+2)=r(d)-position(i,d);
-	//cout << "positions " << position(i,d) << " dist " << edist(e,i,d+2) <<  endl;
-        edist(e,i,1)+=edist(e,i,d+2)*edist(e,i,d+2);
+        edist(i,d+2)=r(d)-position(i,d);
+	//cout << "positions " << position(i,d) << " dist " << edist(i,d+2) <<  endl;
+        edist(i,1)+=edist(i,d+2)*edist(i,d+2);
       }
     }
     for(int i=0; i< ncenters; i++)
     {
-      edist(e,i,0)=sqrt(edist(e,i,1));
+      edist(i,0)=sqrt(edist(i,1));
     }
 
   }
 }
 
+//------------------------------------------------------------
+
+void Center_set::buildCellList(doublevar rcut) {
+  screen=0;
+  if(!havepositions || ncenters < 2 || rcut <= 0) return;
+
+  //Cells are at least rcut wide, so only the neighboring cells 
+  //need to be searched.  Limit the grid to a few cells per center.
+  const int maxcell_dim=int(pow(8.0*ncenters,1.0/3.0))+1;
+  cellorigin.Resize(3);
+  cellsize.Resize(3);
+  ncell.Resize(3);
+  int ntot=1;
+  for(int d=0; d< 3; d++) { 
+    doublevar lo=position(0,d), hi=position(0,d);
+    for(int i=1; i< ncenters; i++) { 
+      lo=min(lo,position(i,d));
+      hi=max(hi,position(i,d));
+    }
+    doublevar extent=hi-lo;
+    if(extent/rcut > maxcell_dim) ncell(d)=maxcell_dim;
+    else ncell(d)=max(1,int(extent/rcut));
+    cellorigin(d)=lo;
+    cellsize(d)=max(extent/ncell(d),rcut);
+    ntot*=ncell(d);
+  }
+  if(ntot==1) return;
+
+  //Counting sort of the centers into cells, keeping them in order
+  Array1 <int> cellof(ncenters);
+  cellstart.Resize(ntot+1);
+  cellstart=0;
+  for(int i=0; i< ncenters; i++) { 
+    int c=0;
+    for(int d=0; d< 3; d++) { 
+      int ic=int((position(i,d)-cellorigin(d))/cellsize(d));
+      ic=min(max(ic,0),ncell(d)-1);
+      c=c*ncell(d)+ic;
+    }
+    cellof(i)=c;
+    cellstart(c+1)++;
+  }
+  for(int c=0; c< ntot; c++) cellstart(c+1)+=cellstart(c);
+  Array1 <int> fill(ntot);
+  fill=0;
+  cellcenters.Resize(ncenters);
+  for(int i=0; i< ncenters; i++) { 
+    int c=cellof(i);
+    cellcenters(cellstart(c)+fill(c))=i;
+    fill(c)++;
+  }
+  cellrcut=rcut;
+  screen=1;
+}
+
+//------------------------------------------------------------
+
+void Center_set::updateNearDistance(int e, Sample_point * sample) { 
+  Array1 <int> & nearlist(Center_set::nearlist);
+  nearlist.Resize(ncenters);
+  if(!screen) { 
+    updateDistance(e,sample);
+    for(int i=0; i< ncenters; i++) nearlist(i)=i;
+    nnear=ncenters;
+    return;
+  }
+  Array2 <doublevar> & edist(Center_set::edist);
+  edist.Resize(ncenters,5);
+  edist_e=e;
+  Array1 <doublevar> r(3);
+  sample->getElectronPos(e, r);
+  int lo[3], hi[3];
+  int near=0;
+  nnear=0;
+  for(int d=0; d< 3; d++) { 
+    doublevar flo=floor((r(d)-cellrcut-cellorigin(d))/cellsize(d));
+    doublevar fhi=floor((r(d)+cellrcut-cellorigin(d))/cellsize(d));
+    if(fhi < 0 || flo > ncell(d)-1) return;
+    lo[d]=max(int(flo),0);
+    hi[d]=min(int(fhi),ncell(d)-1);
+  }
+  for(int i=lo[0]; i<= hi[0]; i++) { 
+    for(int j=lo[1]; j <= hi[1]; j++) { 
+      for(int k=lo[2]; k <= hi[2]; k++) { 
+        int c=(i*ncell(1)+j)*ncell(2)+k;
+        for(int p=cellstart(c); p < cellstart(c+1); p++) { 
+          int cen=cellcenters(p);
+          edist(cen,1)=0;
+          for(int d=0; d< 3; d++) { 
+            edist(cen,d+2)=r(d)-position(cen,d);
+            edist(cen,1)+=edist(cen,d+2)*edist(cen,d+2);
+          }
+          edist(cen,0)=sqrt(edist(cen,1));
+          if(edist(cen,0) < cellrcut) nearlist(near++)=cen;
+        }
+      }
+    }
+  }
+  //Keep the order of the centers, so that sums over them don't change
+  sort(nearlist.v, nearlist.v+near);
+  nnear=near;
+}
+
+//------------------------------------------------------------
+
+void Center_set::showinfo(ostream & os) { 
+  if(screen) 
+    os << "Screening " << ncenters << " centers with a " << ncell(0) << "x" 
+       << ncell(1) << "x" << ncell(2) << " cell list, cutoff " 
+       << cellrcut << endl;
+}
+
 /*!
 Uses flat file of form:
 ncenters
@@ -231,6 +354,7 @@ void Center_set::readcenterfile(string & filename)
   if(!centin) error("Couldn't open ", filename);
   centin >> ncenters;
   position.Resize(ncenters,3);
+  havepositions=1;
   string labeltemp;
   for(int i=0; i< ncenters; i++)
   {
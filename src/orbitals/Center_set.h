@@ -47,6 +47,11 @@ label2  x2 y2 z2         <br>
 .                        <br>
 .                        <br>
 
+When the center positions are fixed and the distances to them are 
+Cartesian (READ, and USEGLOBAL for molecules and periodic systems, 
+where the images are separate centers), buildCellList() bins the 
+centers in a grid, so that updateNearDistance() only visits the 
+centers close to the electron.
 */
 class Center_set
 {
@@ -59,7 +64,7 @@ public:
   //!< Number of basis functions on each particle
 
   Center_set()
-  { usingatoms=0;}
+  { usingatoms=0; havepositions=0; screen=0; }
 
   void read(vector <string> & words, unsigned int pos,
             System * sys);
@@ -67,15 +72,38 @@ public:
   void assignBasis(Array1 <CBasis_function *>);
 
   void updateDistance(int, Sample_point *);
+
+  /*!
+    Bin the centers in cells of side at least rcut, the largest cutoff 
+    of the basis functions.  Does nothing if the center positions aren't 
+    known or if everything would fall in one cell.
+   */
+  void buildCellList(doublevar rcut);
+
+  /*!
+    Update the distances from electron e to the centers closer than 
+    rcut, and list them, in increasing order, in nearCenter().  Other 
+    centers are not updated.  Without a cell list, this is 
+    updateDistance() and lists all the centers.
+
+    The distances and the list are scratch shared by all Center_sets 
+    on a thread, so they are only good until the next update.
+   */
+  void updateNearDistance(int e, Sample_point *);
+  int nNear() { return nnear; }
+  int nearCenter(int i) { return nearlist(i); }
+  int screening() { return screen; }
+  void showinfo(ostream & os);
   void getDistance(const int e, const int cent,
                    Array1 <doublevar> & distance)
   {
-    assert(e< edist.GetDim(0));
+    assert(e==edist_e);
     assert(cent < ncenters);
     assert(distance.GetDim(0) >=5);
+    Array2 <doublevar> & ed(edist);
     for(int d=0; d< 5; d++)
     {
-      distance(d)=edist(e,cent,d);
+      distance(d)=ed(cent,d);
     }
   }
 
@@ -128,7 +156,19 @@ private:
   int usingatoms;
   int usingsampcenters;
   Array2 <doublevar> position;
-  Array3 <doublevar> edist;
+  int havepositions; //!< whether position holds the centers
+  static QMC_THREAD_LOCAL Array2 <doublevar> edist; //!< (center, d) for electron edist_e
+  static QMC_THREAD_LOCAL int edist_e;
+
+  //Cell list
+  int screen;                  //!< whether the cell list is in use
+  doublevar cellrcut;          //!< largest cutoff
+  Array1 <doublevar> cellorigin, cellsize;
+  Array1 <int> ncell;          //!< cells in each direction
+  Array1 <int> cellstart;      //!< where each cell starts in cellcenters
+  Array1 <int> cellcenters;    //!< centers, sorted by cell
+  static QMC_THREAD_LOCAL Array1 <int> nearlist; //!< centers near the last electron
+  static QMC_THREAD_LOCAL int nnear;
   
   vector <string> labels;
 
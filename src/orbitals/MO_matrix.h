@@ -25,6 +25,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "Qmc_std.h"
 #include "Basis_function.h"
 #include "Center_set.h"
+#include "Binary_orb.h"
 #include <algorithm> 
 
 class System;
@@ -98,6 +99,18 @@ public:
   virtual void writeorb(ostream &, Array2 <doublevar> & rotation, Array1 <int> &)
   { error("writeorb not implemented"); } 
 
+  /*!
+    For complex orbitals: if time-reversal symmetry makes them real (up
+    to a constant phase), allocate in real a real MO matrix that 
+    evaluates the same orbitals from words and return 1.  Otherwise 
+    return 0 and leave real alone.  Called after read() and before 
+    buildLists().
+   */
+  virtual int realEquivalent(vector <string> & words, System * sys,
+                             Templated_MO_matrix <doublevar> *& real) { 
+    return 0;
+  }
+
   /*!
     Get the molecular orbital coefficients
    */
@@ -135,6 +148,26 @@ public:
     error("getBasisVal not implemented");
   }
 
+  /*!
+    Evaluate the MO's in list listnum at a block of positions, using
+    electron e as the probe.  Electron e is put back where it was 
+    afterwards, without notifying the wave function.  The default 
+    calls updateVal() once per position; evaluators with a dense 
+    coefficient matrix override it to fill a (position, basis) matrix 
+    and contract it with the coefficients in a single matrix-matrix 
+    multiply.
+   */
+  virtual void updateValBatch(
+    Sample_point * sample,
+    int e,
+    //!< electron number
+    int listnum,
+    Array2 <doublevar> & pos,
+    //!< positions in form (position, [x y z])
+    Array2 <T> & newvals
+    //!< The return: in form (position, MO)
+  );
+
   virtual void updateLap(
     Sample_point * sample,
     int e,
@@ -199,6 +232,40 @@ void rotate_Corb(istream & orbin, ostream & orbout,
 
 */
 //------------------------------------------------------------------------------------------
+
+//! Imaginary parts this small are dropped when complex orbitals are made real
+inline int negligible_imag(const dcomplex & c) { 
+  return fabs(c.imag()) <= 1e-10*max(1.0,fabs(c.real()));
+}
+
+//! True if every component of the k-point is an integer, that is, k=-k
+inline int is_trim_kpoint(Array1 <doublevar> & kpoint) { 
+  for(int d=0; d< kpoint.GetDim(0); d++) 
+    if(fabs(kpoint(d)-floor(kpoint(d)+0.5)) > 1e-8) return 0;
+  return 1;
+}
+
+/*!
+  Read one orbital coefficient.  Real orbitals also accept the complex
+  form (re,im) when the imaginary part is negligible, so that complex
+  orbital files at time-reversal invariant k-points can be read as real.
+*/
+inline int read_orb_coeff(istream & input, dcomplex & c) { 
+  return bool(input >> c);
+}
+inline int read_orb_coeff(istream & input, doublevar & c) { 
+  input >> ws;
+  if(input.peek()=='(') { 
+    dcomplex z;
+    if(!(input >> z)) return 0;
+    if(!negligible_imag(z)) 
+      error("Complex orbital coefficient for real orbitals: ", z);
+    c=z.real();
+    return 1;
+  }
+  return bool(input >> c);
+}
+
 #ifdef USE_MPI
 inline void overloaded_broadcast(Array1 <doublevar> & v) { 
   MPI_Bcast(v.v,v.GetDim(0), MPI_DOUBLE,0,MPI_Comm_grp);
@@ -208,6 +275,23 @@ inline void overloaded_broadcast(Array1 <dcomplex> & v) {
 }
 #endif
 
+//! Send the tables that the root process read to the others
+template <class T> void broadcast_orbs(int & nmo_read, int & maxlabel, 
+                                       Center_set & centers, int maxbasis,
+                                       Array3 <int> & coeffmat, Array1 <T> & coeff) {
+#ifdef USE_MPI
+  MPI_Bcast(&nmo_read,1,MPI_INT,0,MPI_Comm_grp);
+  MPI_Bcast(&maxlabel,1,MPI_INT,0,MPI_Comm_grp);
+  
+  if(mpi_info.node!=0) { 
+    coeffmat.Resize(nmo_read,centers.size(),maxbasis);
+    coeff.Resize(maxlabel);
+  }
+  MPI_Bcast(coeffmat.v,coeffmat.size,MPI_INT,0,MPI_Comm_grp);
+  overloaded_broadcast(coeff);
+#endif
+}
+
 template <class T> int readorb(istream & input, Center_set & centers, 
                                   int nmo, int maxbasis, Array1 <doublevar> & kpoint,
                                   Array3 <int> & coeffmat, Array1 <T> & coeff) {
@@ -269,25 +353,82 @@ template <class T> int readorb(istream & input, Center_set & centers,
     maxlabel=*std::max_element(label.begin(),label.end())+1;
     coeff.Resize(maxlabel);
     for(int i=0; i< maxlabel; i++) { 
-      if(! (input >> coeff(i) ) )
+      if(! read_orb_coeff(input, coeff(i)) )
         error("unexpected end of file when reading orbital coefficients");
     }
   }
-#ifdef USE_MPI
-  MPI_Bcast(&nmo_read,1,MPI_INT,0,MPI_Comm_grp);
-  MPI_Bcast(&maxlabel,1,MPI_INT,0,MPI_Comm_grp);
-  int coeffmatsize;
-  
-  if(mpi_info.node!=0) { 
-    coeffmat.Resize(nmo_read,centers.size(),maxbasis);
+  broadcast_orbs(nmo_read, maxlabel, centers, maxbasis, coeffmat, coeff);
+  return nmo_read;
+}
+
+/*!
+  Same as readorb(), from a binary orbital file (see Binary_orb.h).
+  Only the root process maps the file.
+*/
+template <class T> int readorb_binary(const string & filename, Center_set & centers,
+                                      int nmo, int maxbasis, 
+                                      Array3 <int> & coeffmat, Array1 <T> & coeff) {
+  int nmo_read=0;
+  int maxlabel=0;
+  coeffmat.clear();
+  coeff.clear();
+  if(mpi_info.node==0) { 
+    Binary_orbfile orb;
+    orb.open(filename);
+    int nentries=orb.nentries();
+    int maxcenter=centers.equiv_centers.GetDim(0);
+    for(int e=0; e< nentries; e++) { 
+      const int * ent=orb.entry(e);
+      if(ent[0] <= nmo && ent[0]+1 > nmo_read) nmo_read=ent[0]+1;
+    }
+    coeffmat.Resize(nmo_read, centers.size(), maxbasis);
+    coeffmat=-1;
+    for(int e=0; e< nentries; e++) { 
+      const int * ent=orb.entry(e);
+      if(ent[0] > nmo) continue;
+      if(ent[1] >= maxbasis) 
+        error("Basis function greater than maxbasis requested:",ent[1]+1);
+      else if(ent[1] < 0) 
+        error("Basis function cannot be less than 1:",ent[1]+1);
+      if(ent[2] > maxcenter) 
+        error("Center number in orb file greater than maximum number ", 
+              maxcenter);
+      if(ent[3] >= orb.ncoeff())
+        error("Coefficient label larger than the number of coefficients ",
+              ent[3]+1);
+      for(int c_eq=0; c_eq < centers.ncenters_atom(ent[2]); c_eq++) {
+        int cen2=centers.equiv_centers(ent[2], c_eq);
+        coeffmat(ent[0], cen2, ent[1])=ent[3];
+      }
+      if(ent[3]+1 > maxlabel) maxlabel=ent[3]+1;
+    }
     coeff.Resize(maxlabel);
+    for(int i=0; i< maxlabel; i++) 
+      binary_orb_coeff(orb.coefficients(), orb.isComplex(), i, coeff(i));
   }
-  MPI_Bcast(coeffmat.v,coeffmat.size,MPI_INT,0,MPI_Comm_grp);
-  overloaded_broadcast(coeff);
-#endif
+  broadcast_orbs(nmo_read, maxlabel, centers, maxbasis, coeffmat, coeff);
   return nmo_read;
 }
 
+/*!
+  Read the orbitals from filename, which may be a text .orb file or a
+  binary one.
+*/
+template <class T> int readorbfile(const string & filename, Center_set & centers, 
+                                  int nmo, int maxbasis, Array1 <doublevar> & kpoint,
+                                  Array3 <int> & coeffmat, Array1 <T> & coeff) {
+  int binary=0;
+  if(mpi_info.node==0) binary=Binary_orbfile::isBinary(filename);
+#ifdef USE_MPI
+  MPI_Bcast(&binary,1,MPI_INT,0,MPI_Comm_grp);
+#endif
+  if(binary) 
+    return readorb_binary(filename, centers, nmo, maxbasis, coeffmat, coeff);
+  ifstream input(filename.c_str());
+  if(!input) error("couldn't find orb file ", filename);
+  return readorb(input, centers, nmo, maxbasis, kpoint, coeffmat, coeff);
+}
+
 
 
 //----------------------------------------------------------------------
@@ -342,6 +483,27 @@ template <> inline void eval_kpoint_deriv<doublevar>(Array1 <doublevar> & kpoint
 
 //----------------------------------------------------------------------------
 #include "qmc_io.h"
+#include "Sample_point.h"
+
+template <class T> inline void Templated_MO_matrix<T>::updateValBatch(
+    Sample_point * sample, int e, int listnum, 
+    Array2 <doublevar> & pos, Array2 <T> & newvals) { 
+  int npos=pos.GetDim(0);
+  int nmo_list=newvals.GetDim(1);
+  assert(newvals.GetDim(0) >= npos);
+  assert(nmo_list <= nmo);
+  Array1 <doublevar> oldpos(3), r(3);
+  Array2 <T> vals(nmo,1);
+  sample->getElectronPos(e,oldpos);
+  for(int p=0; p < npos; p++) { 
+    for(int d=0; d< 3; d++) r(d)=pos(p,d);
+    sample->setElectronPosNoNotify(e,r);
+    updateVal(sample,e,listnum,vals);
+    for(int m=0; m < nmo_list; m++) 
+      newvals(p,m)=vals(m,0);
+  }
+  sample->setElectronPosNoNotify(e,oldpos);
+}
 //template<> inline void Complex_MO_matrix::read(vector <string> & words,
 //                     unsigned int & startpos,
 //                     System * sys) { 
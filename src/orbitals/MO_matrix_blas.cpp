@@ -24,16 +24,6 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "qmc_io.h"
 
 
-struct MOBLAS_CalcObjVal { 
-  doublevar * moplace;
-  doublevar sval;
-};
-
-struct MOBLAS_CalcObjLap { 
-  doublevar * moplace;
-  doublevar sval[5];
-};
-
 
 
 inline void output_array(Array2 <doublevar> & arr) {
@@ -45,6 +35,20 @@ inline void output_array(Array2 <doublevar> & arr) {
   }
 }
 
+QMC_THREAD_LOCAL Array1 <doublevar> MO_matrix_blas::symmvals_temp1d;
+QMC_THREAD_LOCAL Array2 <doublevar> MO_matrix_blas::symmvals_temp2d;
+QMC_THREAD_LOCAL Array1 <doublevar> MO_matrix_blas::newvals_T1d;
+QMC_THREAD_LOCAL Array2 <doublevar> MO_matrix_blas::newvals_T2d;
+QMC_THREAD_LOCAL Array1 <MOBLAS_CalcObjVal> MO_matrix_blas::calcobjs_val;
+QMC_THREAD_LOCAL Array1 <MOBLAS_CalcObjLap> MO_matrix_blas::calcobjs_lap;
+QMC_THREAD_LOCAL Array1 <int> MO_matrix_blas::batch_column;
+QMC_THREAD_LOCAL Array1 <int> MO_matrix_blas::batch_active;
+QMC_THREAD_LOCAL Array1 <int> MO_matrix_blas::batch_start;
+QMC_THREAD_LOCAL Array1 <int> MO_matrix_blas::batch_entry;
+QMC_THREAD_LOCAL Array1 <doublevar> MO_matrix_blas::batch_entryval;
+QMC_THREAD_LOCAL Array2 <doublevar> MO_matrix_blas::batch_basis;
+QMC_THREAD_LOCAL Array2 <doublevar> MO_matrix_blas::batch_coeff;
+
 void MO_matrix_blas::init() {
 
 
@@ -88,19 +92,29 @@ void MO_matrix_blas::init() {
   for(int b=0; b< basis.GetDim(0); b++) {
     nfunctions(b)=basis(b)->nfunc();
   }
+
+  //Where the functions of each center start, and the largest cutoff
+  //for the cell list of the centers.
+  funcstart.Resize(centers.size());
+  doublevar rcut=0;
+  int nfunc_tot=0;
+  for(int ion=0; ion< centers.size(); ion++) {
+    funcstart(ion)=nfunc_tot;
+    for(int n=0; n< centers.nbasis(ion); n++) {
+      int b=centers.basis(ion,n);
+      nfunc_tot+=nfunctions(b);
+      rcut=max(rcut,obj_cutoff(b));
+    }
+  }
+  centers.buildCellList(rcut);
   
 
   moCoeff.Resize(totbasis, nmo);
 
 
-  ifstream ORB(orbfile.c_str());
-  if(!ORB) error("couldn't find orb file ", orbfile);
-
   Array3 <int> coeffmat;
   Array1 <doublevar> coeff;
-  readorb(ORB,centers, nmo, maxbasis, kpoint,coeffmat, coeff);
-  string in;
-  ORB.close();
+  readorbfile(orbfile,centers, nmo, maxbasis, kpoint,coeffmat, coeff);
 
   //Find the cutoffs
 
@@ -175,6 +189,8 @@ void MO_matrix_blas::writeorb(ostream & os, Array2 <doublevar> & rotation, Array
     }  //ion
   }
   os << "COEFFICIENTS\n";
+  if(Binary_orbfile::isBinary(orbfile))
+    error("Rotating orbitals needs a text ORBFILE");
   ifstream orbin(orbfile.c_str());
   rotate_orb(orbin, os, rotation, moList, totbasis);
   orbin.close();
@@ -206,6 +222,7 @@ int MO_matrix_blas::showinfo(ostream & os)
 {
   os << "Blas MO " << endl;
   os << "Number of molecular orbitals: " << nmo << endl;
+  centers.showinfo(os);
   string indent="  ";
   os << "Basis functions: \n";
   for(int i=0; i< basis.GetDim(0); i++)
@@ -240,15 +257,15 @@ void MO_matrix_blas::updateVal(Sample_point * sample,
                                int e, int listnum, Array2 <doublevar> & newvals) {
 
 #ifdef USE_BLAS
-  int centermax=centers.size();
 
   assert(e < sample->electronSize());
   assert(newvals.GetDim(1) >=1);
 
 
   Array1 <doublevar> R(5);
-  static Array1 <doublevar> symmvals_temp(maxbasis);
-  static Array1 <doublevar> newvals_T;
+  Array1 <doublevar> & symmvals_temp(symmvals_temp1d);
+  Array1 <doublevar> & newvals_T(newvals_T1d);
+  if(symmvals_temp.GetDim(0) < maxbasis) symmvals_temp.Resize(maxbasis);
   Array2 <doublevar> & moCoefftmp(moCoeff_list(listnum));
   int totbasis=moCoefftmp.GetDim(0);
   int nmo_list=moCoefftmp.GetDim(1);
@@ -258,12 +275,16 @@ void MO_matrix_blas::updateVal(Sample_point * sample,
   int b;
   int totfunc=0;
   
-  centers.updateDistance(e, sample);
+  centers.updateNearDistance(e, sample);
+  int nnear=centers.nNear();
   
-  static Array1 <MOBLAS_CalcObjVal> calcobjs(totbasis);
+  Array1 <MOBLAS_CalcObjVal> & calcobjs(calcobjs_val);
+  if(calcobjs.GetDim(0) < totbasis) calcobjs.Resize(totbasis);
   int ncalcobj=0;
 
-  for(int ion=0; ion < centermax; ion++)  {
+  for(int ic=0; ic < nnear; ic++) {
+    int ion=centers.nearCenter(ic);
+    totfunc=funcstart(ion);
     centers.getDistance(e, ion, R);
     for(int n=0; n< centers.nbasis(ion); n++) {
       b=centers.basis(ion, n);
@@ -308,6 +329,111 @@ void MO_matrix_blas::updateVal(Sample_point * sample,
 
 //------------------------------------------------------------------------
 
+/*!
+  The basis functions are evaluated position by position, and only 
+  those that are nonzero at some position get a column in the basis 
+  matrix.  The matching rows of the coefficients are gathered once, so
+  the contraction is a single dgemm instead of one daxpy per function
+  and position.
+*/
+void MO_matrix_blas::updateValBatch(Sample_point * sample, int e, 
+                                    int listnum, Array2 <doublevar> & pos,
+                                    Array2 <doublevar> & newvals) { 
+#ifdef USE_BLAS
+  int npos=pos.GetDim(0);
+  Array2 <doublevar> & moCoefftmp(moCoeff_list(listnum));
+  int totbasis=moCoefftmp.GetDim(0);
+  int nmo_list=moCoefftmp.GetDim(1);
+  assert(newvals.GetDim(0) >= npos);
+  assert(newvals.GetDim(1) >= nmo_list);
+  if(npos==0) return;
+
+  Array1 <int> & batch_column(MO_matrix_blas::batch_column);
+  Array1 <int> & batch_active(MO_matrix_blas::batch_active);
+  Array1 <int> & batch_start(MO_matrix_blas::batch_start);
+  Array1 <int> & batch_entry(MO_matrix_blas::batch_entry);
+  Array1 <doublevar> & batch_entryval(MO_matrix_blas::batch_entryval);
+  Array1 <doublevar> & symmvals_temp1d(MO_matrix_blas::symmvals_temp1d);
+  Array2 <doublevar> & batch_basis(MO_matrix_blas::batch_basis);
+  Array2 <doublevar> & batch_coeff(MO_matrix_blas::batch_coeff);
+  if(batch_column.GetDim(0)!=totbasis) { 
+    batch_column.Resize(totbasis);
+    batch_column=-1;
+    batch_active.Resize(totbasis);
+  }
+  if(symmvals_temp1d.GetDim(0) < maxbasis) symmvals_temp1d.Resize(maxbasis);
+  batch_start.Resize(npos+1);
+  if(batch_entry.GetDim(0) < npos*totbasis) { 
+    batch_entry.Resize(npos*totbasis);
+    batch_entryval.Resize(npos*totbasis);
+  }
+
+  Array1 <doublevar> R(5), oldpos(3), r(3);
+  sample->getElectronPos(e,oldpos);
+  int nactive=0;
+  int nentry=0;
+  for(int p=0; p < npos; p++) { 
+    batch_start(p)=nentry;
+    for(int d=0; d< 3; d++) r(d)=pos(p,d);
+    sample->setElectronPosNoNotify(e,r);
+    centers.updateNearDistance(e, sample);
+    int nnear=centers.nNear();
+    for(int ic=0; ic < nnear; ic++) {
+      int ion=centers.nearCenter(ic);
+      int totfunc=funcstart(ion);
+      centers.getDistance(e, ion, R);
+      for(int n=0; n< centers.nbasis(ion); n++) {
+        int b=centers.basis(ion, n);
+        if(R(0) < obj_cutoff(b)) {
+          basis(b)->calcVal(R, symmvals_temp1d);
+          int imax=nfunctions(b);
+          for(int i=0; i< imax; i++) {
+            if(R(0) < cutoff(totfunc)) {
+              if(batch_column(totfunc)==-1) { 
+                batch_column(totfunc)=nactive;
+                batch_active(nactive++)=totfunc;
+              }
+              batch_entry(nentry)=batch_column(totfunc);
+              batch_entryval(nentry++)=symmvals_temp1d(i);
+            }
+            totfunc++;
+          }
+        }
+      }
+    }
+  }
+  batch_start(npos)=nentry;
+  sample->setElectronPosNoNotify(e,oldpos);
+
+  if(nactive==0) { 
+    for(int p=0; p < npos; p++) 
+      for(int m=0; m < nmo_list; m++) newvals(p,m)=0.0;
+    return;
+  }
+
+  batch_basis.Resize(npos,nactive);
+  batch_basis=0.0;
+  for(int p=0; p < npos; p++) { 
+    for(int j=batch_start(p); j < batch_start(p+1); j++) 
+      batch_basis(p,batch_entry(j))=batch_entryval(j);
+  }
+  batch_coeff.Resize(nactive,nmo_list);
+  for(int a=0; a < nactive; a++) { 
+    int f=batch_active(a);
+    cblas_dcopy(nmo_list,moCoefftmp.v+f*nmo_list,1,batch_coeff.v+a*nmo_list,1);
+    batch_column(f)=-1;
+  }
+
+  cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, npos, nmo_list, 
+              nactive, 1.0, batch_basis.v, nactive, batch_coeff.v, nmo_list,
+              0.0, newvals.v, newvals.GetDim(1));
+#else
+  error("BLAS libraries not compiled in, so you cannot use BLAS_MO");
+#endif
+}
+
+//------------------------------------------------------------------------
+
 
 /*!
 */
@@ -321,15 +447,15 @@ void MO_matrix_blas::updateLap(
   Array2 <doublevar> & newvals) {
 
 #ifdef USE_BLAS
-  int centermax=centers.size();
 
   assert(e < sample->electronSize());
   assert(newvals.GetDim(1) >=5);
 
 
   Array1 <doublevar> R(5);
-  static Array2 <doublevar> symmvals_temp(maxbasis,5);
-  static Array2 <doublevar> newvals_T;
+  Array2 <doublevar> & symmvals_temp(symmvals_temp2d);
+  Array2 <doublevar> & newvals_T(newvals_T2d);
+  if(symmvals_temp.GetDim(0) < maxbasis) symmvals_temp.Resize(maxbasis,5);
   Array2 <doublevar> & moCoefftmp(moCoeff_list(listnum));
   int totbasis=moCoefftmp.GetDim(0);
   int nmo_list=moCoefftmp.GetDim(1);
@@ -339,13 +465,17 @@ void MO_matrix_blas::updateLap(
   int b;
   int totfunc=0;
   
-  centers.updateDistance(e, sample);
+  centers.updateNearDistance(e, sample);
+  int nnear=centers.nNear();
 
-  static Array1 <MOBLAS_CalcObjLap> calcobjs(totbasis);
+  Array1 <MOBLAS_CalcObjLap> & calcobjs(calcobjs_lap);
+  if(calcobjs.GetDim(0) < totbasis) calcobjs.Resize(totbasis);
   int ncalcobj=0;
   
 
-  for(int ion=0; ion < centermax; ion++)  {
+  for(int ic=0; ic < nnear; ic++) {
+    int ion=centers.nearCenter(ic);
+    totfunc=funcstart(ion);
     centers.getDistance(e, ion, R);
     for(int n=0; n< centers.nbasis(ion); n++) {
       b=centers.basis(ion, n);
@@ -32,6 +32,18 @@ class System;
 class Sample_point;
 //----------------------------------------------------------------------------
 
+struct MOBLAS_CalcObjVal { 
+  doublevar * moplace;
+  doublevar sval;
+};
+
+struct MOBLAS_CalcObjLap { 
+  doublevar * moplace;
+  doublevar sval[5];
+};
+
+//----------------------------------------------------------------------------
+
 class MO_matrix_blas: public MO_matrix
 {
 protected:
@@ -44,6 +56,24 @@ private:
   Array1 <doublevar> obj_cutoff; //!< cutoff for each basis object
   Array1 <doublevar> cutoff;  //!< Cutoff for individual basis functions
   Array1 <int> nfunctions; //!< number of functions in each basis
+  Array1 <int> funcstart; //!< first function of each center
+
+  //Scratch space for updateVal() and updateLap(), per thread
+  static QMC_THREAD_LOCAL Array1 <doublevar> symmvals_temp1d;
+  static QMC_THREAD_LOCAL Array2 <doublevar> symmvals_temp2d;
+  static QMC_THREAD_LOCAL Array1 <doublevar> newvals_T1d;
+  static QMC_THREAD_LOCAL Array2 <doublevar> newvals_T2d;
+  static QMC_THREAD_LOCAL Array1 <MOBLAS_CalcObjVal> calcobjs_val;
+  static QMC_THREAD_LOCAL Array1 <MOBLAS_CalcObjLap> calcobjs_lap;
+
+  //Scratch space for updateValBatch(), per thread
+  static QMC_THREAD_LOCAL Array1 <int> batch_column; //!< column of each function in batch_basis, or -1
+  static QMC_THREAD_LOCAL Array1 <int> batch_active; //!< function in each column of batch_basis
+  static QMC_THREAD_LOCAL Array1 <int> batch_start;  //!< first entry of each position in batch_entry
+  static QMC_THREAD_LOCAL Array1 <int> batch_entry;
+  static QMC_THREAD_LOCAL Array1 <doublevar> batch_entryval;
+  static QMC_THREAD_LOCAL Array2 <doublevar> batch_basis; //!< (position, active function)
+  static QMC_THREAD_LOCAL Array2 <doublevar> batch_coeff; //!< (active function, MO)
 
 public:
 
@@ -110,6 +140,15 @@ public:
     error("Need to implement MO_matrix_blas::getBasisVal()");
   }
 
+  virtual void updateValBatch(
+    Sample_point * sample,
+    int e,
+    int listnum,
+    Array2 <doublevar> & pos,
+    Array2 <doublevar> & newvals
+    //!< The return: in form (position, MO)
+  );
+
   virtual void updateLap(
     Sample_point * sample,
     int e,
@@ -58,16 +58,25 @@ private:
   Array1 <doublevar> obj_cutoff; //!< cutoff for each basis object
   Array1 <doublevar> cutoff;  //!< Cutoff for individual basis functions
   Array1 <int> nfunctions; //!< number of functions in each basis
+  Array1 <int> funcstart; //!< first function of each center
   //Array1 <int> basismo;
   //Array2 <doublevar> moCoeff;
   //Array2 <int> basisfill;
 
-  Array1 < Array2 <int> > basisfill_list;
-  Array1 < Array2 <T> > moCoeff_list;
-  Array1 < Array1 <int> > basismo_list;
+  //The coefficients of each list in compressed sparse row form: 
+  //the nonzero MO's of basis function f are 
+  //molist_list(lis)(rowstart_list(lis)(f)...rowstart_list(lis)(f+1)-1)
+  Array1 < Array1 <int> > rowstart_list;
+  Array1 < Array1 <int> > molist_list;
+  Array1 < Array1 <T> > moCoeff_list;
+  doublevar coeff_threshold; //!< prune coefficients smaller than this in buildLists
+  Array1 <int> nfill_list; //!< number of stored coefficients in each list
+  Array1 <int> npruned_list; //!< number of coefficients pruned from each list
+  Array1 <doublevar> fill_list; //!< stored fraction of the (basis, MO) matrix
 
- Array1 <doublevar> symmvals_temp1d;
- Array2 <doublevar> symmvals_temp2d;
+  //Scratch space for the basis function values, per thread
+  static QMC_THREAD_LOCAL Array1 <doublevar> symmvals_temp1d;
+  static QMC_THREAD_LOCAL Array2 <doublevar> symmvals_temp2d;
 
 
 
@@ -94,7 +103,7 @@ public:
   virtual int writeinput(string &, ostream &);
 
 
-  //virtual void read(vector <string> & words, unsigned int & startpos, System * sys);
+  virtual void read(vector <string> & words, unsigned int & startpos, System * sys);
 
   //! Takes an ORB file and inserts all the coefficients.
   //virtual int readorb(istream &);
@@ -102,6 +111,9 @@ public:
 
   virtual void writeorb(ostream &, Array2 <doublevar> & rotation, Array1 <int> &);
 
+  virtual int realEquivalent(vector <string> & words, System * sys,
+                             Templated_MO_matrix <doublevar> *& real);
+
   virtual void getMoCoeff(Array2 <T> & coeff) {
     error("Cutoff_Mo doesn't support optimization yet");
   }
@@ -149,7 +161,7 @@ public:
 			     //!< in form ([value gradient, dxx,dyy,dzz,dxy,dxz,dyz], MO)
 			     );
   MO_matrix_cutoff()
-  {}
+  { coeff_threshold=0; }
 
 };
 
@@ -160,6 +172,8 @@ public:
 #include "Sample_point.h"
 #include "qmc_io.h"
 
+template <class T> QMC_THREAD_LOCAL Array1 <doublevar> MO_matrix_cutoff<T>::symmvals_temp1d;
+template <class T> QMC_THREAD_LOCAL Array2 <doublevar> MO_matrix_cutoff<T>::symmvals_temp2d;
 
 
 template <class T> void MO_matrix_cutoff<T>::init() {
@@ -201,24 +215,31 @@ template <class T> void MO_matrix_cutoff<T>::init() {
   for(int b=0; b< basis.GetDim(0); b++) {
     nfunctions(b)=basis(b)->nfunc();
   }
+
+  //Where the functions of each center start, and the largest cutoff
+  //for the cell list of the centers.
+  funcstart.Resize(centers.size());
+  doublevar rcut=0;
+  int nfunc_tot=0;
+  for(int ion=0; ion< centers.size(); ion++) {
+    funcstart(ion)=nfunc_tot;
+    for(int n=0; n< centers.nbasis(ion); n++) {
+      int b=centers.basis(ion,n);
+      nfunc_tot+=nfunctions(b);
+      rcut=max(rcut,obj_cutoff(b));
+    }
+  }
+  centers.buildCellList(rcut);
   
 
   nbasis.Resize(nmo);
   mofill.Resize(nmo, totbasis);
   moCoeff2.Resize(nmo, totbasis);
 
-  ifstream ORB(orbfile.c_str());
-
-  if(!ORB) {
-    error("couldn't find orb file ", orbfile);
-  }
-
   Array3 <int> coeffmat;
   Array1 <T> coeff;
   
-  readorb(ORB,centers, nmo, maxbasis,kpoint, coeffmat, coeff);
-  string in;
-  ORB.close();
+  readorbfile(orbfile,centers, nmo, maxbasis,kpoint, coeffmat, coeff);
 
   
   //Find the cutoffs
@@ -265,9 +286,6 @@ template <class T> void MO_matrix_cutoff<T>::init() {
       } //i
     } //n
   }  //ion
-  symmvals_temp1d.Resize(maxbasis);
-  symmvals_temp2d.Resize(maxbasis,10);
-
 }
 
 //---------------------------------------------------------------------------------------------
@@ -306,13 +324,10 @@ template<class T> void MO_matrix_cutoff<T>::writeorb(ostream & os,
     }  //ion
   }
   os << "COEFFICIENTS\n";
-  ifstream orbin(orbfile.c_str());
 
-  //cout << "orbfile " << orbfile << endl;
   Array1 <T> coeff;
   Array3 <int> coeffmat;
-  readorb(orbin,centers, nmo, maxbasis,kpoint, coeffmat, coeff);
-  orbin.close();
+  readorbfile(orbfile,centers, nmo, maxbasis,kpoint, coeffmat, coeff);
 
   Array2 <T> moCoeff(nmo,totbasis);
   moCoeff=0.0;
@@ -362,36 +377,85 @@ template<class T> void MO_matrix_cutoff<T>::writeorb(ostream & os,
 }
 //---------------------------------------------------------------------
 
+template <class T> void MO_matrix_cutoff<T>::read(vector <string> & words,
+    unsigned int & startpos, System * sys) { 
+  unsigned int pos=startpos;
+  if(!readvalue(words, pos, coeff_threshold, "COEFF_THRESHOLD"))
+    coeff_threshold=0;
+  Templated_MO_matrix<T>::read(words, startpos, sys);
+}
+
+//---------------------------------------------------------------------
+
+template <class T> int MO_matrix_cutoff<T>::realEquivalent(vector <string> & words,
+    System * sys, Templated_MO_matrix <doublevar> *& real) { 
+  return 0;
+}
+
+/*!
+  At a time-reversal invariant k-point the Bloch phases on the periodic 
+  images are all +/-1, so the orbitals are real whenever the 
+  coefficients are.
+*/
+template <> inline int MO_matrix_cutoff<dcomplex>::realEquivalent(
+    vector <string> & words, System * sys, 
+    Templated_MO_matrix <doublevar> *& real) { 
+  if(!is_trim_kpoint(kpoint)) return 0;
+  for(int mo=0; mo < nmo; mo++) 
+    for(int j=0; j< nbasis(mo); j++) 
+      if(!negligible_imag(moCoeff2(mo,j))) return 0;
+  real=new MO_matrix_cutoff<doublevar>;
+  unsigned int pos=0;
+  real->read(words, pos, sys);
+  return 1;
+}
+
+//---------------------------------------------------------------------
+
 template <class T> void MO_matrix_cutoff<T>::buildLists(Array1 < Array1 <int> > & occupations){
   int numlists=occupations.GetDim(0);
-  basisfill_list.Resize(numlists);
+  rowstart_list.Resize(numlists);
+  molist_list.Resize(numlists);
   moCoeff_list.Resize(numlists);
-  basismo_list.Resize(numlists);
+  nfill_list.Resize(numlists);
+  npruned_list.Resize(numlists);
+  fill_list.Resize(numlists);
   for(int lis=0; lis < numlists; lis++)
   {
     int nmo_list=occupations(lis).GetDim(0);
-    basisfill_list(lis).Resize(totbasis, nmo_list);
-    moCoeff_list(lis).Resize(totbasis, nmo_list);
-    basismo_list(lis).Resize(totbasis);
-    basismo_list(lis)=0;
-    for(int i=0; i < nmo_list; i++)
-    {
+    //Count the coefficients of each basis function, then fill the rows.
+    Array1 <int> & rowstart(rowstart_list(lis));
+    rowstart.Resize(totbasis+1);
+    rowstart=0;
+    int npruned=0;
+    for(int i=0; i < nmo_list; i++) {
       int mo=occupations(lis)(i);
-      for(int bas=0; bas < nbasis(mo); bas++)
-      {
+      for(int bas=0; bas < nbasis(mo); bas++) {
+        if(abs(moCoeff2(mo,bas)) < coeff_threshold) npruned++;
+        else rowstart(mofill(mo,bas)+1)++;
+      }
+    }
+    for(int f=0; f < totbasis; f++) rowstart(f+1)+=rowstart(f);
+    int nfill=rowstart(totbasis);
+    molist_list(lis).Resize(nfill);
+    moCoeff_list(lis).Resize(nfill);
+    Array1 <int> place(totbasis);
+    for(int f=0; f < totbasis; f++) place(f)=rowstart(f);
+    for(int i=0; i < nmo_list; i++) {
+      int mo=occupations(lis)(i);
+      for(int bas=0; bas < nbasis(mo); bas++) {
+        if(abs(moCoeff2(mo,bas)) < coeff_threshold) continue;
         int func=mofill(mo, bas);
-
-        //basisfill_list(lis)(func, basismo_list(lis)(func))=mo;
-        basisfill_list(lis)(func, basismo_list(lis)(func))=i;
-        moCoeff_list(lis)(func, basismo_list(lis)(func))=moCoeff2(mo, bas);
-        //cout << "basisfill_list " << 2 << "  f  "
-        //     << func << "  mo " <<  mo;
-        //cout << "  basis coeff " << moCoeff2(mo, bas) << endl;
-        //cout << "real basisfill " << basisfill(func, basismo_list(lis)(func))
-        //     << " coeff  " << moCoeff(func, basismo_list(lis)(func)) << endl;
-        basismo_list(lis)(func)++;
+        molist_list(lis)(place(func))=i;
+        moCoeff_list(lis)(place(func))=moCoeff2(mo, bas);
+        place(func)++;
       }
     }
+    nfill_list(lis)=nfill;
+    npruned_list(lis)=npruned;
+    fill_list(lis)=0;
+    if(totbasis > 0 && nmo_list > 0) 
+      fill_list(lis)=doublevar(nfill)/(doublevar(totbasis)*nmo_list);
   }
 }
 
@@ -402,6 +466,14 @@ template <class T> int MO_matrix_cutoff<T>::showinfo(ostream & os)
 {
   os << "Cutoff MO " << endl;
   os << "Number of molecular orbitals: " << nmo << endl;
+  centers.showinfo(os);
+  for(int lis=0; lis < nfill_list.GetDim(0); lis++) { 
+    os << "Orbital list " << lis << ": " << nfill_list(lis) 
+       << " coefficients, fill fraction " << fill_list(lis);
+    if(coeff_threshold > 0) 
+      os << ", " << npruned_list(lis) << " pruned below " << coeff_threshold;
+    os << endl;
+  }
   string indent="  ";
   os << "Basis functions: \n";
   for(int i=0; i< basis.GetDim(0); i++)
@@ -419,6 +491,8 @@ template <class T> int MO_matrix_cutoff<T>::writeinput(string & indent, ostream
   //if(oldsofile!="") 
   //  os << indent << "OLDSOFILE " << oldsofile << endl;
   os << indent << "MAGNIFY " << magnification_factor << endl;
+  if(coeff_threshold > 0)
+    os << indent << "COEFF_THRESHOLD " << coeff_threshold << endl;
   string indent2=indent+"  ";
   for(int i=0; i< basis.GetDim(0); i++)
   {
@@ -437,14 +511,15 @@ template <class T> int MO_matrix_cutoff<T>::writeinput(string & indent, ostream
 template <class T> void MO_matrix_cutoff<T>::updateVal(
   Sample_point * sample,  int e,  int listnum,  Array2 <T> & newvals) {
   //cout << "start updateval " << endl;
-  int centermax=centers.size();
-  static Array1 <doublevar> R(5);
+  Array1 <doublevar> R(5);
   //Array1 <doublevar> symmvals_temp(maxbasis);
+  Array1 <doublevar> & symmvals_temp1d(MO_matrix_cutoff<T>::symmvals_temp1d);
+  symmvals_temp1d.Resize(maxbasis);
 
   //Make references for easier access to the list variables.
-  Array1 <int> & basismotmp(basismo_list(listnum));
-  Array2 <int> & basisfilltmp(basisfill_list(listnum));
-  Array2 <T> & moCoefftmp(moCoeff_list(listnum));
+  Array1 <int> & rowstart(rowstart_list(listnum));
+  Array1 <int> & molist(molist_list(listnum));
+  Array1 <T> & moCoefftmp(moCoeff_list(listnum));
   assert(newvals.GetDim(1) >= 1);
 
   newvals=0;
@@ -453,13 +528,15 @@ template <class T> void MO_matrix_cutoff<T>::updateVal(
   //int fn;
   T c;
   int mo=0;
-  int scalebasis=basisfill_list(listnum).GetDim(1);
   int totfunc=0;
   int b; //basis
   //cout << "here " << endl;
-  centers.updateDistance(e, sample);
+  centers.updateNearDistance(e, sample);
+  int nnear=centers.nNear();
   //int retscale=newvals.GetDim(1);
-  for(int ion=0; ion < centermax; ion++) {
+  for(int ic=0; ic < nnear; ic++) {
+    int ion=centers.nearCenter(ic);
+    totfunc=funcstart(ion);
     //sample->getECDist(e, ion, R);
     centers.getDistance(e,ion,R);
     for(int n=0; n< centers.nbasis(ion); n++) {
@@ -470,17 +547,12 @@ template <class T> void MO_matrix_cutoff<T>::updateVal(
         //cout << "ion " << ion << "b " << b << " mo "<< mo << endl;
         int imax=nfunctions(b);
         for(int i=0; i< imax; i++) {
-          int reducedbasis=scalebasis*totfunc;
           if(R(0) < cutoff(totfunc)) {
-            for(int basmo=0; basmo < basismotmp.v[totfunc]; basmo++) {
-              //mo=basisfill(totfunc, basmo);
-              //c=moCoeff(totfunc, basmo);
-              //cout << "basisfill reducedbasis "<< reducedbasis
-              // << "  basmo " << basmo << endl;
-              mo=basisfilltmp.v[reducedbasis+basmo];
-              //cout << "mocoeff (mo=" << mo <<  endl;
+            int rowend=rowstart.v[totfunc+1];
+            for(int basmo=rowstart.v[totfunc]; basmo < rowend; basmo++) {
+              mo=molist.v[basmo];
               //mo_counter(mo)++;
-              c=moCoefftmp.v[reducedbasis+basmo];
+              c=moCoefftmp.v[basmo];
 
               newvals(mo, 0)+=c*symmvals_temp1d(i);
               //newvals.v[retscale*mo]+=c*symmvals_temp.v[i];
@@ -505,7 +577,6 @@ template <class T>void MO_matrix_cutoff<T>::updateLap( Sample_point * sample,
   int e, int listnum, Array2 <T> & newvals) {
 
   //cout << "updateLap" << endl;
-  int centermax=centers.size();
   //int momax=occupation.GetDim(0);
   newvals=0;
   //assert(momax <= nmo);
@@ -518,21 +589,25 @@ template <class T>void MO_matrix_cutoff<T>::updateLap( Sample_point * sample,
    //cout << "arrayref " << endl;
 
   //References to make the code easier to read and slightly faster.
-  Array1 <int> & basismotmp(basismo_list(listnum));
-  Array2 <int> & basisfilltmp(basisfill_list(listnum));
-  Array2 <T> & moCoefftmp(moCoeff_list(listnum));
+  Array1 <int> & rowstart(rowstart_list(listnum));
+  Array1 <int> & molist(molist_list(listnum));
+  Array1 <T> & moCoefftmp(moCoeff_list(listnum));
 
   Basis_function * tempbasis;
 
   T c;
   int scaleval=0, scalesymm=0;
   int mo=0;
-  int scalebasis=basisfilltmp.GetDim(1);
-  centers.updateDistance(e, sample);
+  centers.updateNearDistance(e, sample);
+  int nnear=centers.nNear();
   int totfunc=0;
   int b;
+  Array2 <doublevar> & symmvals_temp2d(MO_matrix_cutoff<T>::symmvals_temp2d);
+  symmvals_temp2d.Resize(maxbasis,10);
   int symmvals_stride=symmvals_temp2d.GetDim(1);
-  for(int ion=0; ion < centermax; ion++) {
+  for(int ic=0; ic < nnear; ic++) {
+    int ion=centers.nearCenter(ic);
+    totfunc=funcstart(ion);
     centers.getDistance(e, ion, R);
     for(int n=0; n< centers.nbasis(ion); n++) {
       b=centers.basis(ion, n);
@@ -545,22 +620,18 @@ template <class T>void MO_matrix_cutoff<T>::updateLap( Sample_point * sample,
       for(int i=0; i< imax; i++) {
         //cout << "i " << i << endl;
 
-        int reducedbasis=scalebasis*totfunc;
         scalesymm=i*symmvals_stride;
         if(R(0) < cutoff(totfunc)) {
-          for(int basmo=0; basmo < basismotmp.v[totfunc]; basmo++) {
-            //mo=basisfill(basis, basmo);
-            //c=moCoeff(basis, basmo);
-
-            mo=basisfilltmp.v[reducedbasis+basmo];
-            c=moCoefftmp.v[reducedbasis+basmo];
+          int rowend=rowstart.v[totfunc+1];
+          for(int basmo=rowstart.v[totfunc]; basmo < rowend; basmo++) {
+            mo=molist.v[basmo];
+            c=moCoefftmp.v[basmo];
             //cout << c << "   ";
 
             //mo_counter(mo)++;
 
             scaleval=mo*5;
             //cout << "coeff " << c << endl;
-            //cout << "reducedbasis " << reducedbasis << endl;
             // cout << mo << "   " << basmo << "   " << c << endl;
 
 
@@ -605,7 +676,6 @@ template <class T>void MO_matrix_cutoff<T>::updateHessian(
 )
 {
 
-  int centermax=centers.size();
   newvals=0;
   assert(e < sample->electronSize());
   assert(newvals.GetDim(1)==10);
@@ -615,21 +685,25 @@ template <class T>void MO_matrix_cutoff<T>::updateHessian(
  // static Array2 <doublevar> symmvals_temp(maxbasis,10);
 
   //References to make the code easier to read and slightly faster.
-  Array1 <int> & basismotmp(basismo_list(listnum));
-  Array2 <int> & basisfilltmp(basisfill_list(listnum));
-  Array2 <T> & moCoefftmp(moCoeff_list(listnum));
+  Array1 <int> & rowstart(rowstart_list(listnum));
+  Array1 <int> & molist(molist_list(listnum));
+  Array1 <T> & moCoefftmp(moCoeff_list(listnum));
 
   Basis_function * tempbasis;
 
   T c;
   int scaleval=0, scalesymm=0;
   int mo=0;
-  int scalebasis=basisfilltmp.GetDim(1);
-  centers.updateDistance(e, sample);
+  centers.updateNearDistance(e, sample);
+  int nnear=centers.nNear();
   int totfunc=0;
   int b;
+  Array2 <doublevar> & symmvals_temp2d(MO_matrix_cutoff<T>::symmvals_temp2d);
+  symmvals_temp2d.Resize(maxbasis,10);
   int symmvals_stride=symmvals_temp2d.GetDim(1);
-  for(int ion=0; ion < centermax; ion++)  {
+  for(int ic=0; ic < nnear; ic++) {
+    int ion=centers.nearCenter(ic);
+    totfunc=funcstart(ion);
     centers.getDistance(e, ion, R);
     for(int n=0; n< centers.nbasis(ion); n++)  {
       b=centers.basis(ion, n);
@@ -639,12 +713,12 @@ template <class T>void MO_matrix_cutoff<T>::updateHessian(
 
         int imax=nfunctions(b);
         for(int i=0; i< imax; i++)  {
-          int reducedbasis=scalebasis*totfunc;
           scalesymm=i*10;
           if(R(0) < cutoff(totfunc))  {
-            for(int basmo=0; basmo < basismotmp.v[totfunc]; basmo++)   {
-              mo=basisfilltmp.v[reducedbasis+basmo];
-              c=moCoefftmp.v[reducedbasis+basmo];
+            int rowend=rowstart.v[totfunc+1];
+            for(int basmo=rowstart.v[totfunc]; basmo < rowend; basmo++)   {
+              mo=molist.v[basmo];
+              c=moCoefftmp.v[basmo];
               scaleval=mo*symmvals_stride;
               for(int j=0; j< 10; j++) {
                 newvals.v[scaleval+j]+=c*symmvals_temp2d.v[scalesymm+j];
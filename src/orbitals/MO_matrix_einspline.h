@@ -36,31 +36,53 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include <multi_bspline.h>
 #endif
 
+#include "Bspline_3d.h"
+
 /*! This is a simple adaptor class to translate between the template language
- * and the C-type language of einspline
+ * and the spline evaluators.  vals is in form (MO), grad in form (MO,d), and 
+ * hess in form (MO,d1,d2), all with respect to the fractional coordinates.
  * */
 #ifdef USE_EINSPLINE
 template <class T> class Spline_evaluator { 
   public:
-    void create(Ugrid & gridx, Ugrid & gridy, Ugrid & gridz, int nspline) { } 
+    void create(Array1 <int> & npoints, int nspline, int single, int share) { } 
+    int writer() { return 1; }
+    void sync() { }
     void set(int i, T * data) { }
     void val(doublevar x, doublevar y, doublevar z, T * vals) { } 
     void hess(doublevar x, doublevar y, doublevar z, T* vals, T * grad, T * hess) { } 
 };
 
+inline void einspline_grids(Array1 <int> & npoints, Array1 <Ugrid> & grids) { 
+  grids.Resize(3);
+  for(int d=0; d<3; d++) { 
+    grids(d).start=0;
+    grids(d).end=1.0;
+    grids(d).num=npoints(d);
+  }
+}
+
 template <> class Spline_evaluator<doublevar> { 
 private:
   multi_UBspline_3d_d * spline;
 public:
   Spline_evaluator() { spline=NULL; } 
-  void create(Ugrid &  gridx, Ugrid & gridy, Ugrid & gridz,int nspline) { 
+  void create(Array1 <int> & npoints,int nspline, int single, int share) { 
+    if(single) error("SINGLE_PRECISION needs the built-in B-splines; "
+                     "compile without USE_EINSPLINE");
+    if(share) error("SHARED_MEMORY needs the built-in B-splines; "
+                    "compile without USE_EINSPLINE");
+    Array1 <Ugrid> grids;
+    einspline_grids(npoints,grids);
     BCtype_d bc;
     bc.lCode=PERIODIC; bc.rCode=PERIODIC;
-    spline=create_multi_UBspline_3d_d(gridx,gridy,gridz,bc, bc, bc,nspline);
+    spline=create_multi_UBspline_3d_d(grids(0),grids(1),grids(2),bc, bc, bc,nspline);
   }
   void set(int i, doublevar * data) { 
     set_multi_UBspline_3d_d(spline,i,data);
   }
+  int writer() { return 1; }
+  void sync() { }
   void val(doublevar x, doublevar y, doublevar z,doublevar * vals) { 
     eval_multi_UBspline_3d_d(spline,x,y,z,vals);
   }
@@ -79,14 +101,22 @@ private:
   multi_UBspline_3d_z * spline;
 public:
   Spline_evaluator() { spline=NULL; } 
-  void create(Ugrid &  gridx, Ugrid & gridy, Ugrid & gridz,int nspline) { 
+  void create(Array1 <int> & npoints,int nspline, int single, int share) { 
+    if(single) error("SINGLE_PRECISION needs the built-in B-splines; "
+                     "compile without USE_EINSPLINE");
+    if(share) error("SHARED_MEMORY needs the built-in B-splines; "
+                    "compile without USE_EINSPLINE");
+    Array1 <Ugrid> grids;
+    einspline_grids(npoints,grids);
     BCtype_z bc;
     bc.lCode=PERIODIC; bc.rCode=PERIODIC;
-    spline=create_multi_UBspline_3d_z(gridx,gridy,gridz,bc, bc, bc,nspline);
+    spline=create_multi_UBspline_3d_z(grids(0),grids(1),grids(2),bc, bc, bc,nspline);
   }
   void set(int i, dcomplex * data) { 
     set_multi_UBspline_3d_z(spline,i,data);
   }
+  int writer() { return 1; }
+  void sync() { }
   void val(doublevar x, doublevar y, doublevar z,dcomplex * vals) { 
     eval_multi_UBspline_3d_z(spline,x,y,z,vals);
   }
@@ -99,11 +129,74 @@ public:
   }
 };
 
+#else //USE_EINSPLINE
+
+/*!
+  The built-in B-splines.  A complex orbital is stored as two real 
+  functions, its real and imaginary parts, next to each other; since
+  std::complex is laid out as two doubles, the values come out as T 
+  directly and only the derivatives need to be reordered.
+ */
+template <class T> class Spline_evaluator { 
+private:
+  int single;
+  int ncomp; //!< number of real functions per orbital
+  Bspline_3d <doublevar> dspline;
+  Bspline_3d <float> sspline;
+  int nreal; //!< number of real functions
+public:
+  Spline_evaluator() { single=0; nreal=0; ncomp=sizeof(T)/sizeof(doublevar); } 
+  void create(Array1 <int> & npoints, int nspline, int single_, int share) { 
+    single=single_;
+    if(single) sspline.create(npoints,ncomp*nspline,share);
+    else dspline.create(npoints,ncomp*nspline,share);
+    nreal=ncomp*nspline;
+  }
+  void set(int i, T * data) { 
+    doublevar * d=(doublevar *) data;
+    for(int c=0; c< ncomp; c++) { 
+      if(single) sspline.set(ncomp*i+c,d+c,ncomp);
+      else dspline.set(ncomp*i+c,d+c,ncomp);
+    }
+  }
+  int writer() { return single ? sspline.writer() : dspline.writer(); }
+  void sync() { if(single) sspline.sync(); else dspline.sync(); }
+  void val(doublevar x, doublevar y, doublevar z, T * vals) { 
+    if(single) sspline.val(x,y,z,(doublevar *) vals);
+    else dspline.val(x,y,z,(doublevar *) vals);
+  }
+  void hess(doublevar x, doublevar y, doublevar z, T * vals, 
+      T * grad, T * hess) { 
+    static QMC_THREAD_LOCAL Array1 <doublevar> grad_tmp, hess_tmp;
+    grad_tmp.Resize(3*nreal);
+    hess_tmp.Resize(6*nreal);
+    if(single) sspline.vgh(x,y,z,(doublevar *) vals, grad_tmp.v, hess_tmp.v);
+    else dspline.vgh(x,y,z,(doublevar *) vals, grad_tmp.v, hess_tmp.v);
+    int norb=nreal/ncomp;
+    doublevar * g=(doublevar *) grad;
+    doublevar * h=(doublevar *) hess;
+    //position of (d1,d2) in ([xx xy xz yy yz zz])
+    const int sym[3][3]={ {0,1,2}, {1,3,4}, {2,4,5} };
+    for(int i=0; i< norb; i++) { 
+      for(int c=0; c< ncomp; c++) { 
+        int m=ncomp*i+c;
+        for(int d1=0; d1< 3; d1++) { 
+          g[(3*i+d1)*ncomp+c]=grad_tmp(d1*nreal+m);
+          for(int d2=0; d2< 3; d2++) 
+            h[(9*i+3*d1+d2)*ncomp+c]=hess_tmp(sym[d1][d2]*nreal+m);
+        }
+      }
+    }
+  }
+};
+
 #endif //USE_EINSPLINE
 
 
 /*!
-Represents a periodic set of orbitals using Ken Esler's EINSPLINE library. 
+Represents a periodic set of orbitals as tricubic B-splines on a grid.
+By default the splines are the built-in ones in Bspline_3d.h; compiling
+with USE_EINSPLINE uses Ken Esler's EINSPLINE library instead.
  */
 template <class T> class MO_matrix_einspline:public Templated_MO_matrix<T> { 
 protected:
@@ -111,9 +204,9 @@ protected:
   using Templated_MO_matrix<T>::nmo;
   using Templated_MO_matrix<T>::orbfile;
 private:
-#ifdef USE_EINSPLINE
   Array1 <Spline_evaluator<T> > spline;
-#endif
+  int single_precision; //!< store the spline coefficients as floats
+  int shared_memory; //!< keep one copy of the coefficients per node
   Array2 <doublevar> latvec; //lattice vectors for the cell on which the function is defined
   Array2 <doublevar> latvecinv;
   Array1 <int> npoints;
@@ -123,8 +216,14 @@ private:
   Array1 <int> nmo_lists;
   int ndim;
   Array1 <Array1 <int> > occ;
+  //! If nonempty, the file is complex and orbital i is Re(file_phase(i)*data)
+  Array1 <dcomplex> file_phase;
 public:
   virtual void buildLists(Array1 <Array1 <int> > & occupations);
+  virtual int realEquivalent(vector <string> & words, System * sys,
+                             Templated_MO_matrix <doublevar> *& real);
+  //! Read the complex orbital file as real orbitals with these phases
+  void setFilePhases(Array1 <dcomplex> & phase) { file_phase=phase; }
   virtual void read(vector <string> & words, unsigned int & startpos, 
                     System * sys);
   virtual int showinfo(ostream & os);
@@ -145,7 +244,7 @@ public:
   virtual void updateHessian(Sample_point * sample,
 			     int e, int listnum,Array2<T>&);
 
-  MO_matrix_einspline() { } 
+  MO_matrix_einspline() { single_precision=0; shared_memory=0; } 
 };
 
 
@@ -153,35 +252,113 @@ public:
 #include "MatrixAlgebra.h"
 
 
+//----------------------------------------------------------------------
+
+inline void rotated_orbital(dcomplex val, dcomplex phase, doublevar & x) { 
+  x=(phase*val).real();
+}
+inline void rotated_orbital(dcomplex val, dcomplex phase, dcomplex & x) { 
+  x=phase*val;
+}
+
+template <class T> int MO_matrix_einspline<T>::realEquivalent(vector <string> & words,
+    System * sys, Templated_MO_matrix <doublevar> *& real) { 
+  return 0;
+}
+
+/*!
+  At the Gamma point each orbital on the grid is real up to a phase
+  exp(i theta) if the Hamiltonian is real and the band is not 
+  degenerate with its time-reversed partner.  theta is half the phase 
+  of sum psi^2; the orbitals are used as real if none of them has an
+  imaginary part left over after rotating by -theta.  Any other 
+  k-point keeps the complex evaluation.
+*/
+template <> inline int MO_matrix_einspline<dcomplex>::realEquivalent(
+    vector <string> & words, System * sys, 
+    Templated_MO_matrix <doublevar> *& real) { 
+  for(int i=0; i< kpoint.GetDim(0); i++) 
+    for(int d=0; d< ndim; d++) 
+      if(fabs(kpoint(i,d)) > 1e-8) return 0;
+
+  int isreal=1;
+  Array1 <dcomplex> phase(nmo);
+  if(mpi_info.node==0) { 
+    ifstream is(orbfile.c_str());
+    string dummy;
+    is >> dummy;
+    while(dummy != "orbitals") is>>dummy;
+    is.ignore(180,'\n');
+    int ngridpts=npoints(0)*npoints(1)*npoints(2);
+    Array1 <dcomplex> orb_data(ngridpts);
+    for(int mo=0; mo < nmo && isreal; mo++) { 
+      is.read((char*)(orb_data.v),sizeof(dcomplex)*ngridpts);
+      if(!is) error("Unexpected end of file in ",orbfile);
+      dcomplex sumsq=0.0;
+      doublevar total=0.0;
+      for(int p=0; p< ngridpts; p++) { 
+        sumsq+=orb_data(p)*orb_data(p);
+        total+=norm(orb_data(p));
+      }
+      phase(mo)=abs(sumsq) > 0 ? exp(dcomplex(0.0,-0.5*arg(sumsq))) : 1.0;
+      doublevar leftover=0.0;
+      for(int p=0; p< ngridpts; p++) { 
+        doublevar im=(phase(mo)*orb_data(p)).imag();
+        leftover+=im*im;
+      }
+      if(leftover > 1e-10*total) isreal=0;
+    }
+  }
+#ifdef USE_MPI
+  MPI_Bcast(&isreal,1,MPI_INT,0,MPI_Comm_grp);
+  MPI_Bcast(phase.v,nmo,MPI_DOUBLE_COMPLEX,0,MPI_Comm_grp);
+#endif
+  if(!isreal) return 0;
+
+  MO_matrix_einspline<doublevar> * realspline=new MO_matrix_einspline<doublevar>;
+  unsigned int pos=0;
+  realspline->read(words, pos, sys);
+  realspline->setFilePhases(phase);
+  real=realspline;
+  return 1;
+}
+
 //----------------------------------------------------------------------
 template <class T> void MO_matrix_einspline<T>::buildLists(Array1 <Array1 <int> > & occupations) { 
-#ifdef USE_EINSPLINE
   ifstream is(orbfile.c_str());
   string dummy;
   is >> dummy;
   while(dummy != "orbitals") is>>dummy;
   is.ignore(180,'\n');
   Array1 <T> orb_data(npoints(0)*npoints(1)*npoints(2));
+  Array1 <dcomplex> file_data;
+  if(file_phase.GetDim(0)) file_data.Resize(orb_data.GetDim(0));
 
   occ=occupations; 
   int nsplines=occupations.GetDim(0);
   spline.Resize(occupations.GetDim(0));
   int ngridpts=npoints(0)*npoints(1)*npoints(2);
-  Array1 <Ugrid> grids(ndim);
-  for(int d=0; d<ndim; d++) { 
-    grids(d).start=0;
-    grids(d).end=1.0;
-    grids(d).num=npoints(d);
-  }
   nmo_lists.Resize(nsplines);
   for(int s=0; s< nsplines; s++) { 
     nmo_lists(s)=occupations(s).GetDim(0);
-    spline(s).create(grids(0),grids(1), grids(2),nmo_lists(s));
+    spline(s).create(npoints,nmo_lists(s),single_precision,shared_memory);
   }
+#ifdef USE_MPI
+  //With SHARED_MEMORY only one process per node fills in the splines,
+  //so only those need the orbitals.
+  int mywriter=nsplines > 0 ? spline(0).writer() : 1;
+  Array1 <int> writers(mpi_info.nprocs);
+  MPI_Allgather(&mywriter,1,MPI_INT,writers.v,1,MPI_INT,MPI_Comm_grp);
+#endif
 
   for(int mo=0; mo < nmo; mo++) { 
     if(mpi_info.node==0) {
-      is.read((char*)(orb_data.v),sizeof(T)*ngridpts);
+      if(file_phase.GetDim(0)) { 
+        is.read((char*)(file_data.v),sizeof(dcomplex)*ngridpts);
+        for(int p=0; p< ngridpts; p++) 
+          rotated_orbital(file_data(p),file_phase(mo),orb_data(p));
+      }
+      else is.read((char*)(orb_data.v),sizeof(T)*ngridpts);
     }
 
     for(int s=0; s< nsplines; s++) { 
@@ -191,10 +368,10 @@ template <class T> void MO_matrix_einspline<T>::buildLists(Array1 <Array1 <int>
           int nvals=sizeof(T)/sizeof(double);
           if(mpi_info.node==0) { 
             for(int proc=1; proc < mpi_info.nprocs; proc++) { 
-              MPI_Send(orb_data.v,ngridpts*nvals,MPI_DOUBLE,proc,0,MPI_Comm_grp);
+              if(writers(proc)) MPI_Send(orb_data.v,ngridpts*nvals,MPI_DOUBLE,proc,0,MPI_Comm_grp);
             }
           }
-          else { 
+          else if(mywriter) { 
             MPI_Status status;
             MPI_Recv(orb_data.v,ngridpts*nvals,MPI_DOUBLE,0,0,MPI_Comm_grp,&status);
           }          
@@ -204,17 +381,17 @@ template <class T> void MO_matrix_einspline<T>::buildLists(Array1 <Array1 <int>
       }
     }
   }
-
-#endif
+  for(int s=0; s< nsplines; s++) spline(s).sync();
 }
 //----------------------------------------------------------------------
 
 template <class T> void MO_matrix_einspline<T>::read(vector <string> & words, unsigned int & startpos, System * sys) { 
-#ifdef USE_EINSPLINE
   unsigned int pos=startpos;
   ndim=3;
   if(!readvalue(words,pos=startpos,orbfile,"ORBFILE")) 
     error("Need keyword ORBFILE..");
+  single_precision=haskeyword(words,pos=startpos,"SINGLE_PRECISION");
+  shared_memory=haskeyword(words,pos=startpos,"SHARED_MEMORY");
   double magnify=1.0;
   readvalue(words,pos=startpos,magnify,"MAGNIFY");
   //Should probably just make node0 read this and send to others over MPI..
@@ -269,17 +446,23 @@ template <class T> void MO_matrix_einspline<T>::read(vector <string> & words, un
   is.ignore(180,'\n'); is.ignore(180,'\n');
 
   is.close();
-#else
-  error("Not compiled with EINSPLINE support!");
-#endif //USE_EINSPLINE
-
 }
 //----------------------------------------------------------------------
 
 template <class T> int MO_matrix_einspline<T>::showinfo(ostream & os) { 
+#ifdef USE_EINSPLINE
   os << "Einspline" << endl;
+#else
+  os << "B-spline orbitals" << endl;
+#endif
   os << "NMO " << nmo << endl;
   os << "ORBFILE " << orbfile << endl;
+  os << "Grid " << npoints(0) << " x " << npoints(1) << " x " << npoints(2);
+  if(single_precision) os << ", single precision coefficients";
+  if(shared_memory) os << ", shared within each node";
+  os << endl;
+  if(file_phase.GetDim(0)) 
+    os << "Complex orbitals evaluated as real (time-reversal symmetry)" << endl;
   return 1;
 
 }
@@ -289,13 +472,14 @@ template <class T>int MO_matrix_einspline<T>::writeinput(string & indent, ostrea
   os << indent << "EINSPLINE_MO" << endl;
   os<< indent << "NMO " << nmo << endl;
   os<< indent << "ORBFILE " << orbfile << endl;
+  if(single_precision) os << indent << "SINGLE_PRECISION" << endl;
+  if(shared_memory) os << indent << "SHARED_MEMORY" << endl;
   return 1;
 }
 //----------------------------------------------------------------------
 
 template <class T> void MO_matrix_einspline<T>::updateVal(Sample_point * sample,
     int e, int listnum, Array2 <T> & newvals) { 
-#ifdef USE_EINSPLINE
   Array1 <doublevar> pos(ndim),u(ndim);
   sample->getElectronPos(e,pos);
   u=0; 
@@ -321,13 +505,11 @@ template <class T> void MO_matrix_einspline<T>::updateVal(Sample_point * sample,
   for(int i=0; i< nmo_lists(listnum); i++) { 
     newvals(i,0)=vals(i);
   }
-#endif
 }
 //----------------------------------------------------------------------
 
 template <class T> void MO_matrix_einspline<T>::updateLap(Sample_point * sample,
     int e,int listnum,Array2 <T> & newvals) {
-#ifdef USE_EINSPLINE
   Array2 <T> hessvals(nmo_lists(listnum),1+ndim+ndim*(ndim+1)/2);
   updateHessian(sample,e,listnum,hessvals);
   for(int i=0; i < nmo_lists(listnum); i++) {
@@ -339,7 +521,6 @@ template <class T> void MO_matrix_einspline<T>::updateLap(Sample_point * sample,
       newvals(i,ndim+1)+=hessvals(i,d);
     }
   }
-#endif
 }
 
 
@@ -347,7 +528,6 @@ template <class T> void MO_matrix_einspline<T>::updateLap(Sample_point * sample,
 
 template <class T> void MO_matrix_einspline<T>::updateHessian(Sample_point * sample,
     int e,int listnum,Array2 <T> & newvals) { 
-#ifdef USE_EINSPLINE
   Array1 <doublevar> pos(ndim),u(ndim);
   sample->getElectronPos(e,pos);
   u=0;
@@ -451,7 +631,6 @@ template <class T> void MO_matrix_einspline<T>::updateHessian(Sample_point * sam
       }
     }
   }
-#endif
 }
 //----------------------------------------------------------------------
 
@@ -23,23 +23,18 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "Sample_point.h"
 #include "qmc_io.h"
 
+QMC_THREAD_LOCAL Array2 <doublevar> MO_matrix_standard::batch_basis;
+QMC_THREAD_LOCAL Array2 <doublevar> MO_matrix_standard::batch_coeff;
 
 
 void MO_matrix_standard::init() {
   moCoeff.Resize(nmo, totbasis);
 
   single_write(cout, "Standard MO\n");
-  ifstream ORB(orbfile.c_str());
-  if(!ORB)
-  {
-    error("couldn't find orb file ", orbfile);
-  }
-
   single_write(cout,"Reading orbitals from ",orbfile, "\n");
   Array3 <int> coeffmat;
   Array1 <doublevar> coeff;
-  int tempint=readorb(ORB,centers,nmo, maxbasis,kpoint, coeffmat, coeff);
-  ORB.close();
+  int tempint=readorbfile(orbfile,centers,nmo, maxbasis,kpoint, coeffmat, coeff);
   single_write(cout, tempint," unique MO coefficients found.\n\n");
 
   //Fill moCoeff
@@ -247,6 +242,63 @@ void MO_matrix_standard::updateVal(Sample_point * sample, int e,
 
 //------------------------------------------------------------------------
 
+void MO_matrix_standard::updateValBatch(Sample_point * sample, int e,
+                                        int listnum, Array2 <doublevar> & pos,
+                                        Array2 <doublevar> & newvals) { 
+  int npos=pos.GetDim(0);
+  int nmo_list=moLists(listnum).GetDim(0);
+  assert(newvals.GetDim(0) >= npos);
+  assert(newvals.GetDim(1) >= nmo_list);
+  if(npos==0) return;
+
+  Array2 <doublevar> & batch_basis(MO_matrix_standard::batch_basis);
+  Array2 <doublevar> & batch_coeff(MO_matrix_standard::batch_coeff);
+  batch_basis.Resize(npos,totbasis);
+  Array1 <doublevar> basisvals(totbasis);
+  Array1 <doublevar> R(5), oldpos(3), r(3);
+  int centermax=centers.size();
+  sample->getElectronPos(e,oldpos);
+  for(int p=0; p < npos; p++) { 
+    for(int d=0; d< 3; d++) r(d)=pos(p,d);
+    sample->setElectronPosNoNotify(e,r);
+    centers.updateDistance(e, sample);
+    int currfunc=0;
+    for(int ion=0; ion < centermax; ion++) {
+      centers.getDistance(e, ion, R);
+      for(int n=0; n< centers.nbasis(ion); n++) {
+        Basis_function * tempbasis=basis(centers.basis(ion,n));
+        tempbasis->calcVal(R, basisvals, currfunc);
+        currfunc+=tempbasis->nfunc();
+      }
+    }
+    for(int f=0; f< totbasis; f++) batch_basis(p,f)=basisvals(f);
+  }
+  sample->setElectronPosNoNotify(e,oldpos);
+
+  batch_coeff.Resize(nmo_list,totbasis);
+  for(int m=0; m < nmo_list; m++) { 
+    int mo=moLists(listnum)(m);
+    for(int f=0; f< totbasis; f++) batch_coeff(m,f)=moCoeff(mo,f);
+  }
+
+#ifdef USE_BLAS
+  cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasTrans, npos, nmo_list, 
+              totbasis, 1.0, batch_basis.v, totbasis, batch_coeff.v, totbasis,
+              0.0, newvals.v, newvals.GetDim(1));
+#else
+  for(int p=0; p < npos; p++) { 
+    for(int m=0; m < nmo_list; m++) { 
+      doublevar sum=0;
+      for(int f=0; f< totbasis; f++) 
+        sum+=batch_basis(p,f)*batch_coeff(m,f);
+      newvals(p,m)=sum;
+    }
+  }
+#endif
+}
+
+//------------------------------------------------------------------------
+
 void MO_matrix_standard::getBasisVal(Sample_point * sample, int e,
 				     Array1 <doublevar> & newvals
 				     ) {
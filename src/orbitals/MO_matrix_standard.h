@@ -38,6 +38,8 @@ protected:
 private:
   Array2 <doublevar> moCoeff;
   Array1 < Array1 <int> > moLists;
+  static QMC_THREAD_LOCAL Array2 <doublevar> batch_basis; //!< scratch for updateValBatch: (position, basis)
+  static QMC_THREAD_LOCAL Array2 <doublevar> batch_coeff; //!< scratch for updateValBatch: (MO, basis)
 public:
 
   /*!
@@ -91,6 +93,15 @@ public:
     int e,
     Array1 <doublevar> & newvals
   );
+
+  virtual void updateValBatch(
+    Sample_point * sample,
+    int e,
+    int listnum,
+    Array2 <doublevar> & pos,
+    Array2 <doublevar> & newvals
+    //!< The return: in form (position, MO)
+  );
   
   virtual void updateLap(
    Sample_point * sample,
@@ -135,6 +135,79 @@ template <class T> T InverseGetNewRatio(const Array2 <T> & a1,
 }
 
 
+//Apply k buffered column replacements to the inverse at once 
+//(delayed updates).  Column lCols(j) is replaced by newCols(j,:), and 
+//cinv is the transposed inverse of the k x k matrix 
+//C(i,j)=newCols(i,:).a1(lCols(j),:).  The columns must be distinct.
+template <class T> void InverseUpdateColumns(Array2 <T> & a1, 
+    const Array2 <T> & newCols, const Array1 <int> & lCols, 
+    const Array2 <T> & cinv, const int k, const int n) { 
+  Array2 <T> y(n,k), z(n,k), oldrows(k,n);
+  for(int m=0; m < n; m++) { 
+    for(int j=0; j < k; j++) { 
+      T f=T(0.0);
+      for(int l=0; l < n; l++) f+=a1(m,l)*newCols(j,l);
+      if(lCols(j)==m) f-=T(1.0);
+      y(m,j)=f;
+    }
+    for(int i=0; i < k; i++) { 
+      T f=T(0.0);
+      for(int j=0; j < k; j++) f+=y(m,j)*cinv(j,i);
+      z(m,i)=f;
+    }
+  }
+  for(int i=0; i < k; i++) 
+    for(int l=0; l < n; l++) oldrows(i,l)=a1(lCols(i),l);
+  for(int m=0; m < n; m++) { 
+    for(int i=0; i < k; i++) { 
+      T f=z(m,i);
+      for(int l=0; l < n; l++) a1(m,l)-=f*oldrows(i,l);
+    }
+  }
+}
+
+#ifdef USE_BLAS
+void InverseUpdateColumns(Array2 <doublevar> & a1, 
+    const Array2 <doublevar> & newCols, const Array1 <int> & lCols, 
+    const Array2 <doublevar> & cinv, const int k, const int n);
+#endif
+
+//Single-precision storage for inverses of type T (see the mixed 
+//precision updates below).
+template <class T> struct Single_precision { typedef float type; };
+template <> struct Single_precision <dcomplex> { typedef complex <float> type; };
+
+//Mixed precision versions of InverseGetNewRatio and InverseUpdateColumn:
+//the inverse is stored in S (single precision) and the products are 
+//accumulated in T.
+template <class S, class T> T MixedInverseGetNewRatio(const Array2 <S> & a1, 
+    const Array1 <T> & newCol, const int lCol, const int n) { 
+  T f=T(0.0);
+  for(int i=0; i < n; ++i) f+=T(a1(lCol,i))*newCol[i];
+  return T(1.0)/f;
+}
+
+template <class S, class T> T MixedInverseUpdateColumn(Array2 <S> & a1, 
+    const Array1 <T> & newCol, const int lCol, const int n) { 
+  Array1 <T> tmpColL(n), prod(n);
+  T f=T(0.0);
+  for(int i=0; i < n; ++i) f+=T(a1(lCol,i))*newCol[i];
+  f=-T(1.0)/f;
+  for(int j=0; j < n; ++j) { 
+    tmpColL[j]=T(a1(lCol,j));
+    T p=T(0.0);
+    for(int i=0; i < n; ++i) p+=T(a1(j,i))*newCol[i];
+    prod[j]=p*f;
+  }
+  for(int i=0; i < n; ++i) { 
+    for(int j=0; j < n; ++j) 
+      a1(i,j)=S(T(a1(i,j))+tmpColL[j]*prod[i]);
+  }
+  f=-f;
+  for(int j=0; j < n; ++j) a1(lCol,j)=S(f*tmpColL[j]);
+  return f;
+}
+
 doublevar InverseGetNewRatioRow(const Array2 <doublevar> & a1, const Array1 <doublevar> & newRow,
                              const int lRow, const int n);
 doublevar InverseUpdateColumn(Array2 <doublevar> & a1, const Array2 <doublevar> & a,
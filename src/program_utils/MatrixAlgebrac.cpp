@@ -99,9 +99,10 @@ int dgetrs(char trans, int n, int nrhs, double * A, int lda, int * ipiv,
 
 const doublevar TINY=1.0e-20;
 
-Array2 <doublevar> tmp2;
-Array1 <doublevar> tmp11,tmp12;
-Array1 <int> itmp1;
+//Scratch space for the routines below; each thread needs its own.
+QMC_THREAD_LOCAL Array2 <doublevar> tmp2;
+QMC_THREAD_LOCAL Array1 <doublevar> tmp11,tmp12;
+QMC_THREAD_LOCAL Array1 <int> itmp1;
 
 // LU decomposition of matrix a, which is overwritten
 //Modified to return 1 if successful, 0 if not.
@@ -757,6 +758,28 @@ doublevar InverseGetNewRatioRow(const Array2 <doublevar> & a1, const Array1 <dou
 }
 
 
+#ifdef USE_BLAS
+//BLAS-3 version of the delayed update in MatrixAlgebra.h
+void InverseUpdateColumns(Array2 <doublevar> & a1, 
+    const Array2 <doublevar> & newCols, const Array1 <int> & lCols, 
+    const Array2 <doublevar> & cinv, const int k, const int n) { 
+  Array2 <doublevar> y(n,k), z(n,k), oldrows(k,n);
+  int lda=a1.GetDim(1);
+  cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasTrans, n, k, n, 
+              1.0, a1.v, lda, newCols.v, newCols.GetDim(1), 
+              0.0, y.v, k);
+  for(int j=0; j < k; j++) y(lCols(j),j)-=1.0;
+  cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, n, k, k,
+              1.0, y.v, k, cinv.v, cinv.GetDim(1), 
+              0.0, z.v, k);
+  for(int i=0; i < k; i++) 
+    cblas_dcopy(n, a1.v+lCols(i)*lda, 1, oldrows.v+i*n, 1);
+  cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, n, n, k,
+              -1.0, z.v, k, oldrows.v, n, 
+              1.0, a1.v, lda);
+}
+#endif
+
 // Update inverse a1 after column in matrix a has changed
 // get new column out of array1 newCol
 //
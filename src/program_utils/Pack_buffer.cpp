@@ -0,0 +1,148 @@
+/*
+ 
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ 
+*/
+
+#include "Pack_buffer.h"
+
+void Pack_buffer::put(const Array1 <doublevar> & a) { 
+  int n=a.GetDim(0);
+  put(n);
+  for(int i=0; i< n; i++) data.push_back(a(i));
+}
+
+void Pack_buffer::put(const Array1 <int> & a) { 
+  int n=a.GetDim(0);
+  put(n);
+  for(int i=0; i< n; i++) put(a(i));
+}
+
+void Pack_buffer::put(const Array2 <doublevar> & a) { 
+  int n1=a.GetDim(0), n2=a.GetDim(1);
+  put(n1);
+  put(n2);
+  for(int i=0; i< n1; i++) 
+    for(int j=0; j< n2; j++) data.push_back(a(i,j));
+}
+
+void Pack_buffer::put(const string & str) { 
+  int n=str.size();
+  put(n);
+  for(int i=0; i< n; i++) put(int(str[i]));
+}
+
+//----------------------------------------------------------------------
+
+void Pack_buffer::get(Array1 <doublevar> & a) { 
+  int n=getInt();
+  a.Resize(n);
+  for(int i=0; i< n; i++) a(i)=getDouble();
+}
+
+void Pack_buffer::get(Array1 <int> & a) { 
+  int n=getInt();
+  a.Resize(n);
+  for(int i=0; i< n; i++) a(i)=getInt();
+}
+
+void Pack_buffer::get(Array2 <doublevar> & a) { 
+  int n1=getInt();
+  int n2=getInt();
+  a.Resize(n1,n2);
+  for(int i=0; i< n1; i++) 
+    for(int j=0; j< n2; j++) a(i,j)=getDouble();
+}
+
+void Pack_buffer::get(string & str) { 
+  int n=getInt();
+  str.resize(n);
+  for(int i=0; i< n; i++) str[i]=char(getInt());
+}
+
+//----------------------------------------------------------------------
+
+void Pack_buffer::mpiSend(int node) { 
+#ifdef USE_MPI
+  int n=data.size();
+  doublevar dummy=0;
+  MPI_Send(n > 0 ? &data[0] : &dummy, n, MPI_DOUBLE, node, 0, MPI_Comm_grp);
+#else
+  error("Pack_buffer::mpiSend: not using MPI, this is most likely a bug");
+#endif
+}
+
+void Pack_buffer::mpiReceive(int node) { 
+#ifdef USE_MPI
+  MPI_Status status;
+  MPI_Probe(node, 0, MPI_Comm_grp, &status);
+  int n;
+  MPI_Get_count(&status, MPI_DOUBLE, &n);
+  data.resize(n);
+  doublevar dummy;
+  MPI_Recv(n > 0 ? &data[0] : &dummy, n, MPI_DOUBLE, node, 0, MPI_Comm_grp, &status);
+  pos=0;
+#else
+  error("Pack_buffer::mpiReceive: not using MPI, this is most likely a bug");
+#endif
+}
+
+//----------------------------------------------------------------------
+
+void Pack_buffer::startSend(int node) { 
+#ifdef USE_MPI
+  assert(!sending);
+  if(data.size()==0) data.push_back(0.0); //so that we have a valid address
+  MPI_Isend(&data[0], data.size(), MPI_DOUBLE, node, 0, MPI_Comm_grp, &request);
+  sending=1;
+#else
+  error("Pack_buffer::startSend: not using MPI, this is most likely a bug");
+#endif
+}
+
+int Pack_buffer::testSend() { 
+#ifdef USE_MPI
+  if(!sending) return 1;
+  int flag;
+  MPI_Test(&request, &flag, MPI_STATUS_IGNORE);
+  if(flag) sending=0;
+  return flag;
+#else
+  return 1;
+#endif
+}
+
+void Pack_buffer::waitSend() { 
+#ifdef USE_MPI
+  if(!sending) return;
+  MPI_Wait(&request, MPI_STATUS_IGNORE);
+  sending=0;
+#endif
+}
+
+int Pack_buffer::messageWaiting(int node) { 
+#ifdef USE_MPI
+  int flag;
+  MPI_Status status;
+  MPI_Iprobe(node, 0, MPI_Comm_grp, &flag, &status);
+  return flag;
+#else
+  return 0;
+#endif
+}
+
+//----------------------------------------------------------------------
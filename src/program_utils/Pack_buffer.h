@@ -0,0 +1,102 @@
+/*
+ 
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ 
+*/
+
+#ifndef PACK_BUFFER_H_INCLUDED
+#define PACK_BUFFER_H_INCLUDED
+
+#include "Qmc_std.h"
+
+/*!
+  \brief
+  A flat, contiguous buffer of doubles that objects are packed into, so that 
+  they can be sent to another node in a single message.
+
+  Integers and characters are stored as doubles, which is exact for anything
+  that we would send.  Objects pack themselves with put() and read themselves
+  back in the same order with the get functions.  Several objects may be 
+  packed one after another into the same buffer.
+ */
+class Pack_buffer { 
+public:
+  Pack_buffer() { pos=0; sending=0; }
+  void clear() { 
+    data.clear();
+    pos=0;
+  }
+  //! start reading from the beginning again
+  void rewind() { pos=0; }
+  int size() const { return data.size(); }
+  //! true if everything in the buffer has been read
+  int atEnd() const { return pos >= int(data.size()); }
+
+  void put(doublevar d) { data.push_back(d); }
+  void put(int i) { data.push_back(doublevar(i)); }
+  void put(const Array1 <doublevar> & a);
+  void put(const Array1 <int> & a);
+  void put(const Array2 <doublevar> & a);
+  void put(const string & str);
+
+  doublevar getDouble() { 
+    assert(pos < int(data.size()));
+    return data[pos++];
+  }
+  int getInt() { 
+    assert(pos < int(data.size()));
+    return int(data[pos++]);
+  }
+  void get(doublevar & d) { d=getDouble(); }
+  void get(int & i) { i=getInt(); }
+  void get(Array1 <doublevar> & a);
+  void get(Array1 <int> & a);
+  void get(Array2 <doublevar> & a);
+  void get(string & str);
+
+  /*!
+    Send the whole buffer as one message.  The receiver does not need to
+    know the size in advance.
+   */
+  void mpiSend(int node);
+  /*!
+    Replace the contents with one message from node and rewind.
+   */
+  void mpiReceive(int node);
+
+  /*!
+    Non-blocking version of mpiSend.  The buffer must not be changed or
+    copied until waitSend() or testSend() says that the send is complete.
+   */
+  void startSend(int node);
+  //! returns 1 if the send started by startSend has finished
+  int testSend();
+  void waitSend();
+  //! returns 1 if a message from node can be received by mpiReceive
+  int messageWaiting(int node);
+
+private:
+  vector <doublevar> data;
+  int pos; //!< read position
+  int sending; //!< a startSend is in flight
+#ifdef USE_MPI
+  MPI_Request request;
+#endif
+};
+
+#endif //PACK_BUFFER_H_INCLUDED
+//--------------------------------------------------------------------------
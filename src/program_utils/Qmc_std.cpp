@@ -29,6 +29,16 @@ mpi_info_struct mpi_info;
 
 #ifdef USE_MPI
 MPI_Comm MPI_Comm_grp;
+
+MPI_Comm node_comm() { 
+  static MPI_Comm comm=MPI_COMM_NULL;
+#if MPI_VERSION >= 3
+  if(comm==MPI_COMM_NULL) 
+    MPI_Comm_split_type(MPI_Comm_grp, MPI_COMM_TYPE_SHARED, mpi_info.node,
+                        MPI_INFO_NULL, &comm);
+#endif
+  return comm;
+}
 #endif
 
 int parallel_sum(int inp) {
@@ -37,6 +37,10 @@ extern "C" {
 }
 #endif
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace std;
 
 typedef double doublevar;
@@ -60,8 +64,28 @@ extern mpi_info_struct mpi_info;
 
 #ifdef USE_MPI
 extern MPI_Comm MPI_Comm_grp;  // communicator for each independent process
+//! The processes of MPI_Comm_grp that share memory with this one, or MPI_COMM_NULL
+MPI_Comm node_comm();
+#endif
+
+//Scratch space that the objects of a class share.  With OpenMP the
+//walker loops evaluate the same System and Wavefunction_data objects
+//from several threads, so each thread gets its own copy.
+#ifdef _OPENMP
+#define QMC_THREAD_LOCAL thread_local
+#else
+#define QMC_THREAD_LOCAL
 #endif
 
+//! The OpenMP thread we are on, 0 without OpenMP
+inline int thread_num() {
+#ifdef _OPENMP
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
+}
+
 int parallel_sum(int inp);
 doublevar parallel_sum(doublevar inp);
 dcomplex parallel_sum(dcomplex inp);
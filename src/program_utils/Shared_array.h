@@ -0,0 +1,128 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef SHARED_ARRAY_H_INCLUDED
+#define SHARED_ARRAY_H_INCLUDED
+
+#include "Qmc_std.h"
+
+/*!
+\brief
+A one-dimensional array for large read-only tables, which can be 
+allocated once per node and shared by all the MPI processes on it.
+
+With share=1 in Resize() the memory comes from an MPI-3 shared window
+on node_comm().  Only the first process on each node (writer()) fills
+the array; every process must then call sync() before reading it.  
+Without MPI, with share=0, or with an MPI older than 3.0, each process
+gets its own copy and writer() is always true, so the same calling 
+code works everywhere.  Resize(), sync() and the destructor are 
+collective over MPI_Comm_grp when the array is shared.
+*/
+template <class T> class Shared_array {
+public:
+  Shared_array() { 
+    v=NULL;
+    size=0;
+    owner=1;
+    shared=0;
+#ifdef USE_MPI
+    win=MPI_WIN_NULL;
+#endif
+  }
+  ~Shared_array() { clear(); }
+
+  void Resize(int n, int share=0) { 
+    clear();
+    size=n;
+#if defined(USE_MPI) && MPI_VERSION >= 3
+    if(share && node_comm()!=MPI_COMM_NULL) { 
+      int noderank;
+      MPI_Comm_rank(node_comm(),&noderank);
+      owner=(noderank==0);
+      MPI_Aint nbytes=owner ? MPI_Aint(n)*sizeof(T) : 0;
+      void * base;
+      MPI_Win_allocate_shared(nbytes, sizeof(T), MPI_INFO_NULL, node_comm(),
+                              &base, &win);
+      MPI_Aint qsize;
+      int disp;
+      MPI_Win_shared_query(win, 0, &qsize, &disp, &base);
+      v=(T *) base;
+      MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+      shared=1;
+      return;
+    }
+#endif
+    owner=1;
+    v=new T[n];
+  }
+
+  //! Whether this process fills the array.
+  int writer() { return owner; }
+  int isShared() { return shared; }
+
+  //! Make the writer's changes visible on the node.
+  void sync() { 
+#if defined(USE_MPI) && MPI_VERSION >= 3
+    if(shared) { 
+      MPI_Win_sync(win);
+      MPI_Barrier(node_comm());
+      MPI_Win_sync(win);
+    }
+#endif
+  }
+
+  void clear() { 
+#if defined(USE_MPI) && MPI_VERSION >= 3
+    if(shared) { 
+      MPI_Win_unlock_all(win);
+      MPI_Win_free(&win);
+      v=NULL;
+    }
+#endif
+    if(v) delete [] v;
+    v=NULL;
+    size=0;
+    shared=0;
+    owner=1;
+  }
+
+  int GetDim(int d) { return size; }
+
+  T & operator()(int i) { 
+#ifdef RANGE_CHECKING
+    if(i < 0 || i >= size) error("Shared_array index out of range ", i);
+#endif
+    return v[i];
+  }
+
+  T * v;
+private:
+  int size;
+  int owner;
+  int shared;
+#ifdef USE_MPI
+  MPI_Win win;
+#endif
+  Shared_array(const Shared_array &);
+  Shared_array & operator=(const Shared_array &);
+};
+
+#endif //SHARED_ARRAY_H_INCLUDED
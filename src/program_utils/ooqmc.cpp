@@ -294,7 +294,8 @@ void doinput(Program_options & options,
   //Set the random seed if specified
   pos=0;
   vector <string> randnum;
-  if(readsection(words, pos, randnum, "RANDOMSEED")) {
+  int has_seed=readsection(words, pos, randnum, "RANDOMSEED");
+  if(has_seed) {
     if(randnum.size() != 2) {
       error("RANDOMSEED needs two numbers");
     }
@@ -302,6 +303,13 @@ void doinput(Program_options & options,
     long int is2=atoi(randnum[1].c_str());
     rng.seed(is1, is2);
   }
+  if(haskeyword(words, pos=0, "COUNTER_RNG")) { 
+    //Otherwise each process keys its streams from its own /dev/urandom 
+    //seed, and the run can't be reproduced.
+    if(!has_seed)
+      error("COUNTER_RNG needs a RANDOMSEED");
+    rng.useCounterStreams();
+  }
   //else {
   //  rng.seed(12345, 98234 );
   //}
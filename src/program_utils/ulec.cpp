@@ -20,12 +20,20 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "ulec.h"
 
+#ifdef _OPENMP
+thread_local Random_generator rng;
+#else
 Random_generator rng;
+#endif
 
 
 double unif()
 {
+  if(rng.counterStreams()) return rng.ulec();
   static int ix=1234567;
+#ifdef _OPENMP
+#pragma omp threadprivate(ix)
+#endif
   int k1=ix/127773;
   ix=16807*(ix-k1*127773)-k1*2836;
   if(ix < 0)
@@ -25,13 +25,30 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 
 /*!
- 
+  Purposes for the counter-based streams.  Each (walker, step, purpose)
+  combination gets its own independent stream of random numbers.
+*/
+enum rng_purpose { rng_default, rng_init, rng_move, rng_quadrature,
+                   rng_measure, rng_tmove, rng_branch };
+
+/*!
+  By default this is the combined L'Ecuyer generator, with one 
+  sequential state.  After useCounterStreams(), it instead evaluates a 
+  Philox4x32-10 counter-based generator (Salmon et al, SC11), keyed by
+  the seed, at a counter built from (walker, step, purpose) as set by 
+  setStream().  The random numbers a walker sees then do not depend on 
+  which thread or process moves it, or on how many others there are.
 */
 class Random_generator
 {
 public:
   Random_generator()
   {
+    counter_mode=0;
+    run=0;
+    nbuf=0;
+    for(int i=0; i< 4; i++) ctr[i]=0;
+    key[0]=key[1]=0;
     is1=12345;
     is2=56789;
     //Try to read in a true random number from 
@@ -73,6 +90,49 @@ public:
     is2_=is2;
   }
 
+  /*!
+    Switch to counter-based streams keyed by the current seed.  Call this
+    after seeding and before any per-process change of the seed, so that 
+    every process shares the key.
+  */
+  void useCounterStreams() {
+    counter_mode=1;
+    key[0]=(unsigned int) is1;
+    key[1]=(unsigned int) is2;
+    setStream(0,0,rng_default);
+  }
+
+  int counterStreams() { return counter_mode; }
+
+  /*!
+    Start a new run, so that the streams of successive methods (or 
+    successive VMC runs inside an optimization) do not overlap.
+   */
+  void newRun() {
+    run++;
+    setStream(0,0,rng_default);
+  }
+
+  /*!
+    Select the stream for walker at step for purpose.  Does nothing 
+    unless counter-based streams are in use.  walker should be the 
+    global walker index, and step should count from the start of the run.
+  */
+  void setStream(int walker, int step, rng_purpose purpose) {
+    if(!counter_mode) return;
+    ctr[0]=0;
+    ctr[1]=(unsigned int) step;
+    ctr[2]=(unsigned int) walker;
+    ctr[3]=(run << 8) | (unsigned int) purpose;
+    nbuf=0;
+    iset=0;
+  }
+
+  //! Switch to the stream for purpose, keeping the walker and step
+  void setPurpose(rng_purpose purpose) { 
+    setStream(ctr[2], ctr[1], purpose);
+  }
+
   /*!
        uniform random number generator (combined type)
 
@@ -82,6 +142,15 @@ public:
    */
   double ulec()
   {
+    if(counter_mode) { 
+      if(nbuf==0) { 
+        philox(ctr, buf);
+        ctr[0]++;
+        nbuf=4;
+      }
+      nbuf--;
+      return (buf[nbuf]+0.5)*2.3283064365386963e-10;
+    }
     long int k,iz;
     k=is1/53668;
     is1=is1-k*53668;
@@ -138,13 +207,48 @@ private:
   int iset;
   double gset;
 
+  int counter_mode;
+  unsigned int run;
+  unsigned int key[2];
+  unsigned int ctr[4];
+  unsigned int buf[4];
+  int nbuf;
+
+  /*!
+    Philox4x32-10: ten rounds of multiply-and-xor on a 128-bit counter
+    with a 64-bit key.
+  */
+  void philox(const unsigned int * in, unsigned int * out) {
+    unsigned int c0=in[0], c1=in[1], c2=in[2], c3=in[3];
+    unsigned int k0=key[0], k1=key[1];
+    for(int r=0; r< 10; r++) { 
+      unsigned long long p0=0xD2511F53ULL*c0;
+      unsigned long long p1=0xCD9E8D57ULL*c2;
+      unsigned int hi0=(unsigned int)(p0 >> 32), lo0=(unsigned int) p0;
+      unsigned int hi1=(unsigned int)(p1 >> 32), lo1=(unsigned int) p1;
+      c0=hi1^c1^k0;
+      c1=lo1;
+      c2=hi0^c3^k1;
+      c3=lo0;
+      k0+=0x9E3779B9U;
+      k1+=0xBB67AE85U;
+    }
+    out[0]=c0; out[1]=c1; out[2]=c2; out[3]=c3;
+  }
+
 };
 
 /*!
 This is one of the few times that we actually
 _want_ a global variable...
+With OpenMP each thread gets its own generator, so that the walker 
+loops can be run in parallel.
 */
+#ifdef _OPENMP
+extern thread_local Random_generator rng;
+#else
 extern Random_generator rng;
+#endif
 
 double unif();
 
@@ -169,11 +169,7 @@ void Average_ekt::evaluate_valence(Wavefunction_data * wfdata, Wavefunction * wf
   Array2<doublevar> Kin(nelectrons, wf->nfunc());
   //Array2<doublevar> Kin0(nelectrons, wf->nfunc());
   Array2<dcomplex> movals_lap(nmo, 5);
-  for(int e=0; e< nelectrons; e++) { 
-    movals1_base(e).Resize(nmo,1);
-    //Kin(e).Resize(1); //The Kinetic energy 
-    calc_mos(sample, e, movals1_base(e));
-  }
+  calc_mos_all(sample, movals1_base);
 //  sys->calcKineticSeparated(sample,saved_r(i),Kin);
 
   //***** calculate kinetic energy and potential energy
@@ -313,16 +309,13 @@ void Average_ekt::evaluate_obdm(Wavefunction_data * wfdata, Wavefunction * wf,
   int nelectrons=nup+ndown;
 
   Array1 <Array2 <dcomplex> > movals1_base(nelectrons);
-  for(int e=0; e< nelectrons; e++) { 
-    movals1_base(e).Resize(nmo,1);
-    calc_mos(sample,e,movals1_base(e));
-    /*! Huihuo
-      Here, permutation symmetry has been applied, the real evaluation quantity is 
-      sum_(e=1)^N phi_i* (r_e) phi_j(r') psi(r_1,... r',...r_N)/psi(r_1, ..., r_n, ..., r_N)
-      Therefore, movals1_base[e, i] = phi_i(r_e), where e is the index of the electron. 
-      !!!One need to be careful about the off-gamma point 1 RDM 
-      */
-  }
+  calc_mos_all(sample,movals1_base);
+  /*! Huihuo
+    Here, permutation symmetry has been applied, the real evaluation quantity is 
+    sum_(e=1)^N phi_i* (r_e) phi_j(r') psi(r_1,... r',...r_N)/psi(r_1, ..., r_n, ..., r_N)
+    Therefore, movals1_base[e, i] = phi_i(r_e), where e is the index of the electron. 
+    !!!One need to be careful about the off-gamma point 1 RDM 
+    */
   //  avg.vals.Resize(nmo+4*nmo*nmo);
   //  avg.vals=0;
 
@@ -990,6 +983,38 @@ void Average_ekt::calc_mos(Sample_point * sample, int e, Array2 <dcomplex> & mov
 }
 
 
+/*
+   The orbitals at every electron position, evaluated as one block of 
+   positions with electron 0 as the probe.  movals(e) is (MO, 0).
+   */
+void Average_ekt::calc_mos_all(Sample_point * sample, 
+    Array1 <Array2 <dcomplex> > & movals) { 
+  int nelectrons=sample->electronSize();
+  Array2 <doublevar> epos(nelectrons,3);
+  Array1 <doublevar> r(3);
+  for(int e=0; e< nelectrons; e++) { 
+    sample->getElectronPos(e,r);
+    for(int d=0; d< 3; d++) epos(e,d)=r(d);
+  }
+  movals.Resize(nelectrons);
+  if(complex_orbitals) { 
+    Array2 <dcomplex> movals_batch(nelectrons,nmo);
+    cmomat->updateValBatch(sample,0,0,epos,movals_batch);
+    for(int e=0; e< nelectrons; e++) { 
+      movals(e).Resize(nmo,1);
+      for(int i=0; i< nmo; i++) movals(e)(i,0)=movals_batch(e,i);
+    }
+  }
+  else { 
+    Array2 <doublevar> movals_batch(nelectrons,nmo);
+    momat->updateValBatch(sample,0,0,epos,movals_batch);
+    for(int e=0; e< nelectrons; e++) { 
+      movals(e).Resize(nmo,1);
+      for(int i=0; i< nmo; i++) movals(e)(i,0)=movals_batch(e,i);
+    }
+  }
+}
+
 /*
    Calculate the values, gradient and laplacians of molecule orbitals, 
    returned as: [val, grad, lap] 
@@ -63,6 +63,7 @@ class Average_ekt:public Average_generator {
   int deterministic_psp; //Whether to use deterministic evaluation of the pseudopotential
   doublevar gen_sample(int nstep, doublevar  tstep, int e, Array2 <dcomplex> & movals, Sample_point * sample) ;
   void calc_mos(Sample_point *, int e, Array2 <dcomplex> & movals);
+  void calc_mos_all(Sample_point *, Array1 <Array2 <dcomplex> > & movals);
   void calc_mosLap(Sample_point * sample, int e, Array2 <dcomplex> & molaps); 
 
   void evaluate_valence(Wavefunction_data * wfdata, Wavefunction * wf,
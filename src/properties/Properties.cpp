@@ -452,42 +452,48 @@ void Properties_manager::insertPoint(int step,
   assert(pt.nonlocal.GetDim(0)==nwf);
   assert(pt.weight.GetDim(0)==nwf);
 
-  if(npoints_this_block==0) { 
-    weighted_sum.setSize(nwf);
-    sample_avg.setSize(nwf);
-    sample_var.setSize(nwf);
-    sample_avg.weight=0;
-    sample_var.weight=0;
-    weighted_sum.avgrets=pt.avgrets;
-    weighted_sum.weight=0;
-    energy_avg.Resize(nwf);
-    energy_var.Resize(nwf);
-    energy_avg=0;
-    energy_var=0;
-    //sample_avg.avgrets=pt.avgrets;
-    //sample_var.avgrets=pt.avgrets;
-    for(int w=0; w < nwf; w++) { 
-      for(int a=0; a< navg; a++) { 
-        for(int j=0; j< pt.avgrets(w,a).vals.GetDim(0); j++) { 
-          weighted_sum.avgrets(w,a).vals(j)=0;
-          //sample_avg.avgrets(w,a).vals(j)=0;
-          //sample_var.avgrets(w,a).vals(j)=0;
+  //Threaded walker loops insert points concurrently.
+#ifdef _OPENMP
+#pragma omp critical(properties_insert)
+#endif
+  {
+    if(npoints_this_block==0) { 
+      weighted_sum.setSize(nwf);
+      sample_avg.setSize(nwf);
+      sample_var.setSize(nwf);
+      sample_avg.weight=0;
+      sample_var.weight=0;
+      weighted_sum.avgrets=pt.avgrets;
+      weighted_sum.weight=0;
+      energy_avg.Resize(nwf);
+      energy_var.Resize(nwf);
+      energy_avg=0;
+      energy_var=0;
+      //sample_avg.avgrets=pt.avgrets;
+      //sample_var.avgrets=pt.avgrets;
+      for(int w=0; w < nwf; w++) { 
+        for(int a=0; a< navg; a++) { 
+          for(int j=0; j< pt.avgrets(w,a).vals.GetDim(0); j++) { 
+            weighted_sum.avgrets(w,a).vals(j)=0;
+            //sample_avg.avgrets(w,a).vals(j)=0;
+            //sample_var.avgrets(w,a).vals(j)=0;
+          }
         }
       }
     }
-  }
 
 
-  weighted_sum.weighted_add(pt);
-  for(int w=0; w< nwf; w++) { 
-    update_avgvar(sample_avg.kinetic(w),sample_var.kinetic(w),npoints_this_block,pt.kinetic(w));
-    update_avgvar(sample_avg.potential(w),sample_var.potential(w),npoints_this_block,pt.potential(w));
-    update_avgvar(sample_avg.nonlocal(w),sample_var.nonlocal(w),npoints_this_block,pt.nonlocal(w));
-    update_avgvar(sample_avg.weight(w),sample_var.weight(w),npoints_this_block,pt.weight(w));
-    update_avgvar(energy_avg(w),energy_var(w),npoints_this_block,pt.energy(w));
-  }
+    weighted_sum.weighted_add(pt);
+    for(int w=0; w< nwf; w++) { 
+      update_avgvar(sample_avg.kinetic(w),sample_var.kinetic(w),npoints_this_block,pt.kinetic(w));
+      update_avgvar(sample_avg.potential(w),sample_var.potential(w),npoints_this_block,pt.potential(w));
+      update_avgvar(sample_avg.nonlocal(w),sample_var.nonlocal(w),npoints_this_block,pt.nonlocal(w));
+      update_avgvar(sample_avg.weight(w),sample_var.weight(w),npoints_this_block,pt.weight(w));
+      update_avgvar(energy_avg(w),energy_var(w),npoints_this_block,pt.energy(w));
+    }
   
-  npoints_this_block++;
+    npoints_this_block++;
+  }
   
 
 }
@@ -126,6 +126,59 @@ void Properties_point::mpiReceive(int node) {
 
 //----------------------------------------------------------------------
 
+void Properties_point::pack(Pack_buffer & buf) { 
+  int nwf=kinetic.GetDim(0);
+  buf.put(nwf);
+  buf.put(children);
+  buf.put(nchildren);
+  buf.put(parent);
+  buf.put(count);
+  buf.put(kinetic);
+  buf.put(potential);
+  buf.put(nonlocal);
+  buf.put(weight);
+  buf.put(wf_val.amp);
+  buf.put(wf_val.phase);
+  int ni=avgrets.GetDim(0);
+  int nj=avgrets.GetDim(1);
+  buf.put(ni);
+  buf.put(nj);
+  for(int i=0; i< ni; i++) { 
+    for(int j=0; j< nj; j++) { 
+      buf.put(avgrets(i,j).vals);
+      buf.put(avgrets(i,j).type);
+    }
+  }
+}
+
+//----------------------------------------------------------------------
+
+void Properties_point::unpack(Pack_buffer & buf) { 
+  int nwf=buf.getInt();
+  setSize(nwf);
+  buf.get(children);
+  buf.get(nchildren);
+  buf.get(parent);
+  buf.get(count);
+  buf.get(kinetic);
+  buf.get(potential);
+  buf.get(nonlocal);
+  buf.get(weight);
+  buf.get(wf_val.amp);
+  buf.get(wf_val.phase);
+  int ni=buf.getInt();
+  int nj=buf.getInt();
+  avgrets.Resize(ni,nj);
+  for(int i=0; i< ni; i++) { 
+    for(int j=0; j< nj; j++) { 
+      buf.get(avgrets(i,j).vals);
+      buf.get(avgrets(i,j).type);
+    }
+  }
+}
+
+//----------------------------------------------------------------------
+
 #include "qmc_io.h"
 
 void Properties_point::read(istream & is) { 
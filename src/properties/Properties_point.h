@@ -23,6 +23,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "Qmc_std.h"
 #include "Wavefunction.h"
 #include "Average_generator.h"
+#include "Pack_buffer.h"
 /*!
   Universal quantities at one point.  This includes the wave function value,
   any averaging variables, and the various energy components of the configuration.
@@ -49,6 +50,8 @@ struct Properties_point {
   }
   void mpiSend(int node);
   void mpiReceive(int node);
+  void pack(Pack_buffer & buf);
+  void unpack(Pack_buffer & buf);
   void write(string & indent, ostream & os);
   void read(istream & is);
 
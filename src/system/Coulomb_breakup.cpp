@@ -0,0 +1,253 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "Coulomb_breakup.h"
+#include "MatrixAlgebra.h"
+
+const int breakup_nint=12; //!< knot intervals on [0,rc]
+const int breakup_nquad=16; //!< Gauss-Legendre points per interval
+//The k integrals run over k*rc < breakup_kmax in steps of breakup_dk/rc
+const doublevar breakup_kmax=200.0;
+const doublevar breakup_dk=0.05;
+//Range of k_c*rc searched for the requested error
+const doublevar breakup_xmin=1.0, breakup_xmax=60.0;
+
+//----------------------------------------------------------------------
+
+/*!
+  The six quintic Hermite shape functions at u=(r-r_i)/h in interval
+  i: value, slope and curvature at the left knot, then at the right.
+ */
+static void hermite_shapes(doublevar u, doublevar h, doublevar * s) {
+  doublevar w=1-u;
+  doublevar u2=u*u, u3=u2*u;
+  doublevar w2=w*w, w3=w2*w;
+  s[0]=1-u3*(10-15*u+6*u2);
+  s[1]=h*u*(1-u2*(6-8*u+3*u2));
+  s[2]=.5*h*h*u2*(1-u*(3-3*u+u2));
+  s[3]=1-w3*(10-15*w+6*w2);
+  s[4]=-h*w*(1-w2*(6-8*w+3*w2));
+  s[5]=.5*h*h*w2*(1-w*(3-3*w+w2));
+}
+
+//----------------------------------------------------------------------
+
+void Coulomb_breakup::quadrature() {
+  //Gauss-Legendre nodes on [-1,1] by Newton's method
+  const int n=breakup_nquad;
+  Array1 <doublevar> x(n), w(n);
+  for(int i=0; i< (n+1)/2; i++) {
+    doublevar z=cos(pi*(i+.75)/(n+.5));
+    doublevar dp=0;
+    for(int it=0; it < 100; it++) {
+      doublevar p0=1, p1=0;
+      for(int j=1; j<= n; j++) {
+        doublevar p2=p1;
+        p1=p0;
+        p0=((2*j-1)*z*p1-(j-1)*p2)/j;
+      }
+      dp=n*(z*p0-p1)/(z*z-1);
+      doublevar dz=p0/dp;
+      z-=dz;
+      if(fabs(dz) < 1e-15) break;
+    }
+    x(i)=-z; x(n-1-i)=z;
+    w(i)=w(n-1-i)=2/((1-z*z)*dp*dp);
+  }
+
+  quad_r.Resize(nint*n);
+  quad_w.Resize(nint*n);
+  for(int i=0; i< nint; i++) {
+    for(int q=0; q< n; q++) {
+      quad_r(i*n+q)=spacing*(i+.5*(x(q)+1));
+      quad_w(i*n+q)=.5*spacing*w(q);
+    }
+  }
+}
+
+//----------------------------------------------------------------------
+
+doublevar Coulomb_breakup::longRangeReal(doublevar r) {
+  int i=min(int(r*invspacing),nint-1);
+  doublevar h=r-i*spacing;
+  const doublevar * c=poly.v+i*poly.step1;
+  return c[0]+h*(c[1]+h*(c[2]+h*(c[3]+h*(c[4]+h*c[5]))));
+}
+
+//----------------------------------------------------------------------
+
+doublevar Coulomb_breakup::longRange(doublevar k) {
+  assert(k > 0);
+  doublevar sum=cos(k*rc)/k;
+  int nq=quad_r.GetDim(0);
+  for(int q=0; q< nq; q++) {
+    doublevar r=quad_r(q);
+    sum+=quad_w(q)*r*sin(k*r)*longRangeReal(r);
+  }
+  return 4*pi*sum/(volume*k);
+}
+
+//----------------------------------------------------------------------
+
+doublevar Coulomb_breakup::fit(doublevar rcut, doublevar vol,
+                               doublevar tolerance) {
+  rc=rcut;
+  volume=vol;
+  nint=breakup_nint;
+  spacing=rc/nint;
+  invspacing=1.0/spacing;
+  quadrature();
+
+  //Coefficients t(3*knot+type) of the Hermite basis.  The ones at rc
+  //match 1/r and the slope at the origin is zero; the rest are fit.
+  int nbasis=3*(nint+1);
+  Array1 <doublevar> t(nbasis);
+  t=0.0;
+  t(3*nint)=1/rc;
+  t(3*nint+1)=-1/(rc*rc);
+  t(3*nint+2)=2/(rc*rc*rc);
+  Array1 <int> isfree(nbasis);
+  isfree=1;
+  isfree(1)=0;
+  for(int a=0; a< 3; a++) isfree(3*nint+a)=0;
+  Array1 <int> freelist(nbasis);
+  int nfree=0;
+  for(int n=0; n< nbasis; n++) if(isfree(n)) freelist(nfree++)=n;
+
+  //Fourier transforms of the basis functions on the k grid.  For each
+  //k, c(k,n) holds the free functions and target(k) minus the Fourier
+  //transform of everything that's fixed: 1/r beyond rc and the
+  //constrained functions.
+  int nq=quad_r.GetDim(0);
+  Array2 <doublevar> basis(nq,nbasis);
+  basis=0.0;
+  doublevar s[6];
+  for(int q=0; q< nq; q++) {
+    int i=q/breakup_nquad;
+    hermite_shapes(quad_r(q)*invspacing-i,spacing,s);
+    for(int a=0; a< 6; a++) basis(q,3*i+a)=s[a];
+  }
+
+  int nk=int((breakup_kmax-breakup_xmin)/breakup_dk);
+  doublevar dk=breakup_dk/rc;
+  Array1 <doublevar> kval(nk), weight(nk), target(nk);
+  Array2 <doublevar> c(nk,nfree);
+  Array1 <doublevar> cn(nbasis);
+  for(int ik=0; ik < nk; ik++) {
+    doublevar k=breakup_xmin/rc+(ik+.5)*dk;
+    kval(ik)=k;
+    //number of k-vectors per dk in the cell
+    weight(ik)=vol*k*k*dk/(2*pi*pi);
+    cn=0.0;
+    for(int q=0; q< nq; q++) {
+      doublevar f=quad_w(q)*quad_r(q)*sin(k*quad_r(q));
+      int i=q/breakup_nquad;
+      for(int n=3*i; n < 3*i+6; n++) cn(n)+=f*basis(q,n);
+    }
+    doublevar norm=4*pi/(vol*k);
+    doublevar fixed=norm*cos(k*rc)/k;
+    for(int n=0; n< nbasis; n++) {
+      if(!isfree(n)) fixed+=norm*cn(n)*t(n);
+    }
+    target(ik)=-fixed;
+    for(int f=0; f< nfree; f++) c(ik,f)=norm*cn(freelist(f));
+  }
+
+  //Smallest k_c that reaches the tolerance, by bisection on k_c*rc
+  Array2 <doublevar> A(nfree,nfree), evecs(nfree,nfree);
+  Array1 <doublevar> b(nfree), evals(nfree), scale(nfree), y(nfree);
+  Array1 <doublevar> tfree(nfree), tbest(nfree);
+  doublevar lo=breakup_xmin, hi=breakup_xmax;
+  doublevar besterr=-1;
+  for(int iter=0; iter < 30; iter++) {
+    doublevar x=(iter==0)?hi:.5*(lo+hi);
+    doublevar kcut=x/rc;
+    A=0.0;
+    b=0.0;
+    for(int ik=0; ik < nk; ik++) {
+      if(kval(ik) <= kcut) continue;
+      for(int f=0; f< nfree; f++) {
+        doublevar wc=weight(ik)*c(ik,f);
+        b(f)+=wc*target(ik);
+        for(int g=0; g<= f; g++) A(f,g)+=wc*c(ik,g);
+      }
+    }
+    for(int f=0; f< nfree; f++) {
+      for(int g=0; g< f; g++) A(g,f)=A(f,g);
+    }
+    //Solve with a pseudo-inverse; the basis is far from orthogonal
+    for(int f=0; f< nfree; f++) scale(f)=1.0/sqrt(A(f,f));
+    for(int f=0; f< nfree; f++) {
+      for(int g=0; g< nfree; g++) A(f,g)*=scale(f)*scale(g);
+    }
+    EigenSystemSolverRealSymmetricMatrix(A,evals,evecs);
+    y=0.0;
+    for(int e=0; e< nfree; e++) {
+      if(evals(e) < 1e-13*evals(0)) continue;
+      doublevar proj=0;
+      for(int f=0; f< nfree; f++) proj+=evecs(f,e)*scale(f)*b(f);
+      for(int f=0; f< nfree; f++) y(f)+=evecs(f,e)*proj/evals(e);
+    }
+    for(int f=0; f< nfree; f++) tfree(f)=scale(f)*y(f);
+
+    doublevar chi2=0;
+    for(int ik=0; ik < nk; ik++) {
+      if(kval(ik) <= kcut) continue;
+      doublevar resid=-target(ik);
+      for(int f=0; f< nfree; f++) resid+=c(ik,f)*tfree(f);
+      chi2+=weight(ik)*resid*resid;
+    }
+    doublevar err=sqrt(chi2);
+    if(err <= tolerance || iter==0) {
+      besterr=err;
+      kc=kcut;
+      tbest=tfree;
+      if(err > tolerance) break;
+      hi=x;
+    }
+    else lo=x;
+    if(hi-lo < 1e-3) break;
+  }
+  for(int f=0; f< nfree; f++) t(freelist(f))=tbest(f);
+
+  //Power series of V_l on each interval from the Hermite data
+  poly.Resize(nint,6);
+  for(int i=0; i< nint; i++) {
+    doublevar h=spacing;
+    doublevar f0=t(3*i), d0=t(3*i+1)*h, s0=t(3*i+2)*h*h;
+    doublevar f1=t(3*i+3), d1=t(3*i+4)*h, s1=t(3*i+5)*h*h;
+    poly(i,0)=f0;
+    poly(i,1)=d0/h;
+    poly(i,2)=.5*s0/(h*h);
+    poly(i,3)=(10*(f1-f0)-6*d0-4*d1-1.5*s0+.5*s1)/(h*h*h);
+    poly(i,4)=(-15*(f1-f0)+8*d0+7*d1+1.5*s0-s1)/(h*h*h*h);
+    poly(i,5)=(6*(f1-f0)-3*d0-3*d1-.5*s0+.5*s1)/(h*h*h*h*h);
+  }
+
+  doublevar vl_moment=0;
+  for(int q=0; q< nq; q++) {
+    doublevar r=quad_r(q);
+    vl_moment+=quad_w(q)*r*r*longRangeReal(r);
+  }
+  vs0=4*pi*(.5*rc*rc-vl_moment)/volume;
+  return besterr;
+}
+
+//----------------------------------------------------------------------
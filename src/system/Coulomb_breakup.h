@@ -0,0 +1,86 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef COULOMB_BREAKUP_H_INCLUDED
+#define COULOMB_BREAKUP_H_INCLUDED
+
+#include "Qmc_std.h"
+
+/*!
+\brief
+Optimized split of 1/r into short- and long-range parts, following
+Natoli and Ceperley, J. Comput. Phys. 117, 171 (1995).
+
+The long-range part \f$V_l(r)\f$ is 1/r beyond rcut and a piecewise
+quintic inside, with the value and first two derivatives matched at
+rcut and zero slope at the origin.  The quintic is chosen to minimize
+\f$\sum_{|k|>k_c} |V_l(k)|^2\f$, which by Parseval is the mean square
+error in the pair potential from dropping the k-vectors beyond
+\f$k_c\f$.  The short-range part \f$1/r-V_l(r)\f$ vanishes beyond
+rcut, so with rcut at most half the smallest height of the cell it
+needs only the minimum image, and \f$k_c\f$ is the smallest that gives
+the requested error.  Both parts are evaluated from the polynomial
+table, with no special functions.
+*/
+class Coulomb_breakup {
+public:
+  Coulomb_breakup() { nint=0; rc=0; kc=0; }
+
+  /*!
+    Fit the break-up for a cell of volume vol.  Returns the rms error
+    of the pair potential that was reached, which is no larger than
+    tolerance unless the k cutoff hit its upper limit.
+  */
+  doublevar fit(doublevar rcut, doublevar vol, doublevar tolerance);
+
+  doublevar rcut() { return rc; }
+  //! The long-range part is needed only for |k| below this
+  doublevar kcut() { return kc; }
+
+  //! \f$1/r-V_l(r)\f$, zero beyond rcut
+  doublevar shortRange(doublevar r) {
+    if(r >= rc) return 0.0;
+    int i=min(int(r*invspacing),nint-1);
+    doublevar h=r-i*spacing;
+    const doublevar * c=poly.v+i*poly.step1;
+    return 1.0/r-(c[0]+h*(c[1]+h*(c[2]+h*(c[3]+h*(c[4]+h*c[5])))));
+  }
+
+  //! \f$V_l(k)\f$, including the 1/V of the cell
+  doublevar longRange(doublevar k);
+  //! \f$V_l(r=0)\f$, for the self-interaction of each charge
+  doublevar longRangeZero() { return poly(0,0); }
+  //! The k=0 Fourier component of the short-range part
+  doublevar shortRangeZero() { return vs0; }
+
+private:
+  void quadrature();
+  doublevar longRangeReal(doublevar r);
+
+  int nint; //!< number of knot intervals
+  doublevar rc, kc, volume;
+  doublevar spacing, invspacing;
+  Array2 <doublevar> poly; //!< (interval, power) coefficients of V_l
+  doublevar vs0;
+  Array1 <doublevar> quad_r, quad_w; //!< quadrature on [0,rc]
+};
+
+#endif //COULOMB_BREAKUP_H_INCLUDED
+//----------------------------------------------------------------------
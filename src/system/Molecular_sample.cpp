@@ -42,15 +42,11 @@ void Molecular_sample::saveUpdate(int e, Sample_storage * store) {
   {
     for(int i=0; i< nions; i++)
     {
-      store->iondist_temp(d,i)=iondist(d,i,e);
+      store->iondist_temp(d,i)=iondist(e,d,i);
     }
-    for(int i=0; i<e; i++)
+    for(int j=0; j < nelectrons; j++)
     {
-      store->pointdist_temp(d,i)=pointdist(d,i,e);
-    }
-    for(int j=e; j < nelectrons; j++)
-    {
-      store->pointdist_temp(d,j)=pointdist(d,e,j);
+      store->pointdist_temp(d,j)=pointdist(e,d,j);
     }
   }
 }
@@ -67,108 +63,97 @@ void Molecular_sample::restoreUpdate(int e, Sample_storage * store)
   {
     for(int i=0; i< nions; i++)
     {
-      iondist(d,i,e)=store->iondist_temp(d,i);
-    }
-    for(int i=0; i<e; i++)
-    {
-      pointdist(d,i,e)=store->pointdist_temp(d,i);
+      iondist(e,d,i)=store->iondist_temp(d,i);
     }
-    for(int j=e; j < nelectrons; j++)
+    for(int j=0; j < nelectrons; j++)
     {
-      pointdist(d,e,j)=store->pointdist_temp(d,j);
+      pointdist(e,d,j)=store->pointdist_temp(d,j);
     }
   }
+  mirrorRow(e);
 }
 
-
-
+//----------------------------------------------------------------------
 
 void Molecular_sample::updateEIDist()
 {
   //cout << "updateEIDist" << endl;
+  int nions=parent->ions.size();
+  const doublevar * ix=parent->ions.r.v;
+  int istep=parent->ions.r.step1;
   for(int e=0; e< nelectrons; e++)
   {
     if(ionDistStale(e))
     {
       ionDistStale(e)=0;
-      int nions=parent->ions.size();
-      for(int j=0; j<nions; j++)
-      {
-        iondist(1,j,e)=0;
-      }
-
-      for(int i=0; i<3; i++)
-      {
-        for(int j=0; j<nions; j++)
-        {
-          iondist(i+2,j,e)=elecpos(e,i)-parent->ions.r(i,j);
-          iondist(1,j,e)+=iondist(i+2, j, e) * iondist(i+2, j, e);
-        }
-      }
-
+      doublevar * row=iondist.v+e*iondist.step1;
+      int s=iondist.step2;
+      doublevar x=elecpos(e,0), y=elecpos(e,1), z=elecpos(e,2);
       for(int j=0; j<nions; j++)
       {
-        iondist(0,j, e)=sqrt(iondist(1,j, e));
+        doublevar dx=x-ix[j], dy=y-ix[istep+j], dz=z-ix[2*istep+j];
+        doublevar r2=dx*dx+dy*dy+dz*dz;
+        row[j]=sqrt(r2);
+        row[s+j]=r2;
+        row[2*s+j]=dx;
+        row[3*s+j]=dy;
+        row[4*s+j]=dz;
       }
     }
   }
   //cout << "done" << endl;
 }
 
+//----------------------------------------------------------------------
 
 /*!
-
+Each stale electron gets a whole new row, which is then copied into 
+its column so that every row stays complete.
  */
 void Molecular_sample::updateEEDist()
 {
   //cout << "elecelecDistupdate" << endl;
+  const doublevar * px=elecpos.v;
   for(int e=0; e< nelectrons; e++)
   {
     if(elecDistStale(e)==1)
     {
       elecDistStale(e)=0;
-
-      for(int j=0; j<e; j++)
-      {
-        pointdist(1,j, e)=0;
-      }
-      for(int k=e+1; k<nelectrons; k++)
+      doublevar * row=pointdist.v+e*pointdist.step1;
+      int s=pointdist.step2;
+      doublevar x=elecpos(e,0), y=elecpos(e,1), z=elecpos(e,2);
+      for(int j=0; j< nelectrons; j++)
       {
-        pointdist(1,e,k)=0;
+        doublevar dx=x-px[3*j], dy=y-px[3*j+1], dz=z-px[3*j+2];
+        doublevar r2=dx*dx+dy*dy+dz*dz;
+        row[j]=sqrt(r2);
+        row[s+j]=r2;
+        row[2*s+j]=dx;
+        row[3*s+j]=dy;
+        row[4*s+j]=dz;
       }
+      mirrorRow(e);
+    }
+  }
+}
 
-      for(int i=0; i<3; i++)
-      {
-        for(int j=0; j<e; j++)
-        {
-          pointdist(i+2,j, e)=elecpos(j,i)-elecpos(e,i);
-          //cout << "elecpos  " << j << "  " << i << "  "
-          //     << elecpos(j,i) << endl;
-          pointdist(1,j, e)+=pointdist(i+2, j, e) * pointdist(i+2, j, e);
-        }
-        for(int k=e+1; k<nelectrons; k++)
-        {
-          pointdist(i+2,e, k)=elecpos(e,i)-elecpos(k,i);
-          //cout << "elecpos " << k << " " << i << "  "
-          //     << elecpos(k,i) << "   " << pointdist(i+2,e,k) << endl;
-          pointdist(1,e, k)+=pointdist(i+2, e, k) * pointdist(i+2, e, k);
-        }
-      }
+//----------------------------------------------------------------------
 
-      for(int j=0; j<e; j++)
-      {
-        pointdist(0,j, e)=sqrt(pointdist(1,j, e));
-        //cout << j << "   " << e << "   " <<  pointdist(0,j,e) << endl;
-      }
-      for(int k=e+1; k<nelectrons; k++)
-      {
-        pointdist(0,e, k)=sqrt(pointdist(1,e, k));
-        //cout << e << "   " << k << "   " <<  pointdist(0,e,k) << endl;
-      }
-    }
+void Molecular_sample::mirrorRow(int e) {
+  const doublevar * row=pointdist.v+e*pointdist.step1;
+  int s=pointdist.step2;
+  for(int j=0; j< nelectrons; j++)
+  {
+    doublevar * col=pointdist.v+j*pointdist.step1+e;
+    col[0]=row[j];
+    col[s]=row[s+j];
+    col[2*s]=-row[2*s+j];
+    col[3*s]=-row[3*s+j];
+    col[4*s]=-row[4*s+j];
   }
 }
 
+//----------------------------------------------------------------------
 
 void Molecular_sample::init(System * sys) {
   assert(sys != NULL);
@@ -179,9 +164,9 @@ void Molecular_sample::init(System * sys) {
 
   elecpos.Resize(nelectrons, 3);
   elecpos=0.0;
-  iondist.Resize(5,nions,nelectrons);
+  iondist.Resize(nelectrons,5,nions);
   iondist=0.0;
-  pointdist.Resize(5, nelectrons, nelectrons);
+  pointdist.Resize(nelectrons,5,nelectrons);
   pointdist=0.0;
   elecDistStale.Resize(nelectrons);
   ionDistStale.Resize(nelectrons);
@@ -342,7 +327,7 @@ void Molecular_sample::moveIon(const int ion, const Array1 <doublevar> & r)
 void Molecular_sample::rawOutput(ostream & os)
 {
   os << "Molecular_sample\n";
-  os << "numIons  " << iondist.GetDim(1) << endl;
+  os << "numIons  " << iondist.GetDim(2) << endl;
   for(int i=0; i< parent->ions.size(); i++)
   {
     for(int d=0; d< 3; d++)
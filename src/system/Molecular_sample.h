@@ -106,7 +106,7 @@ public:
     assert( ! ionDistStale(e));
     for(int i=0; i<5; i++)
     {
-      distance(i)=iondist(i,ion,e);
+      distance(i)=iondist(e,i,ion);
     }
   }
 
@@ -130,10 +130,24 @@ public:
     assert( e1 < e2 );
     for(int i=0; i< 5; i++)
     {
-      distance(i)=pointdist(i,e1,e2);
+      distance(i)=pointdist(e1,i,e2);
     }
   }
 
+  const doublevar * getEERow(const int e, int & stride) {
+    assert(!elecDistStale(e));
+    stride=pointdist.step2;
+    return pointdist.v+e*pointdist.step1;
+  }
+  const doublevar * getEIRow(const int e, int & stride) {
+    assert(!ionDistStale(e));
+    stride=iondist.step2;
+    return iondist.v+e*iondist.step1;
+  }
+  const doublevar * getECRow(const int e, int & stride) {
+    return getEIRow(e,stride);
+  }
+
   void rawOutput(ostream &);
   void rawInput(istream &);
 
@@ -142,16 +156,18 @@ public:
   void restoreUpdate(int, Sample_storage *);
 
 private:
+  void mirrorRow(int e);
 
   int nelectrons;
 
   Array2 <doublevar> elecpos; //electron positions
 
+  //The distance tables are (e, component, other particle), so that 
+  //each electron's distances are a contiguous row for each component.
   Array3 <doublevar> iondist;
   Array1 <int> elecDistStale;
   Array1 <int> ionDistStale;
-  Array3 <doublevar> pointdist;  //this is an upper triangular matrix;
-                                 //the lower is currently wasted
+  Array3 <doublevar> pointdist;  //!< r_e-r_j, kept for all e and j
 
   Molecular_system * parent;
 
@@ -219,13 +219,15 @@ doublevar Molecular_system::calcLoc(Sample_point * sample) {
   sample->updateEIDist();
   sample->updateEEDist();
 
+  Array1 <doublevar> charge(nions);
+  for(int i=0; i < nions; i++) charge(i)=sample->getIonCharge(i);
+  int stride;
   for(int e=0; e< nelectrons; e++)
   {
+    const doublevar * row=sample->getEIRow(e,stride);
     for(int i=0; i < nions; i++)
     {
-
-      sample->getEIDist(e,i, R);
-      elecIon+=sample->getIonCharge(i)/R(0);
+      elecIon+=charge(i)/row[i];
     }
   }
   elecIon*=-1;
@@ -252,13 +254,12 @@ doublevar Molecular_system::calcLoc(Sample_point * sample) {
   //cout << "Ion-ion: " << IonIon << endl;
 
   doublevar elecElec=0;
-  Array1 <doublevar> R2(5);
   for(int i=0; i< nelectrons; i++)
   {
+    const doublevar * row=sample->getEERow(i,stride);
     for(int j=0; j<i; j++)
     {
-      sample->getEEDist(j,i,R2);
-      elecElec+= 1/R2(0);
+      elecElec+= 1/row[j];
     }
   }
   pot+=elecElec;
@@ -44,6 +44,8 @@ public:
     atomLabels=sys.atomLabels;
     bounding_box=sys.bounding_box;
     use_bounding_box=sys.use_bounding_box;
+    electric_field=sys.electric_field;
+    inirange=sys.inirange;
   }
 
   void notify(change_type, int);
@@ -68,6 +70,13 @@ public:
     labels=atomLabels;
   }
   virtual int nIons() { return atomLabels.size(); }
+  virtual int getCenterPos(Array2 <doublevar> & pos) { 
+    int nions=ions.size();
+    pos.Resize(nions,3);
+    for(int i=0; i< nions; i++) 
+      for(int d=0; d< 3; d++) pos(i,d)=ions.r(d,i);
+    return 1;
+  }
   virtual void getIonPos(int i, Array1 <doublevar> & pos) {
     assert(pos.GetDim(0)==3);
     for(int d=0; d< 3; d++) {
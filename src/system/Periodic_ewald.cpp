@@ -0,0 +1,162 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "Periodic_ewald.h"
+#include "Periodic_system.h"
+#include "Sample_point.h"
+
+//Number of energy evaluations between rebuilds of the running sums
+const int rebuild_interval=500;
+
+//----------------------------------------------------------------------
+
+void Periodic_ewald::init(Periodic_system * sys, int nelectrons_) {
+  parent=sys;
+  nelectrons=nelectrons_;
+  ngpoints=parent->ngpoints;
+  phases.setup(parent->gpoint);
+  phase_r.Resize(5);
+  phase_r=0.0;
+  phase_re.Resize(ngpoints);
+  phase_im.Resize(ngpoints);
+  termpos.Resize(nelectrons,3);
+  rho_re.Resize(ngpoints);
+  rho_im.Resize(ngpoints);
+  ee_real.Resize(nelectrons,nelectrons);
+  ei_real.Resize(nelectrons);
+  moved.Resize(nelectrons);
+  //Force a rebuild on the first evaluation
+  ion_version=parent->ion_version-1;
+}
+
+//----------------------------------------------------------------------
+
+doublevar Periodic_ewald::electronIon(int e, Sample_point * sample) {
+  int nions=parent->ions.size();
+  Array1 <doublevar> r1(3);
+  int stride;
+  const doublevar * row=sample->getEIRow(e,stride);
+  doublevar sum=0;
+  for(int ion=0; ion < nions; ion++) {
+    for(int d=0; d< 3; d++) r1(d)=row[(d+2)*stride+ion];
+    sum-=parent->ions.charge(ion)*parent->shortRangeSum(r1);
+  }
+  return sum;
+}
+
+//----------------------------------------------------------------------
+
+void Periodic_ewald::addPhases(Array2 <doublevar> & pos, int e,
+                               doublevar sign) {
+  for(int d=0; d< 3; d++) phase_r(d+2)=pos(e,d);
+  phases.calc(phase_r, phase_re.v, phase_im.v);
+  for(int g=0; g< ngpoints; g++) {
+    rho_re(g)+=sign*phase_re(g);
+    rho_im(g)+=sign*phase_im(g);
+  }
+}
+
+//----------------------------------------------------------------------
+
+void Periodic_ewald::rebuild(Sample_point * sample,
+                             Array2 <doublevar> & elecpos) {
+  rho_re=0.0;
+  rho_im=0.0;
+  for(int e=0; e< nelectrons; e++) {
+    addPhases(elecpos,e,1.0);
+    ei_real(e)=electronIon(e,sample);
+    for(int d=0; d< 3; d++) termpos(e,d)=elecpos(e,d);
+  }
+
+  Array1 <doublevar> r1(3);
+  int stride;
+  ee_real_total=0;
+  for(int e1=0; e1< nelectrons; e1++) {
+    ee_real(e1,e1)=0;
+    const doublevar * row=sample->getEERow(e1,stride);
+    for(int e2=e1+1; e2 < nelectrons; e2++) {
+      for(int d=0; d< 3; d++) r1(d)=row[(d+2)*stride+e2];
+      doublevar v=parent->shortRangeSum(r1);
+      ee_real(e1,e2)=ee_real(e2,e1)=v;
+      ee_real_total+=v;
+    }
+  }
+  ion_version=parent->ion_version;
+  nsince_rebuild=0;
+}
+
+//----------------------------------------------------------------------
+
+void Periodic_ewald::moveElectron(int e, Sample_point * sample,
+                                  Array2 <doublevar> & elecpos) {
+  addPhases(termpos,e,-1.0);
+  addPhases(elecpos,e,1.0);
+  ei_real(e)=electronIon(e,sample);
+
+  Array1 <doublevar> r1(3);
+  int stride;
+  const doublevar * row=sample->getEERow(e,stride);
+  for(int j=0; j< nelectrons; j++) {
+    if(j==e) continue;
+    for(int d=0; d< 3; d++) r1(d)=row[(d+2)*stride+j];
+    doublevar v=parent->shortRangeSum(r1);
+    ee_real_total+=v-ee_real(e,j);
+    ee_real(e,j)=ee_real(j,e)=v;
+  }
+  for(int d=0; d< 3; d++) termpos(e,d)=elecpos(e,d);
+}
+
+//----------------------------------------------------------------------
+
+doublevar Periodic_ewald::energy(Sample_point * sample,
+                                 Array2 <doublevar> & elecpos) {
+  assert(parent!=NULL);
+  int nmoved=0;
+  for(int e=0; e< nelectrons; e++) {
+    if(termpos(e,0)!=elecpos(e,0) || termpos(e,1)!=elecpos(e,1)
+       || termpos(e,2)!=elecpos(e,2))
+      moved(nmoved++)=e;
+  }
+
+  //Moving an electron computes its phases twice and one row of pairs,
+  //so past half the electrons it's cheaper to start over.
+  if(ion_version!=parent->ion_version || nsince_rebuild >= rebuild_interval
+     || 2*nmoved > nelectrons)
+    rebuild(sample,elecpos);
+  else {
+    for(int i=0; i< nmoved; i++) moveElectron(moved(i),sample,elecpos);
+  }
+  nsince_rebuild++;
+
+  doublevar real=ee_real_total;
+  for(int e=0; e< nelectrons; e++) real+=ei_real(e);
+
+  //Both reciprocal terms come from rho: the electron-electron term
+  //is w|rho|^2 and the electron-ion term -2w Re(rho_ion^* rho)
+  doublevar recip=0;
+  for(int g=0; g< ngpoints; g++) {
+    recip+=parent->gweight(g)*(rho_re(g)*rho_re(g)+rho_im(g)*rho_im(g)
+                               -2*(parent->ion_cos(g)*rho_re(g)
+                                   +parent->ion_sin(g)*rho_im(g)));
+  }
+  return real+recip;
+}
+
+//----------------------------------------------------------------------
@@ -0,0 +1,85 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef PERIODIC_EWALD_H_INCLUDED
+#define PERIODIC_EWALD_H_INCLUDED
+
+#include "Qmc_std.h"
+#include "Planewave_phases.h"
+class Periodic_system;
+class Sample_point;
+
+/*!
+\brief
+The electron-electron and electron-ion Ewald energy of one sample,
+kept up to date one electron at a time.
+
+Each electron's terms are remembered along with the position they were
+computed at.  When the energy is requested, only the electrons that
+have moved since are redone: the electron structure factor
+\f$\rho(g)=\sum_e e^{i g \cdot r_e}\f$ is corrected by the difference
+of the old and new phases, and the real-space pair and electron-ion
+terms of that electron are recomputed.  That is O(N_g+N) work per
+moved electron, against O(N N_g+N^2) for the whole sum.  A rejected
+move puts the electron back where it was, so it costs nothing.
+
+The running sums are rebuilt from scratch every rebuild_interval
+evaluations, so that round-off does not accumulate, and whenever the
+ions have moved.
+*/
+class Periodic_ewald {
+public:
+  Periodic_ewald() { parent=NULL; nelectrons=0; }
+
+  void init(Periodic_system * sys, int nelectrons_);
+
+  /*!
+    The electron part of the Ewald energy (what
+    Periodic_system::ewaldElectron() returns) for the electrons at
+    elecpos.  The sample's distances must be up to date.
+  */
+  doublevar energy(Sample_point * sample, Array2 <doublevar> & elecpos);
+
+private:
+  void rebuild(Sample_point * sample, Array2 <doublevar> & elecpos);
+  void moveElectron(int e, Sample_point * sample,
+                    Array2 <doublevar> & elecpos);
+  void addPhases(Array2 <doublevar> & pos, int e, doublevar sign);
+  doublevar electronIon(int e, Sample_point * sample);
+
+  Periodic_system * parent;
+  int nelectrons;
+  int ngpoints;
+  Planewave_phases phases;
+  Array1 <doublevar> phase_r; //!< scratch position in basis function layout
+  Array1 <doublevar> phase_re, phase_im; //!< scratch phases
+
+  Array2 <doublevar> termpos; //!< (e,d) where the terms of e were computed
+  Array1 <doublevar> rho_re, rho_im; //!< electron structure factor
+  Array2 <doublevar> ee_real; //!< (e1,e2) real-space pair terms
+  doublevar ee_real_total; //!< sum of ee_real over pairs
+  Array1 <doublevar> ei_real; //!< real-space electron-ion term of each electron
+  int ion_version; //!< parent's ion_version when the terms were built
+  int nsince_rebuild;
+  Array1 <int> moved; //!< scratch list of electrons that moved
+};
+
+#endif //PERIODIC_EWALD_H_INCLUDED
+//----------------------------------------------------------------------
@@ -29,8 +29,8 @@ void Periodic_sample::generateStorage(Sample_storage * & store)
 {
   int nions=parent->ions.size();
   store=new Sample_storage;
-  store->iondist_temp.Resize(nions,5);
-  store->pointdist_temp.Resize(nelectrons,5);
+  store->iondist_temp.Resize(5,nions);
+  store->pointdist_temp.Resize(5,nelectrons);
   store->pos_temp.Resize(3);
 }
 
@@ -41,15 +41,11 @@ void Periodic_sample::saveUpdate(int e, Sample_storage * store)
   for(int d=0; d< 5; d++) {
     for(int i=0; i< nions; i++)
     {
-      store->iondist_temp(i,d)=iondist(i,e,d);
+      store->iondist_temp(d,i)=iondist(e,d,i);
     }
-    for(int i=0; i<e; i++)
+    for(int j=0; j < nelectrons; j++)
     {
-      store->pointdist_temp(i,d)=pointdist(i,e,d);
-    }
-    for(int j=e; j < nelectrons; j++)
-    {
-      store->pointdist_temp(j,d)=pointdist(e,j,d);
+      store->pointdist_temp(d,j)=pointdist(e,d,j);
     }
   }
 }
@@ -61,14 +57,12 @@ void Periodic_sample::restoreUpdate(int e, Sample_storage * store){
   int nions=parent->ions.size();
   for(int d=0; d< 5; d++)  {
     for(int i=0; i< nions; i++)
-      iondist(i,e,d)=store->iondist_temp(i,d);
-
-    for(int i=0; i<e; i++)
-      pointdist(i,e,d)=store->pointdist_temp(i,d);
+      iondist(e,d,i)=store->iondist_temp(d,i);
 
-    for(int j=e; j < nelectrons; j++)
-      pointdist(e,j,d)=store->pointdist_temp(j,d);
+    for(int j=0; j < nelectrons; j++)
+      pointdist(e,d,j)=store->pointdist_temp(d,j);
   }
+  mirrorRow(e);
   cenDistStale(e)=1; //Let's not save the center distances, but that means
                      //we have to recalculate when we reject.
 }
@@ -79,23 +73,25 @@ void Periodic_sample::restoreUpdate(int e, Sample_storage * store){
 
 void Periodic_sample::updateEIDist() {
   //cout << "Periodic::updateEIDist" << endl;
-  //Array1 <doublevar> eivec(3);
+  int nions=parent->ions.size();
+  Array1 <doublevar> dr(3);
   for(int e=0; e< nelectrons; e++) {
     if(ionDistStale(e)) {
       ionDistStale(e)=0;
-      int nions=parent->ions.size();
-
+      doublevar * row=iondist.v+e*iondist.step1;
+      int s=iondist.step2;
+      if(orthorhombic) { 
+        orthorhombicRow(e,parent->ions.r.v,1,parent->ions.r.step1,
+                        nions,row,s);
+        continue;
+      }
       for(int ion=0; ion< nions; ion++) {
-        Array1 <doublevar> dr(3);
         for(int d=0; d< 3; d++) dr(d)=elecpos(e,d)-parent->ions.r(d,ion);
         doublevar dis=minimum_image(dr);
-        
-        for(int d=0; d< 3; d++) iondist(ion,e,d+2)=dr(d);
-        iondist(ion,e,1)=dis;
-        
+        row[ion]=sqrt(dis);
+        row[s+ion]=dis;
+        for(int d=0; d< 3; d++) row[(d+2)*s+ion]=dr(d);
       }
-      for(int j=0; j<nions; j++)
-        iondist(j, e,0)=sqrt(iondist(j, e,1));
     }
   }
 
@@ -107,36 +103,79 @@ void Periodic_sample::updateEIDist() {
 //----------------------------------------------------------------------
 
 /*!
-
+Each stale electron gets a whole new row, which is then copied into 
+its column so that every row stays complete.
  */
 void Periodic_sample::updateEEDist() {
-  const int ndim=3;
+  Array1 <doublevar> dr(3);
   for(int e=0; e< nelectrons; e++) {
     if(elecDistStale(e)==1) {
-
       elecDistStale(e)=0;
-      Array1 <doublevar> dr(3);
-      for(int j=0; j< e; j++) { 
-        for(int d=0; d< 3; d++) dr(d)=elecpos(j,d)-elecpos(e,d);
-        doublevar dist=minimum_image(dr);
-        for(int d=0; d< 3; d++) pointdist(j,e,d+2)=dr(d);
-        pointdist(j,e,1)=dist;
-        pointdist(j,e,0)=sqrt(dist);
+      doublevar * row=pointdist.v+e*pointdist.step1;
+      int s=pointdist.step2;
+      if(orthorhombic) { 
+        orthorhombicRow(e,elecpos.v,elecpos.step1,1,nelectrons,row,s);
+        mirrorRow(e);
+        continue;
       }
-      for(int k=e+1; k < nelectrons; k++) { 
-        for(int d=0; d< 3; d++) dr(d)=elecpos(e,d)-elecpos(k,d);
+      for(int j=0; j< nelectrons; j++) { 
+        for(int d=0; d< 3; d++) dr(d)=elecpos(e,d)-elecpos(j,d);
         doublevar dist=minimum_image(dr);
-        for(int d=0; d< 3; d++) pointdist(e,k,d+2)=dr(d);
-        pointdist(e,k,1)=dist;
-        pointdist(e,k,0)=sqrt(dist);
+        row[j]=sqrt(dist);
+        row[s+j]=dist;
+        for(int d=0; d< 3; d++) row[(d+2)*s+j]=dr(d);
       }
-      
+      mirrorRow(e);
     }
   }
   //cout << "done" << endl;
 }
 
+//----------------------------------------------------------------------
 
+/*!
+Distances from electron e to the n particles at pos, component d of
+particle j being pos[j*pstep+d*dstep], for an orthorhombic cell.  Each
+component is wrapped independently by rounding, so there are no
+branches and the loop vectorizes.
+ */
+void Periodic_sample::orthorhombicRow(int e, const doublevar * pos, 
+                                      int pstep, int dstep, int n,
+                                      doublevar * row, int s) {
+  doublevar x=elecpos(e,0), y=elecpos(e,1), z=elecpos(e,2);
+  doublevar bx=box[0], by=box[1], bz=box[2];
+  doublevar ix=inv_box[0], iy=inv_box[1], iz=inv_box[2];
+  for(int j=0; j< n; j++) {
+    const doublevar * p=pos+j*pstep;
+    doublevar dx=x-p[0], dy=y-p[dstep], dz=z-p[2*dstep];
+    dx-=bx*rint(dx*ix);
+    dy-=by*rint(dy*iy);
+    dz-=bz*rint(dz*iz);
+    doublevar r2=dx*dx+dy*dy+dz*dz;
+    row[j]=sqrt(r2);
+    row[s+j]=r2;
+    row[2*s+j]=dx;
+    row[3*s+j]=dy;
+    row[4*s+j]=dz;
+  }
+}
+
+//----------------------------------------------------------------------
+
+void Periodic_sample::mirrorRow(int e) {
+  const doublevar * row=pointdist.v+e*pointdist.step1;
+  int s=pointdist.step2;
+  for(int j=0; j< nelectrons; j++) {
+    doublevar * col=pointdist.v+j*pointdist.step1+e;
+    col[0]=row[j];
+    col[s]=row[s+j];
+    col[2*s]=-row[2*s+j];
+    col[3*s]=-row[3*s+j];
+    col[4*s]=-row[4*s+j];
+  }
+}
+
+//----------------------------------------------------------------------
 
 void Periodic_sample::minDist(Array1 <doublevar> pos1 , Array1 <doublevar> pos2, Array1<doublevar> &rmin) {
   Array1 <doublevar> rminc(3); 
@@ -149,26 +188,23 @@ void Periodic_sample::minDist(Array1 <doublevar> pos1 , Array1 <doublevar> pos2,
 //----------------------------------------------------------------------
 void Periodic_sample::updateECDist() {
   //cout << "periodic_sample::updateECDist() " << endl;
+  int ncenters=parent->centerpos.GetDim(0);
+  const doublevar * cpos=parent->centerpos.v;
   for(int e=0; e< nelectrons; e++)  {
     if(cenDistStale(e)) {
       cenDistStale(e)=0;
-      int ncenters=parent->centerpos.GetDim(0);
-      for(int j=0; j<ncenters; j++)
-      {
-        cendist(e,j,1)=0;
+      doublevar * row=cendist.v+e*cendist.step1;
+      int s=cendist.step2;
+      doublevar x=elecpos(e,0), y=elecpos(e,1), z=elecpos(e,2);
+      for(int j=0; j<ncenters; j++) {
+        doublevar dx=x-cpos[3*j], dy=y-cpos[3*j+1], dz=z-cpos[3*j+2];
+        doublevar r2=dx*dx+dy*dy+dz*dz;
+        row[j]=sqrt(r2);
+        row[s+j]=r2;
+        row[2*s+j]=dx;
+        row[3*s+j]=dy;
+        row[4*s+j]=dz;
       }
-
-      for(int i=0; i<3; i++)
-      {
-        for(int j=0; j<ncenters; j++)
-        {
-          cendist(e,j, i+2)=elecpos(e,i)-parent->centerpos(j,i);
-          cendist(e,j,1)+=cendist(e,j, i+2) * cendist(e,j, i+2);
-        }
-      }
-
-      for(int j=0; j<ncenters; j++)
-        cendist(e,j,0)=sqrt(cendist(e,j,1));
     }
   }
   //cout << "done" << endl;
@@ -184,11 +220,11 @@ void Periodic_sample::init(System * sys) {
   nelectrons=parent->nelectrons(0)+parent->nelectrons(1);
 
   elecpos.Resize(nelectrons, 3);
-  iondist.Resize(nions,nelectrons,5);
-  pointdist.Resize(nelectrons, nelectrons,5);
+  iondist.Resize(nelectrons,5,nions);
+  pointdist.Resize(nelectrons,5,nelectrons);
 
   int ncenters=parent->centerpos.GetDim(0);
-  cendist.Resize(nelectrons,ncenters, 5);
+  cendist.Resize(nelectrons,5,ncenters);
 
 
   elecDistStale.Resize(nelectrons);
@@ -197,6 +233,7 @@ void Periodic_sample::init(System * sys) {
   cenDistStale=1;
   elecDistStale=1;
   ionDistStale=1;
+  ewald.init(parent, nelectrons);
 
   // update_overall_sign is false for complex-valued wavefunctions,
   // i.e., for non-integer k-points
@@ -215,20 +252,13 @@ void Periodic_sample::init(System * sys) {
   }
   */
 
-  //bool orthorhombic=true;
-  //for(int i=0; i< 3; i++) { 
-  //  for(int j=i+1; j < 3; j++) { 
-  //    doublevar dot=0.0;
-  //    for(int d=0; d< 3; d++) {
-  //      dot+=parent->latVec(i,d)*parent->latVec(j,d);
-  //    }
-  //    if(dot > 1e-10) orthorhombic=false;
-  //  }
-  //}
-  //if(orthorhombic) { 
-  //  single_write(cout,"Detected orthorhombic cell");
-  //}
-  //else { 
+  orthorhombic=parent->orthorhombic;
+  for(int d=0; d< 3; d++) {
+    box[d]=parent->box_length(d);
+    inv_box[d]=1.0/box[d];
+  }
+
+  //Skewed cells search over the neighboring images
     int counter=0;
     int nsearch=1;
     int nl=2*nsearch+1;
@@ -257,6 +287,14 @@ void Periodic_sample::init(System * sys) {
 //----------------------------------------------------------------------
 
 doublevar Periodic_sample::minimum_image(Array1 <doublevar> & r) { 
+  if(orthorhombic) { 
+    doublevar dis=0;
+    for(int d=0; d< 3; d++) { 
+      r[d]-=box[d]*rint(r[d]*inv_box[d]);
+      dis+=r[d]*r[d];
+    }
+    return dis;
+  }
 
   doublevar height2=parent->smallestheight*parent->smallestheight*.25;
   int nlat=lattice_basis.GetDim(0);
@@ -385,6 +423,23 @@ void Periodic_sample::setElectronPos(const int e,
 }
 
 
+void Periodic_sample::translationPhase(const int e, 
+                                       const Array1 <doublevar> & trans,
+                                       doublevar & sign, doublevar & phase) {
+  Array1 <doublevar> temp(3);
+  for(int d=0; d< 3; d++) 
+    temp(d)=elecpos(e,d)+trans(d);
+  Array1<int> nshift;
+  parent->enforcePbc(temp, nshift);
+  doublevar kdotr=0;
+  for(int d=0; d< 3; d++) 
+    kdotr+=parent->kpt(d)*nshift(d);
+  sign=update_overall_sign?cos(pi*kdotr):1.0;
+  phase=-pi*kdotr;
+}
+
+//----------------------------------------------------------------------
+
 void Periodic_sample::translateElectron(const int e, const Array1 <doublevar> & trans) {
   Array1 <doublevar> temp(trans.GetDim(0));
   
@@ -25,6 +25,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "Sample_point.h"
 #include "Periodic_system.h"
+#include "Periodic_ewald.h"
 class Wavefunction;
 
 class Sample_storage;
@@ -76,6 +77,8 @@ public:
   void setElectronPosNoNotify(const int e, const Array1 <doublevar> & position);
 
   void translateElectron(const int e, const Array1 <doublevar> & trans);
+  void translationPhase(const int e, const Array1 <doublevar> & trans,
+                        doublevar & sign, doublevar & phase);
   
   void getElectronPos(const int e, Array1 <doublevar> & R)
   {
@@ -122,7 +125,7 @@ public:
     assert(!cenDistStale(e));
     assert(distance.GetDim(0) >=5);
     for(int i=0; i< 5; i++)
-      distance(i)=cendist(e, cent, i);
+      distance(i)=cendist(e, i, cent);
   }
 
   void getEIDist(const int e,const int ion, Array1 <doublevar> & distance)
@@ -131,7 +134,7 @@ public:
     assert( ! ionDistStale(e));
     for(int i=0; i<5; i++)
     {
-      distance(i)=iondist(ion,e,i);
+      distance(i)=iondist(e,i,ion);
     }
   }
   /*!
@@ -144,9 +147,24 @@ public:
     assert( e1 < e2 );
     for(int i=0; i< 5; i++)
     {
-      distance(i)=pointdist(e1,e2,i);
+      distance(i)=pointdist(e1,i,e2);
     }
   }
+  const doublevar * getEERow(const int e, int & stride) {
+    assert(!elecDistStale(e));
+    stride=pointdist.step2;
+    return pointdist.v+e*pointdist.step1;
+  }
+  const doublevar * getEIRow(const int e, int & stride) {
+    assert(!ionDistStale(e));
+    stride=iondist.step2;
+    return iondist.v+e*iondist.step1;
+  }
+  const doublevar * getECRow(const int e, int & stride) {
+    assert(!cenDistStale(e));
+    stride=cendist.step2;
+    return cendist.v+e*cendist.step1;
+  }
   void minDist(Array1 <doublevar> pos1, Array1 <doublevar> pos2, Array1 <doublevar> &rmin); 
   void rawOutput(ostream &);
   void rawInput(istream &);
@@ -160,26 +178,43 @@ public:
   so it doesn't work when you start doing complicated things with setElectronPos(),
   etc.  It's enough for the sampling method, and that's about it.
    */
+  /*!
+    The electron part of the Ewald energy, updated from the last call
+    for the electrons that have moved since.
+   */
+  doublevar ewaldElectron() {
+    updateEEDist();
+    updateEIDist();
+    return ewald.energy(this, elecpos);
+  }
+
   doublevar overallSign() { return overall_sign; }
   doublevar overallPhase() { return overall_phase; }
 private:
+  //! Copy row e of pointdist into column e
+  void mirrorRow(int e);
 
 
   doublevar minimum_image(Array1 <doublevar> & r) ;
+  void orthorhombicRow(int e, const doublevar * pos, int pstep, int dstep,
+                       int n, doublevar * row, int s);
   
   int nelectrons;
 
   Array2 <doublevar> elecpos; //electron positions
 
+  //The distance tables are (e, component, other particle), so that 
+  //each electron's distances are a contiguous row for each component.
   Array3 <doublevar> cendist; //!< center distances
   Array1 <int> cenDistStale;
 
   Array3 <doublevar> iondist;
   Array1 <int> elecDistStale;
   Array1 <int> ionDistStale;
-  Array3 <doublevar> pointdist;  //this is an upper triangular matrix;
-  //the lower is currently wasted
+  Array3 <doublevar> pointdist;  //!< r_e-r_j, kept for all e and j
   Array2 <doublevar> lattice_basis; //the basis we search over for interparticle distances
+  int orthorhombic; //!< minimum images by rounding instead of lattice_basis
+  doublevar box[3], inv_box[3]; //!< cell lengths along x, y, z when orthorhombic
 
   doublevar overall_sign;
   doublevar overall_phase;
@@ -187,6 +222,7 @@ private:
   bool update_overall_sign;
 
   Periodic_system * parent;     //The System that created this object
+  Periodic_ewald ewald;
 };
 
 
@@ -66,6 +66,11 @@ int Periodic_system::showinfo(ostream & os)
   }
   os << "total number of points in reciprocal ewald sum: "
   << ngpoints << endl;
+  if(orthorhombic) 
+    os << "orthorhombic cell; minimum images by rounding" << endl;
+  if(optimized_breakup) 
+    os << "optimized breakup with rcut " << breakup.rcut() 
+       << " kcut " << breakup.kcut() << endl;
 
   os << "Self e-i " << self_ei << endl;
   os << "Self e-e " << self_ee << endl;
@@ -181,6 +186,7 @@ int Periodic_system::read(vector <string> & words,
 
   int ewald_gmax=200;
   readvalue(words, pos=0, ewald_gmax,"EWALD_GMAX");
+  ewald_check=haskeyword(words, pos=0, "EWALD_CHECK");
 
   Array2 <doublevar> atompos(natoms, 3);
   for(int i=0; i< natoms; i++) {
@@ -316,6 +322,19 @@ int Periodic_system::read(vector <string> & words,
     }
   }
 
+  //-------------------orthorhombic cells
+  //When each lattice vector lies along one axis, wrapping into the cell
+  //and finding minimum images reduce to rounding each coordinate.
+  orthorhombic=1;
+  box_length.Resize(ndim);
+  for(int i=0; i< ndim; i++) {
+    box_length(i)=latVec(i,i);
+    for(int j=0; j< ndim; j++) {
+      if(j!=i && fabs(latVec(i,j)) > 1e-12*fabs(latVec(i,i)))
+        orthorhombic=0;
+    }
+  }
+
   
   
   //Make sure the ions are inside the simulation cell
@@ -350,6 +369,27 @@ int Periodic_system::read(vector <string> & words,
 
   debug_write(cout, "alpha ", alpha, "\n");
 
+  optimized_breakup=haskeyword(words, pos=0, "OPTIMIZED_BREAKUP");
+  if(optimized_breakup) { 
+    doublevar tolerance=1e-7;
+    readvalue(words, pos=0, tolerance, "BREAKUP_TOLERANCE");
+    doublevar err=breakup.fit(smallestheight/2, cellVolume, tolerance);
+    single_write(cout,"Optimized breakup: kcut ",breakup.kcut(),"\n");
+    single_write(cout,"rms error in the pair potential ",err,"\n");
+    if(err > tolerance) 
+      single_write(cout,"**Warning** could not reach BREAKUP_TOLERANCE\n");
+
+    //Only the g points inside kcut are needed; since g.a_i=2 pi n_i,
+    //|n_i| <= kcut |a_i|/2pi.
+    ewald_gmax=0;
+    for(int i=0; i< ndim; i++) { 
+      doublevar length=0;
+      for(int j=0; j< ndim; j++) length+=latVec(i,j)*latVec(i,j);
+      int n=int(ceil(breakup.kcut()*sqrt(length)/(2*pi)));
+      ewald_gmax=max(ewald_gmax,n);
+    }
+  }
+
   ///--------------------------------------------
   // Finding the g-points for the Ewald sum
   //
@@ -369,8 +409,8 @@ int Periodic_system::read(vector <string> & words,
                                        +kg*recipLatVec(2,i));
           gsqrd+=tmp*tmp;
         }
-        if(4.0 * pi*exp(-gsqrd/(4*alpha*alpha))
-                               /(cellVolume*gsqrd) > 1e-10) ngpoints++;
+        doublevar weight;
+        if(gsqrd > 1e-8 && gpointWeight(gsqrd,weight)) ngpoints++;
       }
     }
   }
@@ -389,27 +429,28 @@ int Periodic_system::read(vector <string> & words,
       int kgmin=-ewald_gmax;
       if(ig==0 && jg==0) kgmin=0;
       for(int kg=kgmin; kg <= ewald_gmax; kg++) {
+        doublevar g[3];
         for(int i=0; i< ndim; i++) {
-          gpoint(currgpt, i)=2*pi*(ig*recipLatVec(0,i)
-                                       +jg*recipLatVec(1,i)
-                                       +kg*recipLatVec(2,i));
+          g[i]=2*pi*(ig*recipLatVec(0,i)
+                     +jg*recipLatVec(1,i)
+                     +kg*recipLatVec(2,i));
         }
         //cout << "there" << endl;
         doublevar gsqrd=0; //|g|^2
         for(int i=0; i< ndim; i++) {
-          gsqrd+=gpoint(currgpt,i)*gpoint(currgpt,i);
+          gsqrd+=g[i]*g[i];
         }
 
-        if(gsqrd > 1e-8) {
-          gweight(currgpt)=4.0 * pi*exp(-gsqrd/(4*alpha*alpha))
-                               /(cellVolume*gsqrd);
-          if(gweight(currgpt) > 1e-10) { //
-            currgpt++;
-          }
+        doublevar weight;
+        if(gsqrd > 1e-8 && gpointWeight(gsqrd,weight)) {
+          for(int i=0; i< ndim; i++) gpoint(currgpt,i)=g[i];
+          gweight(currgpt)=weight;
+          currgpt++;
         }
       }
     }
   }
+  assert(currgpt==ngpoints);
   single_write(cout,"Ewald sum using ",ngpoints," reciprocal points\n");
   //Done finding the g-points.
   //---------------------------------------
@@ -433,6 +474,7 @@ int Periodic_system::read(vector <string> & words,
   ion_sin.Resize(ngpoints);
   ion_cos.Resize(ngpoints);
   constEwald();
+  ion_version=0;
   ion_ewald=ewaldIon();
 
   vector < vector <string> > pseudotext;
@@ -526,6 +568,23 @@ int Periodic_system::enforcePbc(Array1 <doublevar> & pos, Array1 <int> & nshifte
   //cout << "pos " << pos(0) << "  " << pos(1) << "  " << pos(2) << endl;
   // Array1 <doublevar> oldpos=pos;
 
+  if(orthorhombic) {
+    //Same tolerance as below, in units of the cell.
+    for(int i=0; i< 3; i++) {
+      doublevar f=(pos(i)-origin(i))/box_length(i);
+      if(f < -1e-12 || f > 1+1e-12) {
+        doublevar n=floor(f);
+        if(fabs(n) > 1000)
+          error("Did over 1000 shifts and we're still out of the simulation cell."
+                "  There's probably something wrong.  Position : ", pos(i));
+        pos(i)-=n*box_length(i);
+        nshifted(i)-=int(n);
+        shifted=1;
+      }
+    }
+    return shifted;
+  }
+
   int nshift=0;
   for(int i=0; i< 3; i++) {
     int shouldcontinue=1;
@@ -585,7 +644,23 @@ int Periodic_system::enforcePbc(Array1 <doublevar> & pos, Array1 <int> & nshifte
 
 doublevar Periodic_system::calcLoc(Sample_point * sample)
 {
-  doublevar ewalde=ewaldElectron(sample);
+  doublevar ewalde;
+  Periodic_sample * psample=dynamic_cast<Periodic_sample *>(sample);
+  if(psample) { 
+    ewalde=psample->ewaldElectron();
+    if(ewald_check) { 
+      Array1 <doublevar> separated;
+      doublevar full=ewaldElectron(sample,separated);
+      if(fabs(ewalde-full) > 1e-8*max(1.0,fabs(full))) { 
+        cout << "incremental Ewald " << ewalde << " full sum " << full << endl;
+        error("The incremental Ewald energy disagrees with the full sum");
+      }
+    }
+  }
+  else {
+    Array1 <doublevar> separated;
+    ewalde=ewaldElectron(sample,separated);
+  }
   //cout << "ion_ewald " << ion_ewald << " self_ii " << self_ii
   //     << " self_ee " << self_ee << " self_ei " << self_ei << endl;
   //cout << " ewalde " << ewalde << " xc_correction " << xc_correction << endl;
@@ -597,8 +672,8 @@ doublevar Periodic_system::calcLoc(Sample_point * sample)
 
 void Periodic_system::calcLocSeparated(Sample_point * sample, Array1 <doublevar> & totalv)
 {
-  //  cout << "Not implemented" << endl; 
-  //  doublevar ewalde=ewaldElectron(sample);
+  Array1 <doublevar> ewalde_separated;
+  ewaldElectron(sample,ewalde_separated);
   
   //cout << "ion_ewald " << ion_ewald << " self_ii " << self_ii
   //     << " self_ee " << self_ee << " self_ei " << self_ei << endl;
@@ -644,8 +719,18 @@ void Periodic_system::constEwald() {
     ionSum2+=ions.charge(ion)*ions.charge(ion);
   }
 
-  doublevar squareconst=-.5*(2*alpha/sqrt(pi)+pi/(cellVolume*alpha*alpha));
-  doublevar ijconst=-pi/(cellVolume*alpha*alpha);
+  //The long-range part at r=0 and the short-range part at k=0
+  doublevar vl0, vs0;
+  if(optimized_breakup) { 
+    vl0=breakup.longRangeZero();
+    vs0=breakup.shortRangeZero();
+  }
+  else { 
+    vl0=2*alpha/sqrt(pi);
+    vs0=pi/(cellVolume*alpha*alpha);
+  }
+  doublevar squareconst=-.5*(vl0+vs0);
+  doublevar ijconst=-vs0;
   self_ii=ionIonSum*ijconst+ionSum2*squareconst;
   self_ei=ionElecSum*ijconst; // I guess this term is the charge+ and charge- background interactions
   self_ee=.5*elecElecSum*ijconst+elecSum2*squareconst;
@@ -676,6 +761,7 @@ void Periodic_system::constEwald() {
 doublevar Periodic_system::ewaldIon() {
   assert(ion_sin.GetDim(0) >= ngpoints);
   assert(ion_cos.GetDim(0) >= ngpoints);
+  ion_version++;
 
 
 
@@ -702,7 +788,7 @@ doublevar Periodic_system::ewaldIon() {
             }
             doublevar r=sqrt(r2(0)*r2(0)+r2(1)*r2(1)+r2(2)*r2(2));
 
-            IonIon+=ions.charge(i)*ions.charge(j)*erfcm(alpha*r)/r;
+            IonIon+=ions.charge(i)*ions.charge(j)*shortRange(r);
 //            cout << "r " << r << "  ionion " << IonIon << " i " << i << " j " << j << endl;
           }
         }
@@ -759,8 +845,7 @@ void Periodic_system::calcLocWithTestPos(Sample_point * sample, Array1 <doubleva
     cout <<"Warning, tpos is not in the cell" << endl; 
   }
   int nions=ions.size();
-  int nlatvec=1;
-  Array1 <doublevar> r1(3), r2(3), eidist(5), eedist(5);
+  Array1 <doublevar> r1(3), eidist(5), eedist(5);
   Vtest.Resize(totnelectrons+1);
   for (int e=0; e<totnelectrons; e++) {
     Vtest(e) = ijbg; 
@@ -780,19 +865,7 @@ void Periodic_system::calcLocWithTestPos(Sample_point * sample, Array1 <doubleva
     //for (int d=0; d<3; d++) {
     //  r1(d) = eidist(d+2); 
     //}
-    for(int kk=-nlatvec; kk <=nlatvec; kk++) {
-      for(int jj=-nlatvec; jj <=nlatvec; jj++) {
-	for(int ii=-nlatvec; ii <=nlatvec; ii++) {
-	  for(int d=0; d< 3; d++) {
-	    r2(d)=r1(d)+kk*latVec(0,d)+jj*latVec(1,d)+ii*latVec(2,d);
-	  }
-	  doublevar r=sqrt(r2(0)*r2(0)+r2(1)*r2(1)+r2(2)*r2(2));
-	  Vtest(totnelectrons) -= ions.charge(ion)*erfcm(alpha*r)/r;
-	  //            elecIon_real-=ions.charge(ion)*erfcm(alpha*r)/r;
-	}
-      }
-    }
-      //----done lattice vectors
+    Vtest(totnelectrons) -= ions.charge(ion)*shortRangeSum(r1);
   }
 
   //cout << "electron-electron " << endl;
@@ -806,19 +879,7 @@ void Periodic_system::calcLocWithTestPos(Sample_point * sample, Array1 <doubleva
     //for (int d=0; d<3; d++) r1(d)=eedist(d+2); 
     for (int d=0; d<3; d++) rion(d) = elecpos(e, d); 
     sample->minDist(tpos, rion, r1); 
-    //----over  lattice vectors
-    for(int kk=-nlatvec; kk <=nlatvec; kk++) {
-      for(int jj=-nlatvec; jj <=nlatvec; jj++) {
-	for(int ii=-nlatvec; ii <=nlatvec; ii++) {
-	  for(int d=0; d< 3; d++) {
-	    r2(d)=r1(d)+kk*latVec(0,d)+jj*latVec(1,d)+ii*latVec(2,d);
-	  }
-	  doublevar r=sqrt(r2(0)*r2(0)+r2(1)*r2(1)+r2(2)*r2(2));
-	  Vtest(e) += erfcm(alpha*r)/r;
-	}
-      }
-    }
-    //----done lattice vectors
+    Vtest(e) += shortRangeSum(r1);
   }
 
   //cout << "electron recip " << endl;
@@ -845,7 +906,52 @@ void Periodic_system::calcLocWithTestPos(Sample_point * sample, Array1 <doubleva
 }
 
 
-doublevar Periodic_system::ewaldElectron(Sample_point * sample) {
+int Periodic_system::gpointWeight(doublevar gsqrd, doublevar & weight) {
+  if(optimized_breakup) { 
+    if(gsqrd >= breakup.kcut()*breakup.kcut()) return 0;
+    weight=breakup.longRange(sqrt(gsqrd));
+    return 1;
+  }
+  weight=4.0 * pi*exp(-gsqrd/(4*alpha*alpha))/(cellVolume*gsqrd);
+  return weight > 1e-10;
+}
+
+//----------------------------------------------------------------------
+
+doublevar Periodic_system::shortRange(doublevar r) {
+  if(optimized_breakup) return breakup.shortRange(r);
+  return erfcm(alpha*r)/r;
+}
+
+//----------------------------------------------------------------------
+
+doublevar Periodic_system::shortRangeSum(const Array1 <doublevar> & r1) {
+  //The optimized short-range part vanishes beyond half the smallest
+  //height of the cell, so only the minimum image contributes.
+  if(optimized_breakup) { 
+    return breakup.shortRange(sqrt(r1(0)*r1(0)+r1(1)*r1(1)+r1(2)*r1(2)));
+  }
+  const int nlatvec=1;
+  doublevar sum=0;
+  doublevar r2[3];
+  for(int kk=-nlatvec; kk <=nlatvec; kk++) {
+    for(int jj=-nlatvec; jj <=nlatvec; jj++) {
+      for(int ii=-nlatvec; ii <=nlatvec; ii++) {
+        for(int d=0; d< 3; d++) {
+          r2[d]=r1(d)+kk*latVec(0,d)+jj*latVec(1,d)+ii*latVec(2,d);
+        }
+        doublevar r=sqrt(r2[0]*r2[0]+r2[1]*r2[1]+r2[2]*r2[2]);
+        sum+=erfcm(alpha*r)/r;
+      }
+    }
+  }
+  return sum;
+}
+
+//----------------------------------------------------------------------
+
+doublevar Periodic_system::ewaldElectron(Sample_point * sample,
+                                         Array1 <doublevar> & ewalde_separated) {
   //cout << sample << endl;
   sample->updateEEDist();
   //cout << "updateEIDIST" << endl;
@@ -854,8 +960,7 @@ doublevar Periodic_system::ewaldElectron(Sample_point * sample) {
 
   Array1 <doublevar> eidist(5);
   int nions=ions.size();
-  int nlatvec=1;
-  Array1 <doublevar> r1(3), r2(3);
+  Array1 <doublevar> r1(3);
 
   //cout << "electron-ion " << endl;
   //-------------Electron-ion real part
@@ -867,21 +972,9 @@ doublevar Periodic_system::ewaldElectron(Sample_point * sample) {
 
       sample->getEIDist(e,ion, eidist);
       for(int d=0; d< 3; d++) r1(d)=eidist(d+2);
-
-      //----over  lattice vectors
-      for(int kk=-nlatvec; kk <=nlatvec; kk++) {
-        for(int jj=-nlatvec; jj <=nlatvec; jj++) {
-          for(int ii=-nlatvec; ii <=nlatvec; ii++) {
-            for(int d=0; d< 3; d++) {
-              r2(d)=r1(d)+kk*latVec(0,d)+jj*latVec(1,d)+ii*latVec(2,d);
-            }
-            doublevar r=sqrt(r2(0)*r2(0)+r2(1)*r2(1)+r2(2)*r2(2));
-	    elecIon_real_separated(e) -= ions.charge(ion)*erfcm(alpha*r)/r;
-            elecIon_real-=ions.charge(ion)*erfcm(alpha*r)/r;
-          }
-        }
-      }
-      //----done lattice vectors
+      doublevar v=ions.charge(ion)*shortRangeSum(r1);
+      elecIon_real_separated(e) -= v;
+      elecIon_real-=v;
     }
   }
   //cout << "electron-electron " << endl;
@@ -894,23 +987,10 @@ doublevar Periodic_system::ewaldElectron(Sample_point * sample) {
     for(int e2 =e1+1; e2 < totnelectrons; e2++) {
       sample->getEEDist(e1,e2, eidist);
       for(int d=0; d< 3; d++) r1(d)=eidist(d+2);
-
-      //----over  lattice vectors
-      for(int kk=-nlatvec; kk <=nlatvec; kk++) {
-        for(int jj=-nlatvec; jj <=nlatvec; jj++) {
-          for(int ii=-nlatvec; ii <=nlatvec; ii++) {
-            for(int d=0; d< 3; d++) {
-              r2(d)=r1(d)+kk*latVec(0,d)+jj*latVec(1,d)+ii*latVec(2,d);
-            }
-            doublevar r=sqrt(r2(0)*r2(0)+r2(1)*r2(1)+r2(2)*r2(2));
-
-            elecElec_real+=erfcm(alpha*r)/r;
-	    elecElec_real_separated(e1) += erfcm(alpha*r)/r;
-	    elecElec_real_separated(e2) += erfcm(alpha*r)/r;
-          }
-        }
-      }
-      //----done lattice vectors
+      doublevar v=shortRangeSum(r1);
+      elecElec_real+=v;
+      elecElec_real_separated(e1) += v;
+      elecElec_real_separated(e2) += v;
     }
   }
 
@@ -26,6 +26,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "Pseudopotential.h"
 #include "Particle_set.h"
 #include "Pbc_enforcer.h"
+#include "Coulomb_breakup.h"
 class Periodic_sample;
 
 /*!
@@ -45,6 +46,10 @@ V=.5 \sum_{l}\sum_{i \ne j} q_i q_j \frac{erfc(\alpha |{\bf r_{ij}+l}|)}{r_{ij}}
 
 \f]
 
+With OPTIMIZED_BREAKUP, erfc and the Gaussian weights are replaced by
+the short- and long-range parts of a Coulomb_breakup, and the real-space
+sums need only the minimum image.
+
 \todo
 Stop using Particle_set for the ion positions.  Use Pbc_enforcer instead of 
 having the member function.
@@ -100,6 +105,12 @@ public:
       cenlabels[cen]=atomLabels[equiv_atom(cen)];
     }
   }
+  //The centers include the periodic images, so their distances 
+  //aren't minimum-imaged.
+  virtual int getCenterPos(Array2 <doublevar> & pos) { 
+    pos=centerpos;
+    return 1;
+  }
 
 
   virtual void getEquivalentCenters(Array2 <int> & equiv_centers_,
@@ -143,6 +154,7 @@ public:
 
 private:
   friend class Periodic_sample;
+  friend class Periodic_ewald;
 
   Array1 <int> nspin;
   vector <string> atomLabels;
@@ -168,6 +180,8 @@ private:
   Array2 <doublevar> primlat; //!< lattice vectors of the primitive cell
   Array2 <doublevar> normVec;  //!< normal vectors to the sides, pointing out
   Array2 <doublevar> corners; //!< the position of the corner by moving one lattice vector
+  int orthorhombic; //!< whether the lattice vectors lie along x, y and z
+  Array1 <doublevar> box_length; //!< diagonal of latVec, used when orthorhombic
 
   Array2 <doublevar> gpoint; //!< A list of non-zero g points in the ewald sum
   Array1 <doublevar> gweight;
@@ -176,11 +190,15 @@ private:
   Array1 <doublevar> ion_cos, ion_sin;
   //!< The sums for each g point over the ions.
   doublevar ion_ewald; //!< ionic ewald energy
+  int ion_version; //!< incremented whenever the ion terms are recomputed
+  int ewald_check; //!< compare the incremental Ewald energy to the full sum
 
   int ngpoints; //!< number of k points in ewald sum
   int totnelectrons; //!< number of electrons
   doublevar smallestheight; //!< smallest distance that spans the cell
   doublevar alpha; //!< the ewald parameter
+  int optimized_breakup; //!< use breakup instead of the Gaussian split
+  Coulomb_breakup breakup;
   doublevar cellVolume; //!< Simulation cell volume
 
   doublevar self_ii; //!< self ion-ion energy
@@ -188,7 +206,6 @@ private:
   doublevar self_ee; //!< self electron-electron energy
   doublevar xc_correction; //!<exchange-correlation correction
   //  Array1 <doublevar> self_ee_separated; 
-  Array1 <doublevar> ewalde_separated; 
   doublevar self_e_single; 
   doublevar self_e_single_test; 
   doublevar ijbg; 
@@ -203,9 +220,26 @@ private:
   doublevar ewaldIon();
 
   /*!
-    electron-ion interaction and electron-electron interaction
+    electron-ion interaction and electron-electron interaction;
+    ewalde_separated gets the share of each electron
+   */
+  doublevar ewaldElectron(Sample_point * sample,
+                          Array1 <doublevar> & ewalde_separated);
+
+  /*!
+    Decide whether to keep the g point with |g|^2=gsqrd in the
+    reciprocal sum, and if so, its weight.
+   */
+  int gpointWeight(doublevar gsqrd, doublevar & weight);
+
+  //! The short-range part of 1/r
+  doublevar shortRange(doublevar r);
+
+  /*!
+    The short-range pair potential summed over the images needed for
+    the minimum-image displacement r1.
    */
-  doublevar ewaldElectron(Sample_point * sample);
+  doublevar shortRangeSum(const Array1 <doublevar> & r1);
   doublevar minDistance(Array1 <doublevar> pos1, Array1 <doublevar> pos2, Array1 <doublevar> &rmin ); 
   Array1 <doublevar> ion_polarization;
 };
@@ -464,7 +464,9 @@ void Pseudopotential::calcPseudoSeparated(Wavefunction_data * wfdata,
   //  doublevar accum_nonlocal=0;
   
   wf->updateVal(wfdata, sample);
+  Storage_container wfStore;
   wfStore.initialize(sample, wf);
+  Array3 <doublevar> & integralpt(quadrature());
   
   int accept_counter=0;
   //deriv.Resize(natoms, 3);
@@ -615,7 +617,7 @@ void Pseudopotential::calcNonlocWithAllvariables(Wavefunction_data * wfdata,
   assert(nelectrons == sample->electronSize());
 
   Array1 <doublevar> ionpos(3), oldpos(3), newpos(3);
-  Array1 <doublevar> newdist(5), olddist(5);
+  Array1 <doublevar> olddist(5);
   Wf_return val(nwf,2);
 
   totalv=0;
@@ -623,7 +625,9 @@ void Pseudopotential::calcNonlocWithAllvariables(Wavefunction_data * wfdata,
   doublevar accum_nonlocal=0;
 
   wf->updateVal(wfdata, sample);
+  Storage_container wfStore;
   wfStore.initialize(sample, wf);
+  Array3 <doublevar> & integralpt(quadrature());
   Parm_deriv_return base_deriv;
   if(parm_derivatives) { 
     parm_deriv.Resize(wfdata->nparms());
@@ -637,6 +641,9 @@ void Pseudopotential::calcNonlocWithAllvariables(Wavefunction_data * wfdata,
   Array1 <doublevar>  nonlocal(nwf);
   Array2 <doublevar> integralpts(nwf, maxaip);
   Array1 <doublevar> rDotR(maxaip);
+  Array2 <doublevar> quadpos, quadtrans; //(point, d)
+  Array1 <Wf_return> quadratio;
+  Array2 <doublevar> quadderiv; //(point, parameter)
           
   
   for(int at=0; at< natoms; at++){
@@ -688,60 +695,69 @@ void Pseudopotential::calcNonlocWithAllvariables(Wavefunction_data * wfdata,
       
 
         if(accept)  {
-          wfStore.saveUpdate(sample, wf, e);
           Wf_return  oldWfVal(nwf,2);
           wf->getVal(wfdata, e,oldWfVal);
 
-          for(int i=0; i< aip(at); i++) {
+          //Make sure to move the electron relative to the nearest neighbor
+          //in a periodic calculation(so subtract the distance rather than
+          //adding to the ionic position).  This actually only matters 
+          //when we're doing non-zero k-points.  The electron-ion vector 
+          //at point i is then olddist(0)*integralpt(at,i).
+          int npts=aip(at);
+          quadpos.Resize(npts,3);
+          quadtrans.Resize(npts,3);
+          for(int i=0; i< npts; i++) {
+            rDotR(i)=0;
+            for(int d=0; d < 3; d++) {
+              quadtrans(i,d)=integralpt(at,i,d)*olddist(0)-olddist(d+2);
+              quadpos(i,d)=oldpos(d)+quadtrans(i,d);
+              rDotR(i)+=integralpt(at,i,d)*olddist(d+2);
+            }
+            rDotR(i)/=olddist(0);
+          }
+
+          //The parameter derivatives need the wave function at each
+          //point, so they still move the electron there.
+          if(parm_derivatives) { 
+            wfStore.saveUpdate(sample, wf, e);
+            int np=wfdata->nparms();
+            quadderiv.Resize(npts,np);
+            quadratio.Resize(npts);
+            for(int i=0; i< npts; i++) { 
+              sample->setElectronPos(e, oldpos);
+              for(int d=0; d< 3; d++) newpos(d)=quadtrans(i,d);
+              sample->translateElectron(e, newpos);
+              wf->updateVal(wfdata, sample);
+              wf->getVal(wfdata, e, val);
+              quadratio(i).Resize(nwf,1);
+              quadratio(i).is_complex=val.is_complex;
+              for(int w=0; w< nwf; w++) { 
+                quadratio(i).amp(w,0)=val.amp(w,0)-oldWfVal.amp(w,0);
+                quadratio(i).phase(w,0)=val.phase(w,0)-oldWfVal.phase(w,0);
+              }
+              Parm_deriv_return deriv;
+              deriv.need_hessian=0;
+              wf->getParmDeriv(wfdata, sample, deriv);
+              for(int p=0; p < np; p++) 
+                quadderiv(i,p)=deriv.gradient(p)-base_deriv.gradient(p);
+            }
             sample->setElectronPos(e, oldpos);
-            doublevar base_sign=sample->overallSign();
-            doublevar base_phase=sample->overallPhase();
-            //Make sure to move the electron relative to the nearest neighbor
-            //in a periodic calculation(so subtract the distance rather than
-            //adding to the ionic position).  This actually only matters 
-            //when we're doing non-zero k-points.
-            for(int d=0; d < 3; d++) 
-              newpos(d)=integralpt(at,i,d)*olddist(0)-olddist(d+2);
-	    
-            //cout << "translation " << newpos(0) << "   " 
-             //   << newpos(1) << "   " << newpos(2) << endl;
-            
-            sample->translateElectron(e, newpos);
-            sample->updateEIDist();
-            sample->getEIDist(e,at,newdist);
-            //cout << "ionpos " << ionpos(0) << " " << ionpos(1) << " " << ionpos(2) << endl;
-            //cout << "oldpos " << oldpos(0) << " " << oldpos(1) << " " << oldpos(2) << endl;
-            //cout << "newpos " << oldpos(0)+newpos(0) << " " << oldpos(1)+newpos(1) << 
-            //  " " << oldpos(2)+newpos(2) << endl;
-            //Array1 <doublevar> newpos_test(3);
-            //sample->getElectronPos(e,newpos_test);
-            //cout << "newpos_test " << newpos_test(0) << " " << newpos_test(1) << " "
-            //  << newpos_test(2) << endl;
-
-            //cout << "olddist " << olddist(0) << " newdist " << newdist(0) << endl;
-            //cout << "integralpt " << olddist(0)*integralpt(at,i,0) << " " << olddist(0)*integralpt(at,i,1) 
-            //  << " " << olddist(0)*integralpt(at,i,2) << endl;
+            wfStore.restoreUpdate(sample, wf, e);
+          }
+          else 
+            wf->evalVirtualMoves(wfdata, sample, e, quadpos, quadratio);
 
-            rDotR(i)=0;
-            for(int d=0; d < 3; d++)
-              rDotR(i)+=newdist(d+2)*olddist(d+2);
-            doublevar new_sign=sample->overallSign();
-            doublevar new_phase=sample->overallPhase();
-            
-            rDotR(i)/=(newdist(0)*olddist(0));  //divide by the magnitudes
-            wf->updateVal(wfdata, sample);
-            wf->getVal(wfdata, e, val); 
-            //----
-            //cout << "signs " << base_sign << "  " << new_sign << endl;;
+          for(int i=0; i< npts; i++) {
+            doublevar trans_sign, trans_phase;
+            for(int d=0; d< 3; d++) newpos(d)=quadtrans(i,d);
+            sample->translationPhase(e, newpos, trans_sign, trans_phase);
             for(int w=0; w< nwf; w++) {
-              integralpts(w,i)=exp(val.amp(w,0)-oldWfVal.amp(w,0))
+              integralpts(w,i)=exp(quadratio(i).amp(w,0))
                 *integralweight(at, i);
-              if ( val.is_complex==1 ) {
-                integralpts(w,i)*=cos(val.phase(w,0)+new_phase
-                    -oldWfVal.phase(w,0)-base_phase);
+              if ( quadratio(i).is_complex==1 ) {
+                integralpts(w,i)*=cos(quadratio(i).phase(w,0)+trans_phase);
               } else {
-                integralpts(w,i)*=val.sign(w)*oldWfVal.sign(w)
-                  *base_sign*new_sign;
+                integralpts(w,i)*=cos(quadratio(i).phase(w,0))*trans_sign;
               }
             }
             
@@ -756,7 +772,6 @@ void Pseudopotential::calcNonlocWithAllvariables(Wavefunction_data * wfdata,
               }
               else { 
                 Tmove nwtmove; nwtmove.pos.Resize(3);
-                //sample->getElectronPos(e,nwtmove.pos);
                 nwtmove.pos=newpos;
                 nwtmove.e=e;
                 nwtmove.vxx=vxx;
@@ -765,24 +780,14 @@ void Pseudopotential::calcNonlocWithAllvariables(Wavefunction_data * wfdata,
               
               //-----------parameter derivatives
               if(parm_derivatives) { 
-                Parm_deriv_return deriv;
-                deriv.need_hessian=0;
-                wf->getParmDeriv(wfdata, sample, deriv);
                 int np=wfdata->nparms();
                 for(int p=0; p < np; p++) { 
-                  parm_deriv(p)+=(deriv.gradient(p)-base_deriv.gradient(p))*vxx;
+                  parm_deriv(p)+=quadderiv(i,p)*vxx;
                 }
               }
               //------
             }
-            sample->setElectronPos(e, oldpos);
           } 
-
-          //--------------------
-
-
-
-          wfStore.restoreUpdate(sample, wf, e);
         }
 
         //----------------------------------------------
@@ -817,6 +822,15 @@ void Pseudopotential::calcNonlocWithAllvariables(Wavefunction_data * wfdata,
 
 //------------------------------------------------------------------------
 
+void Pseudopotential::setThreads(int n) { 
+  assert(n >= 1 && integralpt.GetDim(0) >= 1);
+  Array3 <doublevar> pts(integralpt(0));
+  integralpt.Resize(n);
+  for(int t=0; t< n; t++) integralpt(t)=pts;
+}
+
+//------------------------------------------------------------------------
+
 
 void Pseudopotential::randomize() {
   Array1 <doublevar> x(3), y(3), z(3);
@@ -833,6 +847,7 @@ void Pseudopotential::rotateQuadrature(Array1 <doublevar> & x,
 
 
   int natoms=aip.GetDim(0);
+  Array3 <doublevar> & integralpt(quadrature());
 
   //cout << "x1, x2, x3" << x1 << "   " << x2 << "   " << x3 << endl;
   //cout << "y1, y2, y3" << y1 << "   " << y2 << "   " << y3 << endl;
@@ -882,7 +897,8 @@ void Pseudopotential::read(vector <vector <string> > & pseudotext,
   //Get the atomic integration points
   aip.Resize(natoms);
   aip=6; //default value for atomic integration points
-  integralpt.Resize(natoms, maxaip, 3);
+  integralpt.Resize(1);
+  integralpt(0).Resize(natoms, maxaip, 3);
   integralpt_orig.Resize(natoms, maxaip, 3);
   integralweight.Resize(natoms, maxaip);
   addzeff.Resize(natoms);
@@ -959,9 +975,9 @@ void Pseudopotential::read(vector <vector <string> > & pseudotext,
 
     for(int i=0; i< aip(at); i++)
     {
-      integralpt(at,i,0)=integralpt_orig(at, i, 0)=xpt(i);
-      integralpt(at,i,1)=integralpt_orig(at, i, 1)=ypt(i);
-      integralpt(at,i,2)=integralpt_orig(at, i, 2)=zpt(i);
+      integralpt(0)(at,i,0)=integralpt_orig(at, i, 0)=xpt(i);
+      integralpt(0)(at,i,1)=integralpt_orig(at, i, 1)=ypt(i);
+      integralpt(0)(at,i,2)=integralpt_orig(at, i, 2)=zpt(i);
       integralweight(at, i)=weight(i);
     }
 
@@ -185,6 +185,14 @@ public:
     Randomly rotate the axes to unbias the calculation
   */
   void randomize();
+
+  /*!
+    \brief
+    Keep a separate rotation of the quadrature for each of n threads,
+    so that they can share this object.  randomize() and 
+    rotateQuadrature() then only affect the calling thread.
+  */
+  void setThreads(int n);
   
   /*!
     \brief
@@ -218,7 +226,7 @@ public:
 
   doublevar getIntegralPt(int at, int i, int d)
   {
-    return integralpt(at, i, d); 
+    return quadrature()(at, i, d); 
   }
   int getMaxAIP() {
     return maxaip; 
@@ -242,16 +250,20 @@ public:
   const int maxaip; //!< Maximum number of atomic integration points
   int nelectrons;
   Array1 <int> aip;
-  Array3 <doublevar> integralpt;
+  Array1 <Array3 <doublevar> > integralpt; //!< rotated quadrature of each thread
   Array3 <doublevar> integralpt_orig;
   Array2 <doublevar> integralweight;
   Array1 <doublevar> cutoff;
   vector <string> atomnames;
   Array1 <bool> addzeff; //!< whether or not to add Z_eff/r to the local function
   
-  Storage_container wfStore;
-  
   Array2 <Basis_function *> radial_basis;
+
+  Array3 <doublevar> & quadrature() { 
+    int t=thread_num();
+    assert(t < integralpt.GetDim(0));
+    return integralpt(t);
+  }
   
 };
 
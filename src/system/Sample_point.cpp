@@ -32,6 +32,52 @@ int Sample_point::ndim() { return 3; }
 
 //----------------------------------------------------------------------
 
+const doublevar * Sample_point::getEERow(const int e, int & stride) {
+  int n=electronSize();
+  scratch_row.Resize(5,n);
+  Array1 <doublevar> R(5);
+  for(int j=0; j< n; j++) {
+    if(j==e) { 
+      for(int c=0; c< 5; c++) scratch_row(c,j)=0;
+      continue;
+    }
+    if(j < e) { 
+      getEEDist(j,e,R);
+      for(int d=2; d< 5; d++) R(d)=-R(d);
+    }
+    else getEEDist(e,j,R);
+    for(int c=0; c< 5; c++) scratch_row(c,j)=R(c);
+  }
+  stride=n;
+  return scratch_row.v;
+}
+
+const doublevar * Sample_point::getEIRow(const int e, int & stride) {
+  int n=ionSize();
+  scratch_row.Resize(5,n);
+  Array1 <doublevar> R(5);
+  for(int j=0; j< n; j++) {
+    getEIDist(e,j,R);
+    for(int c=0; c< 5; c++) scratch_row(c,j)=R(c);
+  }
+  stride=n;
+  return scratch_row.v;
+}
+
+const doublevar * Sample_point::getECRow(const int e, int & stride) {
+  int n=centerSize();
+  scratch_row.Resize(5,n);
+  Array1 <doublevar> R(5);
+  for(int j=0; j< n; j++) {
+    getECDist(e,j,R);
+    for(int c=0; c< 5; c++) scratch_row(c,j)=R(c);
+  }
+  stride=n;
+  return scratch_row.v;
+}
+
+//----------------------------------------------------------------------
+
 int read_config(string & last_read, istream & is, 
                 Sample_point * sample) {
   if(last_read=="CONFIGS") {
@@ -116,6 +162,25 @@ void Config_save_point::mpiSend(int node) {
 #endif
 }
 
+//----------------------------------------------------------------------
+
+void Config_save_point::pack(Pack_buffer & buf) { 
+  int nelectrons=electronpos.GetDim(0);
+  buf.put(nelectrons);
+  for(int e=0; e< nelectrons; e++) { 
+    for(int d=0; d< 3; d++) buf.put(electronpos(e)(d));
+  }
+}
+
+void Config_save_point::unpack(Pack_buffer & buf) { 
+  int nelectrons=buf.getInt();
+  electronpos.Resize(nelectrons);
+  for(int e=0; e< nelectrons; e++) { 
+    electronpos(e).Resize(3);
+    for(int d=0; d< 3; d++) electronpos(e)(d)=buf.getDouble();
+  }
+}
+
 //----------------------------------------------------------------------
 void Config_save_point::read(istream & is) { 
   string dummy;
@@ -23,6 +23,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define SAMPLE_POINT_H_INCLUDED
 
 #include "Qmc_std.h"
+#include "Pack_buffer.h"
 class Wavefunction;
 class Sample_storage;
 class System;
@@ -120,6 +121,16 @@ public:
   virtual doublevar overallPhase() {
     return 0.0;
   }
+
+  /*!
+    The factors that translateElectron(e,trans) would multiply 
+    overallSign() by and add to overallPhase(), without moving anything.
+  */
+  virtual void translationPhase(const int e, const Array1 <doublevar> & trans,
+                                doublevar & sign, doublevar & phase) {
+    sign=1.0;
+    phase=0.0;
+  }
   
   /*!
     \brief
@@ -219,6 +230,26 @@ public:
   virtual void getECDist(const int e, const int cent,
                          Array1 <doublevar> & distance)=0;
 
+  //Rows of the distance tables
+  /*!
+    \brief
+    All the distances from electron e at once.  Component c 
+    (r, r^2, x, y, z) of the distance to j is row[c*stride+j].  
+
+    These are for reading many distances in a tight loop.  Samples that
+    keep their tables in this layout return a pointer into the table,
+    which is valid until the next move or update; the default copies
+    from the get*Dist() functions into a scratch row.  The distances 
+    must be up to date.
+
+    For getEERow, the vector is r_e-r_j for every j (so it has the
+    opposite sign to getEEDist(j,e) when j < e), and the entry for 
+    j=e is meaningless.
+  */
+  virtual const doublevar * getEERow(const int e, int & stride);
+  virtual const doublevar * getEIRow(const int e, int & stride);
+  virtual const doublevar * getECRow(const int e, int & stride);
+
 
   //I/O
 
@@ -244,6 +275,7 @@ public:
 
 protected:
   Wavefunction * wfObserver;
+  Array2 <doublevar> scratch_row; //!< for the default get*Row()
 };
 
 
@@ -283,6 +315,8 @@ class Config_save_point {
   void restorePos(Sample_point * sample);
   void mpiSend(int node);
   void mpiReceive(int node);
+  void pack(Pack_buffer & buf);
+  void unpack(Pack_buffer & buf);
   void getPos(int e, Array1 <doublevar> & r) { 
     r=electronpos(e);
   }
@@ -149,6 +149,13 @@ public:
   virtual void getCenterLabels(vector <string> & labels) {
     getAtomicLabels(labels);
   }
+  /*!
+    \brief
+    Positions of the centers in getCenterLabels(), (center, dimension).
+    Returns 0 if the distances from the Sample_point to the centers 
+    aren't simple Cartesian distances to fixed positions.
+   */
+  virtual int getCenterPos(Array2 <doublevar> & pos) { return 0; }
   virtual void getEquivalentCenters(Array2 <int> & equiv_centers,
                                     Array1 <int> & ncenters_atom, 
                                     Array2 <int> & displacements)=0;
@@ -112,6 +112,7 @@ public:
   int showinfo(ostream & os);
 
   int writeinput(string &, ostream &);
+  int threadSafe() { return 0; } //!< bfwrapper keeps scratch in the data
 
   int nparms(){
     return bfwrapper.nparms()+pfkeeper.nparms();
@@ -158,6 +158,7 @@ public:
   int showinfo(ostream & os);
 
   int writeinput(string &, ostream &);
+  int threadSafe() { return 0; } //!< bfwrapper keeps scratch in the data
 
   int nparms(){
     return bfwrapper.nparms()+dkeeper.nparms();
@@ -23,6 +23,19 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "System.h"
 #include "Sample_point.h"
 
+QMC_THREAD_LOCAL Array2 <doublevar> Jastrow_group::pair_R;
+QMC_THREAD_LOCAL Array1 <int> Jastrow_group::pair_row;
+QMC_THREAD_LOCAL Array1 <int> Jastrow_group::pair_col;
+QMC_THREAD_LOCAL Array1 <int> Jastrow_group::tab_pair;
+QMC_THREAD_LOCAL Array1 <doublevar> Jastrow_group::tab_r;
+QMC_THREAD_LOCAL Array2 <doublevar> Jastrow_group::tab_val;
+QMC_THREAD_LOCAL Array2 <doublevar> Jastrow_group::tab_dfr;
+QMC_THREAD_LOCAL Array2 <doublevar> Jastrow_group::tab_lap;
+QMC_THREAD_LOCAL Array3 <doublevar> Jastrow2_wf::vm_eibasis;
+QMC_THREAD_LOCAL Array3 <doublevar> Jastrow2_wf::vm_eebasis;
+QMC_THREAD_LOCAL Array3 <doublevar> Jastrow2_wf::vm_eibasis_tmp;
+QMC_THREAD_LOCAL Array1 <doublevar> Jastrow2_wf::vm_newval_ee;
+
 //######################################################################
 
 
@@ -107,6 +120,14 @@ void Jastrow_group::set_up(vector <string> & words, System * sys) {
     optimize_basis=1;
   else optimize_basis=0;
 
+  tabulate_basis=haskeyword(words, pos=0, "TABULATE_BASIS");
+  if(!readvalue(words, pos=0, table_spacing, "TABLE_SPACING"))
+    table_spacing=0.002;
+  if(!readvalue(words, pos=0, table_range, "TABLE_RANGE"))
+    table_range=20.0;
+  if(table_spacing <= 0 || table_range <= 0)
+    error("TABLE_SPACING and TABLE_RANGE must be positive");
+
 
   int fix_old=haskeyword(words, pos=0,"OLD_FORMAT");
   int natoms=atomnames.size();
@@ -235,11 +256,38 @@ void Jastrow_group::set_up(vector <string> & words, System * sys) {
     three_body_diffspin.set_up(threebodysec_diffspin, sys);
   } 
 
+  eib_offset.Resize(natoms, nbasis);
+  eib_offset=-1;
+  for(int at=0; at < natoms; at++) {
+    int counter=0;
+    for(int n=0; n< nbasis_at(at); n++) {
+      int b=atom2basis(at,n);
+      eib_offset(at,b)=counter;
+      counter+=nfunc_eib(b);
+    }
+  }
+  if(tabulate_basis) buildTables();
+
   check_consistency();
 }
 
 //----------------------------------------------------------------------
 
+/*!
+Fit the radial basis functions on a grid.  Basis objects that are not
+radial get an empty table and are always evaluated directly.
+*/
+void Jastrow_group::buildTables() {
+  eitable.Resize(eibasis.GetDim(0));
+  for(int b=0; b< eibasis.GetDim(0); b++)
+    eitable(b).build(eibasis(b), table_spacing, table_range);
+  eetable.Resize(eebasis.GetDim(0));
+  for(int b=0; b< eebasis.GetDim(0); b++)
+    eetable(b).build(eebasis(b), table_spacing, table_range);
+}
+
+//----------------------------------------------------------------------
+
 int Jastrow_group::check_consistency() {
 
   //Check to make sure that the parameters make sense
@@ -306,7 +354,8 @@ int Jastrow_group::check_consistency() {
 //----------------------------------------------------------------------
 
 void Jastrow_group::updateEIBasis(int e, Sample_point * sample,
-                                  Array3 <doublevar> & eisave) {
+                                  Array3 <doublevar> & eisave, 
+                                  int analytic) {
   //cout << "updateEIBasis" << endl;
   int natoms=nbasis_at.GetDim(0);
 
@@ -317,10 +366,37 @@ void Jastrow_group::updateEIBasis(int e, Sample_point * sample,
   Array2 <doublevar> lap(maxeibasis, 5);
   sample->updateEIDist();
 
+  int stride;
+  const doublevar * row=sample->getEIRow(e,stride);
+  if(tabulate_basis && !analytic) { 
+    //Evaluate each basis object on all its atoms at once
+    Array2 <doublevar> & pair_R(Jastrow_group::pair_R);
+    Array1 <int> & pair_row(Jastrow_group::pair_row);
+    Array1 <int> & pair_col(Jastrow_group::pair_col);
+    pair_R.Resize(natoms,5);
+    for(int at=0; at < natoms; at++) { 
+      for(int d=0; d< 5; d++) pair_R(at,d)=row[d*stride+at];
+    }
+    pair_row.Resize(natoms);
+    pair_col.Resize(natoms);
+    for(int b=0; b< eibasis.GetDim(0); b++) { 
+      int np=0;
+      for(int at=0; at < natoms; at++) { 
+        if(eib_offset(at,b) >= 0) { 
+          pair_row(np)=at;
+          pair_col(np)=eib_offset(at,b);
+          np++;
+        }
+      }
+      evalPairs(eibasis(b), eitable(b), np, eisave);
+    }
+    return;
+  }
+
   int b; //basis
 
   for(int at=0; at < natoms; at++) {
-     sample->getEIDist(e,at, R);
+     for(int d=0; d< 5; d++) R(d)=row[d*stride+at];
      int counter=0;
      //eisave(at,counter,0)=1;
      //for(int d=1; d< 5; d++) 
@@ -343,7 +419,8 @@ void Jastrow_group::updateEIBasis(int e, Sample_point * sample,
 //----------------------------------------------------------------------
 
 void Jastrow_group::updateEEBasis(int e, Sample_point * sample,
-                                  Array3 <doublevar> & eesave) {
+                                  Array3 <doublevar> & eesave,
+                                  int analytic) {
   //cout << "updateEEBasis" << endl;
   Array1 <doublevar> R(5);
   Array2 <doublevar> lap(maxeebasis, 5);
@@ -352,6 +429,51 @@ void Jastrow_group::updateEEBasis(int e, Sample_point * sample,
   int counter=0;
   sample->updateEEDist();
 
+  //The row holds r_e-r_i; the basis wants the vector from the lower
+  //numbered electron, as getEEDist() gives it.
+  int stride;
+  const doublevar * row=sample->getEERow(e,stride);
+  Array2 <doublevar> & pair_R(Jastrow_group::pair_R);
+  Array1 <int> & pair_row(Jastrow_group::pair_row);
+  Array1 <int> & pair_col(Jastrow_group::pair_col);
+  pair_R.Resize(nelectrons,5);
+  for(int i=0; i< nelectrons; i++) { 
+    doublevar sign=(i < e)?-1.0:1.0;
+    pair_R(i,0)=row[i];
+    pair_R(i,1)=row[stride+i];
+    for(int d=2; d< 5; d++) pair_R(i,d)=sign*row[d*stride+i];
+  }
+
+  if(tabulate_basis && !analytic) { 
+    //Evaluate each basis object on all the pairs with e at once
+    pair_row.Resize(nelectrons);
+    pair_col.Resize(nelectrons);
+    for(int b=0; b< neebasis; b++) {
+      doublevar cutoff=0;
+      for(int n=0; n< nfunc_eeb(b); n++) {
+        if(cutoff < eebasis(b)->cutoff(n)) cutoff=eebasis(b)->cutoff(n);
+      }
+      int np=0;
+      for(int i=0; i< nelectrons; i++) { 
+        if(i==e) continue;
+        if(pair_R(i,0) < cutoff) { 
+          pair_row(np)=i;
+          pair_col(np)=counter;
+          np++;
+        }
+        else { 
+          for(int n=0; n< nfunc_eeb(b); n++) {
+            for(int d=0; d< 5; d++)
+              eesave(i,counter+n, d)=0;
+          }
+        }
+      }
+      evalPairs(eebasis(b), eetable(b), np, eesave);
+      counter+=nfunc_eeb(b);
+    }
+    return;
+  }
+
   //for(int i=0; i< nelectrons; i++) { 
   //  eesave(i,counter,0)=1;
   //  for(int d=1; d< 5; d++)
@@ -366,7 +488,7 @@ void Jastrow_group::updateEEBasis(int e, Sample_point * sample,
     }
 
     for(int i=0; i< e; i++) {
-      sample->getEEDist(i,e,R);
+      for(int d=0; d< 5; d++) R(d)=pair_R(i,d);
       if(R(0) < cutoff) {
         eebasis(b)->calcLap(R,lap);
         for(int n=0; n< nfunc_eeb(b); n++) {
@@ -385,7 +507,7 @@ void Jastrow_group::updateEEBasis(int e, Sample_point * sample,
       }
     }
     for(int j=e+1; j< nelectrons; j++) {
-      sample->getEEDist(e,j,R);
+      for(int d=0; d< 5; d++) R(d)=pair_R(j,d);
       if(R(0) < cutoff) { 
         eebasis(b)->calcLap(R,lap);
         for(int n=0; n< nfunc_eeb(b); n++) {
@@ -410,6 +532,69 @@ void Jastrow_group::updateEEBasis(int e, Sample_point * sample,
 
 //----------------------------------------------------------------------
 
+/*!
+Evaluate basis object bas at the npairs points set up in pair_row and
+pair_col.  Points inside the table are done together from the splines,
+and the rest (or all of them, if bas has no table) analytically.
+*/
+void Jastrow_group::evalPairs(Basis_function * bas, Radial_table & table,
+                              int npairs, Array3 <doublevar> & save) { 
+  int nf=bas->nfunc();
+  Array2 <doublevar> & pair_R(Jastrow_group::pair_R);
+  Array1 <int> & pair_row(Jastrow_group::pair_row);
+  Array1 <int> & pair_col(Jastrow_group::pair_col);
+  Array1 <int> & tab_pair(Jastrow_group::tab_pair);
+  Array1 <doublevar> & tab_r(Jastrow_group::tab_r);
+  Array2 <doublevar> & tab_val(Jastrow_group::tab_val);
+  Array2 <doublevar> & tab_dfr(Jastrow_group::tab_dfr);
+  Array2 <doublevar> & tab_lap(Jastrow_group::tab_lap);
+  tab_r.Resize(npairs);
+  tab_pair.Resize(npairs);
+  int nt=0;
+  doublevar range=table.isBuilt() ? table.range() : 0.0;
+  for(int p=0; p< npairs; p++) { 
+    int row=pair_row(p);
+    if(pair_R(row,0) < range) { 
+      tab_r(nt)=pair_R(row,0);
+      tab_pair(nt)=p;
+      nt++;
+    }
+    else { 
+      Array1 <doublevar> R(5);
+      Array2 <doublevar> lap(nf,5);
+      for(int d=0; d< 5; d++) R(d)=pair_R(row,d);
+      bas->calcLap(R,lap);
+      int col=pair_col(p);
+      for(int f=0; f< nf; f++) { 
+        for(int d=0; d< 5; d++) save(row,col+f,d)=lap(f,d);
+      }
+    }
+  }
+  if(nt==0) return;
+
+  tab_val.Resize(nf,nt);
+  tab_dfr.Resize(nf,nt);
+  tab_lap.Resize(nf,nt);
+  table.evaluate(nt, tab_r.v, tab_val, tab_dfr, tab_lap);
+  for(int t=0; t< nt; t++) { 
+    int p=tab_pair(t);
+    int row=pair_row(p);
+    const doublevar * R=pair_R.v+row*pair_R.step1;
+    doublevar * out=save.v+row*save.step1+pair_col(p)*save.step2;
+    for(int f=0; f< nf; f++) { 
+      doublevar dfr=tab_dfr(f,t);
+      out[0]=tab_val(f,t);
+      out[1]=dfr*R[2];
+      out[2]=dfr*R[3];
+      out[3]=dfr*R[4];
+      out[4]=tab_lap(f,t);
+      out+=save.step2;
+    }
+  }
+}
+
+//----------------------------------------------------------------------
+
 
 int Jastrow_group::writeinput(string & indent, ostream & os) {
   string indent2=indent+"  ";
@@ -417,6 +602,11 @@ int Jastrow_group::writeinput(string & indent, ostream & os) {
   if(optimize_basis) {
     os << indent << "OPTIMIZEBASIS" << endl;
   }
+  if(tabulate_basis) {
+    os << indent << "TABULATE_BASIS" << endl;
+    os << indent << "TABLE_SPACING " << table_spacing << endl;
+    os << indent << "TABLE_RANGE " << table_range << endl;
+  }
 
   if(has_one_body) {
     os << indent << "ONEBODY { " << endl;
@@ -465,6 +655,10 @@ int Jastrow_group::showinfo(string & indent, ostream & os) {
   if(optimize_basis) {
     os << indent << "Basis optimization turned on" << endl;
   }
+  if(tabulate_basis) {
+    os << indent << "Radial basis functions tabulated with spacing "
+       << table_spacing << " out to at most " << table_range << endl;
+  }
 
   if(has_one_body) {
     os << indent << "One-body terms " << endl;
@@ -645,6 +839,7 @@ void Jastrow_group::setVarParms(Array1 <doublevar> & parms) {
       }
       eebasis(b)->setVarParms(basisparms);
     }
+    if(tabulate_basis) buildTables();
   }
 
 
@@ -1581,11 +1776,30 @@ int Jastrow2_wf::getParmDeriv(Wavefunction_data *wfdata , Sample_point * sample,
   parm_deriv.val_gradient=0.0;
   
   for(int g=0; g< ng; g++) {
+    //The derivatives are taken with the analytic basis functions,
+    //not the tables
+    int analytic=parent->group(g).tabulateBasis();
+    Array4 <doublevar> eibasis_analytic;
+    if(analytic) { 
+      eibasis_analytic.Resize(nelectrons, parent->natoms, maxeibasis, 5);
+      Array3 <doublevar> eibasis(parent->natoms, maxeibasis, 5);
+      for(int e=0; e< nelectrons; e++) { 
+        parent->group(g).updateEIBasis(e,sample,eibasis,1);
+        for(int i=0; i< parent->natoms; i++) {
+          for(int j=0; j< maxeibasis; j++) {
+            for(int d=0; d< 5; d++) {
+              eibasis_analytic(e,i,j,d)=eibasis(i,j,d);
+            }
+          }
+        }
+      }
+    }
+    Array4 <doublevar> & eibasis_g=analytic ? eibasis_analytic : eibasis_save(g);
     
     if(parent->group(g).hasOneBody() and parent->group(g).one_body.nparms() > 0 ) {
       Parm_deriv_return tmp_parm;
       
-      parent->group(g).one_body.getParmDeriv(eibasis_save(g),tmp_parm);
+      parent->group(g).one_body.getParmDeriv(eibasis_g,tmp_parm);
       extend_parm_deriv(parm_deriv,tmp_parm);
     }
 
@@ -1593,7 +1807,7 @@ int Jastrow2_wf::getParmDeriv(Wavefunction_data *wfdata , Sample_point * sample,
     eetotal=-1;
     Array3 <doublevar> eebasis(nelectrons, maxeebasis, 5);
     for(int e=0; e< nelectrons; e++) { 
-      parent->group(g).updateEEBasis(e,sample, eebasis);
+      parent->group(g).updateEEBasis(e,sample, eebasis, analytic);
       for(int j=0; j< e; j++) { 
         for(int b=0; b< maxeebasis; b++) {
           for(int d=0; d< 5; d++) 
@@ -1609,7 +1823,7 @@ int Jastrow2_wf::getParmDeriv(Wavefunction_data *wfdata , Sample_point * sample,
 
     if(parent->group(g).hasThreeBody() and parent->group(g).three_body.nparms() > 0 ) {
       Parm_deriv_return tmp_parm;
-      parent->group(g).three_body.getParmDeriv(eibasis_save(g),eetotal,tmp_parm);
+      parent->group(g).three_body.getParmDeriv(eibasis_g,eetotal,tmp_parm);
       extend_parm_deriv(parm_deriv,tmp_parm);
     }
     
@@ -1656,7 +1870,8 @@ int Jastrow2_wf::get_twobody_ParmDeriv(Sample_point * sample,
       eetotal=-1;
       Array3 <doublevar> eebasis(nelectrons, maxeebasis, 5);
       for(int e=0; e< nelectrons; e++) { 
-        parent->group(g).updateEEBasis(e,sample,eebasis);
+        parent->group(g).updateEEBasis(e,sample,eebasis,
+                                       parent->group(g).tabulateBasis());
         for(int j=0; j< e; j++) { 
           for(int b=0; b< maxeebasis; b++) {
             eetotal(j,e,b)=eebasis(j,b,0);
@@ -1975,6 +2190,86 @@ void Jastrow2_wf::evalTestPos(Array1 <doublevar> & pos, Sample_point * sample,
   }
   
 }
+//--------------------------------------------------------------------------
+/*!
+  The change in U for each position is worked out as in updateVal(), 
+  from the basis functions of e at that position and the saved terms of
+  the other electrons, without storing anything.
+*/
+void Jastrow2_wf::evalVirtualMoves(Wavefunction_data * wfdata, 
+                                   Sample_point * sample, int e,
+                                   Array2 <doublevar> & pos,
+                                   Array1 <Wf_return> & ratio) { 
+  int npos=pos.GetDim(0);
+  if(ratio.GetDim(0) < npos) ratio.Resize(npos);
+  int ngroups=parent->group.GetDim(0);
+
+  doublevar old_eval=0;
+  for(int i=0; i< e; i++) old_eval+=two_body_save(i,e,0);
+  for(int j=e+1; j< nelectrons; j++) old_eval+=two_body_save(e,j,0);
+
+  Array3 <doublevar> & eibasis(vm_eibasis);
+  Array3 <doublevar> & eebasis(vm_eebasis);
+  Array3 <doublevar> & eibasis_tmp(vm_eibasis_tmp);
+  Array1 <doublevar> & newval_ee(vm_newval_ee);
+  eibasis.Resize(parent->natoms, maxeibasis, 5);
+  eebasis.Resize(nelectrons, maxeebasis, 5);
+  eibasis_tmp.Resize(parent->natoms, maxeibasis, 5);
+  newval_ee.Resize(nelectrons);
+  Array1 <doublevar> oldpos(3), r(3);
+  sample->getElectronPos(e,oldpos);
+  for(int p=0; p < npos; p++) { 
+    for(int d=0; d< 3; d++) r(d)=pos(p,d);
+    sample->setElectronPosNoNotify(e,r);
+    doublevar newval_ei=0;
+    newval_ee=0;
+    for(int g=0; g< ngroups; g++) { 
+      Jastrow_group & group=parent->group(g);
+      int threebody=group.hasThreeBody() || group.hasThreeBodySpin();
+      if(group.hasOneBody() || threebody) 
+        group.updateEIBasis(e,sample,eibasis);
+      if(group.hasOneBody()) 
+        group.one_body.updateVal(e,eibasis,newval_ei);
+      if(group.hasTwoBody() || threebody) 
+        group.updateEEBasis(e,sample,eebasis);
+      if(group.hasTwoBody()) 
+        group.two_body->updateVal(e,eebasis,newval_ee);
+
+      //The three-body terms take e's basis from eibasis_save
+      if(threebody) { 
+        for(int i=0; i< parent->natoms; i++) { 
+          for(int j=0; j< maxeibasis; j++) { 
+            for(int d=0; d< 5; d++) { 
+              eibasis_tmp(i,j,d)=eibasis_save(g)(e,i,j,d);
+              eibasis_save(g)(e,i,j,d)=eibasis(i,j,d);
+            }
+          }
+        }
+        if(group.hasThreeBody()) 
+          group.three_body.updateVal(e,eibasis_save(g),eebasis,newval_ee);
+        if(group.hasThreeBodySpin()) 
+          group.three_body_diffspin.updateVal(e,eibasis_save(g),eebasis,
+                                               newval_ee);
+        for(int i=0; i< parent->natoms; i++) { 
+          for(int j=0; j< maxeibasis; j++) { 
+            for(int d=0; d< 5; d++) 
+              eibasis_save(g)(e,i,j,d)=eibasis_tmp(i,j,d);
+          }
+        }
+      }
+    }
+    doublevar new_eval=0;
+    for(int j=0; j< nelectrons; j++) if(j!=e) new_eval+=newval_ee(j);
+    doublevar u=new_eval-old_eval+newval_ei-one_body_save(e,0);
+    ratio(p).Resize(1,1);
+    ratio(p).is_complex=0;
+    ratio(p).amp(0,0)=u;
+    ratio(p).phase(0,0)=0;
+    ratio(p).cvals(0,0)=u;
+  }
+  sample->setElectronPosNoNotify(e,oldpos);
+}
+
 //--------------------------------------------------------------------------
 void create_parm_deriv(const Array3 <doublevar> & func,
     const Array1 <doublevar> & coeff,
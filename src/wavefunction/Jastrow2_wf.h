@@ -31,6 +31,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "Wavefunction.h"
 #include "Wavefunction_data.h"
 #include "Basis_function.h"
+#include "Radial_table.h"
 
 //######################################################################
 
@@ -44,6 +45,7 @@ public:
     has_one_body=0;
     has_two_body=0;
     two_body=NULL;
+    tabulate_basis=0;
 
   }
 
@@ -61,8 +63,11 @@ public:
   }
 
   void set_up(vector <string> & words, System * sys);
-  void updateEIBasis(int e, Sample_point * sample, Array3 <doublevar> & );
-  void updateEEBasis(int e, Sample_point * sample, Array3 <doublevar> & );
+  //! With analytic, ignore the radial tables and call the basis functions
+  void updateEIBasis(int e, Sample_point * sample, Array3 <doublevar> &,
+                     int analytic=0);
+  void updateEEBasis(int e, Sample_point * sample, Array3 <doublevar> &,
+                     int analytic=0);
 
   int maxEIBasis() { return maxbasis_on_center; }
   int nEEBasis() { return n_eebasis; }
@@ -72,6 +77,7 @@ public:
   int hasThreeBody() { return has_three_body; } 
   int hasThreeBodySpin() { return has_three_body_diffspin; } 
   int optimizeBasis() { return optimize_basis; }
+  int tabulateBasis() { return tabulate_basis; }
   Jastrow_onebody_piece one_body;
   Jastrow_twobody_piece * two_body;
   Jastrow_threebody_piece three_body;
@@ -91,6 +97,9 @@ public:
 
 private:
   int check_consistency();
+  void buildTables();
+  void evalPairs(Basis_function * bas, Radial_table & table, int npairs,
+                 Array3 <doublevar> & save);
   vector <string> atomnames;
   
   int has_one_body;
@@ -120,6 +129,21 @@ private:
   int nelectrons;
   int n_spin_up;
 
+  //Tabulated radial functions
+  int tabulate_basis; //!< whether to evaluate radial basis functions from tables
+  doublevar table_spacing; //!< largest grid spacing of the tables
+  doublevar table_range; //!< tables stop here for functions with no cutoff
+  Array1 <Radial_table> eitable; //!< one per eibasis object
+  Array1 <Radial_table> eetable; //!< one per eebasis object
+  Array2 <int> eib_offset; //!< (atom, eibasis) first function, or -1 if not on the atom
+  //Scratch for evalPairs, per thread: the points are 
+  //pair_R(pair_row(p),[r,r^2,x,y,z]), and the results go to 
+  //save(pair_row(p),pair_col(p)+f,[val,grad,lap])
+  static QMC_THREAD_LOCAL Array2 <doublevar> pair_R;
+  static QMC_THREAD_LOCAL Array1 <int> pair_row, pair_col, tab_pair;
+  static QMC_THREAD_LOCAL Array1 <doublevar> tab_r;
+  static QMC_THREAD_LOCAL Array2 <doublevar> tab_val, tab_dfr, tab_lap;
+
 };
 
 //######################################################################
@@ -196,6 +220,9 @@ public:
   virtual void getForceBias(Wavefunction_data *, int, Wf_return &);
 
   virtual void evalTestPos(Array1 <doublevar> & pos, Sample_point * sample,Array1 <Wf_return> & wf);
+  virtual void evalVirtualMoves(Wavefunction_data *, Sample_point *, int e,
+                                Array2 <doublevar> & pos,
+                                Array1 <Wf_return> & ratio);
   
 
 
@@ -286,6 +313,10 @@ private:
   int maxeibasis;
   int maxeebasis;
 
+  //Scratch for evalVirtualMoves, per thread
+  static QMC_THREAD_LOCAL Array3 <doublevar> vm_eibasis, vm_eebasis, vm_eibasis_tmp;
+  static QMC_THREAD_LOCAL Array1 <doublevar> vm_newval_ee;
+
 };
 
 
@@ -144,6 +144,32 @@ void Slat_Jastrow::evalTestPos(Array1 <doublevar> & pos, Sample_point * sample,A
 
 
 
+void Slat_Jastrow::evalVirtualMoves(Wavefunction_data * wfdata, 
+                                    Sample_point * sample, int e,
+                                    Array2 <doublevar> & pos,
+                                    Array1 <Wf_return> & ratio) { 
+  Slat_Jastrow_data * dataptr;
+  recast(wfdata, dataptr);
+  assert(dataptr != NULL);
+  slater_wf->evalVirtualMoves(dataptr->slater,sample,e,pos,slat_ratio);
+  jastrow_wf->evalVirtualMoves(dataptr->jastrow,sample,e,pos,jast_ratio);
+  int npos=pos.GetDim(0);
+  if(ratio.GetDim(0) < npos) ratio.Resize(npos);
+  for(int p=0; p< npos; p++) { 
+    Wf_return & sr=slat_ratio(p);
+    Wf_return & jr=jast_ratio(p);
+    ratio(p).Resize(nfunc_,1);
+    ratio(p).is_complex=(sr.is_complex==1 || jr.is_complex==1);
+    for(int i=0; i< nfunc_; i++) { 
+      int j=(jr.amp.GetDim(0) > i)?i:0;
+      ratio(p).phase(i,0)=sr.phase(i,0)+jr.phase(j,0);
+      ratio(p).amp(i,0)=sr.amp(i,0)+jr.amp(j,0);
+      ratio(p).cvals(i,0)=ratio(p).amp(i,0);
+    }
+  }
+}
+
+
 void Slat_Jastrow::getSymmetricVal(Wavefunction_data * wfdata,
 			     int e, Wf_return & val){
 
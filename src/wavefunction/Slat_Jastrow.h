@@ -86,6 +86,9 @@ public:
   virtual void getForceBias(Wavefunction_data *, int, Wf_return &);
 
   virtual void evalTestPos(Array1 <doublevar> & pos, Sample_point * sample,Array1 <Wf_return> & wf);
+  virtual void evalVirtualMoves(Wavefunction_data *, Sample_point *, int e,
+                                Array2 <doublevar> & pos,
+                                Array1 <Wf_return> & ratio);
   
 
   virtual void generateStorage(Wavefunction_storage * & wfstore);
@@ -115,6 +118,7 @@ private:
   Wavefunction * slater_wf;
   Wavefunction * jastrow_wf;
   int nfunc_;
+  Array1 <Wf_return> slat_ratio, jast_ratio; //!< scratch for evalVirtualMoves()
 };
 
 #endif //SLAT_JASTROW_H_INCLUDED
@@ -54,6 +54,18 @@ public:
 
   int showinfo(ostream & os);
   int writeinput(string &, ostream &);
+  int threadSafe() { 
+    return slater->threadSafe() && jastrow->threadSafe();
+  }
+
+  void showStats(ostream & os) { 
+    slater->showStats(os);
+    jastrow->showStats(os);
+  }
+  void resetStats() { 
+    slater->resetStats();
+    jastrow->resetStats();
+  }
 
   void renormalize()
   {
@@ -49,9 +49,12 @@ private:
   // Added by Matous
   Array2 <T>  moVal_temp_2;
  
+  //Only needed for Clark updates and two-electron moves; otherwise
+  //the trial move never touches the inverse.
   Array3 < Array2 <T> > inverse_temp;
+  Array3 < Array2 <typename Single_precision<T>::type> > inverse_sp_temp;
   Array3 <log_value<T> > detVal_temp;
-
+  int ncommit_temp;
 };
 
 
@@ -66,7 +69,7 @@ template <class T> class Slat_wf : public  Wavefunction
 
 public:
 
-  Slat_wf()
+  Slat_wf():single_precision(0)
   {}
 
 
@@ -83,6 +86,9 @@ public:
   virtual void getVal(Wavefunction_data *, int, Wf_return &);
   virtual void getLap(Wavefunction_data *, int, Wf_return &);
   virtual void evalTestPos(Array1 <doublevar> & pos, Sample_point *, Array1 <Wf_return> & wf);
+  virtual void evalVirtualMoves(Wavefunction_data *, Sample_point *, int e,
+                                Array2 <doublevar> & pos,
+                                Array1 <Wf_return> & ratio);
 
   virtual void saveUpdate(Sample_point *, int e, Wavefunction_storage *);
   virtual void restoreUpdate(Sample_point *, int e, Wavefunction_storage *);
@@ -113,12 +119,27 @@ private:
   void updateInverse(Slat_wf_data *, int e);
   int updateValNoInverse(Slat_wf_data *, int e); 
   //!< update the value, but not the inverse.  Returns 0 if the determinant is zero and updates aren't possible
+  void trialMove(Slat_wf_data *, int e);
+  //!< update the values for a move of e, leaving the inverse update pending when possible
   
   void calcVal(Slat_wf_data *, Sample_point *);
   void updateVal(Slat_wf_data *, Sample_point *, int);
   void calcLap(Slat_wf_data *, Sample_point *);
   void updateLap(Slat_wf_data *, Sample_point *, int);
   void getDetLap(int e, Array3<log_value <T> > & vals );
+
+  //Delayed updates
+  void delayedInverseRow(int f, int det, int s, int r, Array1 <T> & q);
+  T delayedRatio(int f, int det, int s, int r, const Array1 <T> & u);
+  T delayedUpdate(int f, int det, int s, int r, const Array1 <T> & u);
+  void flushDelayed(int f, int det, int s);
+  void rebuildInverse(int s);
+
+  void updateClarkTable(int s);
+
+  //Single-precision inverses
+  log_value <T> invertMatrix(int f, int det, int s, Array2 <T> & mat);
+  void checkSinglePrecision(int f, int det, int s, int r);
   
 
   Array1 <int> electronIsStaleVal;
@@ -145,6 +166,32 @@ private:
 
   Array3 <log_value<T> > detVal; //function #, determinant #, spin
 
+  //Delayed updates: the current matrix differs from the one that 
+  //inverse was computed for by the rows in delayRow, which have been 
+  //replaced by the rows of delayU.  Everything is (function, determinant, spin).
+  int delay;                      //!< maximum number of buffered moves
+  Array3 <int> ndelay;            //!< number of buffered moves
+  Array3 < Array1 <int> > delayRow; //!< electron (within the spin channel) of each buffered move
+  Array3 < Array2 <T> > delayU;   //!< new rows of the matrix, in occupation order
+  Array3 < Array2 <T> > delayC;   //!< C(i,j)=delayU(i,:).inverse(delayRow(j),:)
+  Array3 < Array2 <T> > delayCinv; //!< transposed inverse of C
+  int ncommit; //!< counts changes to the inverses (including the buffers)
+  Array1 <T> delayq, delayy, delayz; //!< work vectors
+  Array2 <T> delayWork;
+
+  //Clark updates: the excitation table of the reference determinant
+  //(see Excitation_list::build_table), kept until the inverse changes.
+  Array1 < Array2 <T> > clarkTable; //!< holes x particles, per spin
+  Array1 < Array2 <T> > clarkMe;    //!< particle orbital values, per spin
+  Array1 <int> clarkTableValid;
+
+  //Single-precision inverses: inverse_sp replaces inverse, and is 
+  //recomputed in double precision when it drifts.
+  typedef typename Single_precision<T>::type Tsp;
+  int single_precision;
+  Array3 < Array2 <Tsp> > inverse_sp;
+  Array3 <int> spUpdates; //!< updates since the last recompute
+
 
   int nmo;        //!<Number of molecular orbitals
   int ndet;       //!<Number of determinants
@@ -201,17 +248,15 @@ inline void Slat_wf<T>::generateStorage(Wavefunction_storage * & wfstore)
   store->moVal_temp_2.Resize (5,   nmo);
 
   store->detVal_temp.Resize(nfunc_, ndet, 2);
-  store->inverse_temp.Resize(nfunc_, ndet, 2);
+  store->ncommit_temp=-1;
+  if(!parent->use_clark_updates) return;
+  store->inverse_temp.Resize(nfunc_, 1, 2);
   for(int i=0; i< nfunc_; i++)
   {
-    for(int det=0; det < ndet; det++)
+    for(int s=0; s<2; s++)
     {
-      for(int s=0; s<2; s++)
-      {
-        store->inverse_temp(i,det,s).Resize(nelectrons(s), nelectrons(s));
-        store->inverse_temp(i,det,s)=0;
-        //store->detVal_temp(i,det,s)=1;
-      }
+      store->inverse_temp(i,0,s).Resize(nelectrons(s), nelectrons(s));
+      store->inverse_temp(i,0,s)=0;
     }
   }
 }
@@ -256,14 +301,29 @@ template <class T> inline void Slat_wf<T>::init(Wavefunction_data * wfdata,
   detVal.Resize (nfunc_, ndet, 2);
   inverse.Resize(nfunc_, ndet, 2);
 
+  single_precision=dataptr->single_precision;
+  if(single_precision) { 
+    inverse_sp.Resize(nfunc_, ndet, 2);
+    spUpdates.Resize(nfunc_, ndet, 2);
+    spUpdates=0;
+  }
+
   for(int i=0; i< nfunc_; i++) {
     for(int det=0; det < ndet; det++) {
       for(int s=0; s<2; s++) {
-        inverse(i,det,s).Resize(nelectrons(s), nelectrons(s));
-        inverse(i,det,s)=0;
-        for(int e=0; e< nelectrons(s); e++) {
-          inverse(i,det,s)(e,e)=1;
-          inverse(i,det,s)(e,e)=1;
+        if(single_precision) { 
+          inverse_sp(i,det,s).Resize(nelectrons(s), nelectrons(s));
+          inverse_sp(i,det,s)=Tsp(0.0);
+          for(int e=0; e< nelectrons(s); e++) 
+            inverse_sp(i,det,s)(e,e)=Tsp(1.0);
+        }
+        else { 
+          inverse(i,det,s).Resize(nelectrons(s), nelectrons(s));
+          inverse(i,det,s)=0;
+          for(int e=0; e< nelectrons(s); e++) {
+            inverse(i,det,s)(e,e)=1;
+            inverse(i,det,s)(e,e)=1;
+          }
         }
 
         detVal(i,det,s)=T(1.0);
@@ -272,6 +332,30 @@ template <class T> inline void Slat_wf<T>::init(Wavefunction_data * wfdata,
   }
 
 
+  delay=dataptr->delay;
+  ndelay.Resize(nfunc_, ndet, 2);
+  ndelay=0;
+  ncommit=0;
+  clarkTable.Resize(2);
+  clarkMe.Resize(2);
+  clarkTableValid.Resize(2);
+  clarkTableValid=0;
+  if(delay > 1) { 
+    delayRow.Resize(nfunc_, ndet, 2);
+    delayU.Resize(nfunc_, ndet, 2);
+    delayC.Resize(nfunc_, ndet, 2);
+    delayCinv.Resize(nfunc_, ndet, 2);
+    for(int i=0; i< nfunc_; i++) {
+      for(int det=0; det < ndet; det++) {
+        for(int s=0; s<2; s++) {
+          delayRow(i,det,s).Resize(delay);
+          delayU(i,det,s).Resize(delay, nelectrons(s));
+          delayC(i,det,s).Resize(delay, delay);
+        }
+      }
+    }
+  }
+
   electronIsStaleVal.Resize(tote);
   electronIsStaleLap.Resize(tote);
 
@@ -333,8 +417,9 @@ template<class T>inline void Slat_wf<T>::saveUpdate(Sample_point * sample, int e
   Slat_wf_storage<T> * store;
   recast(wfstore, store);
   
-  //presumably, if we care enough to save the update, we care enough
-  //to have the inverse up to date
+  //Commit the last move.  After this, a trial move of e only changes 
+  //detVal and e's orbital values; the inverse is left alone until 
+  //the move is committed, so it doesn't need to be saved.
   if(inverseStale) {
     detVal=lastDetVal;
     updateInverse(parent, lastValUpdate);
@@ -342,17 +427,14 @@ template<class T>inline void Slat_wf<T>::saveUpdate(Sample_point * sample, int e
   }
   int s=spin(e);
   
-  int ndet_save=ndet;
-  if(parent->use_clark_updates) ndet_save=1;
   for(int f=0; f< nfunc_; f++) {
-    for(int det=0; det<ndet_save; det++) {
-      store->inverse_temp(f,det,s)=inverse(f,det,s);
-    }
+    if(parent->use_clark_updates) 
+      store->inverse_temp(f,0,s)=inverse(f,0,s);
     for(int det=0; det < ndet; det++) {
       store->detVal_temp(f,det,s)=detVal(f,det,s);
     }
   }
-  
+  store->ncommit_temp=ncommit;
   
   int norb=moVal.GetDim(2);
   for(int d=0; d< 5; d++) {
@@ -379,21 +461,20 @@ template<class T>inline void Slat_wf<T>::restoreUpdate(Sample_point * sample, in
       moVal(j,e,i)=store->moVal_temp(j,i);
     }
   }
-  int ndet_save=ndet;
-  if(parent->use_clark_updates) ndet_save=1;
   
   for(int f=0; f< nfunc_; f++) {
-    for(int det=0; det < ndet_save; det++) {
-      inverse(f,det,s)=store->inverse_temp(f,det,s);
-    }
+    if(parent->use_clark_updates) 
+      inverse(f,0,s)=store->inverse_temp(f,0,s);
     for(int det=0; det < ndet; det++) {
       detVal(f,det,s)=store->detVal_temp(f,det,s);
     }
   }
-  //It seems to be faster to update the inverse than to save it and
-  //recover it.  However, it complicates the implementation too much.
-  //For now, we'll disable it.
-  //updateInverse(parent,e);
+  //Something committed a move since saveUpdate(), so the inverse 
+  //has to be rebuilt.  This doesn't happen in the usual 
+  //move/accept/reject cycle.
+  if(!parent->use_clark_updates && store->ncommit_temp!=ncommit) 
+    rebuildInverse(s);
+  clarkTableValid(s)=0;
   
   electronIsStaleVal(e)=0;
   electronIsStaleLap(e)=0;
@@ -419,18 +500,29 @@ template <class T>inline void Slat_wf<T>::saveUpdate(Sample_point * sample, int
   
   int s1=spin(e1), s2=spin(e2);
   
+  //Moving the second electron commits the first one, so here the 
+  //inverses are saved (only the reference one with Clark updates).
+  int ninv=parent->use_clark_updates?1:ndet;
+  if(single_precision) { 
+    if(store->inverse_sp_temp.GetDim(1) < ninv) 
+      store->inverse_sp_temp.Resize(nfunc_, ninv, 2);
+  }
+  else if(store->inverse_temp.GetDim(1) < ninv) 
+    store->inverse_temp.Resize(nfunc_, ninv, 2);
   for(int f=0; f< nfunc_; f++) {
     for(int det=0; det<ndet; det++) {
-      if ( s1 == s2 ) {
-        store->inverse_temp(f,det,s1)=inverse(f,det,s1);
-        store->detVal_temp(f,det,s1)=detVal(f,det,s1);
+      flushDelayed(f,det,s1);
+      flushDelayed(f,det,s2);
+      if(det < ninv && single_precision) { 
+        store->inverse_sp_temp(f,det,s1)=inverse_sp(f,det,s1);
+        if(s1 != s2) store->inverse_sp_temp(f,det,s2)=inverse_sp(f,det,s2);
       }
-      else {
+      else if(det < ninv) { 
         store->inverse_temp(f,det,s1)=inverse(f,det,s1);
-        store->inverse_temp(f,det,s2)=inverse(f,det,s2);
-        store->detVal_temp(f,det,s1)=detVal(f,det,s1);
-        store->detVal_temp(f,det,s2)=detVal(f,det,s2);
+        if(s1 != s2) store->inverse_temp(f,det,s2)=inverse(f,det,s2);
       }
+      store->detVal_temp(f,det,s1)=detVal(f,det,s1);
+      if(s1 != s2) store->detVal_temp(f,det,s2)=detVal(f,det,s2);
     }
   }
   
@@ -464,20 +556,26 @@ template<class T> inline void Slat_wf<T>::restoreUpdate(Sample_point * sample, i
       moVal(j,e2,i)=store->moVal_temp_2(j,i);
     }
   }
+  int ninv=parent->use_clark_updates?1:ndet;
   for(int f=0; f< nfunc_; f++) {
     for(int det=0; det < ndet; det++) {
-      if ( s1 == s2 ) {
-		      inverse(f,det,s1)=store->inverse_temp(f,det,s1);
-		      detVal(f,det,s1)=store->detVal_temp(f,det,s1);
+      ndelay(f,det,s1)=0;
+      ndelay(f,det,s2)=0;
+      if(det < ninv && single_precision) { 
+        inverse_sp(f,det,s1)=store->inverse_sp_temp(f,det,s1);
+        if(s1 != s2) inverse_sp(f,det,s2)=store->inverse_sp_temp(f,det,s2);
       }
-      else {
-		      inverse(f,det,s1)=store->inverse_temp(f,det,s1);
-		      inverse(f,det,s2)=store->inverse_temp(f,det,s2);
-		      detVal(f,det,s1)=store->detVal_temp(f,det,s1);
-		      detVal(f,det,s2)=store->detVal_temp(f,det,s2);
+      else if(det < ninv) { 
+        inverse(f,det,s1)=store->inverse_temp(f,det,s1);
+        if(s1 != s2) inverse(f,det,s2)=store->inverse_temp(f,det,s2);
       }
+      detVal(f,det,s1)=store->detVal_temp(f,det,s1);
+      if(s1 != s2) detVal(f,det,s2)=store->detVal_temp(f,det,s2);
     }
   }
+  ncommit++;
+  clarkTableValid(s1)=0;
+  clarkTableValid(s2)=0;
   
   electronIsStaleVal(e1)=0;
   electronIsStaleLap(e1)=0;
@@ -687,6 +785,7 @@ template <class T>inline void Slat_wf<T>::updateInverse(Slat_wf_data * dataptr,
   int s=spin(e);
   int ndet_update=ndet;
   if(parent->use_clark_updates) ndet_update=1;
+  ncommit++;
   for(int f=0; f< nfunc_; f++)  {
     for(int det=0; det< ndet_update; det++)  {
       //fill the molecular orbitals for this
@@ -707,8 +806,8 @@ template <class T>inline void Slat_wf<T>::updateInverse(Slat_wf_data * dataptr,
 #endif
 
 
-        detVal(f,det,s)=
-          TransposeInverseMatrix(allmos,inverse(f,det,s), nelectrons(s));
+        detVal(f,det,s)=invertMatrix(f,det,s,allmos);
+        ndelay(f,det,s)=0;
 #ifdef SUPERDEBUG
         cout << "Slat_wf::updateInverse: near-zero determinant " 
           << " f " << f << " det " << det << " new det " << detVal(f,det,s).logval
@@ -717,6 +816,21 @@ template <class T>inline void Slat_wf<T>::updateInverse(Slat_wf_data * dataptr,
 
         
 
+      }
+      else if(delay > 1) { 
+        for(int i = 0; i < nelectrons(s); i++) {
+          modet(i)=moVal(0,e,dataptr->occupation(f,det,s)(i));
+        }
+        detVal(f,det,s)=delayedUpdate(f,det,s,rede(e),modet)*detVal(f,det,s);
+      }
+      else if(single_precision) { 
+        for(int i = 0; i < nelectrons(s); i++) {
+          modet(i)=moVal(0,e,dataptr->occupation(f,det,s)(i));
+        }
+        T ratio=1./MixedInverseUpdateColumn(inverse_sp(f,det,s),
+            modet, rede(e), nelectrons(s));
+        detVal(f,det, s)=ratio*detVal(f,det, s);
+        checkSinglePrecision(f,det,s,rede(e));
       }
       else { 
         for(int i = 0; i < nelectrons(s); i++) {
@@ -730,16 +844,10 @@ template <class T>inline void Slat_wf<T>::updateInverse(Slat_wf_data * dataptr,
       }
     }
     if(parent->use_clark_updates) { 
-
-      Array2 <T> M(nelectrons(s),updatedMoVal.GetDim(0));
-      for(int i=0; i< nelectrons(s); i++){ 
-        int elec=i+s*nelectrons(0);
-        for(int j=0; j< updatedMoVal.GetDim(0); j++) { 
-          M(i,j)=moVal(0,elec,j);
-        }
-      }
+      clarkTableValid(s)=0;
+      updateClarkTable(s);
       Array1 <T> ratios;
-      parent->excitations.clark_updates(inverse(0,0,s),M,s,ratios);
+      parent->excitations.table_ratios(clarkTable(s),s,ratios);
       for(int d=0; d< ndet; d++) { 
         detVal(0,d,s)=ratios(d)*detVal(0,0,s); 
       }
@@ -774,7 +882,12 @@ template <class T> inline int Slat_wf<T>::updateValNoInverse(Slat_wf_data * data
       }
       
       
-      T ratio=1./InverseGetNewRatio(inverse(f,det,s),
+      T ratio;
+      if(delay > 1) ratio=delayedRatio(f,det,s,rede(e),modet);
+      else if(single_precision) 
+        ratio=1./MixedInverseGetNewRatio(inverse_sp(f,det,s),
+                                         modet, rede(e), nelectrons(s));
+      else ratio=1./InverseGetNewRatio(inverse(f,det,s),
                                             modet, rede(e),
                                             nelectrons(s));
 #ifdef SUPERDEBUG
@@ -795,8 +908,30 @@ template <class T> inline int Slat_wf<T>::updateValNoInverse(Slat_wf_data * data
 
 //------------------------------------------------------------------------
 /*!
-
+  With Sherman-Morrison updates, the inverse is only updated when the 
+  move is committed: when another electron is updated or its 
+  gradient is needed, or at the next saveUpdate().  A rejected move 
+  (restoreUpdate()) then costs nothing.  The Clark updates need the 
+  new inverse for the determinant values, so they update it right away.
 */
+template <class T> inline void Slat_wf<T>::trialMove(Slat_wf_data * dataptr, int e) { 
+  inverseStale=1;
+  lastValUpdate=e;
+  lastDetVal=detVal;
+  if(!parent->use_clark_updates) { 
+    if(!updateValNoInverse(dataptr, e)) { 
+      inverseStale=0;
+      updateInverse(dataptr,e);
+    }
+  }
+  else { 
+    updateInverse(dataptr,e);
+    inverseStale=0;
+  } 
+}
+
+//------------------------------------------------------------------------
+
 template <class T> inline void Slat_wf<T>::updateVal( Slat_wf_data * dataptr, Sample_point * sample,int e) {
 
   if(inverseStale && lastValUpdate!=e) { 
@@ -820,20 +955,7 @@ template <class T> inline void Slat_wf<T>::updateVal( Slat_wf_data * dataptr, Sa
   for(int i=0; i< updatedMoVal.GetDim(0); i++)
     moVal(0,e,i)=updatedMoVal(i,0);
 
-
-  inverseStale=1;
-  lastValUpdate=e;
-  lastDetVal=detVal;
-  if(!parent->use_clark_updates) { 
-    if(!updateValNoInverse(dataptr, e)) { 
-      inverseStale=0;
-      updateInverse(dataptr,e);
-    }
-  }
-  else { 
-    updateInverse(dataptr,e);
-    inverseStale=0;
-  } 
+  trialMove(dataptr, e);
 //  for(int d=0; d< ndet; d++) { 
 //    cout << "orig " << detVal(0,d,s).val()  
 //       << " update " << ratios(d)*detVal(0,0,s).val()
@@ -893,6 +1015,9 @@ template <class T> inline void Slat_wf<T>::calcLap(Slat_wf_data * dataptr, Sampl
 {
   //cout << "calcLap " << endl;
   inverseStale=0;
+  ndelay=0;
+  ncommit++;
+  clarkTableValid=0;
   for(int e=0; e< nelectrons(0)+nelectrons(1); e++)  {
     int s=spin(e);
     sample->updateEIDist();
@@ -919,7 +1044,10 @@ template <class T> inline void Slat_wf<T>::calcLap(Slat_wf_data * dataptr, Sampl
   for(int f=0; f< nfunc_; f++)   {
     for(int det=0; det < ndet; det++ ) {
       for(int s=0; s< 2; s++ ) {
-
+        //With Clark updates only the reference determinant is inverted, 
+        //unless it is zero.
+        if(parent->use_clark_updates && f==0 && det > 0 
+           && real_qw(detVal(0,0,s).logval) > -1e200) continue;
 
         for(int e=0; e< nelectrons(s); e++) {
           int curre=s*nelectrons(0)+e;
@@ -933,8 +1061,7 @@ template <class T> inline void Slat_wf<T>::calcLap(Slat_wf_data * dataptr, Sampl
         }
         
         if(nelectrons(s) > 0) { 
-          detVal(f,det,s)=
-          TransposeInverseMatrix(modet,inverse(f,det,s), nelectrons(s));
+          detVal(f,det,s)=invertMatrix(f,det,s,modet);
         }
         else detVal(f,det,s)=T(1.0);
 #ifdef SUPERDEBUG
@@ -946,6 +1073,16 @@ template <class T> inline void Slat_wf<T>::calcLap(Slat_wf_data * dataptr, Sampl
       }
     }
   }
+  if(parent->use_clark_updates) { 
+    for(int s=0; s< 2; s++) { 
+      if(real_qw(detVal(0,0,s).logval) < -1e200) continue;
+      updateClarkTable(s);
+      Array1 <T> ratios;
+      parent->excitations.table_ratios(clarkTable(s),s,ratios);
+      for(int d=1; d< ndet; d++) 
+        detVal(0,d,s)=ratios(d)*detVal(0,0,s);
+    }
+  }
   //cout << "done " << endl;
 }
 
@@ -957,20 +1094,24 @@ template <class T> void Slat_wf<T>::getDetLap(int e, Array3<log_value <T> > &  v
   int s=spin(e);
   int opp=opspin(e);
 
-  //Prepare the matrices we need for the inverse.
-  //There is likely a way to do this via updates, but we'll
-  //leave it for now since it doesn't seem to cost too much.
-  Array2 <T> & lapvec=work2;
-  Array1 <T> tmplapvec(nelectrons(s));
+  //A pending move of another electron has to be committed.  If e 
+  //itself has a pending move, its row of the new inverse is the old 
+  //one divided by the ratio, so the gradients can be taken with the 
+  //old inverse and the old determinant values.
+  if(inverseStale && lastValUpdate!=e) { 
+    inverseStale=0;
+    detVal=lastDetVal;
+    updateInverse(parent, lastValUpdate);
+  }
+  Array3 <log_value<T> > & oldDetVal=inverseStale?lastDetVal:detVal;
+
+  //With Clark updates, the derivatives of all the determinants come 
+  //from the reference inverse and the excitation table.
   int n=moVal.GetDim(2);
+  Array1 <T> dmo;
   if(parent->use_clark_updates) { 
-    lapvec.Resize(nelectrons(s),n);
-    for(int e1=0; e1< nelectrons(s); e1++) {
-      int shift=e1+s*nelectrons(0);
-      for(int j=0; j< n; j++) {  
-        lapvec(e1,j)=moVal(0,shift,j);
-      }
-    }
+    updateClarkTable(s);
+    dmo.Resize(n);
   }
 
 
@@ -981,35 +1122,48 @@ template <class T> void Slat_wf<T>::getDetLap(int e, Array3<log_value <T> > &  v
 
       vals(f,det,0)=detvals(det);
     }
+
+    //With delayed updates, get the current row of each inverse first
+    Array2 <T> invrows;
+    if(delay > 1) { 
+      invrows.Resize(ndet, nelectrons(s));
+      for(int det=0; det < ndet; det++) { 
+        delayedInverseRow(f,det,s,rede(e),delayq);
+        for(int j=0; j<nelectrons(s); j++) invrows(det,j)=delayq(j);
+      }
+    }
     
     Array1 <log_value <T> > detgrads(ndet);
     for(int i=1; i< 5; i++) {
       if(!parent->use_clark_updates) {   //Sherman-Morrison updates
         for(int det=0; det < ndet; det++) {
           T temp=0;
-          for(int j=0; j<nelectrons(s); j++) {
-            temp+=moVal(i , e, parent->occupation(f,det,s)(j) )
-              *inverse(f,det,s)(rede(e), j);
+          if(delay > 1) { 
+            for(int j=0; j<nelectrons(s); j++) 
+              temp+=moVal(i , e, parent->occupation(f,det,s)(j) )*invrows(det,j);
+          }
+          else if(single_precision) { 
+            Array2 <Tsp> & inv=inverse_sp(f,det,s);
+            for(int j=0; j<nelectrons(s); j++) 
+              temp+=moVal(i , e, parent->occupation(f,det,s)(j) )
+                *T(inv(rede(e), j));
+          }
+          else { 
+            for(int j=0; j<nelectrons(s); j++) {
+              temp+=moVal(i , e, parent->occupation(f,det,s)(j) )
+                *inverse(f,det,s)(rede(e), j);
+            }
           }
           detgrads(det)=temp; 
-          detgrads(det)*=detVal(f,det,s);
+          detgrads(det)*=oldDetVal(f,det,s);
         }
       } //-------
       else {  //clark updates
-
-        Array2 <T> &  tmpinverse=work1;
-        tmpinverse=inverse(f,0,s);
-
-        for(int j=0; j< n; j++) 
-          lapvec(rede(e),j)=moVal(i,e,j);
-
-        for(int j=0; j< nelectrons(s); j++) 
-          tmplapvec(j)=lapvec(rede(e),parent->occupation(f,0,s)(j));
-
-        T baseratio=1.0/InverseUpdateColumn(tmpinverse,tmplapvec,
-            rede(e),nelectrons(s));
+        for(int j=0; j< n; j++) dmo(j)=moVal(i,e,j);
         Array1 <T> ratios;
-        parent->excitations.clark_updates(tmpinverse,lapvec,s,ratios);
+        T baseratio=parent->excitations.replace_row_ratios(inverse(f,0,s),
+            clarkTable(s),clarkMe(s),parent->occupation(f,0,s),
+            rede(e),dmo,s,ratios);
         detgrads(0)=baseratio*detVal(f,0,s);
         for(int d=1; d< ndet; d++) { 
           //detgrads(d)=baseratio*ratios(d)*detVal(f,0,s);
@@ -1090,7 +1244,81 @@ template <class T> inline void Slat_wf<T>::updateLap(Slat_wf_data * dataptr,
     for(int i=0; i< updatedMoVal.GetDim(0); i++)
       moVal(d,e,i)=updatedMoVal(i,d);
   
-  updateInverse(dataptr,e);
+  trialMove(dataptr,e);
+}
+
+//-------------------------------------------------------------------------
+
+/*!
+  The orbitals at all the positions come from one updateValBatch() 
+  call, and each determinant ratio is a dot product with a row of the
+  current inverse, as in updateValNoInverse().  
+*/
+template <class T> inline void Slat_wf<T>::evalVirtualMoves(
+    Wavefunction_data * wfdata, Sample_point * sample, int e, 
+    Array2 <doublevar> & pos, Array1 <Wf_return> & ratio) { 
+  
+  if(inverseStale) { 
+    inverseStale=0;
+    detVal=lastDetVal;
+    updateInverse(parent, lastValUpdate);
+  }
+
+  int npos=pos.GetDim(0);
+  if(ratio.GetDim(0) < npos) ratio.Resize(npos);
+  int s=spin(e);
+  int opp=opspin(e);
+
+  Array2 <T> movals(npos,nmo);
+  molecorb->updateValBatch(sample,e,s,pos,movals);
+
+  Array1 <log_value<T> > old_detVals(ndet), new_detVals(ndet);
+  Array1 <log_value<T> > old_total(nfunc_);
+  for(int f=0; f< nfunc_; f++) { 
+    for(int det=0; det< ndet; det++) 
+      old_detVals(det)=parent->detwt(det)*detVal(f,det,s)*detVal(f,det,opp);
+    old_total(f)=sum(old_detVals);
+  }
+  
+  Array1 <T> modet(nmo);
+  Array2 <log_value<T> > vals(nfunc_,1);
+  if(parent->use_clark_updates) updateClarkTable(s);
+  for(int p=0; p < npos; p++) { 
+    for(int f=0; f< nfunc_; f++) { 
+      if(!parent->use_clark_updates) { 
+        for(int det=0; det< ndet; det++)  {
+          for(int i = 0; i < nelectrons(s); i++) 
+            modet(i)=movals(p,parent->occupation(f,det,s)(i));
+          T detratio;
+          if(delay > 1) detratio=delayedRatio(f,det,s,rede(e),modet);
+          else if(single_precision) 
+            detratio=1./MixedInverseGetNewRatio(inverse_sp(f,det,s),
+                                                modet, rede(e), nelectrons(s));
+          else detratio=1./InverseGetNewRatio(inverse(f,det,s),
+                                              modet, rede(e), nelectrons(s));
+          new_detVals(det)=parent->detwt(det)*detVal(f,det,s);
+          new_detVals(det)*=detratio;
+          new_detVals(det)*=detVal(f,det,opp);
+        }
+      }
+      else { 
+        for(int j=0; j< nmo; j++) modet(j)=movals(p,j);
+        Array1 <T> ratios;
+        T baseratio=parent->excitations.replace_row_ratios(inverse(f,0,s),
+            clarkTable(s),clarkMe(s),parent->occupation(f,0,s),
+            rede(e),modet,s,ratios);
+        for(int d=0; d< ndet; d++) {
+          new_detVals(d)=parent->detwt(d)*detVal(f,0,s);
+          new_detVals(d)*=baseratio*ratios(d);
+          new_detVals(d)*=detVal(f,d,opp);
+        }
+      }
+      log_value<T> totval=sum(new_detVals);
+      vals(f,0).logval=totval.logval-old_total(f).logval;
+      vals(f,0).sign=totval.sign*old_total(f).sign;
+    }
+    ratio(p).setVals(vals);
+  }
 }
 
 //-------------------------------------------------------------------------
@@ -1134,7 +1362,12 @@ template <class T> inline void Slat_wf<T>::evalTestPos(Array1 <doublevar> & pos,
         for(int i = 0; i < nelectrons(s); i++) {
           modet(i)=movals(s)(parent->occupation(f,det,s)(i),0);
         }
-        T ratio=1./InverseGetNewRatio(inverse(f,det,s),
+        T ratio;
+        if(delay > 1) ratio=delayedRatio(f,det,s,rede(e),modet);
+        else if(single_precision) 
+          ratio=1./MixedInverseGetNewRatio(inverse_sp(f,det,s),
+                                           modet, rede(e), nelectrons(s));
+        else ratio=1./InverseGetNewRatio(inverse(f,det,s),
             modet, rede(e),
             nelectrons(s));
         new_detVals(det)=parent->detwt(det)*detVal(f,det,s);
@@ -1143,24 +1376,12 @@ template <class T> inline void Slat_wf<T>::evalTestPos(Array1 <doublevar> & pos,
       }
     }
     else { //Clark updates 
-      Array2 <T> & motmp=work1;
-      Array2 <T> & invtmp=work2;
-      invtmp=inverse(f,0,s);
-      int n=moVal.GetDim(2);
-      motmp.Resize(nelectrons(s),n);
-      for(int e1=0; e1< nelectrons(s); e1++) {
-        int shift=e1+s*nelectrons(0);
-        for(int j=0; j< n; j++) {  
-          motmp(e1,j)=moVal(0,shift,j);
-        }
-      }
-      for(int j=0; j< n; j++) motmp(rede(e),j)=movals(s)(j,0);
-      Array1 <T> tmpvec(nelectrons(s));
-      for(int j=0; j< nelectrons(s); j++) 
-        tmpvec(j)=movals(s)(parent->occupation(f,0,s)(j),0);
-      T baseratio=1.0/InverseUpdateColumn(invtmp,tmpvec,rede(e),nelectrons(s));
+      updateClarkTable(s);
+      for(int j=0; j< nmo; j++) modet(j)=movals(s)(j,0);
       Array1 <T> ratios;
-      parent->excitations.clark_updates(invtmp,motmp,s,ratios);
+      T baseratio=parent->excitations.replace_row_ratios(inverse(f,0,s),
+          clarkTable(s),clarkMe(s),parent->occupation(f,0,s),
+          rede(e),modet,s,ratios);
       for(int d=0; d< ndet; d++) {
         new_detVals(d)=parent->detwt(d)*detVal(f,0,s);
         new_detVals(d)*=baseratio*ratios(d);
@@ -1178,6 +1399,230 @@ template <class T> inline void Slat_wf<T>::evalTestPos(Array1 <doublevar> & pos,
 
 }
 
+//----------------------------------------------------------------------
+//Delayed updates.  After k moves of distinct electrons r_1..r_k, with 
+//new rows u_i, the inverse of the current matrix is given by the 
+//Woodbury formula in terms of the stored inverse and the k x k matrix 
+//C(i,j)=u_i.inverse(r_j,:), so ratios and gradients cost O(kN) and 
+//the stored inverse is only updated when the buffer is full.
+//See McDaniel, Fahy, et al, J. Chem. Phys. 147, 174107 (2017).
+
+/*!
+  Row r of the (transposed) inverse of the current matrix.
+ */
+template <class T> inline void Slat_wf<T>::delayedInverseRow(int f, int det, 
+    int s, int r, Array1 <T> & q) { 
+  Array2 <T> & inv=inverse(f,det,s);
+  int n=nelectrons(s);
+  int nb=ndelay(f,det,s);
+  q.Resize(n);
+  for(int j=0; j< n; j++) q(j)=inv(r,j);
+  if(nb==0) return;
+
+  Array2 <T> & U=delayU(f,det,s);
+  Array2 <T> & cinv=delayCinv(f,det,s);
+  Array1 <int> & rows=delayRow(f,det,s);
+  delayy.Resize(nb);
+  delayz.Resize(nb);
+  for(int j=0; j< nb; j++) { 
+    T dot=0;
+    for(int m=0; m< n; m++) dot+=U(j,m)*q(m);
+    if(rows(j)==r) dot-=T(1.0);
+    delayy(j)=dot;
+  }
+  for(int i=0; i< nb; i++) { 
+    T dot=0;
+    for(int j=0; j< nb; j++) dot+=cinv(j,i)*delayy(j);
+    delayz(i)=dot;
+  }
+  for(int i=0; i< nb; i++) { 
+    for(int m=0; m< n; m++) q(m)-=delayz(i)*inv(rows(i),m);
+  }
+}
+
+//----------------------------------------------------------------------
+
+/*!
+  Ratio of the determinant with row r replaced by u to the current one.
+ */
+template <class T> inline T Slat_wf<T>::delayedRatio(int f, int det, 
+    int s, int r, const Array1 <T> & u) { 
+  delayedInverseRow(f,det,s,r,delayq);
+  T ratio=0;
+  for(int m=0; m< nelectrons(s); m++) ratio+=u(m)*delayq(m);
+  return ratio;
+}
+
+//----------------------------------------------------------------------
+
+/*!
+  Replace row r with u in the buffer, flushing it first if it is full.
+  Returns the ratio of the new determinant to the old one.
+ */
+template <class T> inline T Slat_wf<T>::delayedUpdate(int f, int det, 
+    int s, int r, const Array1 <T> & u) { 
+  int n=nelectrons(s);
+  Array1 <int> & rows=delayRow(f,det,s);
+  int nb=ndelay(f,det,s);
+  int i=0;
+  while(i < nb && rows(i)!=r) i++;
+  if(i==nb && nb==delay) { 
+    flushDelayed(f,det,s);
+    nb=i=0;
+  }
+  T ratio=delayedRatio(f,det,s,r,u);
+
+  Array2 <T> & inv=inverse(f,det,s);
+  Array2 <T> & U=delayU(f,det,s);
+  Array2 <T> & C=delayC(f,det,s);
+  for(int m=0; m< n; m++) U(i,m)=u(m);
+  if(i==nb) { 
+    rows(i)=r;
+    nb++;
+    ndelay(f,det,s)=nb;
+    for(int a=0; a< i; a++) { 
+      T dot=0;
+      for(int m=0; m< n; m++) dot+=U(a,m)*inv(r,m);
+      C(a,i)=dot;
+    }
+  }
+  for(int b=0; b< nb; b++) { 
+    T dot=0;
+    for(int m=0; m< n; m++) dot+=u(m)*inv(rows(b),m);
+    C(i,b)=dot;
+  }
+
+  delayWork.Resize(nb,nb);
+  for(int a=0; a< nb; a++) 
+    for(int b=0; b< nb; b++) delayWork(a,b)=C(a,b);
+  delayCinv(f,det,s).Resize(nb,nb);
+  TransposeInverseMatrix(delayWork, delayCinv(f,det,s), nb);
+  return ratio;
+}
+
+//----------------------------------------------------------------------
+
+template <class T> inline void Slat_wf<T>::flushDelayed(int f, int det, int s) { 
+  if(ndelay(f,det,s)==0) return;
+  InverseUpdateColumns(inverse(f,det,s), delayU(f,det,s), delayRow(f,det,s),
+                       delayCinv(f,det,s), ndelay(f,det,s), nelectrons(s));
+  ndelay(f,det,s)=0;
+}
+
+//----------------------------------------------------------------------
+
+/*!
+  Rebuild the inverses and determinant values for spin s from the 
+  orbital values.
+ */
+template <class T> inline void Slat_wf<T>::rebuildInverse(int s) { 
+  int n=nelectrons(s);
+  Array2 <T> allmos(n,n);
+  for(int f=0; f< nfunc_; f++) { 
+    for(int det=0; det < ndet; det++) { 
+      for(int e=0; e< n; e++) {
+        int curre=s*nelectrons(0)+e;
+        for(int i=0; i< n; i++) 
+          allmos(e,i)=moVal(0,curre, parent->occupation(f,det,s)(i));
+      }
+      if(n > 0) 
+        detVal(f,det,s)=invertMatrix(f,det,s,allmos);
+      ndelay(f,det,s)=0;
+    }
+  }
+  ncommit++;
+  clarkTableValid(s)=0;
+}
+
+//----------------------------------------------------------------------
+/*!
+  Build the excitation table for spin s from the reference inverse, if 
+  it is out of date.
+ */
+template <class T> inline void Slat_wf<T>::updateClarkTable(int s) { 
+  if(clarkTableValid(s)) return;
+  int n=moVal.GetDim(2);
+  Array2 <T> & M=work1;
+  M.Resize(nelectrons(s),n);
+  for(int i=0; i< nelectrons(s); i++){ 
+    int elec=i+s*nelectrons(0);
+    for(int j=0; j< n; j++) { 
+      M(i,j)=moVal(0,elec,j);
+    }
+  }
+  parent->excitations.build_table(inverse(0,0,s),M,s,clarkTable(s),clarkMe(s));
+  clarkTableValid(s)=1;
+}
+
+
+//----------------------------------------------------------------------
+/*!
+  Invert mat (the orbital values of determinant det) into the inverse, 
+  in double precision, and return the determinant.
+ */
+template <class T> inline log_value <T> Slat_wf<T>::invertMatrix(int f, 
+    int det, int s, Array2 <T> & mat) { 
+  int n=nelectrons(s);
+  if(!single_precision) 
+    return TransposeInverseMatrix(mat,inverse(f,det,s),n);
+  Array2 <T> & inv=work1;
+  inv.Resize(n,n);
+  log_value <T> d=TransposeInverseMatrix(mat,inv,n);
+  Array2 <Tsp> & invsp=inverse_sp(f,det,s);
+  for(int i=0; i< n; i++) 
+    for(int j=0; j< n; j++) invsp(i,j)=Tsp(inv(i,j));
+  spUpdates(f,det,s)=0;
+  return d;
+}
+
+//----------------------------------------------------------------------
+/*!
+  Drift control for the single-precision inverses, after row r was 
+  updated.  A full residual A*inverse-1 costs O(N^3), so each update 
+  checks one row k of it, cycling through the rows: the diagonal 
+  element and the element in the updated column.  Together with the 
+  periodic recompute this costs O(N) per update.
+ */
+template <class T> inline void Slat_wf<T>::checkSinglePrecision(int f, 
+    int det, int s, int r) { 
+  int n=nelectrons(s);
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+  parent->nspUpdate++;
+  int nupdate=++spUpdates(f,det,s);
+  int k=nupdate%n;
+  Array2 <Tsp> & inv=inverse_sp(f,det,s);
+  Array1 <int> & occ=parent->occupation(f,det,s);
+  int ek=s*nelectrons(0)+k, er=s*nelectrons(0)+r;
+  T diag=T(0.0), off=T(0.0);
+  for(int i=0; i< n; i++) { 
+    diag+=moVal(0,ek,occ(i))*T(inv(k,i));
+    off+=moVal(0,er,occ(i))*T(inv(k,i));
+  }
+  doublevar resid=abs(diag-T(1.0));
+  if(k!=r) resid+=abs(off);
+  bool residual=resid > parent->sp_tolerance;
+  if(residual || nupdate >= parent->sp_recompute) { 
+    Array2 <T> allmos(n,n);
+    for(int e=0; e< n; e++) {
+      int curre=s*nelectrons(0)+e;
+      for(int i=0; i< n; i++) 
+        allmos(e,i)=moVal(0,curre,occ(i));
+    }
+    detVal(f,det,s)=invertMatrix(f,det,s,allmos);
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+    parent->nspRecompute++;
+    if(residual) { 
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+      parent->nspResidual++;
+    }
+  }
+}
 
 //----------------------------------------------------------------------
 #endif //SLAT_WF_H_INCLUDED
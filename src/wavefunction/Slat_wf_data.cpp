@@ -141,6 +141,16 @@ void Slat_wf_data::read(vector <string> & words, unsigned int & pos,
     if(optimize_mo) error("Can't optimize MO's with complex MO's");
     if(optimize_det) 
       error("Don't support optimizing determinants with complex MO's yet");
+    //When time-reversal symmetry makes the orbitals real, evaluate them
+    //and the determinants as real.  cmolecorb is kept for writeinput().
+    keep_complex=haskeyword(words, pos=startpos, "KEEP_COMPLEX");
+    if(!keep_complex && cmolecorb->realEquivalent(mowords, sys, molecorb)) {
+      single_write(cout, "Complex orbitals are real by time-reversal symmetry;"
+                   " using real orbitals and determinants\n");
+      genmolecorb=molecorb;
+      use_complexmo=0;
+      real_from_complex=1;
+    }
   }
   else {
     error("Need ORBITALS or CORBITALS section in SLATER wave function");
@@ -293,13 +303,49 @@ void Slat_wf_data::read(vector <string> & words, unsigned int & pos,
     use_clark_updates=true;
   }
   else { use_clark_updates=false; } 
-  if(haskeyword(words,pos=startpos,"CLARK_UPDATES")) { 
+  int explicit_clark=haskeyword(words,pos=startpos,"CLARK_UPDATES");
+  if(explicit_clark) { 
     use_clark_updates=true;
   }
   else if(haskeyword(words,pos=startpos,"SHERMAN_MORRISON_UPDATES")) { 
     use_clark_updates=false;
   }
 
+  if(!readvalue(words,pos=startpos,delay,"DELAYED_UPDATE"))
+    delay=1;
+  if(delay < 1) 
+    error("DELAYED_UPDATE must be at least 1");
+  //The multideterminant updates work directly on the inverse of the 
+  //reference determinant, so they don't buffer moves.
+  if(use_clark_updates && delay > 1) { 
+    if(explicit_clark)
+      error("DELAYED_UPDATE can't be used with CLARK_UPDATES");
+    single_write(cout,"**Warning** DELAYED_UPDATE is ignored with the ",
+                 "multideterminant updates; add SHERMAN_MORRISON_UPDATES ",
+                 "to use it\n");
+    delay=1;
+  }
+
+  single_precision=haskeyword(words,pos=startpos,"SINGLE_PRECISION_INVERSE");
+  if(single_precision) { 
+    if(use_clark_updates) { 
+      if(explicit_clark)
+        error("SINGLE_PRECISION_INVERSE can't be used with CLARK_UPDATES");
+      single_write(cout,"**Warning** SINGLE_PRECISION_INVERSE is ignored with ",
+                   "the multideterminant updates; add ",
+                   "SHERMAN_MORRISON_UPDATES to use it\n");
+      single_precision=0;
+    }
+    else if(delay > 1)
+      error("SINGLE_PRECISION_INVERSE can't be used with DELAYED_UPDATE");
+  }
+  if(!readvalue(words,pos=startpos,sp_recompute,"RECOMPUTE_INVERSE"))
+    sp_recompute=1000;
+  if(!readvalue(words,pos=startpos,sp_tolerance,"INVERSE_TOLERANCE"))
+    sp_tolerance=1e-4;
+  if(sp_recompute < 1)
+    error("RECOMPUTE_INVERSE must be at least 1");
+
 
 
   //molecorb->buildLists(totoccupation);
@@ -410,6 +456,11 @@ int Slat_wf_data::showinfo(ostream & os)
     os << "Using fast updates for multideterminants.  Reference: \n";
     os << "Clark, Morales, McMinis, Kim, and Scuseria. J. Chem. Phys. 135 244105 (2011)\n";
   }
+  if(delay > 1) 
+    os << "Delayed updates of the inverse every " << delay << " moves" << endl;
+  if(single_precision) 
+    os << "Single-precision inverses, recomputed every " << sp_recompute 
+       << " updates or at a residual of " << sp_tolerance << endl;
 
   for(int f=0; f< nfunc; f++) {
     if(nfunc > 1)
@@ -435,11 +486,22 @@ int Slat_wf_data::showinfo(ostream & os)
   }
 
   os << "Molecular Orbital object : ";
+  if(real_from_complex) 
+    os << "complex orbitals evaluated as real (time-reversal symmetry)" << endl;
   genmolecorb->showinfo(os);
 
   return 1;
 }
 
+//----------------------------------------------------------------------
+
+void Slat_wf_data::showStats(ostream & os) { 
+  if(!single_precision || nspUpdate==0) return;
+  os << "Single-precision inverse updates " << nspUpdate 
+     << " recomputed " << nspRecompute << " (" << nspResidual 
+     << " by the residual check)" << endl;
+}
+
 
 //----------------------------------------------------------------------
 
@@ -463,8 +525,17 @@ int Slat_wf_data::writeinput(string & indent, ostream & os) {
     os << indent << "CLARK_UPDATES" << endl;
   else 
     os << indent << "SHERMAN_MORRISON_UPDATES" << endl;
+  if(delay > 1)
+    os << indent << "DELAYED_UPDATE " << delay << endl;
+  if(single_precision) { 
+    os << indent << "SINGLE_PRECISION_INVERSE" << endl;
+    os << indent << "RECOMPUTE_INVERSE " << sp_recompute << endl;
+    os << indent << "INVERSE_TOLERANCE " << sp_tolerance << endl;
+  }
   if(!sort)
     os << indent << "NOSORT" << endl;
+  if(keep_complex)
+    os << indent << "KEEP_COMPLEX" << endl;
 
 
 
@@ -581,10 +652,11 @@ int Slat_wf_data::writeinput(string & indent, ostream & os) {
     tmp.close();
   }
 
-  if(use_complexmo) os << indent << "CORBITALS { \n";
+  if(use_complexmo || real_from_complex) os << indent << "CORBITALS { \n";
   else os << indent << "ORBITALS {\n";
   string indent2=indent+"  ";
-  genmolecorb->writeinput(indent2, os);
+  if(real_from_complex) cmolecorb->writeinput(indent2, os);
+  else genmolecorb->writeinput(indent2, os);
   os << indent << "}\n";
 
   return 1;
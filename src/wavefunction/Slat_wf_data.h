@@ -63,6 +63,19 @@ will be added to the vector in order.
 <li>
 <b> NSPIN </b>  Override the global parameter.
 </li>
+<li>
+<b> DELAYED_UPDATE </b> Buffer this many accepted moves per spin channel
+before updating the inverse with one matrix-matrix product.  Not 
+available with the multideterminant (CLARK_UPDATES) updates, which are 
+the default for more than one determinant and more than 10 electrons.
+</li>
+<li>
+<b> SINGLE_PRECISION_INVERSE </b> Store and update the inverses in single 
+precision.  They are recomputed in double precision every 
+RECOMPUTE_INVERSE updates (default 1000), or when a row of the residual 
+A*inverse-1 is larger than INVERSE_TOLERANCE (default 1e-4).  Like 
+DELAYED_UPDATE, it needs the single-determinant updates.
+</li>
 </ul>
 
  */
@@ -70,11 +83,17 @@ class Slat_wf_data : public Wavefunction_data
 {
 public:
 
-  Slat_wf_data():molecorb(NULL) {}
+  Slat_wf_data():molecorb(NULL) { 
+    cmolecorb=NULL;
+    keep_complex=0;
+    real_from_complex=0;
+    resetStats();
+  }
 
   ~Slat_wf_data()
   {
     if(molecorb != NULL ) delete molecorb;
+    if(cmolecorb != NULL ) delete cmolecorb;
   }
 
 
@@ -99,6 +118,10 @@ public:
 
 
   int showinfo(ostream & os);
+  void showStats(ostream & os);
+  void resetStats() { 
+    nspUpdate=nspRecompute=nspResidual=0;
+  }
 
   int writeinput(string &, ostream &);
 
@@ -145,8 +168,15 @@ private:
   MO_matrix * molecorb;
   int use_complexmo;
   bool use_clark_updates; //!<Use Bryan Clark's updates.
+  int delay; //!< number of moves buffered before the inverse is updated
+  int single_precision; //!< keep the inverses in single precision
+  int sp_recompute; //!< updates between double-precision recomputes of the inverse
+  doublevar sp_tolerance; //!< residual that forces a recompute of the inverse
+  long int nspUpdate, nspRecompute, nspResidual; //!< single-precision statistics
   Excitation_list excitations;
   Complex_MO_matrix * cmolecorb;
+  int keep_complex; //!< don't replace CORBITALS with real orbitals
+  int real_from_complex; //!< molecorb evaluates the CORBITALS as real orbitals
 
 };
 
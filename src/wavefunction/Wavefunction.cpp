@@ -148,6 +148,40 @@ void Wavefunction::getForceBias(Wavefunction_data * wfdata, int e,
 
 //----------------------------------------------------------------------
 
+void Wavefunction::evalVirtualMoves(Wavefunction_data * wfdata,
+                                    Sample_point * sample, int e,
+                                    Array2 <doublevar> & pos,
+                                    Array1 <Wf_return> & ratio) { 
+  int nwf=nfunc();
+  int npos=pos.GetDim(0);
+  if(ratio.GetDim(0) < npos) ratio.Resize(npos);
+  Wf_return oldval(nwf,2), newval(nwf,2);
+  getVal(wfdata,e,oldval);
+
+  Storage_container store;
+  store.initialize(sample,this);
+  store.saveUpdate(sample,this,e);
+  Array1 <doublevar> r(3), oldpos(3);
+  sample->getElectronPos(e,oldpos);
+  for(int p=0; p < npos; p++) { 
+    for(int d=0; d< 3; d++) r(d)=pos(p,d);
+    sample->setElectronPos(e,r);
+    updateVal(wfdata,sample);
+    getVal(wfdata,e,newval);
+    ratio(p).Resize(nwf,1);
+    ratio(p).is_complex=newval.is_complex;
+    for(int w=0; w< nwf; w++) { 
+      ratio(p).amp(w,0)=newval.amp(w,0)-oldval.amp(w,0);
+      ratio(p).phase(w,0)=newval.phase(w,0)-oldval.phase(w,0);
+      ratio(p).cvals(w,0)=ratio(p).amp(w,0);
+    }
+  }
+  sample->setElectronPos(e,oldpos);
+  store.restoreUpdate(sample,this,e);
+}
+
+//----------------------------------------------------------------------
+
 
 
 int deallocate(Wavefunction * & wfptr)
@@ -162,6 +162,22 @@ public:
     error("evalTestPos() not implemented for this wave function");
   }
 
+  /*!
+    \brief
+    Ratios of the wave function with electron e moved to each of the
+    positions in pos (position, [x y z]) to its current value.
+
+    ratio(p) holds the logarithm of the ratio in the value part, in
+    the same form as getVal(), so the ratios of a product of wave
+    functions add.  The wave function must be up to date 
+    (updateVal()); neither it nor the sample is changed.  The default 
+    moves the electron to each position in turn and restores it 
+    afterwards.
+   */
+  virtual void evalVirtualMoves(Wavefunction_data *, Sample_point *, int e,
+                                Array2 <doublevar> & pos,
+                                Array1 <Wf_return> & ratio);
+
   /*!
     \brief
     Calculate the derivatives with respect to the parameters of
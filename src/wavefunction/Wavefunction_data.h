@@ -130,6 +130,20 @@ public:
    */
   virtual int writeinput(string &, ostream &)=0;
 
+  /*!
+    Whether the Wavefunction objects generated by this can be
+    evaluated from several threads at once.  If not, each thread
+    needs its own copy of the data.
+   */
+  virtual int threadSafe() { return 1; }
+
+  /*!
+    Print and reset the statistics that the Wavefunction objects 
+    accumulated in this data object, once per block.
+   */
+  virtual void showStats(ostream & os) {}
+  virtual void resetStats() {}
+
   virtual void generateWavefunction(Wavefunction * &)=0;
 
   virtual ~Wavefunction_data()
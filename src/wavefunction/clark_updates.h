@@ -36,6 +36,13 @@ class Excitation_list {
      void build_excitation_list(Array3 <Array1 <int> > & occupation,int f);//(function,det,spin) (orb #) )
      template <class T> void clark_updates(Array2 <T> & ginv, Array2 <T> & M,
          int s, Array1 <T> & ratios);
+     template <class T> void build_table(Array2 <T> & ginv, Array2 <T> & M,
+         int s, Array2 <T> & tmat, Array2 <T> & Me);
+     template <class T> void table_ratios(Array2 <T> & tmat, int s, 
+         Array1 <T> & ratios);
+     template <class T> T replace_row_ratios(Array2 <T> & ginv, 
+         Array2 <T> & tmat, Array2 <T> & Me, Array1 <int> & occ, 
+         int r, Array1 <T> & newrow, int s, Array1 <T> & ratios);
   private:
      Array1 <Excitation> excitations;
      Array1 <Excitation> remap;
@@ -46,28 +53,49 @@ class Excitation_list {
 
 template <class T> void Excitation_list::clark_updates(Array2 <T> & ginv, Array2 <T> & M,
      int s, Array1 <T> & ratios) { 
-  int ne=M.GetDim(0);
-  int nex=excitations.GetDim(0);
-
-  Array2 <T>  tmat,detmat;
+  Array2 <T> tmat, Me;
+  build_table(ginv,M,s,tmat,Me);
+  table_ratios(tmat,s,ratios);
+}
 
-  tmat.Resize(allg[s].size(),alle[s].size());
-  int counti=0;
-  for(vector<int>::iterator gi=allg[s].begin(); gi!=allg[s].end(); gi++) { 
-    int countj=0;
-    for(vector <int>::iterator ei=alle[s].begin(); ei!=alle[s].end(); ei++) { 
-      int i=*gi;
-      int j=*ei;
+//---------
+/*!
+  The table tmat(g,e)=sum_k ginv(k,g)*M(k,e) over the holes g and particles e 
+  of spin s, where ginv is the (transposed) inverse of the reference 
+  determinant and M(electron,orbital) holds all the orbital values.  Me 
+  gets the columns of M for the particles, which replace_row_ratios() needs.
+*/
+template <class T> void Excitation_list::build_table(Array2 <T> & ginv, Array2 <T> & M,
+     int s, Array2 <T> & tmat, Array2 <T> & Me) { 
+  int ne=M.GetDim(0);
+  int ng=allg[s].size();
+  int np=alle[s].size();
+  tmat.Resize(ng,np);
+  Me.Resize(ne,np);
+  for(int e=0; e< ne; e++) { 
+    for(int j=0; j< np; j++) 
+      Me(e,j)=M(e,alle[s][j]);
+  }
+  for(int i=0; i< ng; i++) { 
+    int g=allg[s][i];
+    for(int j=0; j< np; j++) { 
       T dot=0.0;
       for(int e=0; e< ne; e++) {
-        dot+=ginv(e,i)*M(e,j);
+        dot+=ginv(e,g)*Me(e,j);
       }
-//      cout << "tmat " << i << " " << j << " : " << dot << endl;
-      tmat(counti,countj)=dot;
-      countj++;
+      tmat(i,j)=dot;
     }
-    counti++;
   }
+}
+
+//---------
+/*!
+  Ratios of all the determinants to the reference one, from the table.
+*/
+template <class T> void Excitation_list::table_ratios(Array2 <T> & tmat, 
+    int s, Array1 <T> & ratios) { 
+  int nex=excitations.GetDim(0);
+  Array2 <T> detmat;
     
   ratios.Resize(nex);
   ratios=T(1.0);
@@ -96,22 +124,46 @@ template <class T> void Excitation_list::clark_updates(Array2 <T> & ginv, Array2
         ratios(ex)=Determinant(detmat,n)*T(excitations(ex).sign(s));
         break;
     }
-    //if(n==0) { }  //do nothing
-    //else if(n==1) { 
-    //  ratios(ex)=T(excitations(ex).sign(s))*tmat(g(0),e(0));
-    //}
-    //else  { 
-    //  detmat.Resize(n,n);
-    //  for(int i=0; i < n; i++ ) { 
-    //    for(int j=0; j < n; j++) { 
-    //      detmat(i,j)=tmat(g(i),e(j));
-    //    }
-    //  }
-    //  ratios(ex)=Determinant(detmat,n)*T(excitations(ex).sign(s));
-    //}
   }
 
 }
 
+//---------
+/*!
+  Replace row r of the matrix by newrow (the values of all the orbitals, 
+  or their derivatives) and get the determinant ratios without touching 
+  the inverse.  With c=ginv(r,:) and w=ginv*newrow(occ), the table of the new 
+  matrix is the rank-1 update
+  tmat'(g,e)=tmat(g,e)+c(g)*(newrow(e)-sum_k w(k)*M(k,e))/(c.newrow(occ)),
+  so the cost is O(N^2+N*np+ng*np) plus the small determinants, instead of 
+  updating an N x N inverse and rebuilding the table.
+  Returns the ratio of the new reference determinant to the old one; ratios 
+  are relative to the new reference determinant, as in clark_updates().
+*/
+template <class T> T Excitation_list::replace_row_ratios(Array2 <T> & ginv, 
+    Array2 <T> & tmat, Array2 <T> & Me, Array1 <int> & occ, 
+    int r, Array1 <T> & newrow, int s, Array1 <T> & ratios) { 
+  int ne=ginv.GetDim(0);
+  int ng=allg[s].size();
+  int np=alle[s].size();
+  Array1 <T> w(ne);
+  for(int k=0; k< ne; k++) { 
+    T dot=0.0;
+    for(int j=0; j< ne; j++) dot+=newrow(occ(j))*ginv(k,j);
+    w(k)=dot;
+  }
+  T baseratio=w(r);
+  Array2 <T> newtmat(ng,np);
+  for(int j=0; j< np; j++) { 
+    T h=newrow(alle[s][j]);
+    for(int k=0; k< ne; k++) h-=w(k)*Me(k,j);
+    h/=baseratio;
+    for(int i=0; i< ng; i++) 
+      newtmat(i,j)=tmat(i,j)+ginv(r,allg[s][i])*h;
+  }
+  table_ratios(newtmat,s,ratios);
+  return baseratio;
+}
+
 //--------
 #endif //CLARK_UPDATES_H_INCLUDED
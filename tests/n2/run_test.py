@@ -47,6 +47,35 @@ for k,v in success.items():
 
 reports.extend(summarize_results(ref_data,dat_properties,success,systems,methods,descriptions))
 
+print("""###########################################
+Checking that VMC with counter-based random numbers does not depend on the
+number of threads.  The reference is the same run with NTHREADS 1.
+################################################""")
+
+for f in ['qw.thread1.log','qw.thread1.config','qw.thread2.log','qw.thread2.config']:
+  try:
+    os.remove(f)
+  except:
+    pass
+
+subprocess.check_output([QW,'qw.thread1'])
+#NTHREADS > 1 is an error without OpenMP
+threaded='needs a build with OpenMP' not in str(subprocess.check_output([QW,'qw.thread2']))
+if not threaded:
+  print("Skipping the NTHREADS 2 run: qwalk was built without OpenMP")
+
+if threaded:
+  ref=json.loads(subprocess.check_output([GOS,'-json','qw.thread1.log']))['properties']
+  dat_properties=json.loads(subprocess.check_output([GOS,'-json','qw.thread2.log']))['properties']
+  for k in ['total_energy','kinetic']:
+    passed=(ref[k]['value'][0]==dat_properties[k]['value'][0] and 
+            ref[k]['error'][0]==dat_properties[k]['error'][0])
+    allsuc.append(passed)
+    reports.append({'system':'n2','method':'vmcthreads','quantity':k,
+      'description':'Checking that VMC with COUNTER_RNG gives the same result with NTHREADS 1 and 2.',
+      'passed':passed,'result':dat_properties[k]['value'][0],'error':dat_properties[k]['error'][0],
+      'reference':ref[k]['value'][0],'err_ref':ref[k]['error'][0]})
+
 print_results(reports)
 save_results(reports)
 
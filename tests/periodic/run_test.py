@@ -0,0 +1,50 @@
+#!/usr/bin/env python
+from __future__ import print_function
+import subprocess
+import json
+import sys
+import os
+
+sys.path.append("../")
+from qwtest import *
+
+reports=[]
+allsuc=[]
+
+print("""###########################################
+Checking the optimized Coulomb break-up for eight H atoms in a skewed cell.
+This tests OPTIMIZED_BREAKUP, including its V_l(0) and V_s(0) self-terms, and
+the incremental electron Ewald energy (EWALD_CHECK stops the run if it drifts).
+The reference is the same walk with the Gaussian Ewald split.
+################################################""")
+
+for f in ['qw.ewald.log','qw.ewald.config','qw.breakup.log','qw.breakup.config']:
+  try:
+    os.remove(f)
+  except:
+    pass
+
+for f in ['qw.ewald','qw.breakup']:
+  out=str(subprocess.check_output([QW,f]))
+  if 'Error' in out:
+    print(out)
+    sys.exit(1)
+
+#Both runs use the same random seed and the walk does not depend on the 
+#potential, so the energies differ only by the error of the break-up.
+ref=json.loads(subprocess.check_output([GOS,'-json','qw.ewald.log']))['properties']
+dat_properties=json.loads(subprocess.check_output([GOS,'-json','qw.breakup.log']))['properties']
+for k in ['total_energy','potential']:
+  passed=abs(ref[k]['value'][0]-dat_properties[k]['value'][0]) < 1e-5
+  allsuc.append(passed)
+  reports.append({'system':'h8cell','method':'breakup','quantity':k,
+    'description':'Checking the optimized Coulomb break-up against the Ewald sum for eight H atoms in a skewed cell.',
+    'passed':passed,'result':dat_properties[k]['value'][0],'error':dat_properties[k]['error'][0],
+    'reference':ref[k]['value'][0],'err_ref':ref[k]['error'][0]})
+
+print_results(reports)
+save_results(reports)
+
+if False in allsuc:
+  sys.exit(1)
+sys.exit(0)
@@ -1,8 +1,10 @@
 from __future__ import print_function
 import csv
 import math
+import os
 
-QW="../../bin/qwalk"
+#QW can point at another build, for example an OpenMP one for the NTHREADS checks.
+QW=os.environ.get("QW","../../bin/qwalk")
 GOS="../../bin/gosling"
 
 def check_errorbars(a,aerr,b,berr,sigma=3):